@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENSL_ES_DESKTOP_H_
+#define OPENSL_ES_DESKTOP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------------*/
+/* Desktop engine options, for slCreateEngine                                */
+/*---------------------------------------------------------------------------*/
+
+/* Number of worker threads which mix tracks in parallel with the audio callback thread,
+ * from 0 (the default, all tracks are mixed by the callback thread) to 8.  With worker threads,
+ * callbacks are always deferred as for SL_DESKTOP_ENGINEOPTION_DEFERREDCALLBACKS, so that the
+ * application is never called back from several threads at once. */
+#define SL_DESKTOP_ENGINEOPTION_MIXERTHREADS    ((SLuint32) 0x00010001)
+
+/* Output device of the engine, one of SL_DESKTOP_DEVICE_*.  SL_DESKTOP_DEVICE_AUDIO renders the
+ * first output mix created, and when that is destroyed, switches to another output mix of the
+ * engine if there is one, without a gap.  The other devices are opened for each output mix as it
+ * is realized, up to 32 at a time, so several output mixes play at once; each is a zone, numbered
+ * from 0 in the order realized, with zone numbers reused as output mixes are destroyed. */
+#define SL_DESKTOP_ENGINEOPTION_DEVICE          ((SLuint32) 0x00010002)
+
+/* Speed of the virtual clock of the null devices, in percent of real time,
+ * or 0 (the default) to render as fast as possible */
+#define SL_DESKTOP_ENGINEOPTION_CLOCK           ((SLuint32) 0x00010003)
+
+/* If SL_BOOLEAN_TRUE, buffer queue and play callbacks of audio players are called on a
+ * dedicated callback thread, rather than by the mixer as each buffer completes; a slow callback
+ * then delays only later callbacks, not the mix.  Callbacks already due when the player is
+ * stopped or its buffer queue is cleared are still delivered afterwards.  An audio player of a
+ * file reads the file from such a callback, so this also keeps file I/O out of the mixer.
+ * The default is SL_BOOLEAN_FALSE. */
+#define SL_DESKTOP_ENGINEOPTION_DEFERREDCALLBACKS ((SLuint32) 0x00010004)
+
+/* Maximum number of audio players which each output mix actually mixes, or 0 (the default) for
+ * no limit.  When more are playing, those with the lowest priority, as set by
+ * Object::SetPriority, and then the lowest gain, are virtual: they keep their place and make
+ * their callbacks, but are silent and cost almost nothing to mix. */
+#define SL_DESKTOP_ENGINEOPTION_MAXVOICES       ((SLuint32) 0x00010005)
+
+/* If SL_BOOLEAN_TRUE (the default), each buffer enqueued on an audio player is scanned for
+ * digital silence, and the mixer only advances past a silent buffer without reading it.  The scan
+ * stops at the first sample which is not silent; SL_BOOLEAN_FALSE saves even that, for
+ * applications which never enqueue silence. */
+#define SL_DESKTOP_ENGINEOPTION_SILENCEDETECTION ((SLuint32) 0x00010006)
+
+/* Frames per period of the output device, the amount mixed at a time, or 0 (the default) for
+ * 256.  SL_DESKTOP_DEVICE_AUDIO and SL_DESKTOP_DEVICE_ALSA may round it to a size they support. */
+#define SL_DESKTOP_ENGINEOPTION_PERIODFRAMES    ((SLuint32) 0x00010007)
+
+/* Periods in the ring buffer of SL_DESKTOP_DEVICE_ALSA, from 2 to 32, or 0 (the default) for 2.
+ * The output latency is about this many periods. */
+#define SL_DESKTOP_ENGINEOPTION_PERIODS         ((SLuint32) 0x00010008)
+
+/* Real-time priority of the thread which renders SL_DESKTOP_DEVICE_ALSA, from 1 to 99 to run
+ * it under SCHED_FIFO, or 0 (the default) for normal scheduling.  If the process is not allowed
+ * to use SCHED_FIFO, the thread runs with normal scheduling and a warning is logged. */
+#define SL_DESKTOP_ENGINEOPTION_PRIORITY        ((SLuint32) 0x00010009)
+
+/* Sample rate of the output device in Hz, from 8000 to 192000, or 0 (the default) for 44100.
+ * The output mix and its effects run at this rate, and audio players are resampled to it.
+ * Realize of the engine fails if the sound card does not support the rate. */
+#define SL_DESKTOP_ENGINEOPTION_SAMPLERATE      ((SLuint32) 0x0001000A)
+
+/* Channels of the output device, from 1 to 8, or 0 (the default) for 2.  The output mix is
+ * stereo: a mono device gets the average of left and right, and a device with more channels gets
+ * left and right on its first two channels, front left and front right, and silence on the
+ * others. */
+#define SL_DESKTOP_ENGINEOPTION_CHANNELS        ((SLuint32) 0x0001000B)
+
+/*---------------------------------------------------------------------------*/
+/* Desktop output devices                                                    */
+/*---------------------------------------------------------------------------*/
+
+/* The sound card, paced by the hardware; this is the default */
+#define SL_DESKTOP_DEVICE_AUDIO                 ((SLuint32) 0x00000000)
+/* No audio hardware: the output mix is rendered at the virtual clock, and discarded */
+#define SL_DESKTOP_DEVICE_NULL                  ((SLuint32) 0x00000001)
+/* As SL_DESKTOP_DEVICE_NULL, but the output mix is written to a 16-bit WAV file at the sample
+ * rate and with the channels of the engine options, named by the environment variable
+ * SL_DESKTOP_WAVFILE, or OpenSLES.wav in the current directory.  Zone 1 uses SL_DESKTOP_WAVFILE1
+ * or OpenSLES1.wav, and so on. */
+#define SL_DESKTOP_DEVICE_WAVFILE               ((SLuint32) 0x00000002)
+/* The sound card through ALSA rather than SDL, if the implementation was built with ALSA: the
+ * output mix is rendered straight into the memory-mapped ring buffer of the PCM named by the
+ * environment variable SL_DESKTOP_ALSA_PCM, or "default".  Zone 1 uses SL_DESKTOP_ALSA_PCM1, and
+ * so on.  For testing without hardware, name the "null" plugin, or a "file" plugin defined in the
+ * ALSA configuration. */
+#define SL_DESKTOP_DEVICE_ALSA                  ((SLuint32) 0x00000003)
+
+/* Audio recorders capture from the audio input device into an SL_DATALOCATOR_BUFFERQUEUE sink,
+ * in its PCM format, with the SL_IID_BUFFERQUEUE interface; a URI sink records nothing.  The
+ * source depends on the output device of the engine.  With SL_DESKTOP_DEVICE_ALSA, and with
+ * SL_DESKTOP_DEVICE_AUDIO if the implementation was built with ALSA, it is the capture PCM named
+ * by the environment variable SL_DESKTOP_ALSA_CAPTURE_PCM, or "default".  With the null devices,
+ * it is the WAV file named by SL_DESKTOP_CAPTUREFILE, which must have the channels of the sink,
+ * and then silence, or only silence; it is paced by the virtual clock, or waits for a buffer if
+ * the clock runs as fast as possible.  Frames captured while no buffer is enqueued are dropped,
+ * and SL_RECORDEVENT_HEADSTALLED is signalled once for each such overrun. */
+
+/*---------------------------------------------------------------------------*/
+/* Desktop Statistics interface                                              */
+/*---------------------------------------------------------------------------*/
+
+/* An explicit interface of the engine, reporting how well the output mix of the engine, the one
+ * SL_DESKTOP_DEVICE_AUDIO would render, keeps up with its device.  The counters are always
+ * maintained; they start from zero when the output mix is realized, and again after
+ * ResetStatistics. */
+extern SL_API const SLInterfaceID SL_IID_DESKTOPSTATISTICS;
+
+/* Number of buckets of the mix time histogram: bucket 0 counts mix times below 2 us,
+ * bucket i counts those from 2^i to 2^(i+1) us, and the last bucket also counts all longer ones */
+#define SL_DESKTOP_MIXTIME_BUCKETS 16
+
+/* Statistics of the output mix of the engine; times are in microseconds */
+typedef struct SLDesktopMixerStatistics_ {
+    SLuint32 fills;             /* periods mixed */
+    SLuint32 period;            /* duration of the last period */
+    SLuint32 lastMixTime;       /* time taken to mix the last period */
+    SLuint32 meanMixTime;
+    SLuint32 maxMixTime;
+    SLuint32 overruns;          /* periods which took longer to mix than their duration */
+    SLuint32 underruns;         /* times an audio player ran out of buffers while playing */
+    SLuint32 meanJitter;        /* how far the interval between the starts of consecutive */
+    SLuint32 maxJitter;         /* periods differed from the duration of a period */
+    SLuint32 workerMisses;      /* periods in which the mixer threads missed their deadline, */
+                                /* after which the callback thread mixes alone for a while */
+    SLuint32 deviceXruns;       /* times the device ran dry or was suspended, and was restarted */
+    SLuint32 mixTimeHistogram[SL_DESKTOP_MIXTIME_BUCKETS];
+} SLDesktopMixerStatistics;
+
+/* Statistics of one audio player */
+typedef struct SLDesktopPlayerStatistics_ {
+    SLuint32 underruns;         /* times it ran out of buffers while playing, as at the end */
+    sl_uint64_t bytesMixed;     /* bytes consumed from its buffer queue, even while virtual */
+} SLDesktopPlayerStatistics;
+
+struct SLDesktopStatisticsItf_;
+typedef const struct SLDesktopStatisticsItf_ * const * SLDesktopStatisticsItf;
+
+struct SLDesktopStatisticsItf_ {
+    /* SL_RESULT_PRECONDITIONS_VIOLATED if the engine has no output mix yet */
+    SLresult (*GetMixerStatistics) (SLDesktopStatisticsItf self,
+        SLDesktopMixerStatistics *pStatistics);
+    /* The player must be a realized audio player with a buffer queue source */
+    SLresult (*GetPlayerStatistics) (SLDesktopStatisticsItf self,
+        SLObjectItf player,
+        SLDesktopPlayerStatistics *pStatistics);
+    /* Restart all counters from zero at the start of the next period */
+    SLresult (*ResetStatistics) (SLDesktopStatisticsItf self);
+    /* Log the mixer statistics every period milliseconds, or never if 0 (the default); the
+     * log is written by the engine's own thread at about 100 ms resolution */
+    SLresult (*SetDumpPeriod) (SLDesktopStatisticsItf self,
+        SLmillisecond period);
+    SLresult (*GetDumpPeriod) (SLDesktopStatisticsItf self,
+        SLmillisecond *pPeriod);
+};
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* OPENSL_ES_DESKTOP_H_ */
@@ -5,6 +5,7 @@ include $(CLEAR_VARS)
 LOCAL_SRC_FILES :=     \
         assert.c          \
         ut/OpenSLESUT.c   \
+        ut/slesutPcm.c    \
         ut/slesutResult.c
 
 LOCAL_C_INCLUDES:= \
@@ -130,7 +130,10 @@
 #define MPH_ANDROIDAUTOMATICGAINCONTROL     91
 #define MPH_ANDROIDNOISESUPPRESSION         92
 
+// Wilhelm desktop extended interfaces, continued
+#define MPH_DESKTOPSTATISTICS            93
+
 // total number of interface IDs
-#define MPH_MAX                          93
+#define MPH_MAX                          94
 
 #endif // !defined(__MPH_H)
@@ -110,6 +110,8 @@ const signed char MPH_to_AudioRecorder[MPH_MAX] = {
     [MPH_ANDROIDACOUSTICECHOCANCELLATION] = 11,
     [MPH_ANDROIDAUTOMATICGAINCONTROL] = 12,
     [MPH_ANDROIDNOISESUPPRESSION] = 13,
+#else
+    [MPH_BUFFERQUEUE] = 9,
 #endif
 #else
 #include "MPH_to_AudioRecorder.h"
@@ -133,7 +135,10 @@ const signed char MPH_to_Engine[MPH_MAX] = {
 #ifdef ANDROID
     [MPH_ANDROIDEFFECTCAPABILITIES] = 11,
 #endif
-    [MPH_XAVIDEODECODERCAPABILITIES] = 12
+    [MPH_XAVIDEODECODERCAPABILITIES] = 12,
+#ifdef USE_OUTPUTMIXEXT
+    [MPH_DESKTOPSTATISTICS] = 13
+#endif
 #else
 #include "MPH_to_Engine.h"
 #endif
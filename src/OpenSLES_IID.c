@@ -259,4 +259,9 @@ const struct SLInterfaceID_ SL_IID_array[MPH_MAX] = {
     { 0xadb80fc0, 0xd622, 0x11e3, 0x927e, { 0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b } },
     // SL_IID_ANDROIDNOISESUPPRESSION
     { 0xbb85ff40, 0xd622, 0x11e3, 0xb770, { 0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b } },
+
+// Wilhelm desktop extended interfaces, continued
+
+    // SL_IID_DESKTOPSTATISTICS
+    { 0x44a10160, 0x6f3b, 0x11e5, 0x9c2d, { 0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b } },
 };
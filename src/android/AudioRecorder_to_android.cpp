@@ -172,6 +172,12 @@ SLresult android_audioRecorder_checkSourceSinkSupport(CAudioRecorder* ar) {
         SLuint32 formatType = *(SLuint32 *)pAudioSnk->pFormat;
         if (SL_DATAFORMAT_PCM == formatType) {
             SLDataFormat_PCM *df_pcm = (SLDataFormat_PCM *)ar->mDataSink.u.mSink.pFormat;
+            // the AudioRecord is 16-bit, and is converted to any sample format slesut handles
+            if (SLESUT_PCM_INVALID == slesutPcmFormatOf(df_pcm)) {
+                SL_LOGE("AudioRecorder unsupported sample format: %u bits in %u-bit container",
+                        df_pcm->bitsPerSample, df_pcm->containerSize);
+                return SL_RESULT_CONTENT_UNSUPPORTED;
+            }
             ar->mSampleRateMilliHz = df_pcm->samplesPerSec;
             ar->mNumChannels = df_pcm->numChannels;
             SL_LOGV("AudioRecorder requested sample rate = %u mHz, %u channel(s)",
@@ -234,21 +240,25 @@ static void audioRecorder_callback(int event, void* user, void *info) {
             BufferHeader *oldFront = ar->mBufferQueue.mFront;
             BufferHeader *newFront = &oldFront[1];
 
-            // FIXME handle 8bit based on buffer format
-            short *pDest = (short*)((char *)oldFront->mBuffer + ar->mBufferQueue.mSizeConsumed);
-            if (ar->mBufferQueue.mSizeConsumed + pBuff->size < oldFront->mSize) {
+            // the AudioRecord delivers 16-bit samples, which are converted to the buffer format
+            char *pDest = (char *)oldFront->mBuffer + ar->mBufferQueue.mSizeConsumed;
+            size_t sampleSize = slesutPcmSampleSize(ar->mPcmFormat);
+            size_t destSize = pBuff->size / sizeof(int16_t) * sampleSize;
+            if (ar->mBufferQueue.mSizeConsumed + destSize < oldFront->mSize) {
                 // can't consume the whole or rest of the buffer in one shot
-                ar->mBufferQueue.mSizeConsumed += pBuff->size;
+                ar->mBufferQueue.mSizeConsumed += destSize;
                 // leave pBuff->size untouched
                 // consume data
                 // FIXME can we avoid holding the lock during the copy?
-                memcpy (pDest, pBuff->i16, pBuff->size);
+                slesutPcmConvert(pDest, ar->mPcmFormat, pBuff->i16, SLESUT_PCM_S16,
+                        pBuff->size / sizeof(int16_t), SLESUT_DITHER_TRIANGULAR, &ar->mDither);
 #ifdef MONITOR_RECORDING
                 if (NULL != gMonitorFp) { fwrite(pBuff->i16, pBuff->size, 1, gMonitorFp); }
 #endif
             } else {
                 // finish pushing the buffer or push the buffer in one shot
-                pBuff->size = oldFront->mSize - ar->mBufferQueue.mSizeConsumed;
+                destSize = oldFront->mSize - ar->mBufferQueue.mSizeConsumed;
+                pBuff->size = destSize / sampleSize * sizeof(int16_t);
                 ar->mBufferQueue.mSizeConsumed = 0;
                 if (newFront == &ar->mBufferQueue.mArray[ar->mBufferQueue.mNumBuffers + 1]) {
                     newFront = ar->mBufferQueue.mArray;
@@ -259,7 +269,14 @@ static void audioRecorder_callback(int event, void* user, void *info) {
                 ar->mBufferQueue.mState.playIndex++;
                 // consume data
                 // FIXME can we avoid holding the lock during the copy?
-                memcpy (pDest, pBuff->i16, pBuff->size);
+                slesutPcmConvert(pDest, ar->mPcmFormat, pBuff->i16, SLESUT_PCM_S16,
+                        pBuff->size / sizeof(int16_t), SLESUT_DITHER_TRIANGULAR, &ar->mDither);
+                // a buffer which isn't a whole number of samples ends with a partial sample,
+                // which is returned as zero rather than left uninitialized
+                size_t partial = destSize % sampleSize;
+                if (0 < partial) {
+                    memset(pDest + destSize - partial, 0, partial);
+                }
 #ifdef MONITOR_RECORDING
                 if (NULL != gMonitorFp) { fwrite(pBuff->i16, pBuff->size, 1, gMonitorFp); }
 #endif
@@ -402,6 +419,14 @@ SLresult android_audioRecorder_realize(CAudioRecorder* ar, SLboolean async) {
 
     SL_LOGV("new AudioRecord %u channels, %u mHz", ar->mNumChannels, ar->mSampleRateMilliHz);
 
+    // the AudioRecord is always 16-bit, and the callback converts to the buffer queue format
+    ar->mPcmFormat = slesutPcmFormatOf(&ar->mDataSink.mFormat.mPCM);
+    if (SLESUT_PCM_INVALID == ar->mPcmFormat) {
+        SL_LOGE("android_audioRecorder_realize(%p) unsupported buffer queue format", ar);
+        return SL_RESULT_CONTENT_UNSUPPORTED;
+    }
+    slesutDitherInit(&ar->mDither, (SLuint32) (uintptr_t) ar);
+
     // currently nothing analogous to canUseFastTrack() for recording
     audio_input_flags_t policy = AUDIO_INPUT_FLAG_FAST;
 
@@ -409,7 +434,7 @@ SLresult android_audioRecorder_realize(CAudioRecorder* ar, SLboolean async) {
     ar->mAudioRecord = new android::AudioRecord();
     ar->mAudioRecord->set(ar->mRecordSource, // source
             sles_to_android_sampleRate(ar->mSampleRateMilliHz), // sample rate in Hertz
-            AUDIO_FORMAT_PCM_16_BIT,   //FIXME use format from buffer queue sink
+            AUDIO_FORMAT_PCM_16_BIT,   // converted to the buffer queue format in the callback
             sles_to_android_channelMaskIn(ar->mNumChannels, 0 /*no channel mask*/),
                                    // channel config
             0,                     //frameCount min
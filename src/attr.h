@@ -30,8 +30,11 @@
 #define ATTR_INDEX_BQ_ENQUEUE  3 // (buffer queue non-empty and in playing state) became true
 #define ATTR_INDEX_ABQ_ENQUEUE 4 // Android buffer queue became non-empty and in playing state
 #define ATTR_INDEX_PLAY_STATE  5 // play: play state
-#define ATTR_INDEX_UNUSED6     6 // reserved for future use
-#define ATTR_INDEX_UNUSED7     7 // reserved for future use
+#define ATTR_INDEX_3D          6 // 3D location, 3D source, 3D Doppler: position, orientation,
+                                 // velocity, rolloff, cone
+#define ATTR_INDEX_RATE        7 // playback rate: rate, properties
+                                 // rate pitch: rate
+                                 // pitch: pitch
 #define ATTR_INDEX_MAX         8 // total number of bits used so far
 
 // bit masks, used with unlock_exclusive_attributes
@@ -43,5 +46,5 @@
 #define ATTR_BQ_ENQUEUE  (1 << ATTR_INDEX_BQ_ENQUEUE)
 #define ATTR_ABQ_ENQUEUE (1 << ATTR_INDEX_ABQ_ENQUEUE)
 #define ATTR_PLAY_STATE  (1 << ATTR_INDEX_PLAY_STATE)
-#define ATTR_UNUSED6     (1 << ATTR_INDEX_UNUSED6)
-#define ATTR_UNUSED7     (1 << ATTR_INDEX_UNUSED7)
+#define ATTR_3D          (1 << ATTR_INDEX_3D)
+#define ATTR_RATE        (1 << ATTR_INDEX_RATE)
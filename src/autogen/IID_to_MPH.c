@@ -129,7 +129,7 @@ int IID_to_MPH(const SLInterfaceID iid)
         -1,
         MPH_XADYNAMICSOURCE,
         -1,
-        -1,
+        MPH_DESKTOPSTATISTICS,
         MPH_XACAMERA,
         -1,
         MPH_XAVIBRA,
@@ -3,4 +3,4 @@
  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  1,
  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0, -1,  2, -1,  6, -1, -1, -1,
-  5, -1,  3, -1, -1, -1, -1, -1, -1,  4, -1, -1, -1
+  5, -1,  3, -1, -1, -1, -1, -1, -1,  4, -1, -1, -1, -1
@@ -1,6 +1,6 @@
 // This file is automagically generated by mphtogen, do not edit
  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  9, -1, -1,  1, -1, -1, -1, -1,  4,  5,
  -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  2, -1, -1, -1, -1,  6, -1, -1, -1, -1,
- -1,  7, 10,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+ -1,  7, 10,  8,  3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
- -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
@@ -132,6 +132,10 @@ static const struct iid_vtable AudioRecorder_interfaces[INTERFACES_AudioRecorder
     {MPH_ANDROIDAUTOMATICGAINCONTROL, INTERFACE_OPTIONAL, offsetof(CAudioRecorder,
                                                                    mAutomaticGainControl)},
     {MPH_ANDROIDNOISESUPPRESSION, INTERFACE_OPTIONAL, offsetof(CAudioRecorder, mNoiseSuppression)},
+#elif defined(USE_OUTPUTMIXEXT)
+    {MPH_BUFFERQUEUE, INTERFACE_EXPLICIT, offsetof(CAudioRecorder, mBufferQueue)},
+#else
+    {MPH_BUFFERQUEUE, INTERFACE_UNAVAILABLE, 0},
 #endif
 };
 
@@ -173,9 +177,16 @@ static const struct iid_vtable Engine_interfaces[INTERFACES_Engine] = {
 #ifdef ANDROID
     {MPH_ANDROIDEFFECTCAPABILITIES, INTERFACE_EXPLICIT,
         offsetof(CEngine, mAndroidEffectCapabilities)},
+#else
+    {MPH_ANDROIDEFFECTCAPABILITIES, INTERFACE_UNAVAILABLE, 0},
 #endif
     {MPH_XAVIDEODECODERCAPABILITIES, INTERFACE_EXPLICIT,
         offsetof(CEngine, mVideoDecoderCapabilities)},
+#ifdef USE_OUTPUTMIXEXT
+    {MPH_DESKTOPSTATISTICS, INTERFACE_EXPLICIT, offsetof(CEngine, mDesktopStatistics)},
+#else
+    {MPH_DESKTOPSTATISTICS, INTERFACE_UNAVAILABLE, 0},
+#endif
 };
 
 static const ClassTable CEngine_class = {
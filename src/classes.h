@@ -82,6 +82,8 @@
     // implementation-specific data for this instance
 #ifdef USE_OUTPUTMIXEXT
     Track *mTrack;
+    Resampler *mResampler;          ///< Owned by the audio player, used by mTrack if non-NULL
+    Stretch *mStretch;              ///< Likewise
     float mGains[STEREO_CHANNELS];  ///< Computed gain based on volume, mute, solo, stereo position
     SLboolean mDestroyRequested;    ///< Mixer to acknowledge application's call to Object::Destroy
 #endif
@@ -122,7 +124,7 @@
 #ifdef ANDROID
 #define INTERFACES_AudioRecorder 14 // see MPH_to_AudioRecorder in MPH_to.c for list of interfaces
 #else
-#define INTERFACES_AudioRecorder 9  // see MPH_to_AudioRecorder in MPH_to.c for list of interfaces
+#define INTERFACES_AudioRecorder 10 // see MPH_to_AudioRecorder in MPH_to.c for list of interfaces
 #endif
     SLuint8 mInterfaceStates2[INTERFACES_AudioRecorder - INTERFACES_Default];
     IDynamicInterfaceManagement mDynamicInterfaceManagement;
@@ -140,6 +142,8 @@
     IAndroidAcousticEchoCancellation  mAcousticEchoCancellation;
     IAndroidAutomaticGainControl mAutomaticGainControl;
     IAndroidNoiseSuppression mNoiseSuppression;
+#elif defined(USE_OUTPUTMIXEXT)
+    IBufferQueue mBufferQueue;
 #endif
     // remaining are per-instance private fields not associated with an interface
     DataLocatorFormat mDataSource;
@@ -156,17 +160,20 @@
     android::sp<android::CallbackProtector> mCallbackProtector;
     audio_source_t mRecordSource;
 #endif
+#if defined(ANDROID) || defined(USE_OUTPUTMIXEXT)
+    slesutPcmFormat mPcmFormat;     // sample format of the buffer queue, converted from 16-bit
+    slesutDitherState mDither;      // for conversion to 8-bit
+#endif
+#ifdef USE_OUTPUTMIXEXT
+    CaptureDevice mCaptureDevice;   // captures into mBufferQueue
+#endif
 } /*CAudioRecorder*/;
 
 
 /*typedef*/ struct CEngine_struct {
     // mandated implicit interfaces
     IObject mObject;
-#ifdef ANDROID
-#define INTERFACES_Engine 13 // see MPH_to_Engine in MPH_to.c for list of interfaces
-#else
-#define INTERFACES_Engine 12 // see MPH_to_Engine in MPH_to.c for list of interfaces
-#endif
+#define INTERFACES_Engine 14 // see MPH_to_Engine in MPH_to.c for list of interfaces
     SLuint8 mInterfaceStates2[INTERFACES_Engine - INTERFACES_Default];
     IDynamicInterfaceManagement mDynamicInterfaceManagement;
     IEngine mEngine;
@@ -186,9 +193,15 @@
 #endif
     // OpenMAX AL explicit interfaces
     IVideoDecoderCapabilities mVideoDecoderCapabilities;
+#ifdef USE_OUTPUTMIXEXT
+    IDesktopStatistics mDesktopStatistics;
+#endif
     // remaining are per-instance private fields not associated with an interface
     ThreadPool mThreadPool; // for asynchronous operations
     pthread_t mSyncThread;
+#ifdef USE_OUTPUTMIXEXT
+    Spatial mSpatial;       // 3D listener and voices of every output mix
+#endif
 #if defined(ANDROID)
     // FIXME number of presets will only be saved in IEqualizer, preset names will not be stored
     SLuint32 mEqNumPresets;
@@ -207,7 +220,7 @@ typedef struct {
     SLuint32 mDeviceID;
 } CLEDDevice;
 
-typedef struct {
+/*typedef*/ struct CListener_struct {
     // mandated interfaces
     IObject mObject;
 #define INTERFACES_Listener 4 // see MPH_to_Listener in MPH_to.c for list of interfaces
@@ -216,7 +229,7 @@ typedef struct {
     I3DDoppler m3DDoppler;
     I3DLocation m3DLocation;
     // remaining are per-instance private fields not associated with an interface
-} CListener;
+} /*CListener*/;
 
 typedef struct {
     // mandated interfaces
@@ -295,6 +308,14 @@ typedef struct {
     IAndroidEffect mAndroidEffect;
 #endif
     // remaining are per-instance private fields not associated with an interface
+#ifdef USE_OUTPUTMIXEXT
+    // unless the engine's device is SL_DESKTOP_DEVICE_AUDIO, each output mix has its own device
+    unsigned mZone;         // which of the engine's devices, see COutputMix_openDevice
+    NullDevice mNullDevice; // renders the output mix if there is no audio hardware
+#ifdef USE_ALSA
+    AlsaDevice mAlsaDevice; // renders the output mix into an ALSA PCM
+#endif
+#endif
 } /*COutputMix*/;
 
 typedef struct {
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file ALSA.c ALSA output device */
+
+#include "sles_allinclusive.h"
+#include <sched.h>
+
+
+// The ALSA device takes the place of SDL_callback, like the null device, but it is paced by the
+// sound card.  Each period is mixed straight into the PCM's ring buffer, as mapped by
+// snd_pcm_mmap_begin, so there is no copy between the output mix and the hardware, and no
+// buffering beyond the periods asked for by the engine options.  The stream starts itself once
+// the ring is full.  An underrun or a suspend is recovered from by preparing the stream again,
+// which refills the ring with the next periods; only an error which ALSA can't recover from
+// stops the device, and then the output mix is no longer rendered.  Each output mix has its own
+// ALSA device, on its own PCM.
+
+#define AlsaDevice_PCM "default"        // PCM if SL_DESKTOP_ALSA_PCM is not set
+#define AlsaDevice_NAME_MAX 32          // characters in the name of a variable, with the zone
+#define AlsaDevice_WAIT_MS 100          // how long to wait for the device between shutdown checks
+
+
+/** \brief Recover from an error returned by the PCM, and return whether rendering can go on.
+ *  An xrun is only counted, in the mixer statistics and for the log at close, as logging from
+ *  this thread could make it miss the next period too.
+ */
+
+static SLboolean AlsaDevice_recover(COutputMix *outputMix, int err)
+{
+    AlsaDevice *alsaDevice = &outputMix->mAlsaDevice;
+    if (-EPIPE == err || -ESTRPIPE == err) {
+        ++alsaDevice->mXruns;
+        // the statistics are only used by the thread which fills the output mix, which is us
+        ++outputMix->mOutputMixExt.mStatistics.mCounters.deviceXruns;
+    }
+    // snd_pcm_recover handles an underrun and a suspend, and fails for anything else
+    int result = snd_pcm_recover(alsaDevice->mPcm, err, 1);
+    if (0 > result) {
+        SL_LOGE("ALSA device stopped after %s: %s", snd_strerror(err), snd_strerror(result));
+        return SL_BOOLEAN_FALSE;
+    }
+    return SL_BOOLEAN_TRUE;
+}
+
+
+/** \brief Entry point of the thread which renders the output mix */
+
+static void *AlsaDevice_render(void *arg)
+{
+    COutputMix *outputMix = (COutputMix *) arg;
+    const IEngine *thisEngine = &outputMix->mObject.mEngine->mEngine;
+    AlsaDevice *alsaDevice = &outputMix->mAlsaDevice;
+    SLOutputMixExtItf OutputMixExt = &outputMix->mOutputMixExt.mItf;
+    snd_pcm_t *pcm = alsaDevice->mPcm;
+    snd_pcm_uframes_t periodFrames = alsaDevice->mPeriodFrames;
+    // const after the engine is created, no lock needed
+    SLuint32 frameSize = thisEngine->mChannels * sizeof(short);
+    while (!atomic_load_acquire(&alsaDevice->mShutdown)) {
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(pcm);
+        if (0 > avail) {
+            if (!AlsaDevice_recover(outputMix, (int) avail)) {
+                break;
+            }
+            continue;
+        }
+        if ((snd_pcm_uframes_t) avail < periodFrames) {
+            // the ring is full until the device has played another period
+            int err = snd_pcm_wait(pcm, AlsaDevice_WAIT_MS);
+            if (0 > err && !AlsaDevice_recover(outputMix, err)) {
+                break;
+            }
+            continue;
+        }
+        // mix a period in place, in two parts if it wraps around the end of the ring
+        snd_pcm_uframes_t remaining = periodFrames;
+        int err = 0;
+        while (0 < remaining) {
+            const snd_pcm_channel_area_t *areas;
+            snd_pcm_uframes_t offset, frames = remaining;
+            err = snd_pcm_mmap_begin(pcm, &areas, &offset, &frames);
+            if (0 > err) {
+                break;
+            }
+            // the access is interleaved, so the area of the first channel addresses the frames
+            void *ring = (char *) areas[0].addr + (areas[0].first + offset * areas[0].step) / 8;
+            IOutputMixExt_FillBuffer(OutputMixExt, ring, (SLuint32) frames * frameSize);
+            snd_pcm_sframes_t committed = snd_pcm_mmap_commit(pcm, offset, frames);
+            if (0 > committed || (snd_pcm_uframes_t) committed != frames) {
+                // a short commit means the device ran dry while we were mixing
+                err = 0 > committed ? (int) committed : -EPIPE;
+                break;
+            }
+            alsaDevice->mFrames += frames;
+            remaining -= frames;
+        }
+        if (0 > err && !AlsaDevice_recover(outputMix, err)) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+
+/** \brief Configure the PCM for 16-bit samples at the sample rate and with the channels of the
+ *  engine options, with memory-mapped interleaved access and the period and buffer sizes of the
+ *  engine options.  Returns 0 or a negative error code of ALSA.
+ */
+
+static int AlsaDevice_configure(AlsaDevice *alsaDevice, const IEngine *thisEngine)
+{
+    snd_pcm_t *pcm = alsaDevice->mPcm;
+    snd_pcm_uframes_t periodFrames = thisEngine->mPeriodFrames;
+    unsigned periods = thisEngine->mPeriods;
+    snd_pcm_uframes_t bufferFrames;
+    int dir = 0;
+    snd_pcm_hw_params_t *hwParams;
+    snd_pcm_hw_params_alloca(&hwParams);
+    int err;
+    if (0 > (err = snd_pcm_hw_params_any(pcm, hwParams)) ||
+            0 > (err = snd_pcm_hw_params_set_access(pcm, hwParams,
+                SND_PCM_ACCESS_MMAP_INTERLEAVED)) ||
+            0 > (err = snd_pcm_hw_params_set_format(pcm, hwParams, SND_PCM_FORMAT_S16)) ||
+            0 > (err = snd_pcm_hw_params_set_channels(pcm, hwParams, thisEngine->mChannels)) ||
+            0 > (err = snd_pcm_hw_params_set_rate(pcm, hwParams, thisEngine->mSampleRate, 0))) {
+        SL_LOGE("ALSA device does not support mmap of %u 16-bit channels at %u Hz: %s",
+            thisEngine->mChannels, thisEngine->mSampleRate, snd_strerror(err));
+        return err;
+    }
+    if (0 > (err = snd_pcm_hw_params_set_period_size_near(pcm, hwParams, &periodFrames,
+                &dir)) ||
+            0 > (err = snd_pcm_hw_params_set_periods_near(pcm, hwParams, &periods, &dir)) ||
+            0 > (err = snd_pcm_hw_params(pcm, hwParams)) ||
+            0 > (err = snd_pcm_hw_params_get_period_size(hwParams, &periodFrames, &dir)) ||
+            0 > (err = snd_pcm_hw_params_get_buffer_size(hwParams, &bufferFrames))) {
+        SL_LOGE("ALSA device does not support %lu frames per period: %s",
+            (unsigned long) periodFrames, snd_strerror(err));
+        return err;
+    }
+    // periods are only mixed whole, so the ring is full at the last whole period
+    snd_pcm_sw_params_t *swParams;
+    snd_pcm_sw_params_alloca(&swParams);
+    if (0 > (err = snd_pcm_sw_params_current(pcm, swParams)) ||
+            0 > (err = snd_pcm_sw_params_set_avail_min(pcm, swParams, periodFrames)) ||
+            0 > (err = snd_pcm_sw_params_set_start_threshold(pcm, swParams,
+                bufferFrames / periodFrames * periodFrames)) ||
+            0 > (err = snd_pcm_sw_params(pcm, swParams))) {
+        SL_LOGE("ALSA device software parameters failed: %s", snd_strerror(err));
+        return err;
+    }
+    alsaDevice->mPeriodFrames = periodFrames;
+    alsaDevice->mBufferFrames = bufferFrames;
+    return 0;
+}
+
+
+/** \brief Create a thread for an ALSA PCM, under SCHED_FIFO at the priority of the engine option
+ *  if it is not zero and the process is allowed to, otherwise with normal scheduling.  Returns 0
+ *  or an error number of pthread_create.
+ */
+
+int AlsaDevice_startThread(pthread_t *thread, void *(*run)(void *), void *arg, SLuint32 priority)
+{
+    int err = 0;
+    if (0 < priority) {
+        pthread_attr_t attr;
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = (int) priority;
+        (void) pthread_attr_init(&attr);
+        (void) pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        (void) pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        (void) pthread_attr_setschedparam(&attr, &param);
+        err = pthread_create(thread, &attr, run, arg);
+        (void) pthread_attr_destroy(&attr);
+        if (EPERM == err) {
+            SL_LOGW("not permitted to use SCHED_FIFO priority %u for an ALSA device", priority);
+        }
+    }
+    if (0 == priority || EPERM == err) {
+        err = pthread_create(thread, (const pthread_attr_t *) NULL, run, arg);
+    }
+    return err;
+}
+
+
+/** \brief Called by COutputMix_Realize to start the ALSA device of an output mix, instead of
+ *  SDL_open.  Output mixes after the first name their PCMs by SL_DESKTOP_ALSA_PCM1 and so on,
+ *  see COutputMix::mZone.
+ */
+
+SLresult AlsaDevice_open(COutputMix *outputMix)
+{
+    AlsaDevice *alsaDevice = &outputMix->mAlsaDevice;
+    assert(!alsaDevice->mStarted);
+    alsaDevice->mShutdown = SL_BOOLEAN_FALSE;
+    alsaDevice->mFrames = 0;
+    alsaDevice->mXruns = 0;
+    // const after the engine is created, no lock needed
+    const IEngine *thisEngine = &outputMix->mObject.mEngine->mEngine;
+    char variable[AlsaDevice_NAME_MAX];
+    if (0 == outputMix->mZone) {
+        snprintf(variable, sizeof(variable), "SL_DESKTOP_ALSA_PCM");
+    } else {
+        snprintf(variable, sizeof(variable), "SL_DESKTOP_ALSA_PCM%u", outputMix->mZone);
+    }
+    const char *name = getenv(variable);
+    if (NULL == name || '\0' == *name) {
+        name = AlsaDevice_PCM;
+    }
+    int err = snd_pcm_open(&alsaDevice->mPcm, name, SND_PCM_STREAM_PLAYBACK, 0);
+    if (0 > err) {
+        SL_LOGE("unable to open ALSA PCM %s: %s", name, snd_strerror(err));
+        alsaDevice->mPcm = NULL;
+        return SL_RESULT_IO_ERROR;
+    }
+    if (0 > AlsaDevice_configure(alsaDevice, thisEngine)) {
+        (void) snd_pcm_close(alsaDevice->mPcm);
+        alsaDevice->mPcm = NULL;
+        return SL_RESULT_CONTENT_UNSUPPORTED;
+    }
+    SL_LOGI("ALSA PCM %s for zone %u: %lu frames per period, %lu frames in the ring", name,
+        outputMix->mZone,
+        (unsigned long) alsaDevice->mPeriodFrames, (unsigned long) alsaDevice->mBufferFrames);
+    err = AlsaDevice_startThread(&alsaDevice->mThread, AlsaDevice_render, outputMix,
+        thisEngine->mPriority);
+    SLresult result = err_to_result(err);
+    if (SL_RESULT_SUCCESS != result) {
+        (void) snd_pcm_close(alsaDevice->mPcm);
+        alsaDevice->mPcm = NULL;
+        return result;
+    }
+    alsaDevice->mStarted = SL_BOOLEAN_TRUE;
+    return SL_RESULT_SUCCESS;
+}
+
+
+/** \brief Called during Object::Destroy for an output mix to stop its ALSA device, if it was
+ *  started.  The output mix is unlocked, as the device needs the lock to finish its period.
+ */
+
+void AlsaDevice_close(COutputMix *outputMix)
+{
+    AlsaDevice *alsaDevice = &outputMix->mAlsaDevice;
+    if (!alsaDevice->mStarted) {
+        return;
+    }
+    atomic_store_release(&alsaDevice->mShutdown, SL_BOOLEAN_TRUE);
+    (void) pthread_join(alsaDevice->mThread, (void **) NULL);
+    alsaDevice->mStarted = SL_BOOLEAN_FALSE;
+    SL_LOGI("ALSA device %u rendered %llu frames with %u xruns", outputMix->mZone,
+        alsaDevice->mFrames, alsaDevice->mXruns);
+    (void) snd_pcm_drop(alsaDevice->mPcm);
+    (void) snd_pcm_close(alsaDevice->mPcm);
+    alsaDevice->mPcm = NULL;
+}
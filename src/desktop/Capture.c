@@ -0,0 +1,693 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file Capture.c Capture device of an audio recorder */
+
+#include "sles_allinclusive.h"
+#include <time.h>
+
+
+// The capture device takes the place of the AudioRecord callback on Android.  Each realized audio
+// recorder with a buffer queue sink has its own capture thread, and the buffer queue is its ring:
+// frames are captured straight into the application's buffer at the front of the queue, after
+// what the buffer already holds, and the buffer is returned to the application as soon as it is
+// full.  The audio recorder is only locked while the thread decides where a period goes and while
+// it accounts for it afterwards, not while capturing, so the application can enqueue meanwhile.
+// The play position, markers, and duration limit all count the frames which reach a buffer.
+// While the queue is empty, or the source loses frames, the frames are dropped, and the overrun
+// is signalled by SL_RECORDEVENT_HEADSTALLED, as on Android.
+//
+// With the null devices, the source is the WAV file named by SL_DESKTOP_CAPTUREFILE, or silence,
+// paced by the virtual clock; if the clock runs as fast as possible, it waits for the application
+// instead, so it never overruns.  With ALSA, the source is an ALSA capture PCM, which also serves
+// SL_DESKTOP_DEVICE_AUDIO as SDL has no capture.
+//
+// While there is nothing to capture, the thread waits on the audio recorder's condition variable,
+// which Record::SetRecordState, BufferQueue::Enqueue, BufferQueue::Clear, and CaptureDevice_close
+// broadcast after changing what it waits for.
+
+#define CaptureDevice_RESYNC_PERIODS 8      // periods late before the clock stops catching up
+#define CaptureDevice_ALSA_PCM "default"    // PCM if SL_DESKTOP_ALSA_CAPTURE_PCM is not set
+#define CaptureDevice_WAIT_MS 100           // how long to wait for ALSA between checks for requests
+
+
+/** \brief Return the monotonic clock in nanoseconds */
+
+static long long CaptureDevice_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+/** \brief Called with the audio recorder locked, to acknowledge a BufferQueue::Clear.  The capture
+ *  thread is between periods, so none of the buffers is being captured into.
+ */
+
+static void CaptureDevice_acknowledgeClear(CAudioRecorder *audioRecorder)
+{
+    IBufferQueue *bufferQueue = &audioRecorder->mBufferQueue;
+    bufferQueue->mFront = &bufferQueue->mArray[0];
+    bufferQueue->mRear = &bufferQueue->mArray[0];
+    bufferQueue->mState.count = 0;
+    bufferQueue->mState.playIndex = 0;
+    bufferQueue->mClearRequested = SL_BOOLEAN_FALSE;
+    audioRecorder->mCaptureDevice.mOffset = 0;
+    object_cond_broadcast(&audioRecorder->mObject);
+}
+
+
+/** \brief Called with the audio recorder locked while recording, to decide where the next period
+ *  goes: into the buffer at the front of the queue, which *front is set to, or nowhere if the
+ *  queue is empty.  Returns the number of frames to capture, which stops short of the end of the
+ *  buffer and of the duration limit.  At the limit, recording stops instead, and
+ *  SL_RECORDEVENT_HEADATLIMIT is added to *events.
+ */
+
+static SLuint32 CaptureDevice_plan(CAudioRecorder *audioRecorder, BufferHeader **front,
+    SLuint32 *events)
+{
+    CaptureDevice *capture = &audioRecorder->mCaptureDevice;
+    IRecord *thisRecord = &audioRecorder->mRecord;
+    IBufferQueue *bufferQueue = &audioRecorder->mBufferQueue;
+    unsigned frameSize = audioRecorder->mNumChannels *
+        slesutPcmSampleSize(audioRecorder->mPcmFormat);
+    SLuint32 frames = capture->mPeriodFrames;
+    *front = NULL;
+    if (bufferQueue->mFront != bufferQueue->mRear) {
+        *front = bufferQueue->mFront;
+        SLuint32 room = ((*front)->mSize - capture->mOffset) / frameSize;
+        if (room < frames) {
+            frames = room;
+        }
+    }
+    SLmillisecond limit = thisRecord->mDurationLimit;
+    if (0 != limit) {
+        unsigned long long limitFrames = (unsigned long long) limit *
+            audioRecorder->mSampleRateMilliHz / 1000000ULL;
+        if (capture->mFrames >= limitFrames) {
+            atomic_store_release(&thisRecord->mState, SL_RECORDSTATE_STOPPED);
+            *events |= SL_RECORDEVENT_HEADATLIMIT;
+            *front = NULL;
+            return 0;
+        }
+        if (NULL != *front && limitFrames - capture->mFrames < frames) {
+            frames = (SLuint32) (limitFrames - capture->mFrames);
+        }
+    }
+    return frames;
+}
+
+
+/** \brief Called with the audio recorder locked while recording, to account for the frames
+ *  captured into front, or dropped if it is NULL.  If that fills the buffer, it is removed from
+ *  the queue and *callback is set to the buffer queue callback.  Returns the record events which
+ *  are now due; the caller delivers them after unlocking.
+ */
+
+static SLuint32 CaptureDevice_commit(CAudioRecorder *audioRecorder, BufferHeader *front,
+    SLuint32 frames, SLboolean overrun, slBufferQueueCallback *callback)
+{
+    CaptureDevice *capture = &audioRecorder->mCaptureDevice;
+    IRecord *thisRecord = &audioRecorder->mRecord;
+    IBufferQueue *bufferQueue = &audioRecorder->mBufferQueue;
+    SLuint32 events = 0;
+    // an overrun is signalled once, and not again until frames reach a buffer
+    SLboolean dropped = NULL == front && 0 < frames;
+    if (dropped) {
+        capture->mDropped += frames;
+    }
+    if (overrun || dropped) {
+        if (!capture->mStalled) {
+            capture->mStalled = SL_BOOLEAN_TRUE;
+            ++capture->mOverruns;
+            events |= SL_RECORDEVENT_HEADSTALLED;
+        }
+    } else if (0 < frames) {
+        capture->mStalled = SL_BOOLEAN_FALSE;
+    }
+    if (NULL == front) {
+        return events;
+    }
+    unsigned frameSize = audioRecorder->mNumChannels *
+        slesutPcmSampleSize(audioRecorder->mPcmFormat);
+    capture->mOffset += frames * frameSize;
+    if (front->mSize - capture->mOffset < frameSize) {
+        // the buffer is full, so give it back; the application only enqueues at the rear, and
+        // the front is only advanced here, with the audio recorder locked
+        BufferHeader *newFront = front + 1;
+        if (newFront == &bufferQueue->mArray[bufferQueue->mNumBuffers + 1]) {
+            newFront = bufferQueue->mArray;
+        }
+        atomic_store_release(&bufferQueue->mFront, newFront);
+        assert(0 < bufferQueue->mState.count);
+        atomic_dec_release(&bufferQueue->mState.count);
+        atomic_inc_release(&bufferQueue->mState.playIndex);
+        capture->mOffset = 0;
+        *callback = bufferQueue->mCallback;
+    }
+    if (0 == frames) {
+        return events;
+    }
+    capture->mFrames += frames;
+    capture->mFramesSincePositionUpdate += frames;
+    SLuint32 sampleRateMilliHz = audioRecorder->mSampleRateMilliHz;
+    SLmillisecond oldPosition = thisRecord->mPosition;
+    // this will overflow after 49 days, but no fix possible as it's part of the API
+    SLmillisecond position = (SLmillisecond) (capture->mFrames * 1000000ULL / sampleRateMilliHz);
+    thisRecord->mPosition = position;
+    // the marker is reached once as the position moves forward past it
+    SLmillisecond markerPosition = thisRecord->mMarkerPosition;
+    if ((SL_TIME_UNKNOWN != markerPosition) && (oldPosition < markerPosition) &&
+            (markerPosition <= position)) {
+        events |= SL_RECORDEVENT_HEADATMARKER;
+    }
+    // as for audio players, a late update is reported as lost updates rather than as jitter
+    SLuint32 frameUpdatePeriod = (SLuint32) ((unsigned long long)
+        thisRecord->mPositionUpdatePeriod * sampleRateMilliHz / 1000000ULL);
+    if ((0 != frameUpdatePeriod) &&
+            (capture->mFramesSincePositionUpdate >= frameUpdatePeriod)) {
+        if ((capture->mFramesSincePositionUpdate -= frameUpdatePeriod) >= frameUpdatePeriod) {
+            capture->mFramesSincePositionUpdate %= frameUpdatePeriod;
+        }
+        events |= SL_RECORDEVENT_HEADATNEWPOS;
+    }
+    return events;
+}
+
+
+#ifdef USE_ALSA
+
+/** \brief Capture up to the specified frames from the ALSA PCM into dst.  Returns the number of
+ *  frames captured, which is zero if none came in time, or negative if the PCM has failed.  An
+ *  overrun of the PCM's ring loses frames, so it is recovered from and reported in *overrun.
+ */
+
+static long CaptureDevice_readAlsa(CaptureDevice *capture, void *dst, SLuint32 frames,
+    SLboolean *overrun)
+{
+    snd_pcm_t *pcm = capture->mPcm;
+    int err = snd_pcm_wait(pcm, CaptureDevice_WAIT_MS);
+    if (0 == err) {
+        return 0;
+    }
+    if (0 < err) {
+        snd_pcm_sframes_t count = snd_pcm_readi(pcm, dst, frames);
+        if (0 <= count) {
+            return (long) count;
+        }
+        err = (int) count;
+    }
+    if (-EPIPE == err || -ESTRPIPE == err) {
+        *overrun = SL_BOOLEAN_TRUE;
+    }
+    // snd_pcm_recover handles an overrun and a suspend, and fails for anything else; a capture
+    // stream then needs to be started again
+    if (0 > snd_pcm_recover(pcm, err, 1) || 0 > snd_pcm_start(pcm)) {
+        SL_LOGE("ALSA capture device stopped: %s", snd_strerror(err));
+        return -1;
+    }
+    SL_LOGW("ALSA capture device recovered from %s", snd_strerror(err));
+    return 0;
+}
+
+#endif
+
+
+/** \brief Capture the specified frames from the source into dst, in the sample format of the
+ *  buffer queue, or into the scratch buffer to be dropped if dst is NULL.  Returns the number of
+ *  frames captured, or negative if the source has failed, and sets *overrun if the source lost
+ *  frames.
+ */
+
+static long CaptureDevice_read(CAudioRecorder *audioRecorder, void *dst, SLuint32 frames,
+    SLboolean *overrun)
+{
+    CaptureDevice *capture = &audioRecorder->mCaptureDevice;
+#ifdef USE_ALSA
+    if (NULL != capture->mPcm) {
+        // ALSA converts to the sample format of the buffer queue itself
+        return CaptureDevice_readAlsa(capture, NULL != dst ? dst : capture->mScratch, frames,
+            overrun);
+    }
+#endif
+    // the file is read as 16-bit, straight into the buffer if that is 16-bit too
+    unsigned channels = audioRecorder->mNumChannels;
+    slesutPcmFormat format = audioRecorder->mPcmFormat;
+    short *pcm = NULL != dst && SLESUT_PCM_S16 == format ? (short *) dst :
+        (short *) capture->mScratch;
+    SLuint32 count = 0;
+#ifdef USE_SNDFILE
+    if (NULL != capture->mSNDFILE) {
+        sf_count_t count_ = sf_readf_short(capture->mSNDFILE, pcm, (sf_count_t) frames);
+        if (0 < count_) {
+            count = (SLuint32) count_;
+        }
+    }
+#endif
+    // after the end of the file, or without one, the source is silent
+    if (count < frames) {
+        memset(&pcm[count * channels], 0, (frames - count) * channels * sizeof(short));
+    }
+    if (NULL != dst && (short *) dst != pcm) {
+        // only the capture thread uses the dither state, so no lock is needed
+        slesutPcmConvert(dst, format, pcm, SLESUT_PCM_S16, frames * channels,
+            SLESUT_DITHER_TRIANGULAR, &audioRecorder->mDither);
+    }
+    return (long) frames;
+}
+
+
+/** \brief Start the source as recording starts or resumes; returns whether it started */
+
+static SLboolean CaptureDevice_start(CaptureDevice *capture)
+{
+#ifdef USE_ALSA
+    if (NULL != capture->mPcm) {
+        int err;
+        if (0 > (err = snd_pcm_prepare(capture->mPcm)) ||
+                0 > (err = snd_pcm_start(capture->mPcm))) {
+            SL_LOGE("unable to start ALSA capture device: %s", snd_strerror(err));
+            return SL_BOOLEAN_FALSE;
+        }
+    }
+#endif
+    return SL_BOOLEAN_TRUE;
+}
+
+
+/** \brief Stop the source as recording stops or pauses */
+
+static void CaptureDevice_stop(CaptureDevice *capture)
+{
+#ifdef USE_ALSA
+    if (NULL != capture->mPcm) {
+        (void) snd_pcm_drop(capture->mPcm);
+    }
+#endif
+}
+
+
+/** \brief Entry point of the thread which captures for an audio recorder */
+
+static void *CaptureDevice_run(void *arg)
+{
+    CAudioRecorder *audioRecorder = (CAudioRecorder *) arg;
+    CaptureDevice *capture = &audioRecorder->mCaptureDevice;
+    IRecord *thisRecord = &audioRecorder->mRecord;
+    IBufferQueue *bufferQueue = &audioRecorder->mBufferQueue;
+    // const after the engine is created, no lock needed
+    SLuint32 clockPercent = audioRecorder->mObject.mEngine->mEngine.mClockPercent;
+    // a source which runs by itself drops what there is no buffer for; a source which runs as
+    // fast as possible waits for a buffer instead
+    SLboolean realTime = 0 != clockPercent;
+#ifdef USE_ALSA
+    if (NULL != capture->mPcm) {
+        realTime = SL_BOOLEAN_TRUE;
+        clockPercent = 0;
+    }
+#endif
+    // duration of one period at the speed of the virtual clock, for a file or silence
+    long long periodNs = 0 == clockPercent ? 0 : (long long) capture->mPeriodFrames *
+        1000000000LL * 100000LL / ((long long) audioRecorder->mSampleRateMilliHz * clockPercent);
+    long long next = 0;
+    SLboolean running = SL_BOOLEAN_FALSE;   // whether the source is started
+    SLboolean failed = SL_BOOLEAN_FALSE;    // whether the source has failed for good
+    while (!atomic_load_acquire(&capture->mShutdown)) {
+        SLuint32 events = 0;
+        slBufferQueueCallback bufferQueueCallback = NULL;
+
+        // decide where the next period goes; this also acknowledges a clear while idle
+        object_lock_exclusive(&audioRecorder->mObject);
+        if (bufferQueue->mClearRequested) {
+            CaptureDevice_acknowledgeClear(audioRecorder);
+        }
+        SLboolean recording = SL_RECORDSTATE_RECORDING == thisRecord->mState && !failed;
+        BufferHeader *front = NULL;
+        SLuint32 frames = 0;
+        SLuint32 offset = capture->mOffset;
+        if (recording) {
+            frames = CaptureDevice_plan(audioRecorder, &front, &events);
+        }
+        slRecordCallback recordCallback = thisRecord->mCallback;
+        void *recordContext = thisRecord->mContext;
+        SLuint32 eventsMask = thisRecord->mCallbackEventsMask;
+        // what an idle thread waits to change
+        SLuint32 state = thisRecord->mState;
+        BufferHeader *rear = bufferQueue->mRear;
+        object_unlock_exclusive(&audioRecorder->mObject);
+
+        // the source only runs while recording
+        if (recording && !running) {
+            running = CaptureDevice_start(capture);
+            failed = !running;
+            next = CaptureDevice_now();
+        } else if (!recording && running) {
+            CaptureDevice_stop(capture);
+            running = SL_BOOLEAN_FALSE;
+        }
+
+        SLboolean idle = !running || (NULL == front && (0 == frames || !realTime));
+        if (!idle) {
+            if (0 < periodNs) {
+                // wait for the virtual clock to have captured the period
+                long long now = CaptureDevice_now();
+                if (next > now) {
+                    struct timespec delay = {(time_t) ((next - now) / 1000000000LL),
+                        (long) ((next - now) % 1000000000LL)};
+                    nanosleep(&delay, NULL);
+                } else if (now - next > CaptureDevice_RESYNC_PERIODS * periodNs) {
+                    next = now;
+                }
+                next += periodNs * frames / capture->mPeriodFrames;
+            }
+            SLboolean overrun = SL_BOOLEAN_FALSE;
+            long captured = 0;
+            if (0 < frames) {
+                captured = CaptureDevice_read(audioRecorder,
+                    NULL == front ? NULL : (char *) front->mBuffer + offset, frames, &overrun);
+                if (0 > captured) {
+                    failed = SL_BOOLEAN_TRUE;
+                    captured = 0;
+                }
+            }
+
+            // account for the period, unless recording stopped or paused meanwhile
+            object_lock_exclusive(&audioRecorder->mObject);
+            if (bufferQueue->mClearRequested) {
+                // the buffer was taken back while being captured into, so the frames are lost
+                CaptureDevice_acknowledgeClear(audioRecorder);
+            } else if (SL_RECORDSTATE_RECORDING == thisRecord->mState) {
+                events |= CaptureDevice_commit(audioRecorder, front, (SLuint32) captured,
+                    overrun, &bufferQueueCallback);
+            }
+            recordCallback = thisRecord->mCallback;
+            recordContext = thisRecord->mContext;
+            eventsMask = thisRecord->mCallbackEventsMask;
+            object_unlock_exclusive(&audioRecorder->mObject);
+        }
+
+        // callbacks are called with the audio recorder unlocked, buffer completion first
+        if (NULL != bufferQueueCallback) {
+            (*bufferQueueCallback)(&bufferQueue->mItf, bufferQueue->mContext);
+        }
+        events &= eventsMask;
+        if (NULL != recordCallback) {
+            while (0 != events) {
+                SLuint32 event = events & -events;
+                events &= ~event;
+                (*recordCallback)(&thisRecord->mItf, recordContext, event);
+            }
+        }
+
+        // wait for the state or the queue to change, unless it already has
+        if (idle) {
+            object_lock_exclusive(&audioRecorder->mObject);
+            if (!capture->mShutdown && !bufferQueue->mClearRequested &&
+                    state == thisRecord->mState && rear == bufferQueue->mRear) {
+                object_cond_wait(&audioRecorder->mObject);
+            }
+            object_unlock_exclusive(&audioRecorder->mObject);
+        }
+    }
+    if (running) {
+        CaptureDevice_stop(capture);
+    }
+    return NULL;
+}
+
+
+/** \brief Called by IEngine::CreateAudioRecorder to check the source and sink.  A buffer queue
+ *  sink must be PCM, and then its sample format, channels, and sample rate are those captured.
+ */
+
+SLresult CaptureDevice_checkSourceSink(CAudioRecorder *audioRecorder)
+{
+    // checkDataSource only allows an I/O device, but not which kind
+    if (SL_IODEVICE_AUDIOINPUT != audioRecorder->mDataSource.mLocator.mIODevice.deviceType) {
+        SL_LOGE("audio recorder source must be the audio input device");
+        return SL_RESULT_PARAMETER_INVALID;
+    }
+    if (SL_DATALOCATOR_BUFFERQUEUE != audioRecorder->mDataSink.mLocator.mLocatorType) {
+        return SL_RESULT_SUCCESS;
+    }
+    const SLDataFormat_PCM *pcm = &audioRecorder->mDataSink.mFormat.mPCM;
+    audioRecorder->mPcmFormat = slesutPcmFormatOf(pcm);
+    if (SLESUT_PCM_INVALID == audioRecorder->mPcmFormat) {
+        SL_LOGE("audio recorder buffer queue has an unsupported sample format");
+        return SL_RESULT_CONTENT_UNSUPPORTED;
+    }
+    audioRecorder->mNumChannels = (SLuint8) pcm->numChannels;
+    audioRecorder->mSampleRateMilliHz = pcm->samplesPerSec;
+    slesutDitherInit(&audioRecorder->mDither, (SLuint32) (uintptr_t) audioRecorder);
+    return SL_RESULT_SUCCESS;
+}
+
+
+#ifdef USE_ALSA
+
+/** \brief Map the sample format of a buffer queue to ALSA's */
+
+static snd_pcm_format_t CaptureDevice_alsaFormat(slesutPcmFormat format)
+{
+    switch (format) {
+    case SLESUT_PCM_U8:
+        return SND_PCM_FORMAT_U8;
+    case SLESUT_PCM_S16:
+        return SND_PCM_FORMAT_S16;
+    case SLESUT_PCM_S24_PACKED:
+        return SND_PCM_FORMAT_S24_3LE;
+    case SLESUT_PCM_S32:
+        return SND_PCM_FORMAT_S32;
+    case SLESUT_PCM_FLOAT:
+        return SND_PCM_FORMAT_FLOAT;
+    default:
+        return SND_PCM_FORMAT_UNKNOWN;
+    }
+}
+
+
+/** \brief Open and configure the ALSA capture PCM for the format of the buffer queue, with
+ *  interleaved read access, and the period and buffer sizes of the engine options
+ */
+
+static SLresult CaptureDevice_openAlsa(CAudioRecorder *audioRecorder, const IEngine *thisEngine)
+{
+    CaptureDevice *capture = &audioRecorder->mCaptureDevice;
+    const char *name = getenv("SL_DESKTOP_ALSA_CAPTURE_PCM");
+    if (NULL == name || '\0' == *name) {
+        name = CaptureDevice_ALSA_PCM;
+    }
+    int err = snd_pcm_open(&capture->mPcm, name, SND_PCM_STREAM_CAPTURE, 0);
+    if (0 > err) {
+        SL_LOGE("unable to open ALSA capture PCM %s: %s", name, snd_strerror(err));
+        capture->mPcm = NULL;
+        return SL_RESULT_IO_ERROR;
+    }
+    snd_pcm_t *pcm = capture->mPcm;
+    unsigned sampleRate = (audioRecorder->mSampleRateMilliHz + 500) / 1000;
+    snd_pcm_uframes_t periodFrames = thisEngine->mPeriodFrames;
+    unsigned periods = thisEngine->mPeriods;
+    int dir = 0;
+    snd_pcm_hw_params_t *hwParams;
+    snd_pcm_hw_params_alloca(&hwParams);
+    if (0 > (err = snd_pcm_hw_params_any(pcm, hwParams)) ||
+            0 > (err = snd_pcm_hw_params_set_access(pcm, hwParams,
+                SND_PCM_ACCESS_RW_INTERLEAVED)) ||
+            0 > (err = snd_pcm_hw_params_set_format(pcm, hwParams,
+                CaptureDevice_alsaFormat(audioRecorder->mPcmFormat))) ||
+            0 > (err = snd_pcm_hw_params_set_channels(pcm, hwParams,
+                audioRecorder->mNumChannels)) ||
+            0 > (err = snd_pcm_hw_params_set_rate(pcm, hwParams, sampleRate, 0)) ||
+            0 > (err = snd_pcm_hw_params_set_period_size_near(pcm, hwParams, &periodFrames,
+                &dir)) ||
+            0 > (err = snd_pcm_hw_params_set_periods_near(pcm, hwParams, &periods, &dir)) ||
+            0 > (err = snd_pcm_hw_params(pcm, hwParams)) ||
+            0 > (err = snd_pcm_hw_params_get_period_size(hwParams, &periodFrames, &dir))) {
+        SL_LOGE("ALSA capture PCM %s does not support %u channels at %u Hz: %s", name,
+            audioRecorder->mNumChannels, sampleRate, snd_strerror(err));
+        (void) snd_pcm_close(pcm);
+        capture->mPcm = NULL;
+        return SL_RESULT_CONTENT_UNSUPPORTED;
+    }
+    capture->mPeriodFrames = (SLuint32) periodFrames;
+    SL_LOGI("ALSA capture PCM %s: %lu frames per period", name, (unsigned long) periodFrames);
+    return SL_RESULT_SUCCESS;
+}
+
+#endif
+
+
+/** \brief Open the WAV file named by SL_DESKTOP_CAPTUREFILE as the source, if there is one.  It
+ *  must have the channels of the buffer queue; its sample rate is only checked for a warning.
+ */
+
+static SLresult CaptureDevice_openFile(CAudioRecorder *audioRecorder)
+{
+#ifdef USE_SNDFILE
+    CaptureDevice *capture = &audioRecorder->mCaptureDevice;
+    capture->mSNDFILE = NULL;
+    const char *pathname = getenv("SL_DESKTOP_CAPTUREFILE");
+    if (NULL == pathname || '\0' == *pathname) {
+        return SL_RESULT_SUCCESS;
+    }
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    capture->mSNDFILE = sf_open(pathname, SFM_READ, &info);
+    if (NULL == capture->mSNDFILE) {
+        SL_LOGE("unable to open capture file %s: %s", pathname, sf_strerror(NULL));
+        return SL_RESULT_IO_ERROR;
+    }
+    if ((unsigned) info.channels != audioRecorder->mNumChannels) {
+        SL_LOGE("capture file %s has %d channels, but the buffer queue has %u", pathname,
+            info.channels, audioRecorder->mNumChannels);
+        (void) sf_close(capture->mSNDFILE);
+        capture->mSNDFILE = NULL;
+        return SL_RESULT_CONTENT_UNSUPPORTED;
+    }
+    if ((SLuint32) info.samplerate * 1000 != audioRecorder->mSampleRateMilliHz) {
+        SL_LOGW("capture file %s is at %d Hz, but is captured at %u mHz", pathname,
+            info.samplerate, audioRecorder->mSampleRateMilliHz);
+    }
+#endif
+    return SL_RESULT_SUCCESS;
+}
+
+
+/** \brief Close the source, and free the scratch buffer */
+
+static void CaptureDevice_release(CaptureDevice *capture)
+{
+#ifdef USE_SNDFILE
+    if (NULL != capture->mSNDFILE) {
+        (void) sf_close(capture->mSNDFILE);
+        capture->mSNDFILE = NULL;
+    }
+#endif
+#ifdef USE_ALSA
+    if (NULL != capture->mPcm) {
+        (void) snd_pcm_close(capture->mPcm);
+        capture->mPcm = NULL;
+    }
+#endif
+    free(capture->mScratch);
+    capture->mScratch = NULL;
+}
+
+
+/** \brief Called by CAudioRecorder_Realize to open the source of an audio recorder with a buffer
+ *  queue sink, and start its capture thread, which idles until recording starts
+ */
+
+SLresult CaptureDevice_open(CAudioRecorder *audioRecorder)
+{
+    CaptureDevice *capture = &audioRecorder->mCaptureDevice;
+    assert(!capture->mStarted);
+    capture->mShutdown = SL_BOOLEAN_FALSE;
+    // const after the engine is created, no lock needed
+    const IEngine *thisEngine = &audioRecorder->mObject.mEngine->mEngine;
+    capture->mPeriodFrames = thisEngine->mPeriodFrames;
+    SLresult result;
+    switch (thisEngine->mDevice) {
+#ifdef USE_ALSA
+    case SL_DESKTOP_DEVICE_AUDIO:   // SDL has no capture, so the sound card is reached by ALSA
+    case SL_DESKTOP_DEVICE_ALSA:
+        result = CaptureDevice_openAlsa(audioRecorder, thisEngine);
+        break;
+#endif
+    case SL_DESKTOP_DEVICE_NULL:
+    case SL_DESKTOP_DEVICE_WAVFILE:
+        result = CaptureDevice_openFile(audioRecorder);
+        break;
+    default:
+        SL_LOGE("audio recorders need ALSA to capture from the sound card");
+        result = SL_RESULT_RESOURCE_ERROR;
+        break;
+    }
+    if (SL_RESULT_SUCCESS != result) {
+        return result;
+    }
+    // big enough for a period in the format of the buffer queue, or as 16-bit to be converted
+    unsigned sampleSize = slesutPcmSampleSize(audioRecorder->mPcmFormat);
+    if (sizeof(short) > sampleSize) {
+        sampleSize = sizeof(short);
+    }
+    capture->mScratch = malloc(capture->mPeriodFrames * audioRecorder->mNumChannels * sampleSize);
+    if (NULL == capture->mScratch) {
+        CaptureDevice_release(capture);
+        return SL_RESULT_MEMORY_FAILURE;
+    }
+    int err;
+#ifdef USE_ALSA
+    if (NULL != capture->mPcm) {
+        err = AlsaDevice_startThread(&capture->mThread, CaptureDevice_run, audioRecorder,
+            thisEngine->mPriority);
+    } else
+#endif
+    {
+        err = pthread_create(&capture->mThread, (const pthread_attr_t *) NULL,
+            CaptureDevice_run, audioRecorder);
+    }
+    result = err_to_result(err);
+    if (SL_RESULT_SUCCESS != result) {
+        CaptureDevice_release(capture);
+        return result;
+    }
+    capture->mStarted = SL_BOOLEAN_TRUE;
+    return SL_RESULT_SUCCESS;
+}
+
+
+/** \brief Called during Object::Destroy for an audio recorder to stop its capture thread, if it
+ *  was started.  The audio recorder is unlocked, as the thread needs the lock to finish a period.
+ */
+
+void CaptureDevice_close(CAudioRecorder *audioRecorder)
+{
+    CaptureDevice *capture = &audioRecorder->mCaptureDevice;
+    if (!capture->mStarted) {
+        return;
+    }
+    object_lock_exclusive(&audioRecorder->mObject);
+    atomic_store_release(&capture->mShutdown, SL_BOOLEAN_TRUE);
+    object_cond_broadcast(&audioRecorder->mObject);
+    object_unlock_exclusive(&audioRecorder->mObject);
+    (void) pthread_join(capture->mThread, (void **) NULL);
+    capture->mStarted = SL_BOOLEAN_FALSE;
+    SL_LOGI("capture device dropped %llu frames in %u overruns", capture->mDropped,
+        capture->mOverruns);
+    CaptureDevice_release(capture);
+}
+
+
+/** \brief Called by Record::SetRecordState with the audio recorder locked, after the state
+ *  changes.  A recording started from stopped, rather than resumed, starts from position zero.
+ *  The capture thread is woken, as it may be waiting for the state to change.
+ */
+
+void audioRecorderStateUpdate(CAudioRecorder *audioRecorder, SLuint32 oldState)
+{
+    if (SL_RECORDSTATE_STOPPED == oldState &&
+            SL_RECORDSTATE_RECORDING == audioRecorder->mRecord.mState) {
+        CaptureDevice *capture = &audioRecorder->mCaptureDevice;
+        capture->mFrames = 0;
+        capture->mFramesSincePositionUpdate = 0;
+        capture->mStalled = SL_BOOLEAN_FALSE;
+        audioRecorder->mRecord.mPosition = 0;
+    }
+    object_cond_broadcast(&audioRecorder->mObject);
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file Dispatcher.c Callback thread for deferred buffer queue and play callbacks */
+
+#include "sles_allinclusive.h"
+#include <semaphore.h>
+#include <time.h>
+
+
+// The mixer never calls the application when callbacks are deferred.  Instead it counts buffer
+// completions and play events on the track, and puts the track on a ring the first time it
+// has something to report.  A track is on the ring at most once, so a ring with one slot per
+// track can never overflow, and the mixer can add to it without blocking.  Several mixer
+// threads can add at once, so a slot is claimed by incrementing mRear, and is then filled in;
+// only the callback thread empties slots.  The callback thread calls back in ring order, and
+// each player's callbacks are all made by that one thread, so they stay in order per player.
+
+#define DISPATCHER_RING MAX_TRACK   // a power of 2
+
+struct Dispatcher_struct {
+    pthread_t mThread;
+    sem_t mWakeup;          ///< Posted by Dispatcher_wake, and to shut down
+    SLboolean mShutdown;
+    SLboolean mPending;     ///< Whether a track was put on the ring since the last wakeup
+    unsigned mRear;         ///< Next slot to claim, incremented atomically by the mixer threads
+    unsigned mFront;        ///< Next slot to empty, only used by the callback thread
+    // statistics, only used by the callback thread
+    unsigned long long mDispatched; ///< Number of times a track was taken off the ring
+    long long mLatencySum;  ///< Total time tracks spent on the ring, in nanoseconds
+    long long mLatencyMax;  ///< Longest time a track spent on the ring, in nanoseconds
+    Track *mRing[DISPATCHER_RING];  ///< NULL if empty
+};
+
+
+/** \brief Return the monotonic clock in nanoseconds */
+
+static long long dispatcher_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+/** \brief Make the callbacks which are due on one track taken off the ring */
+
+static void dispatcher_dispatch(Dispatcher *thiz, Track *track)
+{
+    long long latency = dispatcher_now() - track->mDeferredTime;
+    ++thiz->mDispatched;
+    thiz->mLatencySum += latency;
+    if (thiz->mLatencyMax < latency) {
+        thiz->mLatencyMax = latency;
+    }
+    // Clear the flag before taking the counts, so that anything the mixer adds from now on puts
+    // the track back on the ring, rather than being overlooked
+    (void) atomic_exchange_acq_rel(&track->mDeferredScheduled, 0);
+    SLuint32 buffers = atomic_exchange_acq_rel(&track->mDeferredBuffers, 0);
+    SLuint32 events = atomic_exchange_acq_rel(&track->mDeferredEvents, 0);
+    if (events & DISPATCHER_RELEASE) {
+        // The application is waiting in Object::Destroy, so pending callbacks are discarded
+        IOutputMixExt_releaseTrack(track);
+        return;
+    }
+    // The player can't be destroyed until we release its track, so it's safe to lock it; as we
+    // are not the mixer, we can block, and we get a consistent snapshot of the callbacks
+    CAudioPlayer *audioPlayer = track->mDeferredPlayer;
+    object_lock_exclusive(&audioPlayer->mObject);
+    slBufferQueueCallback bufferQueueCallback = audioPlayer->mBufferQueue.mCallback;
+    void *bufferQueueContext = audioPlayer->mBufferQueue.mContext;
+    slPlayCallback playCallback = audioPlayer->mPlay.mCallback;
+    void *playContext = audioPlayer->mPlay.mContext;
+    object_unlock_exclusive(&audioPlayer->mObject);
+    // callbacks are called with mutex unlocked, in the order the mixer would have made them
+    if (NULL != bufferQueueCallback) {
+        while (0 < buffers--) {
+            (*bufferQueueCallback)(&audioPlayer->mBufferQueue.mItf, bufferQueueContext);
+        }
+    }
+    if (NULL != playCallback) {
+        if (events & SL_PLAYEVENT_HEADATMARKER) {
+            (*playCallback)(&audioPlayer->mPlay.mItf, playContext, SL_PLAYEVENT_HEADATMARKER);
+        }
+        if (events & SL_PLAYEVENT_HEADATNEWPOS) {
+            (*playCallback)(&audioPlayer->mPlay.mItf, playContext, SL_PLAYEVENT_HEADATNEWPOS);
+        }
+    }
+}
+
+
+/** \brief Entry point of the callback thread */
+
+static void *dispatcher_run(void *arg)
+{
+    Dispatcher *thiz = (Dispatcher *) arg;
+    for (;;) {
+        if (0 != sem_wait(&thiz->mWakeup)) {
+            assert(EINTR == errno);
+            continue;
+        }
+        if (atomic_load_acquire(&thiz->mShutdown)) {
+            break;
+        }
+        // A slot which has been claimed but not yet filled in is picked up at the next wakeup,
+        // as the mixer wakes us after filling in all of its slots
+        for (;;) {
+            Track **slot = &thiz->mRing[thiz->mFront & (DISPATCHER_RING - 1)];
+            Track *track = atomic_load_acquire(slot);
+            if (NULL == track) {
+                break;
+            }
+            // empty the slot before the track can be put on the ring again
+            atomic_store_relaxed(slot, NULL);
+            ++thiz->mFront;
+            dispatcher_dispatch(thiz, track);
+        }
+    }
+    SL_LOGI("callback thread dispatched %llu times, latency mean %.3f ms, max %.3f ms",
+        thiz->mDispatched, 0 < thiz->mDispatched ?
+        thiz->mLatencySum / (thiz->mDispatched * 1e6) : 0.0, thiz->mLatencyMax / 1e6);
+    return NULL;
+}
+
+
+/** \brief Return a new callback thread, or NULL if it could not be started */
+
+Dispatcher *Dispatcher_create(void)
+{
+    Dispatcher *thiz = (Dispatcher *) malloc(sizeof(Dispatcher));
+    if (NULL == thiz) {
+        return NULL;
+    }
+    if (0 != sem_init(&thiz->mWakeup, 0, 0)) {
+        free(thiz);
+        return NULL;
+    }
+    thiz->mShutdown = SL_BOOLEAN_FALSE;
+    thiz->mPending = SL_BOOLEAN_FALSE;
+    thiz->mRear = 0;
+    thiz->mFront = 0;
+    thiz->mDispatched = 0;
+    thiz->mLatencySum = 0;
+    thiz->mLatencyMax = 0;
+    memset(thiz->mRing, 0, sizeof(thiz->mRing));
+    if (0 != pthread_create(&thiz->mThread, (const pthread_attr_t *) NULL, dispatcher_run,
+            thiz)) {
+        (void) sem_destroy(&thiz->mWakeup);
+        free(thiz);
+        return NULL;
+    }
+    return thiz;
+}
+
+
+/** \brief Stop the callback thread; all players have been destroyed, so the ring is empty */
+
+void Dispatcher_destroy(Dispatcher *thiz)
+{
+    if (NULL != thiz) {
+        atomic_store_release(&thiz->mShutdown, SL_BOOLEAN_TRUE);
+        (void) sem_post(&thiz->mWakeup);
+        (void) pthread_join(thiz->mThread, (void **) NULL);
+        (void) sem_destroy(&thiz->mWakeup);
+        free(thiz);
+    }
+}
+
+
+/** \brief Called by a mixer thread after adding to the track's deferred counts, to make sure the
+ *  track is on the ring.  Never blocks.
+ */
+
+void Dispatcher_schedule(Dispatcher *thiz, Track *track)
+{
+    if (0 != atomic_exchange_acq_rel(&track->mDeferredScheduled, 1)) {
+        // already on the ring, and the callback thread will see the new counts
+        return;
+    }
+    track->mDeferredTime = dispatcher_now();
+    unsigned rear = atomic_fetch_inc_relaxed(&thiz->mRear);
+    Track **slot = &thiz->mRing[rear & (DISPATCHER_RING - 1)];
+    assert(NULL == atomic_load_relaxed(slot));
+    atomic_store_release(slot, track);
+    atomic_store_relaxed(&thiz->mPending, SL_BOOLEAN_TRUE);
+}
+
+
+/** \brief Called by the mixer at the end of each fill, to wake the callback thread if there is
+ *  anything new on the ring.  Never blocks.
+ */
+
+void Dispatcher_wake(Dispatcher *thiz)
+{
+    if (atomic_exchange_acquire(&thiz->mPending, SL_BOOLEAN_FALSE)) {
+        (void) sem_post(&thiz->mWakeup);
+    }
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file NullDevice.c Output device without audio hardware */
+
+#include "sles_allinclusive.h"
+#include <time.h>
+
+
+// The null device takes the place of SDL_callback: it pulls periods from its output mix on its
+// own thread, either as fast as possible or paced by a virtual clock running at a multiple of
+// real time.  Play positions, markers, and buffer queue callbacks are all derived from the
+// number of frames mixed, so they follow the virtual clock rather than the wall clock.  Each
+// output mix has its own null device, with its own virtual clock.
+
+#define NullDevice_RESYNC_PERIODS 8     // periods late before the virtual clock stops catching up
+#define NullDevice_WAVFILE "OpenSLES"   // WAV file if SL_DESKTOP_WAVFILE is not set, less .wav
+#define NullDevice_NAME_MAX 32          // characters in a variable or file name, with the zone
+
+
+/** \brief Add nanoseconds to a time */
+
+static void timespec_add(struct timespec *ts, long long ns)
+{
+    ns += ts->tv_nsec;
+    ts->tv_sec += (time_t) (ns / 1000000000LL);
+    ts->tv_nsec = (long) (ns % 1000000000LL);
+}
+
+
+/** \brief Return the nanoseconds from a to b */
+
+static long long timespec_diff(const struct timespec *a, const struct timespec *b)
+{
+    return (b->tv_sec - a->tv_sec) * 1000000000LL + (b->tv_nsec - a->tv_nsec);
+}
+
+
+/** \brief Entry point of the thread which renders the output mix */
+
+static void *NullDevice_render(void *arg)
+{
+    COutputMix *outputMix = (COutputMix *) arg;
+    const IEngine *thisEngine = &outputMix->mObject.mEngine->mEngine;
+    NullDevice *nullDevice = &outputMix->mNullDevice;
+    SLOutputMixExtItf OutputMixExt = &outputMix->mOutputMixExt.mItf;
+    // const after the engine is created, no lock needed
+    SLuint32 clockPercent = thisEngine->mClockPercent;
+    SLuint32 periodFrames = thisEngine->mPeriodFrames;
+    SLuint32 sampleRate = thisEngine->mSampleRate;
+    SLuint32 periodSize = periodFrames * thisEngine->mChannels * sizeof(short);
+    // duration of one period at the speed of the virtual clock, or zero for as fast as possible
+    long long periodNs = 0 == clockPercent ? 0 : (long long) periodFrames * 1000000000LL *
+        100LL / ((long long) sampleRate * clockPercent);
+    struct timespec start, next, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    next = start;
+    while (!atomic_load_acquire(&nullDevice->mShutdown)) {
+        IOutputMixExt_FillBuffer(OutputMixExt, nullDevice->mBuffer, periodSize);
+#ifdef USE_SNDFILE
+        if (NULL != nullDevice->mSNDFILE) {
+            sf_count_t count = sf_writef_short(nullDevice->mSNDFILE, nullDevice->mBuffer,
+                periodFrames);
+            if ((sf_count_t) periodFrames != count) {
+                SL_LOGE("null device write failed: %s", sf_strerror(nullDevice->mSNDFILE));
+            }
+        }
+#endif
+        nullDevice->mFrames += periodFrames;
+        if (0 < periodNs) {
+            timespec_add(&next, periodNs);
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (timespec_diff(&next, &now) > NullDevice_RESYNC_PERIODS * periodNs) {
+                // we were starved of CPU for a while, so restart the virtual clock from now
+                // rather than render a burst of periods to catch up
+                next = now;
+            } else {
+                (void) clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double seconds = timespec_diff(&start, &now) / 1e9;
+    SL_LOGI("null device %u rendered %llu frames in %.3f s, %.1f times real time",
+        outputMix->mZone, nullDevice->mFrames, seconds, 0.0 < seconds ?
+        nullDevice->mFrames / (seconds * sampleRate) : 0.0);
+    return NULL;
+}
+
+
+/** \brief Called by COutputMix_Realize to start the null device of an output mix, instead of
+ *  SDL_open.  Output mixes after the first write to different WAV files, see COutputMix::mZone.
+ */
+
+SLresult NullDevice_open(COutputMix *outputMix)
+{
+    NullDevice *nullDevice = &outputMix->mNullDevice;
+    assert(!nullDevice->mStarted);
+    nullDevice->mShutdown = SL_BOOLEAN_FALSE;
+    nullDevice->mFrames = 0;
+    // const after the engine is created, no lock needed
+    const IEngine *thisEngine = &outputMix->mObject.mEngine->mEngine;
+    nullDevice->mBuffer = (short *) malloc(thisEngine->mPeriodFrames * thisEngine->mChannels *
+        sizeof(short));
+    if (NULL == nullDevice->mBuffer) {
+        return SL_RESULT_MEMORY_FAILURE;
+    }
+#ifdef USE_SNDFILE
+    nullDevice->mSNDFILE = NULL;
+    if (SL_DESKTOP_DEVICE_WAVFILE == thisEngine->mDevice) {
+        // SL_DESKTOP_WAVFILE and OpenSLES.wav for the first zone, then SL_DESKTOP_WAVFILE1 and
+        // OpenSLES1.wav, and so on
+        char variable[NullDevice_NAME_MAX], fallback[NullDevice_NAME_MAX];
+        if (0 == outputMix->mZone) {
+            snprintf(variable, sizeof(variable), "SL_DESKTOP_WAVFILE");
+            snprintf(fallback, sizeof(fallback), NullDevice_WAVFILE ".wav");
+        } else {
+            snprintf(variable, sizeof(variable), "SL_DESKTOP_WAVFILE%u", outputMix->mZone);
+            snprintf(fallback, sizeof(fallback), NullDevice_WAVFILE "%u.wav", outputMix->mZone);
+        }
+        const char *pathname = getenv(variable);
+        if (NULL == pathname || '\0' == *pathname) {
+            pathname = fallback;
+        }
+        SF_INFO sfinfo;
+        memset(&sfinfo, 0, sizeof(SF_INFO));
+        sfinfo.samplerate = thisEngine->mSampleRate;
+        sfinfo.channels = thisEngine->mChannels;
+        sfinfo.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+        nullDevice->mSNDFILE = sf_open(pathname, SFM_WRITE, &sfinfo);
+        if (NULL == nullDevice->mSNDFILE) {
+            SL_LOGE("unable to create %s: %s", pathname, sf_strerror(NULL));
+            free(nullDevice->mBuffer);
+            nullDevice->mBuffer = NULL;
+            return SL_RESULT_IO_ERROR;
+        }
+    }
+#endif
+    int err = pthread_create(&nullDevice->mThread, (const pthread_attr_t *) NULL,
+        NullDevice_render, outputMix);
+    SLresult result = err_to_result(err);
+    if (SL_RESULT_SUCCESS != result) {
+#ifdef USE_SNDFILE
+        if (NULL != nullDevice->mSNDFILE) {
+            (void) sf_close(nullDevice->mSNDFILE);
+            nullDevice->mSNDFILE = NULL;
+        }
+#endif
+        free(nullDevice->mBuffer);
+        nullDevice->mBuffer = NULL;
+        return result;
+    }
+    nullDevice->mStarted = SL_BOOLEAN_TRUE;
+    return SL_RESULT_SUCCESS;
+}
+
+
+/** \brief Called during Object::Destroy for an output mix to stop its null device, if it was
+ *  started.  The output mix is unlocked, as the device needs the lock to finish its period.
+ */
+
+void NullDevice_close(COutputMix *outputMix)
+{
+    NullDevice *nullDevice = &outputMix->mNullDevice;
+    if (!nullDevice->mStarted) {
+        return;
+    }
+    atomic_store_release(&nullDevice->mShutdown, SL_BOOLEAN_TRUE);
+    (void) pthread_join(nullDevice->mThread, (void **) NULL);
+    nullDevice->mStarted = SL_BOOLEAN_FALSE;
+#ifdef USE_SNDFILE
+    if (NULL != nullDevice->mSNDFILE) {
+        // this also completes the WAV header with the final length
+        (void) sf_close(nullDevice->mSNDFILE);
+        nullDevice->mSNDFILE = NULL;
+    }
+#endif
+    free(nullDevice->mBuffer);
+    nullDevice->mBuffer = NULL;
+}
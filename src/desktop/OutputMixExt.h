@@ -32,17 +32,158 @@ struct SLOutputMixExtItf_ {
     void (*FillBuffer)(SLOutputMixExtItf self, void *pBuffer, SLuint32 size);
 };
 
-/** \brief Track describes each PCM input source to OutputMix */
+typedef struct Dispatcher_struct Dispatcher;
+typedef struct Visualizer_struct Visualizer;
+
+/** \brief The mixer's side of an equalizer: its copy of the filters last published by an
+ *  IEqualizer, and the state of those filters
+ */
+
+typedef struct {
+    MixBiquadCoefs mCoefs;
+    float mState[MIX_BIQUAD_STATE];
+    SLuint32 mSequence;     ///< IEqualizer::mCoefsSequence when mCoefs was copied
+    SLboolean mActive;      ///< Whether the equalizer is enabled and not flat
+} Equalizer;
+
+/** \brief A reverb of an output mix, as an aux effect: the parameters last published by
+ *  IEnvironmentalReverb or IPresetReverb, and the mixer's reverb which runs them
+ */
+
+typedef struct {
+    Reverb *mReverb;        ///< Created when the interface is exposed on an output mix, or NULL
+    ReverbParams mPublished;    ///< Designed from the properties by IOutputMixExt_publishReverb
+    SLuint32 mSequence;     ///< Odd while mPublished is being updated
+    SLuint32 mCopied;       ///< Only used by the mixer: mSequence when mReverb last copied it
+} AuxReverb;
+
+/** \brief The state of an audio player's play interface which its "head at marker" and "head at
+ *  new position" play events depend on, as published to the mixer by audioPlayerEventsUpdate
+ */
 
 typedef struct {
+    slPlayCallback mCallback;
+    void *mContext;
+    SLuint32 mEventFlags;
+    SLmillisecond mMarkerPosition;  ///< SL_TIME_UNKNOWN if there is no marker
+    SLuint32 mFrameUpdatePeriod;    ///< IPlay::mFrameUpdatePeriod
+    SLmillisecond mSeekPosition;    ///< Position of the last seek
+    SLuint32 mSeeks;                ///< Incremented by each seek, to restart the position
+    SLuint32 mPostpones;            ///< Incremented to postpone the next update event
+} PlayEvents;
+
+/** \brief Track describes each PCM input source to OutputMix.
+ *  The mixer does not lock the audio player, so the fields shared with application threads are
+ *  accessed atomically; see the comments in IOutputMixExt.c.
+ */
+
+typedef struct Track_struct {
     struct BufferQueue_interface *mBufferQueue;
     CAudioPlayer *mAudioPlayer; ///< Mixer examines this track if non-NULL
+    unsigned mIndex;        ///< Group * TRACK_GROUP + index within group, const
     const void *mReader;    ///< Pointer to next frame in BufferHeader.mBuffer
     SLuint32 mAvail;        ///< Number of available bytes in the current buffer
-    float mGains[STEREO_CHANNELS]; ///< Copied from CAudioPlayer::mGains
+    SLboolean mSilent;      ///< Whether the current buffer is all silence, see BufferHeader
+    slesutPcmFormat mFormat; ///< Sample format of the source, converted to float if not 16-bit
+    unsigned mChannels;     ///< Number of interleaved channels in each source frame
+    unsigned mFrameSize;    ///< Number of bytes in each source frame
+    /** Downmix matrix for sources which are not stereo, see MixDownmix */
+    float mDownmix[STEREO_CHANNELS * MIX_MAX_CHANNELS];
+    Resampler *mResampler;  ///< Non-NULL if the track's rate differs from the device's, or Doppler
+    Stretch *mStretch;      ///< Non-NULL once the tempo has differed from the pitch, see mTempo
+    float mGains[STEREO_CHANNELS]; ///< Gains used by mixer, last good copy of mPublishedGains
+    float mPublishedGains[STEREO_CHANNELS]; ///< Copied from CAudioPlayer::mGains
+    float mSends[AUX_MAX];  ///< Gains of the sends to the aux effects, as for mGains
+    float mPublishedSends[AUX_MAX]; ///< Published with mPublishedGains
+    float mPitch;           ///< Speed of the resampler before Doppler, last good copy as for mGains
+    float mPublishedPitch;  ///< Published with mPublishedGains by audioPlayerRateUpdate
+    float mTempo;           ///< Tempo of the time stretch, last good copy of mPublishedTempo
+    float mPublishedTempo;  ///< Published with mPublishedGains
+    SLuint32 mGainsSequence; ///< Odd while mPublishedGains is being updated
     SLuint32 mFramesMixed;  ///< Number of sample frames mixed from track; reset periodically
+    SLboolean mVirtual;     ///< Whether the track only advances during this fill, see mix_voices
+    Equalizer mEqualizer;   ///< Of the audio player, applied before the track is mixed
+    // 3D, see mix_spatialize
+    SLboolean mSpatialized;     ///< Whether the track is 3D, set by audioPlayer3DUpdate
+    float mSpatialPublished[MIX_VOICE_INPUTS]; ///< Column of the voice, see Spatial::mSequence
+    float mSpatialStaged[MIX_VOICE_INPUTS]; ///< Deferred column, to be published by the next commit
+    SLboolean mSpatialPending;  ///< Whether the track is on Spatial::mStaged
+    struct Track_struct *mSpatialNext;  ///< Next track on Spatial::mStaged
+    float mSpatial[MIX_VOICE_INPUTS];   ///< Mixer's last good copy of mSpatialPublished
+    float mSpatialGains[STEREO_CHANNELS];   ///< Applied with mGains, 1 unless the track is 3D
+    float mDopplerSpeed;    ///< Applied with mPitch, 1 unless the track is 3D
+    // Statistics, only written by the thread mixing the track and read atomically
+    SLboolean mStarved;     ///< Whether the track has had no data since it ran dry or stopped
+    SLuint32 mUnderruns;    ///< Number of times the track ran dry while playing
+    unsigned long long mBytesMixed; ///< Number of bytes consumed from the buffer queue
+    // Play events, only written by the thread mixing the track unless noted, see track_position
+    PlayEvents mEvents;         ///< Last good copy of mPublishedEvents
+    PlayEvents mPublishedEvents;    ///< Written with the audio player locked
+    SLuint32 mEventsSequence;   ///< Odd while mPublishedEvents is being updated
+    SLmillisecond mPositionBase; ///< Position at the last stop or seek
+    SLuint32 mPositionFrames;   ///< Number of frames mixed since the last stop or seek
+    SLuint32 mUpdateFrames;     ///< Number of frames mixed since the last update event
+    SLmillisecond mEventPosition; ///< Position when the events were last checked
+    // Requests to clear, stop, or destroy, see track_check; never reset, as a waiter might still
+    // be polling mAcknowledged after the track is freed and given to another player
+    SLuint32 mRequests;         ///< Number of requests made, written with the audio player locked
+    SLuint32 mAcknowledged;     ///< Number of requests acknowledged by the mixer
+    // Deferred callbacks, see desktop/Dispatcher.c
+    Dispatcher *mDispatcher;    ///< Callback thread, or NULL to call back from the mixer
+    CAudioPlayer *mDeferredPlayer;  ///< As mAudioPlayer, but kept until the track is released
+    SLuint32 mDeferredScheduled;    ///< Non-zero while the track is on the dispatcher's ring
+    SLuint32 mDeferredBuffers;  ///< Number of buffer completions not yet called back
+    SLuint32 mDeferredEvents;   ///< Play events not yet called back, and DISPATCHER_RELEASE
+    long long mDeferredTime;    ///< When the track was put on the ring, in monotonic nanoseconds
 } Track;
 
+/** \brief The 3D state an engine shares with the mixers of its output mixes.  One sequence
+ *  covers the listener and the columns published by every 3D track, so that a mixer sees all of
+ *  a commit of deferred 3D changes or none of it, see mix_spatialize.  Only written with the
+ *  engine locked.
+ */
+
+typedef struct {
+    MixListener mListener;          ///< Published by listener3DUpdate
+    SLboolean mListenerPublished;   ///< Whether mListener has been published, else the default
+    MixListener mStagedListener;    ///< Deferred listener, to be published by the next commit
+    SLboolean mListenerStaged;      ///< Whether mStagedListener is pending
+    Track *mStaged;                 ///< Tracks with a deferred column, see Track::mSpatialNext
+    SLuint32 mSequence;             ///< Odd while anything above is being published
+} Spatial;
+
+/** \brief Deferred event asking the callback thread to release the track of a destroyed player */
+#define DISPATCHER_RELEASE 0x80000000
+
 extern SLresult IOutputMixExt_checkAudioPlayerSourceSink(CAudioPlayer *thiz);
+extern SLresult IOutputMixExt_realizeAudioPlayer(CAudioPlayer *thiz);
+extern void IOutputMixExt_destroyAudioPlayer(CAudioPlayer *thiz);
 extern void audioPlayerGainUpdate(CAudioPlayer *thiz);
+extern void audioPlayer3DUpdate(CAudioPlayer *thiz);
+extern void audioPlayerRateUpdate(CAudioPlayer *thiz);
+extern void listener3DUpdate(CListener *thiz);
+extern void IOutputMixExt_commit3D(CEngine *engine);
+extern void audioPlayerFramesMixedUpdate(CAudioPlayer *thiz);
+extern void audioPlayerEventsUpdate(CAudioPlayer *thiz, SLboolean seek, SLboolean postpone);
+extern void audioPlayerAwaitMixer(CAudioPlayer *thiz);
+extern SLboolean IOutputMixExt_isSilent(struct BufferQueue_interface *bufferQueue,
+    const void *buffer, SLuint32 size);
 extern void IOutputMixExt_FillBuffer(SLOutputMixExtItf self, void *pBuffer, SLuint32 size);
+extern void IOutputMixExt_startWorkers(COutputMix *outputMix, unsigned numWorkers);
+extern void IOutputMixExt_startDispatcher(COutputMix *outputMix);
+extern void IOutputMixExt_stopThreads(COutputMix *outputMix);
+extern void IOutputMixExt_releaseTrack(Track *track);
+extern Dispatcher *Dispatcher_create(void);
+extern void Dispatcher_destroy(Dispatcher *dispatcher);
+extern void Dispatcher_schedule(Dispatcher *dispatcher, Track *track);
+extern void Dispatcher_wake(Dispatcher *dispatcher);
+extern Visualizer *Visualizer_create(unsigned sampleRate);
+extern void Visualizer_destroy(Visualizer *visualizer);
+extern void Visualizer_setCallback(Visualizer *visualizer, slVisualizationCallback callback,
+    void *context, SLmilliHertz rate);
+extern void Visualizer_write(Visualizer *visualizer, const float *bus, unsigned frames);
+extern void IDesktopStatistics_sync(CEngine *engine);
+extern bool IOutputMixExt_exposeReverb(AuxReverb *auxReverb, SLuint32 sampleRate);
+extern void IOutputMixExt_publishReverb(AuxReverb *auxReverb,
+    const SLEnvironmentalReverbSettings *properties, SLboolean enabled, SLuint32 sampleRate);
+extern void IOutputMixExt_destroyReverb(AuxReverb *auxReverb);
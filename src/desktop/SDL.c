@@ -18,6 +18,8 @@
 
 #include "sles_allinclusive.h"
 
+#define SDL_MAX_SAMPLES 16384   // SDL_AudioSpec::samples is 16-bit, and doubled on Windows
+
 
 /** \brief Called by SDL to fill the next audio output buffer */
 
@@ -25,41 +27,40 @@ static void SDLCALL SDL_callback(void *context, Uint8 *stream, int len)
 {
     assert(len > 0);
     IEngine *thisEngine = (IEngine *) context;
-    // A peek lock would be risky if output mixes are dynamic, so we use SDL_PauseAudio to
-    // temporarily disable callbacks during any change to the current output mix, and use a
-    // shared lock here
-    interface_lock_shared(thisEngine);
-    COutputMix *outputMix = thisEngine->mOutputMix;
-    interface_unlock_shared(thisEngine);
-    if (NULL != outputMix) {
-        SLOutputMixExtItf OutputMixExt = &outputMix->mOutputMixExt.mItf;
-        IOutputMixExt_FillBuffer(OutputMixExt, stream, (SLuint32) len);
-    } else {
-        memset(stream, 0, (size_t) len);
-    }
+    // the output mix can change at any time without pausing SDL, see IOutputMixExt_render
+    (void) IOutputMixExt_render(thisEngine, stream, (SLuint32) len);
 }
 
 
-/** \brief Called during slCreateEngine to initialize SDL */
+/** \brief Called by CEngine_Realize to initialize SDL */
 
-void SDL_open(IEngine *thisEngine)
+SLresult SDL_open(IEngine *thisEngine)
 {
+    // const after the engine is created, no lock needed; as the obtained format is not asked
+    // for, SDL converts from exactly this one if the sound card does not support it
+    SLuint32 periodFrames = thisEngine->mPeriodFrames;
+    if (SDL_MAX_SAMPLES < periodFrames) {
+        periodFrames = SDL_MAX_SAMPLES;
+    }
     SDL_AudioSpec fmt;
-    fmt.freq = 44100;
+    fmt.freq = (int) thisEngine->mSampleRate;
     fmt.format = AUDIO_S16;
-    fmt.channels = STEREO_CHANNELS;
+    fmt.channels = (Uint8) thisEngine->mChannels;
 #ifdef _WIN32 // FIXME Either a bug or a serious misunderstanding
-    fmt.samples = SndFile_BUFSIZE;
+    fmt.samples = (Uint16) (periodFrames * sizeof(short));
 #else
-    fmt.samples = SndFile_BUFSIZE / sizeof(short);
+    fmt.samples = (Uint16) periodFrames;
 #endif
     fmt.callback = SDL_callback;
     fmt.userdata = (void *) thisEngine;
 
     if (SDL_OpenAudio(&fmt, NULL) < 0) {
         SL_LOGE("Unable to open audio: %s", SDL_GetError());
-        exit(EXIT_FAILURE);
+        return SL_RESULT_IO_ERROR;
     }
+    // SDL_callback renders silence until there is an output mix
+    SDL_PauseAudio(0);
+    return SL_RESULT_SUCCESS;
 }
 
 
@@ -21,14 +21,16 @@
 
 /** \brief Called by SndFile.c:audioPlayerTransportUpdate after a play state change or seek,
  *  and by IOutputMixExt::FillBuffer after each buffer is consumed.
+ *  Unlike a buffer queue player, a file player is not real-time safe: this reads the file and
+ *  locks the audio player to enqueue what it read, so unless the output mix defers callbacks to
+ *  its callback thread, the mixer can block here.  The play events are left to the mixer.
  */
 
 void SndFile_Callback(SLBufferQueueItf caller, void *pContext)
 {
     CAudioPlayer *thisAP = (CAudioPlayer *) pContext;
-    object_lock_peek(&thisAP->mObject);
-    SLuint32 state = thisAP->mPlay.mState;
-    object_unlock_peek(&thisAP->mObject);
+    // the mixer also reads the play state without locking
+    SLuint32 state = atomic_load_acquire(&thisAP->mPlay.mState);
     if (SL_PLAYSTATE_PLAYING != state) {
         return;
     }
@@ -44,54 +46,50 @@ void SndFile_Callback(SLBufferQueueItf caller, void *pContext)
         thiz->mWhich = 0;
     }
     sf_count_t count;
-    count = sf_read_short(thiz->mSNDFILE, pBuffer, (sf_count_t) SndFile_BUFSIZE);
+    // the samples are passed through in the file's own format, and the output mix converts them;
+    // libsndfile reads whole frames only, so round down to a multiple of the frame size
+    sf_count_t frameSize = thiz->mSfInfo.channels * slesutPcmSampleSize(thiz->mFormat);
+    count = sf_read_raw(thiz->mSNDFILE, pBuffer,
+        (sizeof(short) * SndFile_BUFSIZE / frameSize) * frameSize);
     pthread_mutex_unlock(&thiz->mMutex);
-    bool headAtNewPos = false;
-    object_lock_exclusive(&thisAP->mObject);
-    slPlayCallback callback = thisAP->mPlay.mCallback;
-    void *context = thisAP->mPlay.mContext;
-    // make a copy of sample rate so we are absolutely sure we will not divide by zero
-    SLuint32 sampleRateMilliHz = thisAP->mSampleRateMilliHz;
-    if (UNKNOWN_SAMPLERATE != sampleRateMilliHz) {
-        // this will overflow after 49 days, but no fix possible as it's part of the API
-        thisAP->mPlay.mPosition = (SLuint32) (((long long) thisAP->mPlay.mFramesSinceLastSeek *
-            1000000LL) / sampleRateMilliHz) + thisAP->mPlay.mLastSeekPosition;
-        // make a good faith effort for the mean time between "head at new position" callbacks to
-        // occur at the requested update period, but there will be jitter
-        SLuint32 frameUpdatePeriod = thisAP->mPlay.mFrameUpdatePeriod;
-        if ((0 != frameUpdatePeriod) &&
-            (thisAP->mPlay.mFramesSincePositionUpdate >= frameUpdatePeriod) &&
-            (SL_PLAYEVENT_HEADATNEWPOS & thisAP->mPlay.mEventFlags)) {
-            // if we overrun a requested update period, then reset the clock modulo the
-            // update period so that it appears to the application as one or more lost callbacks,
-            // but no additional jitter
-            if ((thisAP->mPlay.mFramesSincePositionUpdate -= thisAP->mPlay.mFrameUpdatePeriod) >=
-                    frameUpdatePeriod) {
-                thisAP->mPlay.mFramesSincePositionUpdate %= frameUpdatePeriod;
-            }
-            headAtNewPos = true;
-        }
-    }
     if (0 < count) {
-        object_unlock_exclusive(&thisAP->mObject);
-        SLuint32 size = (SLuint32) (count * sizeof(short));
+        SLuint32 size = (SLuint32) count;
         result = IBufferQueue_Enqueue(caller, pBuffer, size);
         // not much we can do if the Enqueue fails, so we'll just drop the decoded data
         if (SL_RESULT_SUCCESS != result) {
             SL_LOGE("enqueue failed 0x%x", result);
         }
     } else {
-        thisAP->mPlay.mState = SL_PLAYSTATE_PAUSED;
+        object_lock_exclusive(&thisAP->mObject);
+        // a stop requested since we looked must not be overridden
+        if (SL_PLAYSTATE_PLAYING == thisAP->mPlay.mState) {
+            atomic_store_release(&thisAP->mPlay.mState, SL_PLAYSTATE_PAUSED);
+        }
         thiz->mEOF = SL_BOOLEAN_TRUE;
         // this would result in a non-monotonically increasing position, so don't do it
         // thisAP->mPlay.mPosition = thisAP->mPlay.mDuration;
         object_unlock_exclusive_attributes(&thisAP->mObject, ATTR_TRANSPORT);
     }
-    // callbacks are called with mutex unlocked
-    if (NULL != callback) {
-        if (headAtNewPos) {
-            (*callback)(&thisAP->mPlay.mItf, context, SL_PLAYEVENT_HEADATNEWPOS);
-        }
+}
+
+
+/** \brief Return the sample format of the raw data in a WAV file, or SLESUT_PCM_INVALID */
+
+static slesutPcmFormat SndFile_PcmFormat(const SF_INFO *sfinfo)
+{
+    switch (sfinfo->format & SF_FORMAT_SUBMASK) {
+    case SF_FORMAT_PCM_U8:
+        return SLESUT_PCM_U8;
+    case SF_FORMAT_PCM_16:
+        return SLESUT_PCM_S16;
+    case SF_FORMAT_PCM_24:
+        return SLESUT_PCM_S24_PACKED;
+    case SF_FORMAT_PCM_32:
+        return SLESUT_PCM_S32;
+    case SF_FORMAT_FLOAT:
+        return SLESUT_PCM_FLOAT;
+    default:
+        return SLESUT_PCM_INVALID;
     }
 }
 
@@ -106,24 +104,20 @@ SLboolean SndFile_IsSupported(const SF_INFO *sfinfo)
     default:
         return SL_BOOLEAN_FALSE;
     }
-    switch (sfinfo->format & SF_FORMAT_SUBMASK) {
-    case SF_FORMAT_PCM_U8:
-    case SF_FORMAT_PCM_16:
-        break;
-    default:
+    if (SLESUT_PCM_INVALID == SndFile_PcmFormat(sfinfo)) {
         return SL_BOOLEAN_FALSE;
     }
-    switch (sfinfo->samplerate) {
-    case 11025:
-    case 22050:
-    case 44100:
-        break;
-    default:
+    // the output mix resamples to the device rate, so allow the same range as checkDataFormat
+    if (sfinfo->samplerate < 8000 || sfinfo->samplerate > 192000) {
         return SL_BOOLEAN_FALSE;
     }
+    // the output mix downmixes to stereo
     switch (sfinfo->channels) {
     case 1:
     case 2:
+    case 4:
+    case 6:
+    case 8:
         break;
     default:
         return SL_BOOLEAN_FALSE;
@@ -202,9 +196,11 @@ void audioPlayerTransportUpdate(CAudioPlayer *audioPlayer)
                 pos = audioPlayer->mPlay.mDuration;
             }
             audioPlayer->mPlay.mLastSeekPosition = pos;
+            audioPlayerFramesMixedUpdate(audioPlayer);
             audioPlayer->mPlay.mFramesSinceLastSeek = 0;
-            // seek postpones the next head at new position callback
-            audioPlayer->mPlay.mFramesSincePositionUpdate = 0;
+            // the mixer restarts its position for the play events too, and seek postpones the
+            // next head at new position callback
+            audioPlayerEventsUpdate(audioPlayer, SL_BOOLEAN_TRUE, SL_BOOLEAN_FALSE);
         }
         object_unlock_exclusive(&audioPlayer->mObject);
 
@@ -261,6 +257,7 @@ SLresult SndFile_Realize(CAudioPlayer *thiz)
             thiz->mPlay.mDuration = (SLmillisecond) (((long long) thiz->mSndFile.mSfInfo.frames *
                 1000LL) / thiz->mSndFile.mSfInfo.samplerate);
             thiz->mNumChannels = thiz->mSndFile.mSfInfo.channels;
+            thiz->mSndFile.mFormat = SndFile_PcmFormat(&thiz->mSndFile.mSfInfo);
             thiz->mSampleRateMilliHz = thiz->mSndFile.mSfInfo.samplerate * 1000;
 #ifdef USE_OUTPUTMIXEXT
             thiz->mPlay.mFrameUpdatePeriod = ((long long) thiz->mPlay.mPositionUpdatePeriod *
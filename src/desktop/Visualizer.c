@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file Visualizer.c Visualization thread for the waveform and FFT callbacks of an output mix */
+
+#include "sles_allinclusive.h"
+#include <math.h>
+#include <time.h>
+
+
+// The mixer copies each pass of the final mix into a ring, and that is all it does: it never
+// waits for the visualization thread, and never calls the application.  It is the only writer,
+// and publishes how many frames it has written once they are in the ring.  The visualization
+// thread wakes at the rate the application asked for, copies the most recent frames out of the
+// ring, and checks afterwards that the mixer can't have been overwriting them meanwhile; if it
+// might have, the capture is dropped.  The FFT and the conversion to 8 bits are done by the
+// visualization thread, which then calls back with no locks held.
+
+#define VISUALIZER_CAPTURE 512  // mono samples of the waveform, and points of the FFT
+#define VISUALIZER_BINS (VISUALIZER_CAPTURE / 2)    // magnitudes of the FFT, from 0 Hz to Nyquist
+#define VISUALIZER_RING 2048    // frames, a power of 2 with room for a capture and a mixer pass
+
+#if VISUALIZER_RING < VISUALIZER_CAPTURE + 2 * MIXBUS_FRAMES
+#error VISUALIZER_RING is too small
+#endif
+
+struct Visualizer_struct {
+    pthread_t mThread;
+    pthread_mutex_t mMutex; ///< Protects the fields up to mDeadline
+    pthread_cond_t mCond;   ///< Signalled when they change
+    SLboolean mShutdown;
+    slVisualizationCallback mCallback;
+    void *mContext;
+    SLmilliHertz mRate;
+    long long mDeadline;    ///< Of the next callback, in monotonic nanoseconds
+    // shared with the mixer
+    SLboolean mActive;      ///< Whether there is a callback, so the mixer is to write to the ring
+    unsigned mWritten;      ///< Number of frames written to the ring, published after writing
+    // only used by the visualization thread
+    const MixKernels *mKernels;
+    SLmilliHertz mSampleRate;
+    unsigned mCaptured;     ///< mWritten at the last capture
+    float mWindow[VISUALIZER_CAPTURE];  ///< Hann window applied before the FFT
+    unsigned short mReversed[VISUALIZER_CAPTURE];   ///< Bit reversal permutation of the input
+    /** Twiddles of all passes, of the pass with half butterflies from index half - 1 */
+    float mTwiddleRe[VISUALIZER_CAPTURE - 1];
+    float mTwiddleIm[VISUALIZER_CAPTURE - 1];
+    float mCapture[VISUALIZER_CAPTURE * STEREO_CHANNELS];
+    float mRe[VISUALIZER_CAPTURE];
+    float mIm[VISUALIZER_CAPTURE];
+    SLuint8 mWaveform[VISUALIZER_CAPTURE];
+    SLuint8 mFft[VISUALIZER_BINS];
+    float mRing[VISUALIZER_RING * STEREO_CHANNELS];     ///< Interleaved float stereo
+};
+
+
+/** \brief Return the monotonic clock in nanoseconds */
+
+static long long visualizer_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+/** \brief Return the period of the callbacks in nanoseconds */
+
+static long long visualizer_period(const Visualizer *thiz)
+{
+    return 1000000000000LL / thiz->mRate;
+}
+
+
+/** \brief Copy the most recent frames out of the ring, and return whether they are intact */
+
+static bool visualizer_capture(Visualizer *thiz)
+{
+    unsigned written = atomic_load_acquire(&thiz->mWritten);
+    unsigned start = written - VISUALIZER_CAPTURE;
+    unsigned i;
+    for (i = 0; i < VISUALIZER_CAPTURE; ) {
+        unsigned index = (start + i) & (VISUALIZER_RING - 1);
+        unsigned count = VISUALIZER_RING - index;
+        if (count > VISUALIZER_CAPTURE - i) {
+            count = VISUALIZER_CAPTURE - i;
+        }
+        memcpy(&thiz->mCapture[i * STEREO_CHANNELS], &thiz->mRing[index * STEREO_CHANNELS],
+            count * STEREO_CHANNELS * sizeof(float));
+        i += count;
+    }
+    atomic_fence_acquire();
+    // the mixer writes at most a pass beyond what it has published
+    unsigned now = atomic_load_relaxed(&thiz->mWritten);
+    if (now + MIXBUS_FRAMES - start > VISUALIZER_RING) {
+        return false;
+    }
+    thiz->mCaptured = written;
+    return true;
+}
+
+
+/** \brief Convert a capture to the waveform and the magnitudes of its FFT, as 8-bit samples */
+
+static void visualizer_analyze(Visualizer *thiz)
+{
+    unsigned i;
+    for (i = 0; i < VISUALIZER_CAPTURE; ++i) {
+        float sample = (thiz->mCapture[i * STEREO_CHANNELS] +
+            thiz->mCapture[i * STEREO_CHANNELS + 1]) * 0.5f;
+        // unsigned 8-bit, as for 8-bit PCM; the mix has headroom, so clamp it
+        int waveform = (int) lrintf(sample * 128.0f) + 128;
+        thiz->mWaveform[i] = waveform < 0 ? 0 : waveform > 255 ? 255 : waveform;
+        thiz->mRe[thiz->mReversed[i]] = sample * thiz->mWindow[i];
+        thiz->mIm[i] = 0.0f;
+    }
+    unsigned half;
+    for (half = 1; half < VISUALIZER_CAPTURE; half *= 2) {
+        (*thiz->mKernels->mButterflies)(thiz->mRe, thiz->mIm, VISUALIZER_CAPTURE, half,
+            &thiz->mTwiddleRe[half - 1], &thiz->mTwiddleIm[half - 1]);
+    }
+    // the peak of a full scale sine through the Hann window is a quarter of the points
+    const float scale = 4.0f * 255.0f / VISUALIZER_CAPTURE;
+    for (i = 0; i < VISUALIZER_BINS; ++i) {
+        float magnitude = sqrtf(thiz->mRe[i] * thiz->mRe[i] + thiz->mIm[i] * thiz->mIm[i]);
+        int fft = (int) lrintf(magnitude * scale);
+        thiz->mFft[i] = fft > 255 ? 255 : fft;
+    }
+}
+
+
+/** \brief Entry point of the visualization thread */
+
+static void *visualizer_run(void *arg)
+{
+    Visualizer *thiz = (Visualizer *) arg;
+    unsigned long long callbacks = 0, dropped = 0;
+    pthread_mutex_lock(&thiz->mMutex);
+    while (!thiz->mShutdown) {
+        if (NULL == thiz->mCallback) {
+            pthread_cond_wait(&thiz->mCond, &thiz->mMutex);
+            continue;
+        }
+        long long now = visualizer_now();
+        if (now < thiz->mDeadline) {
+            struct timespec deadline;
+            deadline.tv_sec = thiz->mDeadline / 1000000000LL;
+            deadline.tv_nsec = thiz->mDeadline % 1000000000LL;
+            (void) pthread_cond_timedwait(&thiz->mCond, &thiz->mMutex, &deadline);
+            continue;
+        }
+        // if we fell behind, don't try to catch up
+        long long period = visualizer_period(thiz);
+        thiz->mDeadline += period;
+        if (thiz->mDeadline <= now) {
+            thiz->mDeadline = now + period;
+        }
+        slVisualizationCallback callback = thiz->mCallback;
+        void *context = thiz->mContext;
+        pthread_mutex_unlock(&thiz->mMutex);
+        // nothing new to show while the device is stopped
+        if (atomic_load_acquire(&thiz->mWritten) != thiz->mCaptured) {
+            if (visualizer_capture(thiz)) {
+                visualizer_analyze(thiz);
+                (*callback)(context, thiz->mWaveform, thiz->mFft, thiz->mSampleRate);
+                ++callbacks;
+            } else {
+                ++dropped;
+            }
+        }
+        pthread_mutex_lock(&thiz->mMutex);
+    }
+    pthread_mutex_unlock(&thiz->mMutex);
+    SL_LOGI("visualization thread called back %llu times, dropped %llu captures", callbacks,
+        dropped);
+    return NULL;
+}
+
+
+/** \brief Return a new visualization thread for a mix at the specified sample rate, with no
+ *  callback, or NULL if it could not be started
+ */
+
+Visualizer *Visualizer_create(unsigned sampleRate)
+{
+    Visualizer *thiz = (Visualizer *) calloc(1, sizeof(Visualizer));
+    if (NULL == thiz) {
+        return NULL;
+    }
+    thiz->mShutdown = SL_BOOLEAN_FALSE;
+    thiz->mCallback = NULL;
+    thiz->mContext = NULL;
+    thiz->mRate = 1;
+    thiz->mDeadline = 0;
+    thiz->mActive = SL_BOOLEAN_FALSE;
+    thiz->mWritten = 0;
+    thiz->mKernels = MixKernels_get();
+    thiz->mSampleRate = sampleRate * 1000;
+    thiz->mCaptured = 0;
+    unsigned i;
+    for (i = 0; i < VISUALIZER_CAPTURE; ++i) {
+        thiz->mWindow[i] = (float) (0.5 - 0.5 * cos(2.0 * M_PI * i / VISUALIZER_CAPTURE));
+        unsigned reversed = 0, bit;
+        for (bit = 1; bit < VISUALIZER_CAPTURE; bit <<= 1) {
+            reversed = (reversed << 1) | (0 != (i & bit));
+        }
+        thiz->mReversed[i] = (unsigned short) reversed;
+    }
+    unsigned half;
+    for (half = 1; half < VISUALIZER_CAPTURE; half *= 2) {
+        for (i = 0; i < half; ++i) {
+            double angle = -M_PI * i / half;
+            thiz->mTwiddleRe[half - 1 + i] = (float) cos(angle);
+            thiz->mTwiddleIm[half - 1 + i] = (float) sin(angle);
+        }
+    }
+    pthread_condattr_t attr;
+    if (0 != pthread_condattr_init(&attr)) {
+        free(thiz);
+        return NULL;
+    }
+    (void) pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    int err = pthread_cond_init(&thiz->mCond, &attr);
+    (void) pthread_condattr_destroy(&attr);
+    if (0 != err) {
+        free(thiz);
+        return NULL;
+    }
+    if (0 != pthread_mutex_init(&thiz->mMutex, (const pthread_mutexattr_t *) NULL)) {
+        (void) pthread_cond_destroy(&thiz->mCond);
+        free(thiz);
+        return NULL;
+    }
+    if (0 != pthread_create(&thiz->mThread, (const pthread_attr_t *) NULL, visualizer_run,
+            thiz)) {
+        (void) pthread_mutex_destroy(&thiz->mMutex);
+        (void) pthread_cond_destroy(&thiz->mCond);
+        free(thiz);
+        return NULL;
+    }
+    return thiz;
+}
+
+
+/** \brief Stop the visualization thread; the mixer no longer writes to the ring */
+
+void Visualizer_destroy(Visualizer *thiz)
+{
+    if (NULL != thiz) {
+        pthread_mutex_lock(&thiz->mMutex);
+        thiz->mShutdown = SL_BOOLEAN_TRUE;
+        pthread_cond_signal(&thiz->mCond);
+        pthread_mutex_unlock(&thiz->mMutex);
+        (void) pthread_join(thiz->mThread, (void **) NULL);
+        (void) pthread_mutex_destroy(&thiz->mMutex);
+        (void) pthread_cond_destroy(&thiz->mCond);
+        free(thiz);
+    }
+}
+
+
+/** \brief Set the callback, or none if NULL, and the rate in milliHertz at which it is called.
+ *  The first call is one period from now.  May block briefly, but never for a callback.
+ */
+
+void Visualizer_setCallback(Visualizer *thiz, slVisualizationCallback callback, void *context,
+    SLmilliHertz rate)
+{
+    assert(0 < rate);
+    pthread_mutex_lock(&thiz->mMutex);
+    thiz->mCallback = callback;
+    thiz->mContext = context;
+    thiz->mRate = rate;
+    thiz->mDeadline = visualizer_now() + visualizer_period(thiz);
+    atomic_store_relaxed(&thiz->mActive, NULL != callback);
+    pthread_cond_signal(&thiz->mCond);
+    pthread_mutex_unlock(&thiz->mMutex);
+}
+
+
+/** \brief Called by the mixer with each pass of the final mix, of at most MIXBUS_FRAMES frames of
+ *  interleaved float stereo, or NULL for silence.  Never blocks.
+ */
+
+void Visualizer_write(Visualizer *thiz, const float *bus, unsigned frames)
+{
+    assert(frames <= MIXBUS_FRAMES);
+    if (!atomic_load_relaxed(&thiz->mActive)) {
+        return;
+    }
+    // we are the only writer
+    unsigned written = thiz->mWritten;
+    while (frames > 0) {
+        unsigned index = written & (VISUALIZER_RING - 1);
+        unsigned count = VISUALIZER_RING - index;
+        if (count > frames) {
+            count = frames;
+        }
+        float *dst = &thiz->mRing[index * STEREO_CHANNELS];
+        if (NULL != bus) {
+            memcpy(dst, bus, count * STEREO_CHANNELS * sizeof(float));
+            bus += count * STEREO_CHANNELS;
+        } else {
+            memset(dst, 0, count * STEREO_CHANNELS * sizeof(float));
+        }
+        written += count;
+        frames -= count;
+    }
+    atomic_store_release(&thiz->mWritten, written);
+}
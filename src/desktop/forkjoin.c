@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file forkjoin.c Fork-join worker threads for the track mixer */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     // pthread_setaffinity_np
+#endif
+#include "forkjoin.h"
+#include <assert.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/** \brief Entry point of each worker thread */
+
+static void *forkjoin_worker(void *arg)
+{
+    ForkJoinWorker *worker = (ForkJoinWorker *) arg;
+    ForkJoin *forkJoin = worker->mForkJoin;
+    unsigned generation = 0;
+    int ok;
+    ok = pthread_mutex_lock(&forkJoin->mMutex);
+    assert(0 == ok);
+    for (;;) {
+        while (!forkJoin->mShutdown && generation == forkJoin->mGeneration) {
+            ok = pthread_cond_wait(&forkJoin->mCondFork, &forkJoin->mMutex);
+            assert(0 == ok);
+        }
+        if (forkJoin->mShutdown) {
+            break;
+        }
+        generation = forkJoin->mGeneration;
+        ForkJoinWork work = forkJoin->mWork;
+        void *context = forkJoin->mContext;
+        ok = pthread_mutex_unlock(&forkJoin->mMutex);
+        assert(0 == ok);
+        (*work)(context, worker->mWorker);
+        ok = pthread_mutex_lock(&forkJoin->mMutex);
+        assert(0 == ok);
+        assert(0 < forkJoin->mPending);
+        if (0 == --forkJoin->mPending) {
+            ok = pthread_cond_signal(&forkJoin->mCondJoin);
+            assert(0 == ok);
+        }
+    }
+    ok = pthread_mutex_unlock(&forkJoin->mMutex);
+    assert(0 == ok);
+    return NULL;
+}
+
+
+/** \brief Stop and join the first numStarted worker threads, and release the pool */
+
+static void forkjoin_shutdown(ForkJoin *forkJoin, unsigned numStarted)
+{
+    int ok;
+    ok = pthread_mutex_lock(&forkJoin->mMutex);
+    assert(0 == ok);
+    assert(0 == forkJoin->mPending);
+    forkJoin->mShutdown = 1;
+    ok = pthread_cond_broadcast(&forkJoin->mCondFork);
+    assert(0 == ok);
+    ok = pthread_mutex_unlock(&forkJoin->mMutex);
+    assert(0 == ok);
+    unsigned i;
+    for (i = 0; i < numStarted; ++i) {
+        ok = pthread_join(forkJoin->mWorkers[i].mThread, NULL);
+        assert(0 == ok);
+    }
+    (void) pthread_cond_destroy(&forkJoin->mCondJoin);
+    (void) pthread_cond_destroy(&forkJoin->mCondFork);
+    (void) pthread_mutex_destroy(&forkJoin->mMutex);
+    free(forkJoin);
+}
+
+
+ForkJoin *ForkJoin_create(unsigned numWorkers)
+{
+    assert(0 < numWorkers && FORKJOIN_MAX_WORKERS >= numWorkers);
+    ForkJoin *forkJoin = (ForkJoin *) malloc(sizeof(ForkJoin));
+    if (NULL == forkJoin) {
+        return NULL;
+    }
+    if (0 != pthread_mutex_init(&forkJoin->mMutex, NULL)) {
+        free(forkJoin);
+        return NULL;
+    }
+    if (0 != pthread_cond_init(&forkJoin->mCondFork, NULL)) {
+        (void) pthread_mutex_destroy(&forkJoin->mMutex);
+        free(forkJoin);
+        return NULL;
+    }
+    // the join deadline is measured on the monotonic clock, so it is immune to clock changes
+    pthread_condattr_t attr;
+    (void) pthread_condattr_init(&attr);
+    (void) pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    int err = pthread_cond_init(&forkJoin->mCondJoin, &attr);
+    (void) pthread_condattr_destroy(&attr);
+    if (0 != err) {
+        (void) pthread_cond_destroy(&forkJoin->mCondFork);
+        (void) pthread_mutex_destroy(&forkJoin->mMutex);
+        free(forkJoin);
+        return NULL;
+    }
+    forkJoin->mNumWorkers = numWorkers;
+    forkJoin->mGeneration = 0;
+    forkJoin->mPending = 0;
+    forkJoin->mShutdown = 0;
+    forkJoin->mWork = NULL;
+    forkJoin->mContext = NULL;
+#ifdef __linux__
+    long numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    unsigned i;
+    for (i = 0; i < numWorkers; ++i) {
+        ForkJoinWorker *worker = &forkJoin->mWorkers[i];
+        worker->mForkJoin = forkJoin;
+        worker->mWorker = i + 1;
+        if (0 != pthread_create(&worker->mThread, NULL, forkjoin_worker, worker)) {
+            forkjoin_shutdown(forkJoin, i);
+            return NULL;
+        }
+#ifdef __linux__
+        // pin the workers to CPUs 1 and up, sharing them round robin if there are more workers,
+        // so that they don't migrate and lose their caches between forks; the thread which forks
+        // is not pinned, but no worker competes with it on CPU 0
+        if (1 < numCpus) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(1 + i % (numCpus - 1), &cpus);
+            (void) pthread_setaffinity_np(worker->mThread, sizeof(cpus), &cpus);
+        }
+#endif
+    }
+    return forkJoin;
+}
+
+
+void ForkJoin_destroy(ForkJoin *forkJoin)
+{
+    if (NULL != forkJoin) {
+        forkjoin_shutdown(forkJoin, forkJoin->mNumWorkers);
+    }
+}
+
+
+void ForkJoin_fork(ForkJoin *forkJoin, ForkJoinWork work, void *context)
+{
+    int ok;
+    ok = pthread_mutex_lock(&forkJoin->mMutex);
+    assert(0 == ok);
+    assert(0 == forkJoin->mPending);
+    forkJoin->mWork = work;
+    forkJoin->mContext = context;
+    forkJoin->mPending = forkJoin->mNumWorkers;
+    ++forkJoin->mGeneration;
+    ok = pthread_cond_broadcast(&forkJoin->mCondFork);
+    assert(0 == ok);
+    ok = pthread_mutex_unlock(&forkJoin->mMutex);
+    assert(0 == ok);
+}
+
+
+int ForkJoin_join(ForkJoin *forkJoin, unsigned timeoutNs)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeoutNs / 1000000000;
+    deadline.tv_nsec += timeoutNs % 1000000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_nsec -= 1000000000;
+        ++deadline.tv_sec;
+    }
+    int onTime = 1;
+    int ok;
+    ok = pthread_mutex_lock(&forkJoin->mMutex);
+    assert(0 == ok);
+    while (0 < forkJoin->mPending) {
+        if (onTime) {
+            ok = pthread_cond_timedwait(&forkJoin->mCondJoin, &forkJoin->mMutex, &deadline);
+            if (ETIMEDOUT == ok) {
+                onTime = 0;
+            } else {
+                assert(0 == ok);
+            }
+        } else {
+            ok = pthread_cond_wait(&forkJoin->mCondJoin, &forkJoin->mMutex);
+            assert(0 == ok);
+        }
+    }
+    ok = pthread_mutex_unlock(&forkJoin->mMutex);
+    assert(0 == ok);
+    return onTime;
+}
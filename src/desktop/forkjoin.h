@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file forkjoin.h Fork-join worker threads for the track mixer */
+
+#ifndef __forkjoin_h
+#define __forkjoin_h
+
+// A small pool of worker threads, each pinned to a CPU, which all run the same work function
+// once per fork.  The thread which forks is expected to do a share of the work itself, and then
+// joins with a deadline, so that it can tell whether the pool is keeping up.
+// Like the mixer kernels, it has no dependencies on the rest of the implementation.
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FORKJOIN_MAX_WORKERS 8
+
+/** \brief Work function, called once per fork on each worker, where worker is 1 to mNumWorkers;
+ *  0 is reserved for the thread which forks.
+ */
+typedef void (*ForkJoinWork)(void *context, unsigned worker);
+
+struct ForkJoin_struct;
+
+/** \brief Per-worker state */
+
+typedef struct {
+    struct ForkJoin_struct *mForkJoin;
+    unsigned mWorker;       ///< 1 to mNumWorkers
+    pthread_t mThread;
+} ForkJoinWorker;
+
+/** \brief Pool of worker threads */
+
+typedef struct ForkJoin_struct {
+    pthread_mutex_t mMutex;
+    pthread_cond_t mCondFork;   ///< Signalled when mGeneration is incremented or on shutdown
+    pthread_cond_t mCondJoin;   ///< Signalled when mPending reaches zero
+    unsigned mNumWorkers;
+    unsigned mGeneration;       ///< Incremented by each fork
+    unsigned mPending;          ///< Number of workers which have not finished the current fork
+    int mShutdown;
+    ForkJoinWork mWork;
+    void *mContext;
+    ForkJoinWorker mWorkers[FORKJOIN_MAX_WORKERS];
+} ForkJoin;
+
+/** \brief Return a new pool of numWorkers threads, or NULL if they could not be started */
+extern ForkJoin *ForkJoin_create(unsigned numWorkers);
+
+/** \brief Stop and join the worker threads, which must not be running a fork */
+extern void ForkJoin_destroy(ForkJoin *forkJoin);
+
+/** \brief Start each worker running work(context, worker), and return without waiting */
+extern void ForkJoin_fork(ForkJoin *forkJoin, ForkJoinWork work, void *context);
+
+/** \brief Wait for all workers to finish the current fork.  Returns whether they finished within
+ *  timeoutNs nanoseconds of the call; if not, it keeps waiting, as the workers might still
+ *  be using the caller's data, and returns 0 when they are done.
+ */
+extern int ForkJoin_join(ForkJoin *forkJoin, unsigned timeoutNs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // !defined(__forkjoin_h)
@@ -0,0 +1,1748 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file mixer.c Track mixer kernels */
+
+#include "mixer.h"
+#include <math.h>
+#include <stddef.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#define MIXER_X86
+#endif
+
+
+/** \brief Saturate a 32-bit intermediate result to 16 bits */
+
+static inline short clamp16(long sample)
+{
+    if (sample > 32767) {
+        return 32767;
+    }
+    if (sample < -32768) {
+        return -32768;
+    }
+    return (short) sample;
+}
+
+
+// Portable scalar kernels, also used for the tail of each vectorized kernel.
+// Products are rounded to nearest (lrintf) so the results match the vector conversions exactly.
+
+static void mix_copy_gain_scalar(short *dst, const short *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    for ( ; frames > 0; --frames, dst += 2, src += 2) {
+        dst[0] = clamp16(lrintf(src[0] * gainLeft));
+        dst[1] = clamp16(lrintf(src[1] * gainRight));
+    }
+}
+
+static void mix_add_gain_scalar(short *dst, const short *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    for ( ; frames > 0; --frames, dst += 2, src += 2) {
+        dst[0] = clamp16((long) dst[0] + clamp16(lrintf(src[0] * gainLeft)));
+        dst[1] = clamp16((long) dst[1] + clamp16(lrintf(src[1] * gainRight)));
+    }
+}
+
+static void mix_add_scalar(short *dst, const short *src, unsigned frames)
+{
+    unsigned samples = frames * 2;
+    for ( ; samples > 0; --samples, ++dst, ++src) {
+        *dst = clamp16((long) *dst + *src);
+    }
+}
+
+// Bus samples are normalized so that 16-bit full scale is +/-1.0
+
+#define S16_TO_FLOAT (1.0f / 32768.0f)
+#define FLOAT_TO_S16 32768.0f
+
+static void mix_load_scalar(float *bus, const short *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    gainLeft *= S16_TO_FLOAT;
+    gainRight *= S16_TO_FLOAT;
+    for ( ; frames > 0; --frames, bus += 2, src += 2) {
+        bus[0] = src[0] * gainLeft;
+        bus[1] = src[1] * gainRight;
+    }
+}
+
+static void mix_accumulate_scalar(float *bus, const short *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    gainLeft *= S16_TO_FLOAT;
+    gainRight *= S16_TO_FLOAT;
+    for ( ; frames > 0; --frames, bus += 2, src += 2) {
+        bus[0] += src[0] * gainLeft;
+        bus[1] += src[1] * gainRight;
+    }
+}
+
+static void mix_clamp_scalar(short *dst, const float *bus, unsigned frames)
+{
+    unsigned samples = frames * 2;
+    for ( ; samples > 0; --samples, ++dst, ++bus) {
+        float sample = *bus * FLOAT_TO_S16;
+        if (sample > 32767.0f) {
+            sample = 32767.0f;
+        } else if (sample < -32768.0f) {
+            sample = -32768.0f;
+        }
+        *dst = (short) lrintf(sample);
+    }
+}
+
+static void mix_load_float_scalar(float *bus, const float *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    for ( ; frames > 0; --frames, bus += 2, src += 2) {
+        bus[0] = src[0] * gainLeft;
+        bus[1] = src[1] * gainRight;
+    }
+}
+
+static void mix_accumulate_float_scalar(float *bus, const float *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    for ( ; frames > 0; --frames, bus += 2, src += 2) {
+        bus[0] += src[0] * gainLeft;
+        bus[1] += src[1] * gainRight;
+    }
+}
+
+static void mix_filter_scalar(float *out, const float *left, const float *right,
+    const float *coefs0, const float *coefs1, float fraction, unsigned taps)
+{
+    float sumLeft = 0.0f, sumRight = 0.0f;
+    for ( ; taps > 0; --taps) {
+        float coef = *coefs0 + fraction * (*coefs1++ - *coefs0);
+        ++coefs0;
+        sumLeft += *left++ * coef;
+        sumRight += *right++ * coef;
+    }
+    out[0] = sumLeft;
+    out[1] = sumRight;
+}
+
+static void mix_downmix_scalar(float *dst, const short *src, unsigned frames, unsigned channels,
+    const float *matrix)
+{
+    float left[MIX_MAX_CHANNELS], right[MIX_MAX_CHANNELS];
+    unsigned channel;
+    for (channel = 0; channel < channels; ++channel) {
+        left[channel] = matrix[channel] * S16_TO_FLOAT;
+        right[channel] = matrix[MIX_MAX_CHANNELS + channel] * S16_TO_FLOAT;
+    }
+    for ( ; frames > 0; --frames, dst += 2, src += channels) {
+        float sumLeft = 0.0f, sumRight = 0.0f;
+        for (channel = 0; channel < channels; ++channel) {
+            sumLeft += src[channel] * left[channel];
+            sumRight += src[channel] * right[channel];
+        }
+        dst[0] = sumLeft;
+        dst[1] = sumRight;
+    }
+}
+
+static void mix_downmix_float_scalar(float *dst, const float *src, unsigned frames,
+    unsigned channels, const float *matrix)
+{
+    const float *left = matrix;
+    const float *right = matrix + MIX_MAX_CHANNELS;
+    unsigned channel;
+    for ( ; frames > 0; --frames, dst += 2, src += channels) {
+        float sumLeft = 0.0f, sumRight = 0.0f;
+        for (channel = 0; channel < channels; ++channel) {
+            sumLeft += src[channel] * left[channel];
+            sumRight += src[channel] * right[channel];
+        }
+        dst[0] = sumLeft;
+        dst[1] = sumRight;
+    }
+}
+
+/** \brief Zero the state of a biquad cascade where it has decayed below audibility, as it would
+ *  otherwise decay into denormals, which are very slow on some CPUs
+ */
+
+static void flush_biquad_state(float *state)
+{
+    unsigned i;
+    for (i = 0; i < MIX_BIQUAD_STATE; ++i) {
+        if (fabsf(state[i]) < 1e-15f) {
+            state[i] = 0.0f;
+        }
+    }
+}
+
+// The state of each channel is the last output of each section, then the two delays of each
+// section: left in state[0] to state[11], and right in state[12] to state[23]
+
+static void mix_biquads_scalar(float *bus, unsigned frames, const MixBiquadCoefs *coefs,
+    float *state)
+{
+    unsigned channel;
+    for (channel = 0; channel < 2; ++channel) {
+        float *y = &state[channel * 3 * MIX_BIQUADS];
+        float *s1 = y + MIX_BIQUADS;
+        float *s2 = s1 + MIX_BIQUADS;
+        float *sample = &bus[channel];
+        unsigned n;
+        for (n = 0; n < frames; ++n, sample += 2) {
+            float x[MIX_BIQUADS];
+            x[0] = *sample;
+            unsigned i;
+            for (i = 1; i < MIX_BIQUADS; ++i) {
+                x[i] = y[i - 1];
+            }
+            for (i = 0; i < MIX_BIQUADS; ++i) {
+                float out = coefs->mB0[i] * x[i] + s1[i];
+                s1[i] = coefs->mB1[i] * x[i] + s2[i] - coefs->mA1[i] * out;
+                s2[i] = coefs->mB2[i] * x[i] - coefs->mA2[i] * out;
+                y[i] = out;
+            }
+            *sample = y[MIX_BIQUADS - 1];
+        }
+    }
+    flush_biquad_state(state);
+}
+
+/** \brief Zero the low pass filters of a feedback delay network where they have decayed below
+ *  audibility, as for the biquads
+ */
+
+static void flush_fdn_state(float *state)
+{
+    unsigned i;
+    for (i = 0; i < MIX_FDN_LINES; ++i) {
+        if (fabsf(state[i]) < 1e-15f) {
+            state[i] = 0.0f;
+        }
+    }
+}
+
+/** \brief In place fast Walsh-Hadamard transform of order MIX_FDN_LINES, one butterfly stage per
+ *  bit of the line index; the vector kernels do the same arithmetic in the same order
+ */
+
+static void hadamard_scalar(float *x)
+{
+    unsigned bit, i;
+    for (bit = 1; bit < MIX_FDN_LINES; bit <<= 1) {
+        for (i = 0; i < MIX_FDN_LINES; ++i) {
+            if (!(i & bit)) {
+                float a = x[i], b = x[i | bit];
+                x[i] = a + b;
+                x[i | bit] = a - b;
+            }
+        }
+    }
+}
+
+/** \brief The frames from first onwards of the feedback delay network, whose rows are frames
+ *  long; also the tail of each vector kernel
+ */
+
+static void fdn_scalar(float *out, float *lines, const float *in, unsigned first, unsigned frames,
+    const MixFdnCoefs *coefs, float *state)
+{
+    unsigned n;
+    for (n = first; n < frames; ++n) {
+        float x[MIX_FDN_LINES];
+        unsigned i;
+        for (i = 0; i < MIX_FDN_LINES; ++i) {
+            float tap = lines[i * frames + n];
+            state[i] = tap + coefs->mDamping[i] * (state[i] - tap);
+            x[i] = state[i];
+        }
+        hadamard_scalar(x);
+        float left = 0.0f, right = 0.0f;
+        for (i = 0; i < MIX_FDN_LINES; ++i) {
+            float feedback = x[i] * coefs->mFeedback[i] + in[n] * coefs->mInput[i];
+            lines[i * frames + n] = feedback;
+            left += feedback * coefs->mLeft[i];
+            right += feedback * coefs->mRight[i];
+        }
+        out[n * 2] = left;
+        out[n * 2 + 1] = right;
+    }
+}
+
+static void mix_fdn_scalar(float *out, float *lines, const float *in, unsigned frames,
+    const MixFdnCoefs *coefs, float *state)
+{
+    fdn_scalar(out, lines, in, 0, frames, coefs, state);
+    flush_fdn_state(state);
+}
+
+static float mix_peak_scalar(const float *bus, unsigned frames)
+{
+    float peak = 0.0f;
+    unsigned samples = frames * 2;
+    for ( ; samples > 0; --samples, ++bus) {
+        float magnitude = fabsf(*bus);
+        if (magnitude > peak) {
+            peak = magnitude;
+        }
+    }
+    return peak;
+}
+
+/** \brief The crossfeed from frame first to frames, for the tails of the vector kernels */
+
+static void crossfeed_scalar(float *bus, const float *left, const float *right, unsigned first,
+    unsigned frames, const MixCrossfeedCoefs *coefs)
+{
+    unsigned n;
+    for (n = first; n < frames; ++n) {
+        float sumLeft = left[n] * coefs->mDirect;
+        float sumRight = right[n] * coefs->mDirect;
+        int i;
+        for (i = 0; i < MIX_CROSSFEED_TAPS; ++i) {
+            sumLeft += right[(int) n - i] * coefs->mCross[i];
+            sumRight += left[(int) n - i] * coefs->mCross[i];
+        }
+        bus[2 * n] = sumLeft;
+        bus[2 * n + 1] = sumRight;
+    }
+}
+
+static void mix_crossfeed_scalar(float *bus, const float *left, const float *right,
+    unsigned frames, const MixCrossfeedCoefs *coefs)
+{
+    crossfeed_scalar(bus, left, right, 0, frames, coefs);
+}
+
+/** \brief The butterflies of one block from k = first, for the tails of the vector kernels */
+
+static void butterflies_scalar(float *re, float *im, unsigned first, unsigned half,
+    const float *twiddleRe, const float *twiddleIm)
+{
+    unsigned k;
+    for (k = first; k < half; ++k) {
+        float tRe = re[half + k] * twiddleRe[k] - im[half + k] * twiddleIm[k];
+        float tIm = re[half + k] * twiddleIm[k] + im[half + k] * twiddleRe[k];
+        re[half + k] = re[k] - tRe;
+        im[half + k] = im[k] - tIm;
+        re[k] += tRe;
+        im[k] += tIm;
+    }
+}
+
+static void mix_butterflies_scalar(float *re, float *im, unsigned points, unsigned half,
+    const float *twiddleRe, const float *twiddleIm)
+{
+    unsigned block;
+    for (block = 0; block < points; block += 2 * half) {
+        butterflies_scalar(re + block, im + block, 0, half, twiddleRe, twiddleIm);
+    }
+}
+
+#define SPATIAL_EPSILON 1e-4f   // meters, or a cosine, below which a difference is negligible
+
+/** \brief Spatialize the voices from first to count, for the tails of the vector kernels */
+
+static void spatialize_scalar(float *voices, unsigned stride, unsigned first, unsigned count,
+    const MixListener *listener)
+{
+    unsigned i;
+    for (i = first; i < count; ++i) {
+        float *v = &voices[i];
+        float relative = v[MIX_VOICE_RELATIVE * stride];
+        float world = 1.0f - relative;
+        // from the listener to the voice
+        float dx = v[MIX_VOICE_X * stride] - world * listener->mPosition[0];
+        float dy = v[MIX_VOICE_Y * stride] - world * listener->mPosition[1];
+        float dz = v[MIX_VOICE_Z * stride] - world * listener->mPosition[2];
+        float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+        float inverse = distance > SPATIAL_EPSILON ? 1.0f / distance : 0.0f;
+        // distance attenuation
+        float minDistance = v[MIX_VOICE_MIN_DISTANCE * stride];
+        float maxDistance = v[MIX_VOICE_MAX_DISTANCE * stride];
+        float rolloff = v[MIX_VOICE_ROLLOFF * stride];
+        float clamped = distance < minDistance ? minDistance :
+            distance > maxDistance ? maxDistance : distance;
+        float gain;
+        if (0.0f != v[MIX_VOICE_LINEAR * stride]) {
+            float range = maxDistance - minDistance;
+            gain = 1.0f - rolloff * (clamped - minDistance) /
+                (range > SPATIAL_EPSILON ? range : SPATIAL_EPSILON);
+            if (gain < 0.0f) {
+                gain = 0.0f;
+            }
+        } else {
+            gain = powf(clamped / minDistance, -rolloff);
+        }
+        if (0.0f != v[MIX_VOICE_MUTE * stride] && distance > maxDistance) {
+            gain = 0.0f;
+        }
+        // cone, on the cosine of the angle between the front of the voice and the listener
+        float cosine = 0.0f == inverse ? 1.0f : -(dx * v[MIX_VOICE_FRONT_X * stride] +
+            dy * v[MIX_VOICE_FRONT_Y * stride] + dz * v[MIX_VOICE_FRONT_Z * stride]) * inverse;
+        float inner = v[MIX_VOICE_CONE_INNER * stride];
+        float width = inner - v[MIX_VOICE_CONE_OUTER * stride];
+        float outside = (inner - cosine) / (width > SPATIAL_EPSILON ? width : SPATIAL_EPSILON);
+        outside = outside < 0.0f ? 0.0f : outside > 1.0f ? 1.0f : outside;
+        gain *= 1.0f + outside * (v[MIX_VOICE_CONE_LEVEL * stride] - 1.0f);
+        // constant power panning on the component to the right of the listener
+        float right = relative * dx + world * (dx * listener->mRight[0] +
+            dy * listener->mRight[1] + dz * listener->mRight[2]);
+        float pan = right * inverse;
+        pan = pan < -1.0f ? -1.0f : pan > 1.0f ? 1.0f : pan;
+        v[MIX_VOICE_GAIN_LEFT * stride] = gain * sqrtf(1.0f - pan);
+        v[MIX_VOICE_GAIN_RIGHT * stride] = gain * sqrtf(1.0f + pan);
+        // Doppler shift, from the velocities along the line from the listener to the voice
+        float doppler = v[MIX_VOICE_DOPPLER * stride] * listener->mDopplerFactor * inverse;
+        float approach = world * doppler * (dx * listener->mVelocity[0] +
+            dy * listener->mVelocity[1] + dz * listener->mVelocity[2]);
+        float recede = doppler * (dx * v[MIX_VOICE_VX * stride] + dy * v[MIX_VOICE_VY * stride] +
+            dz * v[MIX_VOICE_VZ * stride]);
+        float limit = 0.5f * MIX_SPEED_OF_SOUND;
+        approach = approach < -limit ? -limit : approach > limit ? limit : approach;
+        recede = recede < -limit ? -limit : recede > limit ? limit : recede;
+        float speed = (MIX_SPEED_OF_SOUND + approach) / (MIX_SPEED_OF_SOUND + recede);
+        v[MIX_VOICE_SPEED * stride] = speed < MIX_SPEED_MIN ? MIX_SPEED_MIN :
+            speed > MIX_SPEED_MAX ? MIX_SPEED_MAX : speed;
+    }
+}
+
+static void mix_spatialize_scalar(float *voices, unsigned stride, unsigned count,
+    const MixListener *listener)
+{
+    spatialize_scalar(voices, stride, 0, count, listener);
+}
+
+/** \brief Correlate the offsets from first to offsets, for the tails of the vector kernels */
+
+static void correlate_scalar(float *scores, const float *reference, const float *signal,
+    unsigned length, unsigned first, unsigned offsets)
+{
+    unsigned k, i;
+    for (k = first; k < offsets; ++k) {
+        float sum = 0.0f;
+        for (i = 0; i < length; ++i) {
+            sum += reference[i] * signal[k + i];
+        }
+        scores[k] = sum;
+    }
+}
+
+static void mix_correlate_scalar(float *scores, const float *reference, const float *signal,
+    unsigned length, unsigned offsets)
+{
+    correlate_scalar(scores, reference, signal, length, 0, offsets);
+}
+
+const MixKernels MixKernels_scalar = {
+    "scalar",
+    mix_copy_gain_scalar,
+    mix_add_gain_scalar,
+    mix_add_scalar,
+    mix_load_scalar,
+    mix_accumulate_scalar,
+    mix_clamp_scalar,
+    mix_load_float_scalar,
+    mix_accumulate_float_scalar,
+    mix_filter_scalar,
+    mix_downmix_scalar,
+    mix_downmix_float_scalar,
+    mix_biquads_scalar,
+    mix_fdn_scalar,
+    mix_peak_scalar,
+    mix_crossfeed_scalar,
+    mix_butterflies_scalar,
+    mix_spatialize_scalar,
+    mix_correlate_scalar
+};
+
+
+#ifdef MIXER_X86
+
+// SSE2 kernels process 4 stereo frames (one 128-bit vector of 16-bit samples) per iteration
+
+/** \brief Multiply 8 interleaved samples by per-channel gains, with rounding and saturation */
+
+__attribute__((target("sse2")))
+static inline __m128i mul_gain_sse2(__m128i x, __m128 gains)
+{
+    // sign-extend to 32 bits by duplicating each sample into the upper half then shifting down
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+    lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(lo), gains));
+    hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(hi), gains));
+    return _mm_packs_epi32(lo, hi);
+}
+
+__attribute__((target("sse2")))
+static void mix_copy_gain_sse2(short *dst, const short *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    __m128 gains = _mm_setr_ps(gainLeft, gainRight, gainLeft, gainRight);
+    for ( ; frames >= 4; frames -= 4, dst += 8, src += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *) src);
+        _mm_storeu_si128((__m128i *) dst, mul_gain_sse2(x, gains));
+    }
+    mix_copy_gain_scalar(dst, src, frames, gainLeft, gainRight);
+}
+
+__attribute__((target("sse2")))
+static void mix_add_gain_sse2(short *dst, const short *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    __m128 gains = _mm_setr_ps(gainLeft, gainRight, gainLeft, gainRight);
+    for ( ; frames >= 4; frames -= 4, dst += 8, src += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *) src);
+        __m128i y = _mm_loadu_si128((const __m128i *) dst);
+        _mm_storeu_si128((__m128i *) dst, _mm_adds_epi16(y, mul_gain_sse2(x, gains)));
+    }
+    mix_add_gain_scalar(dst, src, frames, gainLeft, gainRight);
+}
+
+__attribute__((target("sse2")))
+static void mix_add_sse2(short *dst, const short *src, unsigned frames)
+{
+    for ( ; frames >= 4; frames -= 4, dst += 8, src += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *) src);
+        __m128i y = _mm_loadu_si128((const __m128i *) dst);
+        _mm_storeu_si128((__m128i *) dst, _mm_adds_epi16(y, x));
+    }
+    mix_add_scalar(dst, src, frames);
+}
+
+/** \brief Convert 8 interleaved samples to float and multiply by per-channel gains */
+
+__attribute__((target("sse2")))
+static inline void widen_gain_sse2(__m128i x, __m128 gains, __m128 *lo, __m128 *hi)
+{
+    *lo = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)), gains);
+    *hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16)), gains);
+}
+
+__attribute__((target("sse2")))
+static void mix_load_sse2(float *bus, const short *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    __m128 gains = _mm_setr_ps(gainLeft * S16_TO_FLOAT, gainRight * S16_TO_FLOAT,
+        gainLeft * S16_TO_FLOAT, gainRight * S16_TO_FLOAT);
+    for ( ; frames >= 4; frames -= 4, bus += 8, src += 8) {
+        __m128 lo, hi;
+        widen_gain_sse2(_mm_loadu_si128((const __m128i *) src), gains, &lo, &hi);
+        _mm_storeu_ps(bus, lo);
+        _mm_storeu_ps(bus + 4, hi);
+    }
+    mix_load_scalar(bus, src, frames, gainLeft, gainRight);
+}
+
+__attribute__((target("sse2")))
+static void mix_accumulate_sse2(float *bus, const short *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    __m128 gains = _mm_setr_ps(gainLeft * S16_TO_FLOAT, gainRight * S16_TO_FLOAT,
+        gainLeft * S16_TO_FLOAT, gainRight * S16_TO_FLOAT);
+    for ( ; frames >= 4; frames -= 4, bus += 8, src += 8) {
+        __m128 lo, hi;
+        widen_gain_sse2(_mm_loadu_si128((const __m128i *) src), gains, &lo, &hi);
+        _mm_storeu_ps(bus, _mm_add_ps(_mm_loadu_ps(bus), lo));
+        _mm_storeu_ps(bus + 4, _mm_add_ps(_mm_loadu_ps(bus + 4), hi));
+    }
+    mix_accumulate_scalar(bus, src, frames, gainLeft, gainRight);
+}
+
+__attribute__((target("sse2")))
+static void mix_clamp_sse2(short *dst, const float *bus, unsigned frames)
+{
+    const __m128 scale = _mm_set1_ps(FLOAT_TO_S16);
+    const __m128 max = _mm_set1_ps(32767.0f);
+    const __m128 min = _mm_set1_ps(-32768.0f);
+    for ( ; frames >= 4; frames -= 4, dst += 8, bus += 8) {
+        // clamp in float, as the float to int conversion does not saturate
+        __m128 lo = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(bus), scale), max), min);
+        __m128 hi = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(bus + 4), scale), max), min);
+        _mm_storeu_si128((__m128i *) dst,
+            _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi)));
+    }
+    mix_clamp_scalar(dst, bus, frames);
+}
+
+__attribute__((target("sse2")))
+static void mix_load_float_sse2(float *bus, const float *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    __m128 gains = _mm_setr_ps(gainLeft, gainRight, gainLeft, gainRight);
+    for ( ; frames >= 2; frames -= 2, bus += 4, src += 4) {
+        _mm_storeu_ps(bus, _mm_mul_ps(_mm_loadu_ps(src), gains));
+    }
+    mix_load_float_scalar(bus, src, frames, gainLeft, gainRight);
+}
+
+__attribute__((target("sse2")))
+static void mix_accumulate_float_sse2(float *bus, const float *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    __m128 gains = _mm_setr_ps(gainLeft, gainRight, gainLeft, gainRight);
+    for ( ; frames >= 2; frames -= 2, bus += 4, src += 4) {
+        __m128 x = _mm_mul_ps(_mm_loadu_ps(src), gains);
+        _mm_storeu_ps(bus, _mm_add_ps(_mm_loadu_ps(bus), x));
+    }
+    mix_accumulate_float_scalar(bus, src, frames, gainLeft, gainRight);
+}
+
+/** \brief Sum the 4 lanes of each of two vectors, and store the two sums */
+
+__attribute__((target("sse2")))
+static inline void store_sums_sse2(float *out, __m128 a, __m128 b)
+{
+    // a0+a2 a1+a3 b0+b2 b1+b3
+    __m128 pairs = _mm_add_ps(_mm_movelh_ps(a, b), _mm_movehl_ps(b, a));
+    // (a0+a2)+(a1+a3) and (b0+b2)+(b1+b3) in lanes 0 and 2
+    __m128 sums = _mm_add_ps(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(3, 3, 1, 1)));
+    out[0] = _mm_cvtss_f32(sums);
+    out[1] = _mm_cvtss_f32(_mm_movehl_ps(sums, sums));
+}
+
+__attribute__((target("sse2")))
+static void mix_filter_sse2(float *out, const float *left, const float *right,
+    const float *coefs0, const float *coefs1, float fraction, unsigned taps)
+{
+    __m128 f = _mm_set1_ps(fraction);
+    __m128 sumLeft = _mm_setzero_ps(), sumRight = _mm_setzero_ps();
+    for ( ; taps > 0; taps -= 4, left += 4, right += 4, coefs0 += 4, coefs1 += 4) {
+        __m128 c0 = _mm_loadu_ps(coefs0);
+        __m128 coef = _mm_add_ps(c0, _mm_mul_ps(f, _mm_sub_ps(_mm_loadu_ps(coefs1), c0)));
+        sumLeft = _mm_add_ps(sumLeft, _mm_mul_ps(_mm_loadu_ps(left), coef));
+        sumRight = _mm_add_ps(sumRight, _mm_mul_ps(_mm_loadu_ps(right), coef));
+    }
+    store_sums_sse2(out, sumLeft, sumRight);
+}
+
+/** \brief Convert the low 4 of 8 16-bit samples to float */
+
+__attribute__((target("sse2")))
+static inline __m128 widen_lo_sse2(__m128i x)
+{
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+}
+
+__attribute__((target("sse2")))
+static void mix_downmix_sse2(float *dst, const short *src, unsigned frames, unsigned channels,
+    const float *matrix)
+{
+    const __m128 scale = _mm_set1_ps(S16_TO_FLOAT);
+    switch (channels) {
+    case 1:
+        {
+        // 4 frames per iteration, each sample is duplicated then multiplied by the left and right
+        __m128 gains = _mm_mul_ps(_mm_setr_ps(matrix[0], matrix[MIX_MAX_CHANNELS],
+            matrix[0], matrix[MIX_MAX_CHANNELS]), scale);
+        for ( ; frames >= 4; frames -= 4, dst += 8, src += 4) {
+            __m128 x = widen_lo_sse2(_mm_loadl_epi64((const __m128i *) src));
+            _mm_storeu_ps(dst, _mm_mul_ps(_mm_unpacklo_ps(x, x), gains));
+            _mm_storeu_ps(dst + 4, _mm_mul_ps(_mm_unpackhi_ps(x, x), gains));
+        }
+        }
+        break;
+    case 4:
+        {
+        __m128 left = _mm_mul_ps(_mm_loadu_ps(matrix), scale);
+        __m128 right = _mm_mul_ps(_mm_loadu_ps(matrix + MIX_MAX_CHANNELS), scale);
+        for ( ; frames > 0; --frames, dst += 2, src += 4) {
+            __m128 x = widen_lo_sse2(_mm_loadl_epi64((const __m128i *) src));
+            store_sums_sse2(dst, _mm_mul_ps(x, left), _mm_mul_ps(x, right));
+        }
+        }
+        break;
+    case 6:
+    case 8:
+        {
+        __m128 leftLo = _mm_mul_ps(_mm_loadu_ps(matrix), scale);
+        __m128 leftHi = _mm_mul_ps(_mm_loadu_ps(matrix + 4), scale);
+        __m128 rightLo = _mm_mul_ps(_mm_loadu_ps(matrix + MIX_MAX_CHANNELS), scale);
+        __m128 rightHi = _mm_mul_ps(_mm_loadu_ps(matrix + MIX_MAX_CHANNELS + 4), scale);
+        // each iteration loads 8 samples, so for 5.1 the last frame is left to the scalar code
+        // rather than read past the end of the source; the extra samples have zero coefficients
+        for ( ; frames > (8 == channels ? 0 : 1); --frames, dst += 2, src += channels) {
+            __m128i x = _mm_loadu_si128((const __m128i *) src);
+            __m128 lo = widen_lo_sse2(x);
+            __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+            store_sums_sse2(dst,
+                _mm_add_ps(_mm_mul_ps(lo, leftLo), _mm_mul_ps(hi, leftHi)),
+                _mm_add_ps(_mm_mul_ps(lo, rightLo), _mm_mul_ps(hi, rightHi)));
+        }
+        }
+        break;
+    default:
+        break;
+    }
+    mix_downmix_scalar(dst, src, frames, channels, matrix);
+}
+
+__attribute__((target("sse2")))
+static void mix_downmix_float_sse2(float *dst, const float *src, unsigned frames,
+    unsigned channels, const float *matrix)
+{
+    // 4 frames per iteration, with each channel gathered across the frames, so the sums are
+    // in the same order as the scalar code for any channel count
+    unsigned stride = channels * 4;
+    for ( ; frames >= 4; frames -= 4, dst += 8, src += stride) {
+        __m128 sumLeft = _mm_setzero_ps(), sumRight = _mm_setzero_ps();
+        unsigned channel;
+        for (channel = 0; channel < channels; ++channel) {
+            const float *x = &src[channel];
+            __m128 v = _mm_setr_ps(x[0], x[channels], x[2 * channels], x[3 * channels]);
+            sumLeft = _mm_add_ps(sumLeft, _mm_mul_ps(v, _mm_set1_ps(matrix[channel])));
+            sumRight = _mm_add_ps(sumRight,
+                _mm_mul_ps(v, _mm_set1_ps(matrix[MIX_MAX_CHANNELS + channel])));
+        }
+        _mm_storeu_ps(dst, _mm_unpacklo_ps(sumLeft, sumRight));
+        _mm_storeu_ps(dst + 4, _mm_unpackhi_ps(sumLeft, sumRight));
+    }
+    mix_downmix_float_scalar(dst, src, frames, channels, matrix);
+}
+
+/** \brief One frame of a pipelined biquad cascade on one channel, with a section in each lane */
+
+__attribute__((target("sse2")))
+static inline __m128 biquads_step_sse2(float sample, __m128 *y, __m128 *s1, __m128 *s2,
+    __m128 b0, __m128 b1, __m128 b2, __m128 a1, __m128 a2)
+{
+    // each section's last output moves up a lane to the input of the next, and the sample
+    // enters the first
+    __m128 x = _mm_move_ss(_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(*y), 4)),
+        _mm_set_ss(sample));
+    __m128 out = _mm_add_ps(_mm_mul_ps(b0, x), *s1);
+    *s1 = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(b1, x), *s2), _mm_mul_ps(a1, out));
+    *s2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, out));
+    *y = out;
+    return out;
+}
+
+__attribute__((target("sse2")))
+static void mix_biquads_sse2(float *bus, unsigned frames, const MixBiquadCoefs *coefs,
+    float *state)
+{
+    __m128 b0 = _mm_loadu_ps(coefs->mB0), b1 = _mm_loadu_ps(coefs->mB1);
+    __m128 b2 = _mm_loadu_ps(coefs->mB2), a1 = _mm_loadu_ps(coefs->mA1);
+    __m128 a2 = _mm_loadu_ps(coefs->mA2);
+    __m128 yLeft = _mm_loadu_ps(&state[0]), s1Left = _mm_loadu_ps(&state[4]);
+    __m128 s2Left = _mm_loadu_ps(&state[8]);
+    __m128 yRight = _mm_loadu_ps(&state[12]), s1Right = _mm_loadu_ps(&state[16]);
+    __m128 s2Right = _mm_loadu_ps(&state[20]);
+    // the two channels are independent, so their dependency chains overlap
+    for ( ; frames > 0; --frames, bus += 2) {
+        __m128 left = biquads_step_sse2(bus[0], &yLeft, &s1Left, &s2Left, b0, b1, b2, a1, a2);
+        __m128 right = biquads_step_sse2(bus[1], &yRight, &s1Right, &s2Right, b0, b1, b2, a1,
+            a2);
+        // the outputs of the last sections, in lane 3
+        _mm_storeh_pi((__m64 *) bus, _mm_unpackhi_ps(left, right));
+    }
+    _mm_storeu_ps(&state[0], yLeft);
+    _mm_storeu_ps(&state[4], s1Left);
+    _mm_storeu_ps(&state[8], s2Left);
+    _mm_storeu_ps(&state[12], yRight);
+    _mm_storeu_ps(&state[16], s1Right);
+    _mm_storeu_ps(&state[20], s2Right);
+    flush_biquad_state(state);
+}
+
+/** \brief Walsh-Hadamard transform of one frame of the feedback delay network, with lines 0 to 3
+ *  in lo and 4 to 7 in hi; each butterfly adds the other line of the pair times +1 or -1
+ */
+
+__attribute__((target("sse2")))
+static inline void hadamard_sse2(__m128 *lo, __m128 *hi)
+{
+    const __m128 sign1 = _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f);
+    const __m128 sign2 = _mm_setr_ps(1.0f, 1.0f, -1.0f, -1.0f);
+    __m128 a = *lo, b = *hi;
+    a = _mm_add_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 0, 0)),
+        _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 1, 1)), sign1));
+    b = _mm_add_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 0, 0)),
+        _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 1, 1)), sign1));
+    a = _mm_add_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 2, 3, 2)), sign2));
+    b = _mm_add_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 2, 3, 2)), sign2));
+    *lo = _mm_add_ps(a, b);
+    *hi = _mm_sub_ps(a, b);
+}
+
+__attribute__((target("sse2")))
+static void mix_fdn_sse2(float *out, float *lines, const float *in, unsigned frames,
+    const MixFdnCoefs *coefs, float *state)
+{
+    __m128 dampLo = _mm_loadu_ps(coefs->mDamping), dampHi = _mm_loadu_ps(coefs->mDamping + 4);
+    __m128 feedLo = _mm_loadu_ps(coefs->mFeedback), feedHi = _mm_loadu_ps(coefs->mFeedback + 4);
+    __m128 inLo = _mm_loadu_ps(coefs->mInput), inHi = _mm_loadu_ps(coefs->mInput + 4);
+    __m128 lpLo = _mm_loadu_ps(state), lpHi = _mm_loadu_ps(state + 4);
+    // 4 frames per iteration: the rows are read 4 frames at a time, and transposed so that
+    // each frame is a vector of lines, then transposed back to be written
+    unsigned n;
+    for (n = 0; n + 4 <= frames; n += 4) {
+        __m128 lo[4], hi[4];
+        unsigned i;
+        for (i = 0; i < 4; ++i) {
+            lo[i] = _mm_loadu_ps(&lines[i * frames + n]);
+            hi[i] = _mm_loadu_ps(&lines[(i + 4) * frames + n]);
+        }
+        _MM_TRANSPOSE4_PS(lo[0], lo[1], lo[2], lo[3]);
+        _MM_TRANSPOSE4_PS(hi[0], hi[1], hi[2], hi[3]);
+        for (i = 0; i < 4; ++i) {
+            lpLo = _mm_add_ps(lo[i], _mm_mul_ps(dampLo, _mm_sub_ps(lpLo, lo[i])));
+            lpHi = _mm_add_ps(hi[i], _mm_mul_ps(dampHi, _mm_sub_ps(lpHi, hi[i])));
+            __m128 a = lpLo, b = lpHi;
+            hadamard_sse2(&a, &b);
+            __m128 x = _mm_set1_ps(in[n + i]);
+            lo[i] = _mm_add_ps(_mm_mul_ps(a, feedLo), _mm_mul_ps(x, inLo));
+            hi[i] = _mm_add_ps(_mm_mul_ps(b, feedHi), _mm_mul_ps(x, inHi));
+        }
+        _MM_TRANSPOSE4_PS(lo[0], lo[1], lo[2], lo[3]);
+        _MM_TRANSPOSE4_PS(hi[0], hi[1], hi[2], hi[3]);
+        // the outputs are summed line by line, in the same order as the scalar kernel
+        __m128 left = _mm_setzero_ps(), right = _mm_setzero_ps();
+        for (i = 0; i < 4; ++i) {
+            _mm_storeu_ps(&lines[i * frames + n], lo[i]);
+            left = _mm_add_ps(left, _mm_mul_ps(lo[i], _mm_set1_ps(coefs->mLeft[i])));
+            right = _mm_add_ps(right, _mm_mul_ps(lo[i], _mm_set1_ps(coefs->mRight[i])));
+        }
+        for (i = 0; i < 4; ++i) {
+            _mm_storeu_ps(&lines[(i + 4) * frames + n], hi[i]);
+            left = _mm_add_ps(left, _mm_mul_ps(hi[i], _mm_set1_ps(coefs->mLeft[i + 4])));
+            right = _mm_add_ps(right, _mm_mul_ps(hi[i], _mm_set1_ps(coefs->mRight[i + 4])));
+        }
+        _mm_storeu_ps(&out[n * 2], _mm_unpacklo_ps(left, right));
+        _mm_storeu_ps(&out[n * 2 + 4], _mm_unpackhi_ps(left, right));
+    }
+    _mm_storeu_ps(state, lpLo);
+    _mm_storeu_ps(state + 4, lpHi);
+    fdn_scalar(out, lines, in, n, frames, coefs, state);
+    flush_fdn_state(state);
+}
+
+/** \brief Return the largest of the 4 lanes */
+
+__attribute__((target("sse2")))
+static inline float max_lanes_sse2(__m128 x)
+{
+    x = _mm_max_ps(x, _mm_movehl_ps(x, x));
+    x = _mm_max_ss(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(x);
+}
+
+__attribute__((target("sse2")))
+static float mix_peak_sse2(const float *bus, unsigned frames)
+{
+    __m128 mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 peak = _mm_setzero_ps();
+    for ( ; frames >= 2; frames -= 2, bus += 4) {
+        peak = _mm_max_ps(peak, _mm_and_ps(_mm_loadu_ps(bus), mask));
+    }
+    float tail = mix_peak_scalar(bus, frames);
+    float vector = max_lanes_sse2(peak);
+    return tail > vector ? tail : vector;
+}
+
+__attribute__((target("sse2")))
+static void mix_crossfeed_sse2(float *bus, const float *left, const float *right,
+    unsigned frames, const MixCrossfeedCoefs *coefs)
+{
+    __m128 direct = _mm_set1_ps(coefs->mDirect);
+    unsigned n;
+    for (n = 0; n + 4 <= frames; n += 4) {
+        __m128 sumLeft = _mm_mul_ps(_mm_loadu_ps(&left[n]), direct);
+        __m128 sumRight = _mm_mul_ps(_mm_loadu_ps(&right[n]), direct);
+        int i;
+        for (i = 0; i < MIX_CROSSFEED_TAPS; ++i) {
+            __m128 cross = _mm_set1_ps(coefs->mCross[i]);
+            sumLeft = _mm_add_ps(sumLeft, _mm_mul_ps(_mm_loadu_ps(&right[(int) n - i]), cross));
+            sumRight = _mm_add_ps(sumRight, _mm_mul_ps(_mm_loadu_ps(&left[(int) n - i]), cross));
+        }
+        _mm_storeu_ps(&bus[2 * n], _mm_unpacklo_ps(sumLeft, sumRight));
+        _mm_storeu_ps(&bus[2 * n + 4], _mm_unpackhi_ps(sumLeft, sumRight));
+    }
+    crossfeed_scalar(bus, left, right, n, frames, coefs);
+}
+
+__attribute__((target("sse2")))
+static void mix_butterflies_sse2(float *re, float *im, unsigned points, unsigned half,
+    const float *twiddleRe, const float *twiddleIm)
+{
+    unsigned block;
+    for (block = 0; block < points; block += 2 * half) {
+        float *re0 = re + block, *im0 = im + block;
+        float *re1 = re0 + half, *im1 = im0 + half;
+        unsigned k;
+        // 4 butterflies at a time, so the first two passes are scalar
+        for (k = 0; k + 4 <= half; k += 4) {
+            __m128 wRe = _mm_loadu_ps(&twiddleRe[k]), wIm = _mm_loadu_ps(&twiddleIm[k]);
+            __m128 xRe = _mm_loadu_ps(&re1[k]), xIm = _mm_loadu_ps(&im1[k]);
+            __m128 tRe = _mm_sub_ps(_mm_mul_ps(xRe, wRe), _mm_mul_ps(xIm, wIm));
+            __m128 tIm = _mm_add_ps(_mm_mul_ps(xRe, wIm), _mm_mul_ps(xIm, wRe));
+            __m128 yRe = _mm_loadu_ps(&re0[k]), yIm = _mm_loadu_ps(&im0[k]);
+            _mm_storeu_ps(&re1[k], _mm_sub_ps(yRe, tRe));
+            _mm_storeu_ps(&im1[k], _mm_sub_ps(yIm, tIm));
+            _mm_storeu_ps(&re0[k], _mm_add_ps(yRe, tRe));
+            _mm_storeu_ps(&im0[k], _mm_add_ps(yIm, tIm));
+        }
+        butterflies_scalar(re0, im0, k, half, twiddleRe, twiddleIm);
+    }
+}
+
+/** \brief log2 of positive normal floats, to within about 1e-6 */
+
+__attribute__((target("sse2")))
+static inline __m128 log2_sse2(__m128 x)
+{
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128i bits = _mm_castps_si128(x);
+    __m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23),
+        _mm_set1_epi32(127)));
+    // the mantissa m is from 1 to 2, and ln(m) = 2 atanh(t) where t = (m - 1) / (m + 1) <= 1/3
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)),
+        _mm_set1_epi32(0x3F800000)));
+    __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+    __m128 t2 = _mm_mul_ps(t, t);
+    __m128 series = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(1.0f / 9.0f), t2),
+        _mm_set1_ps(1.0f / 7.0f));
+    series = _mm_add_ps(_mm_mul_ps(series, t2), _mm_set1_ps(1.0f / 5.0f));
+    series = _mm_add_ps(_mm_mul_ps(series, t2), _mm_set1_ps(1.0f / 3.0f));
+    series = _mm_add_ps(_mm_mul_ps(series, t2), one);
+    return _mm_add_ps(exponent,
+        _mm_mul_ps(_mm_mul_ps(series, t), _mm_set1_ps((float) (2.0 / M_LN2))));
+}
+
+/** \brief 2 ^ y, to within about 1e-6 relative, with y clamped to +/-126 */
+
+__attribute__((target("sse2")))
+static inline __m128 exp2_sse2(__m128 y)
+{
+    y = _mm_min_ps(_mm_max_ps(y, _mm_set1_ps(-126.0f)), _mm_set1_ps(126.0f));
+    // the integer part, truncated toward zero, goes into the exponent, and e ^ u, where u is
+    // the rest times ln(2), is a Taylor series
+    __m128i integer = _mm_cvttps_epi32(y);
+    __m128 u = _mm_mul_ps(_mm_sub_ps(y, _mm_cvtepi32_ps(integer)), _mm_set1_ps((float) M_LN2));
+    __m128 series = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(1.0f / 5040.0f), u),
+        _mm_set1_ps(1.0f / 720.0f));
+    series = _mm_add_ps(_mm_mul_ps(series, u), _mm_set1_ps(1.0f / 120.0f));
+    series = _mm_add_ps(_mm_mul_ps(series, u), _mm_set1_ps(1.0f / 24.0f));
+    series = _mm_add_ps(_mm_mul_ps(series, u), _mm_set1_ps(1.0f / 6.0f));
+    series = _mm_add_ps(_mm_mul_ps(series, u), _mm_set1_ps(0.5f));
+    series = _mm_add_ps(_mm_mul_ps(series, u), _mm_set1_ps(1.0f));
+    series = _mm_add_ps(_mm_mul_ps(series, u), _mm_set1_ps(1.0f));
+    __m128i scale = _mm_slli_epi32(_mm_add_epi32(integer, _mm_set1_epi32(127)), 23);
+    return _mm_mul_ps(series, _mm_castsi128_ps(scale));
+}
+
+/** \brief a where mask is set, else b */
+
+__attribute__((target("sse2")))
+static inline __m128 select_sse2(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+__attribute__((target("sse2")))
+static inline __m128 clamp_sse2(__m128 x, __m128 lo, __m128 hi)
+{
+    return _mm_min_ps(_mm_max_ps(x, lo), hi);
+}
+
+__attribute__((target("sse2")))
+static inline __m128 dot_sse2(__m128 x, __m128 y, __m128 z, __m128 a, __m128 b, __m128 c)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, a), _mm_mul_ps(y, b)), _mm_mul_ps(z, c));
+}
+
+__attribute__((target("sse2")))
+static void mix_spatialize_sse2(float *voices, unsigned stride, unsigned count,
+    const MixListener *listener)
+{
+    __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    __m128 epsilon = _mm_set1_ps(SPATIAL_EPSILON);
+    __m128 sound = _mm_set1_ps(MIX_SPEED_OF_SOUND);
+    __m128 limit = _mm_set1_ps(0.5f * MIX_SPEED_OF_SOUND);
+    // as for scalar, but 4 voices at a time, and with selects in place of the branches
+    unsigned i;
+    for (i = 0; i + 4 <= count; i += 4) {
+        float *v = &voices[i];
+        __m128 relative = _mm_loadu_ps(&v[MIX_VOICE_RELATIVE * stride]);
+        __m128 world = _mm_sub_ps(one, relative);
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(&v[MIX_VOICE_X * stride]),
+            _mm_mul_ps(world, _mm_set1_ps(listener->mPosition[0])));
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(&v[MIX_VOICE_Y * stride]),
+            _mm_mul_ps(world, _mm_set1_ps(listener->mPosition[1])));
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(&v[MIX_VOICE_Z * stride]),
+            _mm_mul_ps(world, _mm_set1_ps(listener->mPosition[2])));
+        __m128 distance = _mm_sqrt_ps(dot_sse2(dx, dy, dz, dx, dy, dz));
+        __m128 far = _mm_cmpgt_ps(distance, epsilon);
+        __m128 inverse = _mm_and_ps(far, _mm_div_ps(one, _mm_max_ps(distance, epsilon)));
+        // distance attenuation
+        __m128 minDistance = _mm_loadu_ps(&v[MIX_VOICE_MIN_DISTANCE * stride]);
+        __m128 maxDistance = _mm_loadu_ps(&v[MIX_VOICE_MAX_DISTANCE * stride]);
+        __m128 rolloff = _mm_loadu_ps(&v[MIX_VOICE_ROLLOFF * stride]);
+        __m128 clamped = clamp_sse2(distance, minDistance, maxDistance);
+        __m128 range = _mm_max_ps(_mm_sub_ps(maxDistance, minDistance), epsilon);
+        __m128 linear = _mm_max_ps(_mm_sub_ps(one, _mm_div_ps(_mm_mul_ps(rolloff,
+            _mm_sub_ps(clamped, minDistance)), range)), zero);
+        __m128 exponential = exp2_sse2(_mm_mul_ps(_mm_sub_ps(zero, rolloff),
+            log2_sse2(_mm_div_ps(clamped, minDistance))));
+        __m128 gain = select_sse2(
+            _mm_cmpneq_ps(_mm_loadu_ps(&v[MIX_VOICE_LINEAR * stride]), zero), linear,
+            exponential);
+        __m128 muted = _mm_and_ps(
+            _mm_cmpneq_ps(_mm_loadu_ps(&v[MIX_VOICE_MUTE * stride]), zero),
+            _mm_cmpgt_ps(distance, maxDistance));
+        gain = _mm_andnot_ps(muted, gain);
+        // cone
+        __m128 facing = _mm_mul_ps(dot_sse2(dx, dy, dz,
+            _mm_loadu_ps(&v[MIX_VOICE_FRONT_X * stride]),
+            _mm_loadu_ps(&v[MIX_VOICE_FRONT_Y * stride]),
+            _mm_loadu_ps(&v[MIX_VOICE_FRONT_Z * stride])), inverse);
+        __m128 cosine = select_sse2(far, _mm_sub_ps(zero, facing), one);
+        __m128 inner = _mm_loadu_ps(&v[MIX_VOICE_CONE_INNER * stride]);
+        __m128 width = _mm_max_ps(
+            _mm_sub_ps(inner, _mm_loadu_ps(&v[MIX_VOICE_CONE_OUTER * stride])), epsilon);
+        __m128 outside = clamp_sse2(_mm_div_ps(_mm_sub_ps(inner, cosine), width), zero, one);
+        gain = _mm_mul_ps(gain, _mm_add_ps(one, _mm_mul_ps(outside,
+            _mm_sub_ps(_mm_loadu_ps(&v[MIX_VOICE_CONE_LEVEL * stride]), one))));
+        // panning
+        __m128 right = _mm_add_ps(_mm_mul_ps(relative, dx), _mm_mul_ps(world, dot_sse2(dx, dy, dz,
+            _mm_set1_ps(listener->mRight[0]), _mm_set1_ps(listener->mRight[1]),
+            _mm_set1_ps(listener->mRight[2]))));
+        __m128 pan = clamp_sse2(_mm_mul_ps(right, inverse), _mm_sub_ps(zero, one), one);
+        _mm_storeu_ps(&v[MIX_VOICE_GAIN_LEFT * stride],
+            _mm_mul_ps(gain, _mm_sqrt_ps(_mm_sub_ps(one, pan))));
+        _mm_storeu_ps(&v[MIX_VOICE_GAIN_RIGHT * stride],
+            _mm_mul_ps(gain, _mm_sqrt_ps(_mm_add_ps(one, pan))));
+        // Doppler shift
+        __m128 doppler = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&v[MIX_VOICE_DOPPLER * stride]),
+            _mm_set1_ps(listener->mDopplerFactor)), inverse);
+        __m128 approach = _mm_mul_ps(_mm_mul_ps(world, doppler), dot_sse2(dx, dy, dz,
+            _mm_set1_ps(listener->mVelocity[0]), _mm_set1_ps(listener->mVelocity[1]),
+            _mm_set1_ps(listener->mVelocity[2])));
+        __m128 recede = _mm_mul_ps(doppler, dot_sse2(dx, dy, dz,
+            _mm_loadu_ps(&v[MIX_VOICE_VX * stride]), _mm_loadu_ps(&v[MIX_VOICE_VY * stride]),
+            _mm_loadu_ps(&v[MIX_VOICE_VZ * stride])));
+        approach = clamp_sse2(approach, _mm_sub_ps(zero, limit), limit);
+        recede = clamp_sse2(recede, _mm_sub_ps(zero, limit), limit);
+        __m128 speed = _mm_div_ps(_mm_add_ps(sound, approach), _mm_add_ps(sound, recede));
+        _mm_storeu_ps(&v[MIX_VOICE_SPEED * stride], clamp_sse2(speed,
+            _mm_set1_ps(MIX_SPEED_MIN), _mm_set1_ps(MIX_SPEED_MAX)));
+    }
+    spatialize_scalar(voices, stride, i, count, listener);
+}
+
+/** \brief Vectorized over the offsets, so that each reference sample is broadcast once and
+ *  the signal is read with unaligned loads, and there is no horizontal sum
+ */
+
+__attribute__((target("sse2")))
+static void mix_correlate_sse2(float *scores, const float *reference, const float *signal,
+    unsigned length, unsigned offsets)
+{
+    unsigned k, i;
+    for (k = 0; k + 8 <= offsets; k += 8) {
+        __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+        for (i = 0; i < length; ++i) {
+            __m128 r = _mm_set1_ps(reference[i]);
+            sum0 = _mm_add_ps(sum0, _mm_mul_ps(r, _mm_loadu_ps(&signal[k + i])));
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(r, _mm_loadu_ps(&signal[k + i + 4])));
+        }
+        _mm_storeu_ps(&scores[k], sum0);
+        _mm_storeu_ps(&scores[k + 4], sum1);
+    }
+    correlate_scalar(scores, reference, signal, length, k, offsets);
+}
+
+const MixKernels MixKernels_sse2 = {
+    "sse2",
+    mix_copy_gain_sse2,
+    mix_add_gain_sse2,
+    mix_add_sse2,
+    mix_load_sse2,
+    mix_accumulate_sse2,
+    mix_clamp_sse2,
+    mix_load_float_sse2,
+    mix_accumulate_float_sse2,
+    mix_filter_sse2,
+    mix_downmix_sse2,
+    mix_downmix_float_sse2,
+    mix_biquads_sse2,
+    mix_fdn_sse2,
+    mix_peak_sse2,
+    mix_crossfeed_sse2,
+    mix_butterflies_sse2,
+    mix_spatialize_sse2,
+    mix_correlate_sse2
+};
+
+
+// AVX2 kernels process 8 stereo frames (one 256-bit vector of 16-bit samples) per iteration
+
+__attribute__((target("avx2")))
+static inline __m256i mul_gain_avx2(__m256i x, __m256 gains)
+{
+    __m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(x));
+    __m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(x, 1));
+    lo = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(lo), gains));
+    hi = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(hi), gains));
+    // packs operates within each 128-bit lane, so restore the sample order afterwards
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+}
+
+__attribute__((target("avx2")))
+static void mix_copy_gain_avx2(short *dst, const short *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    __m256 gains = _mm256_setr_ps(gainLeft, gainRight, gainLeft, gainRight,
+        gainLeft, gainRight, gainLeft, gainRight);
+    for ( ; frames >= 8; frames -= 8, dst += 16, src += 16) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) src);
+        _mm256_storeu_si256((__m256i *) dst, mul_gain_avx2(x, gains));
+    }
+    mix_copy_gain_scalar(dst, src, frames, gainLeft, gainRight);
+}
+
+__attribute__((target("avx2")))
+static void mix_add_gain_avx2(short *dst, const short *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    __m256 gains = _mm256_setr_ps(gainLeft, gainRight, gainLeft, gainRight,
+        gainLeft, gainRight, gainLeft, gainRight);
+    for ( ; frames >= 8; frames -= 8, dst += 16, src += 16) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) src);
+        __m256i y = _mm256_loadu_si256((const __m256i *) dst);
+        _mm256_storeu_si256((__m256i *) dst, _mm256_adds_epi16(y, mul_gain_avx2(x, gains)));
+    }
+    mix_add_gain_scalar(dst, src, frames, gainLeft, gainRight);
+}
+
+__attribute__((target("avx2")))
+static void mix_add_avx2(short *dst, const short *src, unsigned frames)
+{
+    for ( ; frames >= 8; frames -= 8, dst += 16, src += 16) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) src);
+        __m256i y = _mm256_loadu_si256((const __m256i *) dst);
+        _mm256_storeu_si256((__m256i *) dst, _mm256_adds_epi16(y, x));
+    }
+    mix_add_scalar(dst, src, frames);
+}
+
+__attribute__((target("avx2")))
+static inline void widen_gain_avx2(__m256i x, __m256 gains, __m256 *lo, __m256 *hi)
+{
+    *lo = _mm256_mul_ps(_mm256_cvtepi32_ps(
+        _mm256_cvtepi16_epi32(_mm256_castsi256_si128(x))), gains);
+    *hi = _mm256_mul_ps(_mm256_cvtepi32_ps(
+        _mm256_cvtepi16_epi32(_mm256_extracti128_si256(x, 1))), gains);
+}
+
+__attribute__((target("avx2")))
+static void mix_load_avx2(float *bus, const short *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    __m256 gains = _mm256_setr_ps(gainLeft * S16_TO_FLOAT, gainRight * S16_TO_FLOAT,
+        gainLeft * S16_TO_FLOAT, gainRight * S16_TO_FLOAT,
+        gainLeft * S16_TO_FLOAT, gainRight * S16_TO_FLOAT,
+        gainLeft * S16_TO_FLOAT, gainRight * S16_TO_FLOAT);
+    for ( ; frames >= 8; frames -= 8, bus += 16, src += 16) {
+        __m256 lo, hi;
+        widen_gain_avx2(_mm256_loadu_si256((const __m256i *) src), gains, &lo, &hi);
+        _mm256_storeu_ps(bus, lo);
+        _mm256_storeu_ps(bus + 8, hi);
+    }
+    mix_load_scalar(bus, src, frames, gainLeft, gainRight);
+}
+
+__attribute__((target("avx2")))
+static void mix_accumulate_avx2(float *bus, const short *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    __m256 gains = _mm256_setr_ps(gainLeft * S16_TO_FLOAT, gainRight * S16_TO_FLOAT,
+        gainLeft * S16_TO_FLOAT, gainRight * S16_TO_FLOAT,
+        gainLeft * S16_TO_FLOAT, gainRight * S16_TO_FLOAT,
+        gainLeft * S16_TO_FLOAT, gainRight * S16_TO_FLOAT);
+    for ( ; frames >= 8; frames -= 8, bus += 16, src += 16) {
+        __m256 lo, hi;
+        widen_gain_avx2(_mm256_loadu_si256((const __m256i *) src), gains, &lo, &hi);
+        _mm256_storeu_ps(bus, _mm256_add_ps(_mm256_loadu_ps(bus), lo));
+        _mm256_storeu_ps(bus + 8, _mm256_add_ps(_mm256_loadu_ps(bus + 8), hi));
+    }
+    mix_accumulate_scalar(bus, src, frames, gainLeft, gainRight);
+}
+
+__attribute__((target("avx2")))
+static void mix_clamp_avx2(short *dst, const float *bus, unsigned frames)
+{
+    const __m256 scale = _mm256_set1_ps(FLOAT_TO_S16);
+    const __m256 max = _mm256_set1_ps(32767.0f);
+    const __m256 min = _mm256_set1_ps(-32768.0f);
+    for ( ; frames >= 8; frames -= 8, dst += 16, bus += 16) {
+        __m256 lo = _mm256_max_ps(_mm256_min_ps(
+            _mm256_mul_ps(_mm256_loadu_ps(bus), scale), max), min);
+        __m256 hi = _mm256_max_ps(_mm256_min_ps(
+            _mm256_mul_ps(_mm256_loadu_ps(bus + 8), scale), max), min);
+        __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(lo), _mm256_cvtps_epi32(hi));
+        _mm256_storeu_si256((__m256i *) dst, _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    mix_clamp_scalar(dst, bus, frames);
+}
+
+__attribute__((target("avx2")))
+static void mix_load_float_avx2(float *bus, const float *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    __m256 gains = _mm256_setr_ps(gainLeft, gainRight, gainLeft, gainRight,
+        gainLeft, gainRight, gainLeft, gainRight);
+    for ( ; frames >= 4; frames -= 4, bus += 8, src += 8) {
+        _mm256_storeu_ps(bus, _mm256_mul_ps(_mm256_loadu_ps(src), gains));
+    }
+    mix_load_float_scalar(bus, src, frames, gainLeft, gainRight);
+}
+
+__attribute__((target("avx2")))
+static void mix_accumulate_float_avx2(float *bus, const float *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    __m256 gains = _mm256_setr_ps(gainLeft, gainRight, gainLeft, gainRight,
+        gainLeft, gainRight, gainLeft, gainRight);
+    for ( ; frames >= 4; frames -= 4, bus += 8, src += 8) {
+        __m256 x = _mm256_mul_ps(_mm256_loadu_ps(src), gains);
+        _mm256_storeu_ps(bus, _mm256_add_ps(_mm256_loadu_ps(bus), x));
+    }
+    mix_accumulate_float_scalar(bus, src, frames, gainLeft, gainRight);
+}
+
+__attribute__((target("avx2")))
+static void mix_filter_avx2(float *out, const float *left, const float *right,
+    const float *coefs0, const float *coefs1, float fraction, unsigned taps)
+{
+    __m256 f = _mm256_set1_ps(fraction);
+    __m256 sumLeft = _mm256_setzero_ps(), sumRight = _mm256_setzero_ps();
+    for ( ; taps > 0; taps -= 8, left += 8, right += 8, coefs0 += 8, coefs1 += 8) {
+        __m256 c0 = _mm256_loadu_ps(coefs0);
+        __m256 coef = _mm256_add_ps(c0,
+            _mm256_mul_ps(f, _mm256_sub_ps(_mm256_loadu_ps(coefs1), c0)));
+        sumLeft = _mm256_add_ps(sumLeft, _mm256_mul_ps(_mm256_loadu_ps(left), coef));
+        sumRight = _mm256_add_ps(sumRight, _mm256_mul_ps(_mm256_loadu_ps(right), coef));
+    }
+    store_sums_sse2(out,
+        _mm_add_ps(_mm256_castps256_ps128(sumLeft), _mm256_extractf128_ps(sumLeft, 1)),
+        _mm_add_ps(_mm256_castps256_ps128(sumRight), _mm256_extractf128_ps(sumRight, 1)));
+}
+
+__attribute__((target("avx2")))
+static void mix_downmix_avx2(float *dst, const short *src, unsigned frames, unsigned channels,
+    const float *matrix)
+{
+    const __m256 scale = _mm256_set1_ps(S16_TO_FLOAT);
+    switch (channels) {
+    case 1:
+        {
+        __m256 gains = _mm256_mul_ps(_mm256_setr_ps(
+            matrix[0], matrix[MIX_MAX_CHANNELS], matrix[0], matrix[MIX_MAX_CHANNELS],
+            matrix[0], matrix[MIX_MAX_CHANNELS], matrix[0], matrix[MIX_MAX_CHANNELS]), scale);
+        for ( ; frames >= 8; frames -= 8, dst += 16, src += 8) {
+            __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(
+                _mm_loadu_si128((const __m128i *) src)));
+            // unpack duplicates within each 128-bit lane, so swap the middle halves afterwards
+            __m256 lo = _mm256_unpacklo_ps(x, x);
+            __m256 hi = _mm256_unpackhi_ps(x, x);
+            _mm256_storeu_ps(dst, _mm256_mul_ps(_mm256_permute2f128_ps(lo, hi, 0x20), gains));
+            _mm256_storeu_ps(dst + 8,
+                _mm256_mul_ps(_mm256_permute2f128_ps(lo, hi, 0x31), gains));
+        }
+        }
+        break;
+    case 4:
+        {
+        // 2 frames per iteration, one in each 128-bit lane
+        __m256 left = _mm256_mul_ps(_mm256_broadcast_ps((const __m128 *) matrix), scale);
+        __m256 right = _mm256_mul_ps(
+            _mm256_broadcast_ps((const __m128 *) (matrix + MIX_MAX_CHANNELS)), scale);
+        for ( ; frames >= 2; frames -= 2, dst += 4, src += 8) {
+            __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(
+                _mm_loadu_si128((const __m128i *) src)));
+            // per lane: l0+l1 l2+l3 r0+r1 r2+r3, then L R L R
+            __m256 sums = _mm256_hadd_ps(_mm256_mul_ps(x, left), _mm256_mul_ps(x, right));
+            sums = _mm256_hadd_ps(sums, sums);
+            _mm_storeu_ps(dst, _mm_movelh_ps(_mm256_castps256_ps128(sums),
+                _mm256_extractf128_ps(sums, 1)));
+        }
+        }
+        break;
+    case 6:
+    case 8:
+        {
+        __m256 left = _mm256_mul_ps(_mm256_loadu_ps(matrix), scale);
+        __m256 right = _mm256_mul_ps(_mm256_loadu_ps(matrix + MIX_MAX_CHANNELS), scale);
+        // as for SSE2, the last frame of 5.1 is left to the scalar code
+        for ( ; frames > (8 == channels ? 0 : 1); --frames, dst += 2, src += channels) {
+            __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(
+                _mm_loadu_si128((const __m128i *) src)));
+            __m256 l = _mm256_mul_ps(x, left);
+            __m256 r = _mm256_mul_ps(x, right);
+            store_sums_sse2(dst,
+                _mm_add_ps(_mm256_castps256_ps128(l), _mm256_extractf128_ps(l, 1)),
+                _mm_add_ps(_mm256_castps256_ps128(r), _mm256_extractf128_ps(r, 1)));
+        }
+        }
+        break;
+    default:
+        break;
+    }
+    mix_downmix_scalar(dst, src, frames, channels, matrix);
+}
+
+__attribute__((target("avx2")))
+static void mix_downmix_float_avx2(float *dst, const float *src, unsigned frames,
+    unsigned channels, const float *matrix)
+{
+    // as for SSE2, but 8 frames per iteration with a hardware gather
+    int c = (int) channels;
+    const __m256i index = _mm256_setr_epi32(0, c, 2 * c, 3 * c, 4 * c, 5 * c, 6 * c, 7 * c);
+    unsigned stride = channels * 8;
+    for ( ; frames >= 8; frames -= 8, dst += 16, src += stride) {
+        __m256 sumLeft = _mm256_setzero_ps(), sumRight = _mm256_setzero_ps();
+        unsigned channel;
+        for (channel = 0; channel < channels; ++channel) {
+            __m256 v = _mm256_i32gather_ps(&src[channel], index, sizeof(float));
+            sumLeft = _mm256_add_ps(sumLeft, _mm256_mul_ps(v, _mm256_set1_ps(matrix[channel])));
+            sumRight = _mm256_add_ps(sumRight,
+                _mm256_mul_ps(v, _mm256_set1_ps(matrix[MIX_MAX_CHANNELS + channel])));
+        }
+        // unpack interleaves within each 128-bit lane, so swap the middle halves afterwards
+        __m256 lo = _mm256_unpacklo_ps(sumLeft, sumRight);
+        __m256 hi = _mm256_unpackhi_ps(sumLeft, sumRight);
+        _mm256_storeu_ps(dst, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(dst + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    mix_downmix_float_scalar(dst, src, frames, channels, matrix);
+}
+
+__attribute__((target("avx2")))
+static void mix_biquads_avx2(float *bus, unsigned frames, const MixBiquadCoefs *coefs,
+    float *state)
+{
+    // both channels at once, with the sections of the left channel in the lower 128-bit lane
+    // and those of the right channel in the upper lane
+    __m256 b0 = _mm256_broadcast_ps((const __m128 *) coefs->mB0);
+    __m256 b1 = _mm256_broadcast_ps((const __m128 *) coefs->mB1);
+    __m256 b2 = _mm256_broadcast_ps((const __m128 *) coefs->mB2);
+    __m256 a1 = _mm256_broadcast_ps((const __m128 *) coefs->mA1);
+    __m256 a2 = _mm256_broadcast_ps((const __m128 *) coefs->mA2);
+    __m256 y = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&state[0])),
+        _mm_loadu_ps(&state[12]), 1);
+    __m256 s1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&state[4])),
+        _mm_loadu_ps(&state[16]), 1);
+    __m256 s2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&state[8])),
+        _mm_loadu_ps(&state[20]), 1);
+    // the left sample goes to lane 0 and the right sample to lane 4
+    const __m256i spread = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+    for ( ; frames > 0; --frames, bus += 2) {
+        __m256 sample = _mm256_permutevar8x32_ps(
+            _mm256_castps128_ps256(_mm_castpd_ps(_mm_load_sd((const double *) bus))), spread);
+        // the shift is within each 128-bit lane, as for SSE2
+        __m256 x = _mm256_blend_ps(_mm256_castsi256_ps(_mm256_slli_si256(
+            _mm256_castps_si256(y), 4)), sample, 0x11);
+        y = _mm256_add_ps(_mm256_mul_ps(b0, x), s1);
+        s1 = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(b1, x), s2), _mm256_mul_ps(a1, y));
+        s2 = _mm256_sub_ps(_mm256_mul_ps(b2, x), _mm256_mul_ps(a2, y));
+        // the outputs of the last sections, in lanes 3 and 7
+        _mm_storeh_pi((__m64 *) bus, _mm_unpackhi_ps(_mm256_castps256_ps128(y),
+            _mm256_extractf128_ps(y, 1)));
+    }
+    _mm_storeu_ps(&state[0], _mm256_castps256_ps128(y));
+    _mm_storeu_ps(&state[4], _mm256_castps256_ps128(s1));
+    _mm_storeu_ps(&state[8], _mm256_castps256_ps128(s2));
+    _mm_storeu_ps(&state[12], _mm256_extractf128_ps(y, 1));
+    _mm_storeu_ps(&state[16], _mm256_extractf128_ps(s1, 1));
+    _mm_storeu_ps(&state[20], _mm256_extractf128_ps(s2, 1));
+    flush_biquad_state(state);
+}
+
+/** \brief Transpose 8 rows of 8 floats in place */
+
+__attribute__((target("avx2")))
+static inline void transpose8_avx2(__m256 *r)
+{
+    __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]), t1 = _mm256_unpackhi_ps(r[0], r[1]);
+    __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]), t3 = _mm256_unpackhi_ps(r[2], r[3]);
+    __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]), t5 = _mm256_unpackhi_ps(r[4], r[5]);
+    __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]), t7 = _mm256_unpackhi_ps(r[6], r[7]);
+    __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+    r[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+    r[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+    r[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+    r[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+    r[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+    r[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+    r[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+    r[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+}
+
+/** \brief Walsh-Hadamard transform of one frame of the feedback delay network, a line per lane */
+
+__attribute__((target("avx2")))
+static inline __m256 hadamard_avx2(__m256 x)
+{
+    const __m256 sign1 = _mm256_setr_ps(1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f);
+    const __m256 sign2 = _mm256_setr_ps(1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f);
+    const __m256 sign4 = _mm256_setr_ps(1.0f, 1.0f, 1.0f, 1.0f, -1.0f, -1.0f, -1.0f, -1.0f);
+    x = _mm256_add_ps(_mm256_permute_ps(x, _MM_SHUFFLE(2, 2, 0, 0)),
+        _mm256_mul_ps(_mm256_permute_ps(x, _MM_SHUFFLE(3, 3, 1, 1)), sign1));
+    x = _mm256_add_ps(_mm256_permute_ps(x, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_mul_ps(_mm256_permute_ps(x, _MM_SHUFFLE(3, 2, 3, 2)), sign2));
+    return _mm256_add_ps(_mm256_permute2f128_ps(x, x, 0x00),
+        _mm256_mul_ps(_mm256_permute2f128_ps(x, x, 0x11), sign4));
+}
+
+__attribute__((target("avx2")))
+static void mix_fdn_avx2(float *out, float *lines, const float *in, unsigned frames,
+    const MixFdnCoefs *coefs, float *state)
+{
+    __m256 damping = _mm256_loadu_ps(coefs->mDamping);
+    __m256 feedback = _mm256_loadu_ps(coefs->mFeedback);
+    __m256 input = _mm256_loadu_ps(coefs->mInput);
+    __m256 lp = _mm256_loadu_ps(state);
+    // as for SSE2, but 8 frames per iteration, and all the lines of a frame in one vector
+    unsigned n;
+    for (n = 0; n + 8 <= frames; n += 8) {
+        __m256 r[MIX_FDN_LINES];
+        unsigned i;
+        for (i = 0; i < MIX_FDN_LINES; ++i) {
+            r[i] = _mm256_loadu_ps(&lines[i * frames + n]);
+        }
+        transpose8_avx2(r);
+        for (i = 0; i < 8; ++i) {
+            lp = _mm256_add_ps(r[i], _mm256_mul_ps(damping, _mm256_sub_ps(lp, r[i])));
+            r[i] = _mm256_add_ps(_mm256_mul_ps(hadamard_avx2(lp), feedback),
+                _mm256_mul_ps(_mm256_set1_ps(in[n + i]), input));
+        }
+        transpose8_avx2(r);
+        __m256 left = _mm256_setzero_ps(), right = _mm256_setzero_ps();
+        for (i = 0; i < MIX_FDN_LINES; ++i) {
+            _mm256_storeu_ps(&lines[i * frames + n], r[i]);
+            left = _mm256_add_ps(left, _mm256_mul_ps(r[i], _mm256_set1_ps(coefs->mLeft[i])));
+            right = _mm256_add_ps(right,
+                _mm256_mul_ps(r[i], _mm256_set1_ps(coefs->mRight[i])));
+        }
+        // unpack interleaves within each 128-bit lane, so swap the middle halves afterwards
+        __m256 lo = _mm256_unpacklo_ps(left, right);
+        __m256 hi = _mm256_unpackhi_ps(left, right);
+        _mm256_storeu_ps(&out[n * 2], _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(&out[n * 2 + 8], _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    _mm256_storeu_ps(state, lp);
+    fdn_scalar(out, lines, in, n, frames, coefs, state);
+    flush_fdn_state(state);
+}
+
+__attribute__((target("avx2")))
+static float mix_peak_avx2(const float *bus, unsigned frames)
+{
+    __m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 peak = _mm256_setzero_ps();
+    for ( ; frames >= 4; frames -= 4, bus += 8) {
+        peak = _mm256_max_ps(peak, _mm256_and_ps(_mm256_loadu_ps(bus), mask));
+    }
+    float tail = mix_peak_scalar(bus, frames);
+    float vector = max_lanes_sse2(_mm_max_ps(_mm256_castps256_ps128(peak),
+        _mm256_extractf128_ps(peak, 1)));
+    return tail > vector ? tail : vector;
+}
+
+__attribute__((target("avx2")))
+static void mix_crossfeed_avx2(float *bus, const float *left, const float *right,
+    unsigned frames, const MixCrossfeedCoefs *coefs)
+{
+    __m256 direct = _mm256_set1_ps(coefs->mDirect);
+    unsigned n;
+    for (n = 0; n + 8 <= frames; n += 8) {
+        __m256 sumLeft = _mm256_mul_ps(_mm256_loadu_ps(&left[n]), direct);
+        __m256 sumRight = _mm256_mul_ps(_mm256_loadu_ps(&right[n]), direct);
+        int i;
+        for (i = 0; i < MIX_CROSSFEED_TAPS; ++i) {
+            __m256 cross = _mm256_set1_ps(coefs->mCross[i]);
+            sumLeft = _mm256_add_ps(sumLeft,
+                _mm256_mul_ps(_mm256_loadu_ps(&right[(int) n - i]), cross));
+            sumRight = _mm256_add_ps(sumRight,
+                _mm256_mul_ps(_mm256_loadu_ps(&left[(int) n - i]), cross));
+        }
+        // frames 0, 1, 4, 5 and 2, 3, 6, 7, then back into order
+        __m256 lo = _mm256_unpacklo_ps(sumLeft, sumRight);
+        __m256 hi = _mm256_unpackhi_ps(sumLeft, sumRight);
+        _mm256_storeu_ps(&bus[2 * n], _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(&bus[2 * n + 8], _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    crossfeed_scalar(bus, left, right, n, frames, coefs);
+}
+
+__attribute__((target("avx2")))
+static void mix_butterflies_avx2(float *re, float *im, unsigned points, unsigned half,
+    const float *twiddleRe, const float *twiddleIm)
+{
+    if (half < 8) {
+        mix_butterflies_sse2(re, im, points, half, twiddleRe, twiddleIm);
+        return;
+    }
+    unsigned block;
+    for (block = 0; block < points; block += 2 * half) {
+        float *re0 = re + block, *im0 = im + block;
+        float *re1 = re0 + half, *im1 = im0 + half;
+        // half is a power of 2, so there is no tail
+        unsigned k;
+        for (k = 0; k < half; k += 8) {
+            __m256 wRe = _mm256_loadu_ps(&twiddleRe[k]), wIm = _mm256_loadu_ps(&twiddleIm[k]);
+            __m256 xRe = _mm256_loadu_ps(&re1[k]), xIm = _mm256_loadu_ps(&im1[k]);
+            __m256 tRe = _mm256_sub_ps(_mm256_mul_ps(xRe, wRe), _mm256_mul_ps(xIm, wIm));
+            __m256 tIm = _mm256_add_ps(_mm256_mul_ps(xRe, wIm), _mm256_mul_ps(xIm, wRe));
+            __m256 yRe = _mm256_loadu_ps(&re0[k]), yIm = _mm256_loadu_ps(&im0[k]);
+            _mm256_storeu_ps(&re1[k], _mm256_sub_ps(yRe, tRe));
+            _mm256_storeu_ps(&im1[k], _mm256_sub_ps(yIm, tIm));
+            _mm256_storeu_ps(&re0[k], _mm256_add_ps(yRe, tRe));
+            _mm256_storeu_ps(&im0[k], _mm256_add_ps(yIm, tIm));
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256 log2_avx2(__m256 x)
+{
+    // as for SSE2
+    __m256 one = _mm256_set1_ps(1.0f);
+    __m256i bits = _mm256_castps_si256(x);
+    __m256 exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23),
+        _mm256_set1_epi32(127)));
+    __m256 m = _mm256_castsi256_ps(_mm256_or_si256(
+        _mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000)));
+    __m256 t = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+    __m256 t2 = _mm256_mul_ps(t, t);
+    __m256 series = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(1.0f / 9.0f), t2),
+        _mm256_set1_ps(1.0f / 7.0f));
+    series = _mm256_add_ps(_mm256_mul_ps(series, t2), _mm256_set1_ps(1.0f / 5.0f));
+    series = _mm256_add_ps(_mm256_mul_ps(series, t2), _mm256_set1_ps(1.0f / 3.0f));
+    series = _mm256_add_ps(_mm256_mul_ps(series, t2), one);
+    return _mm256_add_ps(exponent,
+        _mm256_mul_ps(_mm256_mul_ps(series, t), _mm256_set1_ps((float) (2.0 / M_LN2))));
+}
+
+__attribute__((target("avx2")))
+static inline __m256 exp2_avx2(__m256 y)
+{
+    // as for SSE2
+    y = _mm256_min_ps(_mm256_max_ps(y, _mm256_set1_ps(-126.0f)), _mm256_set1_ps(126.0f));
+    __m256i integer = _mm256_cvttps_epi32(y);
+    __m256 u = _mm256_mul_ps(_mm256_sub_ps(y, _mm256_cvtepi32_ps(integer)),
+        _mm256_set1_ps((float) M_LN2));
+    __m256 series = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(1.0f / 5040.0f), u),
+        _mm256_set1_ps(1.0f / 720.0f));
+    series = _mm256_add_ps(_mm256_mul_ps(series, u), _mm256_set1_ps(1.0f / 120.0f));
+    series = _mm256_add_ps(_mm256_mul_ps(series, u), _mm256_set1_ps(1.0f / 24.0f));
+    series = _mm256_add_ps(_mm256_mul_ps(series, u), _mm256_set1_ps(1.0f / 6.0f));
+    series = _mm256_add_ps(_mm256_mul_ps(series, u), _mm256_set1_ps(0.5f));
+    series = _mm256_add_ps(_mm256_mul_ps(series, u), _mm256_set1_ps(1.0f));
+    series = _mm256_add_ps(_mm256_mul_ps(series, u), _mm256_set1_ps(1.0f));
+    __m256i scale = _mm256_slli_epi32(_mm256_add_epi32(integer, _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(series, _mm256_castsi256_ps(scale));
+}
+
+__attribute__((target("avx2")))
+static inline __m256 clamp_avx2(__m256 x, __m256 lo, __m256 hi)
+{
+    return _mm256_min_ps(_mm256_max_ps(x, lo), hi);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 dot_avx2(__m256 x, __m256 y, __m256 z, __m256 a, __m256 b, __m256 c)
+{
+    return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, a), _mm256_mul_ps(y, b)),
+        _mm256_mul_ps(z, c));
+}
+
+__attribute__((target("avx2")))
+static void mix_spatialize_avx2(float *voices, unsigned stride, unsigned count,
+    const MixListener *listener)
+{
+    __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    __m256 epsilon = _mm256_set1_ps(SPATIAL_EPSILON);
+    __m256 sound = _mm256_set1_ps(MIX_SPEED_OF_SOUND);
+    __m256 limit = _mm256_set1_ps(0.5f * MIX_SPEED_OF_SOUND);
+    // as for SSE2, but 8 voices at a time
+    unsigned i;
+    for (i = 0; i + 8 <= count; i += 8) {
+        float *v = &voices[i];
+        __m256 relative = _mm256_loadu_ps(&v[MIX_VOICE_RELATIVE * stride]);
+        __m256 world = _mm256_sub_ps(one, relative);
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&v[MIX_VOICE_X * stride]),
+            _mm256_mul_ps(world, _mm256_set1_ps(listener->mPosition[0])));
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&v[MIX_VOICE_Y * stride]),
+            _mm256_mul_ps(world, _mm256_set1_ps(listener->mPosition[1])));
+        __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(&v[MIX_VOICE_Z * stride]),
+            _mm256_mul_ps(world, _mm256_set1_ps(listener->mPosition[2])));
+        __m256 distance = _mm256_sqrt_ps(dot_avx2(dx, dy, dz, dx, dy, dz));
+        __m256 far = _mm256_cmp_ps(distance, epsilon, _CMP_GT_OQ);
+        __m256 inverse = _mm256_and_ps(far,
+            _mm256_div_ps(one, _mm256_max_ps(distance, epsilon)));
+        // distance attenuation
+        __m256 minDistance = _mm256_loadu_ps(&v[MIX_VOICE_MIN_DISTANCE * stride]);
+        __m256 maxDistance = _mm256_loadu_ps(&v[MIX_VOICE_MAX_DISTANCE * stride]);
+        __m256 rolloff = _mm256_loadu_ps(&v[MIX_VOICE_ROLLOFF * stride]);
+        __m256 clamped = clamp_avx2(distance, minDistance, maxDistance);
+        __m256 range = _mm256_max_ps(_mm256_sub_ps(maxDistance, minDistance), epsilon);
+        __m256 linear = _mm256_max_ps(_mm256_sub_ps(one, _mm256_div_ps(_mm256_mul_ps(rolloff,
+            _mm256_sub_ps(clamped, minDistance)), range)), zero);
+        __m256 exponential = exp2_avx2(_mm256_mul_ps(_mm256_sub_ps(zero, rolloff),
+            log2_avx2(_mm256_div_ps(clamped, minDistance))));
+        __m256 gain = _mm256_blendv_ps(exponential, linear, _mm256_cmp_ps(
+            _mm256_loadu_ps(&v[MIX_VOICE_LINEAR * stride]), zero, _CMP_NEQ_OQ));
+        __m256 muted = _mm256_and_ps(
+            _mm256_cmp_ps(_mm256_loadu_ps(&v[MIX_VOICE_MUTE * stride]), zero, _CMP_NEQ_OQ),
+            _mm256_cmp_ps(distance, maxDistance, _CMP_GT_OQ));
+        gain = _mm256_andnot_ps(muted, gain);
+        // cone
+        __m256 facing = _mm256_mul_ps(dot_avx2(dx, dy, dz,
+            _mm256_loadu_ps(&v[MIX_VOICE_FRONT_X * stride]),
+            _mm256_loadu_ps(&v[MIX_VOICE_FRONT_Y * stride]),
+            _mm256_loadu_ps(&v[MIX_VOICE_FRONT_Z * stride])), inverse);
+        __m256 cosine = _mm256_blendv_ps(one, _mm256_sub_ps(zero, facing), far);
+        __m256 inner = _mm256_loadu_ps(&v[MIX_VOICE_CONE_INNER * stride]);
+        __m256 width = _mm256_max_ps(
+            _mm256_sub_ps(inner, _mm256_loadu_ps(&v[MIX_VOICE_CONE_OUTER * stride])), epsilon);
+        __m256 outside = clamp_avx2(_mm256_div_ps(_mm256_sub_ps(inner, cosine), width), zero,
+            one);
+        gain = _mm256_mul_ps(gain, _mm256_add_ps(one, _mm256_mul_ps(outside,
+            _mm256_sub_ps(_mm256_loadu_ps(&v[MIX_VOICE_CONE_LEVEL * stride]), one))));
+        // panning
+        __m256 right = _mm256_add_ps(_mm256_mul_ps(relative, dx),
+            _mm256_mul_ps(world, dot_avx2(dx, dy, dz, _mm256_set1_ps(listener->mRight[0]),
+            _mm256_set1_ps(listener->mRight[1]), _mm256_set1_ps(listener->mRight[2]))));
+        __m256 pan = clamp_avx2(_mm256_mul_ps(right, inverse), _mm256_sub_ps(zero, one), one);
+        _mm256_storeu_ps(&v[MIX_VOICE_GAIN_LEFT * stride],
+            _mm256_mul_ps(gain, _mm256_sqrt_ps(_mm256_sub_ps(one, pan))));
+        _mm256_storeu_ps(&v[MIX_VOICE_GAIN_RIGHT * stride],
+            _mm256_mul_ps(gain, _mm256_sqrt_ps(_mm256_add_ps(one, pan))));
+        // Doppler shift
+        __m256 doppler = _mm256_mul_ps(_mm256_mul_ps(
+            _mm256_loadu_ps(&v[MIX_VOICE_DOPPLER * stride]),
+            _mm256_set1_ps(listener->mDopplerFactor)), inverse);
+        __m256 approach = _mm256_mul_ps(_mm256_mul_ps(world, doppler), dot_avx2(dx, dy, dz,
+            _mm256_set1_ps(listener->mVelocity[0]), _mm256_set1_ps(listener->mVelocity[1]),
+            _mm256_set1_ps(listener->mVelocity[2])));
+        __m256 recede = _mm256_mul_ps(doppler, dot_avx2(dx, dy, dz,
+            _mm256_loadu_ps(&v[MIX_VOICE_VX * stride]),
+            _mm256_loadu_ps(&v[MIX_VOICE_VY * stride]),
+            _mm256_loadu_ps(&v[MIX_VOICE_VZ * stride])));
+        approach = clamp_avx2(approach, _mm256_sub_ps(zero, limit), limit);
+        recede = clamp_avx2(recede, _mm256_sub_ps(zero, limit), limit);
+        __m256 speed = _mm256_div_ps(_mm256_add_ps(sound, approach),
+            _mm256_add_ps(sound, recede));
+        _mm256_storeu_ps(&v[MIX_VOICE_SPEED * stride], clamp_avx2(speed,
+            _mm256_set1_ps(MIX_SPEED_MIN), _mm256_set1_ps(MIX_SPEED_MAX)));
+    }
+    spatialize_scalar(voices, stride, i, count, listener);
+}
+
+__attribute__((target("avx2")))
+static void mix_correlate_avx2(float *scores, const float *reference, const float *signal,
+    unsigned length, unsigned offsets)
+{
+    unsigned k, i;
+    for (k = 0; k + 16 <= offsets; k += 16) {
+        __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+        for (i = 0; i < length; ++i) {
+            __m256 r = _mm256_set1_ps(reference[i]);
+            sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(r, _mm256_loadu_ps(&signal[k + i])));
+            sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(r, _mm256_loadu_ps(&signal[k + i + 8])));
+        }
+        _mm256_storeu_ps(&scores[k], sum0);
+        _mm256_storeu_ps(&scores[k + 8], sum1);
+    }
+    correlate_scalar(scores, reference, signal, length, k, offsets);
+}
+
+const MixKernels MixKernels_avx2 = {
+    "avx2",
+    mix_copy_gain_avx2,
+    mix_add_gain_avx2,
+    mix_add_avx2,
+    mix_load_avx2,
+    mix_accumulate_avx2,
+    mix_clamp_avx2,
+    mix_load_float_avx2,
+    mix_accumulate_float_avx2,
+    mix_filter_avx2,
+    mix_downmix_avx2,
+    mix_downmix_float_avx2,
+    mix_biquads_avx2,
+    mix_fdn_avx2,
+    mix_peak_avx2,
+    mix_crossfeed_avx2,
+    mix_butterflies_avx2,
+    mix_spatialize_avx2,
+    mix_correlate_avx2
+};
+
+#endif // MIXER_X86
+
+
+int MixKernels_isSupported(const MixKernels *kernels)
+{
+    if (&MixKernels_scalar == kernels) {
+        return 1;
+    }
+#ifdef MIXER_X86
+    __builtin_cpu_init();
+    if (&MixKernels_sse2 == kernels) {
+        return __builtin_cpu_supports("sse2");
+    }
+    if (&MixKernels_avx2 == kernels) {
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    return 0;
+}
+
+
+const MixKernels *MixKernels_get(void)
+{
+    // The selection is idempotent, so a race between two first callers is harmless
+    static const MixKernels *selected = NULL;
+    const MixKernels *kernels = selected;
+    if (NULL == kernels) {
+        kernels = &MixKernels_scalar;
+#ifdef MIXER_X86
+        if (MixKernels_isSupported(&MixKernels_avx2)) {
+            kernels = &MixKernels_avx2;
+        } else if (MixKernels_isSupported(&MixKernels_sse2)) {
+            kernels = &MixKernels_sse2;
+        }
+#endif
+        selected = kernels;
+    }
+    return kernels;
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file mixer.h Track mixer kernels */
+
+#ifndef __mixer_h
+#define __mixer_h
+
+// The kernels operate on interleaved 16-bit stereo frames, and saturate rather than wrap.
+// The bus kernels operate on a wide bus of interleaved float stereo frames, where full scale
+// is +/-1.0; the bus has headroom, and is only clamped when it is converted to 16 bits.
+// The float and filter kernels are used by tracks which go through the resampler, the
+// downmix kernels by tracks which are not stereo, the biquad kernel by equalizers and the bass
+// boost, the network kernel by reverbs, the crossfeed kernel by the virtualizer, the peak
+// and butterfly kernels by the bass boost and the FFT of the visualizer, and the spatialize
+// kernel by the 3D voices, once per fill rather than per frame.
+// They have no dependencies on the rest of the implementation, so they can also be
+// linked into host tools such as tools/mixbench.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief dst = src * gain, per channel */
+typedef void (*MixCopyGain)(short *dst, const short *src, unsigned frames,
+    float gainLeft, float gainRight);
+
+/** \brief dst += src * gain, per channel */
+typedef void (*MixAddGain)(short *dst, const short *src, unsigned frames,
+    float gainLeft, float gainRight);
+
+/** \brief dst += src */
+typedef void (*MixAdd)(short *dst, const short *src, unsigned frames);
+
+/** \brief bus = src * gain, per channel */
+typedef void (*MixLoad)(float *bus, const short *src, unsigned frames,
+    float gainLeft, float gainRight);
+
+/** \brief bus += src * gain, per channel */
+typedef void (*MixAccumulate)(float *bus, const short *src, unsigned frames,
+    float gainLeft, float gainRight);
+
+/** \brief dst = bus, with clamping to 16 bits */
+typedef void (*MixClamp)(short *dst, const float *bus, unsigned frames);
+
+/** \brief bus = src * gain, per channel, where src is interleaved float stereo */
+typedef void (*MixLoadFloat)(float *bus, const float *src, unsigned frames,
+    float gainLeft, float gainRight);
+
+/** \brief bus += src * gain, per channel, where src is interleaved float stereo */
+typedef void (*MixAccumulateFloat)(float *bus, const float *src, unsigned frames,
+    float gainLeft, float gainRight);
+
+/** \brief One output frame of an FIR filter with interpolated coefficients:
+ *  out[0] = sum(left[i] * coefs[i]) and out[1] = sum(right[i] * coefs[i]),
+ *  where coefs[i] = coefs0[i] + fraction * (coefs1[i] - coefs0[i]).
+ *  The channels are deinterleaved, and taps must be a multiple of 8.
+ */
+typedef void (*MixFilter)(float *out, const float *left, const float *right,
+    const float *coefs0, const float *coefs1, float fraction, unsigned taps);
+
+#define MIX_MAX_CHANNELS 8  // row length of a downmix matrix
+
+/** \brief dst = src * matrix, where src has 1 to MIX_MAX_CHANNELS interleaved 16-bit channels,
+ *  and dst is interleaved float stereo.  The matrix has a row of MIX_MAX_CHANNELS coefficients
+ *  for the left output followed by a row for the right output, and the coefficients for
+ *  channels at or above the channel count must be zero.
+ */
+typedef void (*MixDownmix)(float *dst, const short *src, unsigned frames, unsigned channels,
+    const float *matrix);
+
+/** \brief As MixDownmix, but src is interleaved float normalized like the bus, for sources
+ *  which are decoded from other sample formats
+ */
+typedef void (*MixDownmixFloat)(float *dst, const float *src, unsigned frames,
+    unsigned channels, const float *matrix);
+
+#define MIX_BIQUADS 4       // sections of the biquad cascade, one per lane of a 128-bit vector
+#define MIX_BIQUAD_STATE (2 * 3 * MIX_BIQUADS)  // floats of state of a stereo biquad cascade
+
+/** \brief Coefficients of a cascade of MIX_BIQUADS biquad sections, normalized so that a0 is 1,
+ *  with one element per section in each array.  A section with b0 = 1 and the rest 0 passes
+ *  its input through unchanged.
+ */
+typedef struct {
+    float mB0[MIX_BIQUADS];
+    float mB1[MIX_BIQUADS];
+    float mB2[MIX_BIQUADS];
+    float mA1[MIX_BIQUADS];
+    float mA2[MIX_BIQUADS];
+} MixBiquadCoefs;
+
+/** \brief Filter interleaved float stereo in place through a cascade of MIX_BIQUADS biquad
+ *  sections in transposed direct form II.  The sections are pipelined so that they can all run
+ *  at once: each takes the output of the section before it from the previous frame, which delays
+ *  the output by MIX_BIQUADS - 1 frames.  The state is MIX_BIQUAD_STATE floats, which are zero
+ *  initially, and carries the filter over from one call to the next.
+ */
+typedef void (*MixBiquads)(float *bus, unsigned frames, const MixBiquadCoefs *coefs,
+    float *state);
+
+#define MIX_FDN_LINES 8     // delay lines of a feedback delay network, one per lane of 256 bits
+
+/** \brief Coefficients of a feedback delay network, with one element per delay line in each
+ *  array
+ */
+typedef struct {
+    float mDamping[MIX_FDN_LINES];  ///< Pole of the one-pole low pass filter after each line
+    float mFeedback[MIX_FDN_LINES]; ///< Gain from the mixing matrix back into each line
+    float mInput[MIX_FDN_LINES];    ///< Gain from the input into each line
+    float mLeft[MIX_FDN_LINES];     ///< Gain from what goes into each line to the left output
+    float mRight[MIX_FDN_LINES];    ///< Gain from what goes into each line to the right output
+} MixFdnCoefs;
+
+/** \brief The feedback path of a network of MIX_FDN_LINES delay lines, for a block of frames.
+ *  The caller keeps the delay lines, which must each be at least frames long, so that nothing
+ *  that goes into a line during the block comes out of it during the same block.  On entry lines
+ *  holds what comes out of each line in each frame, as MIX_FDN_LINES rows of frames floats, and
+ *  on return what goes into each line instead: the outputs are low pass filtered, mixed by a
+ *  Hadamard matrix of order MIX_FDN_LINES with elements of +1 and -1, scaled by the feedback
+ *  gains, and added to the mono input scaled by the input gains.  out is set to interleaved float
+ *  stereo, mixed from what goes into the lines by the output gains.  The state is MIX_FDN_LINES
+ *  floats, the low pass filters, which are zero initially.
+ */
+typedef void (*MixFdn)(float *out, float *lines, const float *in, unsigned frames,
+    const MixFdnCoefs *coefs, float *state);
+
+/** \brief Return the largest magnitude of the samples of interleaved float stereo */
+typedef float (*MixPeak)(const float *bus, unsigned frames);
+
+#define MIX_CROSSFEED_TAPS 32   // length of the filter from each channel into the other
+
+/** \brief Coefficients of a crossfeed: each output channel is the same input channel scaled by
+ *  mDirect, plus the other input channel through an FIR filter
+ */
+typedef struct {
+    float mDirect;
+    float mCross[MIX_CROSSFEED_TAPS];  ///< Gain of the other channel, i frames ago at index i
+} MixCrossfeedCoefs;
+
+/** \brief bus = the crossfeed of a block of stereo, deinterleaved into left and right, each of
+ *  which is preceded by MIX_CROSSFEED_TAPS - 1 frames of history:
+ *  bus[2n] = left[n] * mDirect + sum(right[n - i] * mCross[i]), and bus[2n + 1] likewise
+ *  with left and right exchanged.  bus is interleaved float stereo.
+ */
+typedef void (*MixCrossfeed)(float *bus, const float *left, const float *right, unsigned frames,
+    const MixCrossfeedCoefs *coefs);
+
+/** \brief One radix-2 decimation in time pass of a complex FFT of points points, a power of 2,
+ *  in place on the real and imaginary parts: in each block of 2 * half points, point half + k is
+ *  multiplied by twiddle k, and then subtracted from and added to point k, for k < half.
+ */
+typedef void (*MixButterflies)(float *re, float *im, unsigned points, unsigned half,
+    const float *twiddleRe, const float *twiddleIm);
+
+/** \brief The listener of a batch of 3D voices.  Positions are in meters and velocities in
+ *  meters per second.  mFront and mRight are unit vectors, in the direction the listener faces
+ *  and to its right.
+ */
+typedef struct {
+    float mPosition[3];
+    float mVelocity[3];
+    float mFront[3];
+    float mRight[3];
+    float mDopplerFactor;   ///< Scales the Doppler shift of every voice, 1 for the physical shift
+} MixListener;
+
+/** \brief Rows of a batch of 3D voices, see MixSpatialize */
+enum {
+    MIX_VOICE_X,            ///< Position in meters
+    MIX_VOICE_Y,
+    MIX_VOICE_Z,
+    MIX_VOICE_VX,           ///< Velocity in meters per second
+    MIX_VOICE_VY,
+    MIX_VOICE_VZ,
+    MIX_VOICE_FRONT_X,      ///< Unit vector in the direction the voice faces, for the cone
+    MIX_VOICE_FRONT_Y,
+    MIX_VOICE_FRONT_Z,
+    MIX_VOICE_RELATIVE,     ///< 1 if the position and velocity are relative to the listener's
+                            ///< head, where x is to its right, y up and -z to its front, else 0
+    MIX_VOICE_MIN_DISTANCE, ///< Distance in meters within which the voice is not attenuated
+    MIX_VOICE_MAX_DISTANCE, ///< Distance in meters beyond which it is attenuated no further
+    MIX_VOICE_ROLLOFF,      ///< Rolloff factor, 1 for the physical rolloff
+    MIX_VOICE_LINEAR,       ///< 1 for the linear rolloff model, 0 for the exponential model
+    MIX_VOICE_MUTE,         ///< 1 to mute the voice beyond the max distance, else 0
+    MIX_VOICE_CONE_INNER,   ///< Cosine of half the inner angle of the cone
+    MIX_VOICE_CONE_OUTER,   ///< Cosine of half the outer angle of the cone
+    MIX_VOICE_CONE_LEVEL,   ///< Gain outside the outer angle
+    MIX_VOICE_DOPPLER,      ///< Doppler factor, 0 for no Doppler shift
+    MIX_VOICE_INPUTS,       // number of rows set by the caller
+    MIX_VOICE_GAIN_LEFT = MIX_VOICE_INPUTS, ///< Left gain, including distance and cone
+    MIX_VOICE_GAIN_RIGHT,   ///< Right gain
+    MIX_VOICE_SPEED,        ///< Playback speed, from MIX_SPEED_MIN to MIX_SPEED_MAX
+    MIX_VOICE_ROWS
+};
+
+#define MIX_SPEED_OF_SOUND 343.3f   // meters per second
+#define MIX_SPEED_MIN 0.5f  // lowest Doppler playback speed, an octave down
+#define MIX_SPEED_MAX 2.0f  // highest Doppler playback speed, an octave up
+
+/** \brief Spatialize a batch of count 3D voices heard by a listener.  voices is a structure of
+ *  arrays: MIX_VOICE_ROWS rows of stride floats, with the parameters of voice i in column i of
+ *  the input rows, and its results stored to column i of the output rows.
+ *  The distance attenuation clamps the distance to between the min and max distances, and
+ *  for the exponential model is (distance / min) ^ -rolloff, and for the linear model is
+ *  1 - rolloff * (distance - min) / (max - min), down to 0.  The cone gain is 1 within the inner
+ *  angle, and interpolates to the cone level on the cosine of the angle out to the outer angle.
+ *  The panning is constant power, unity on each side for a voice straight ahead, and the speed
+ *  is the Doppler shift of the velocities along the line between the voice and the listener.
+ */
+typedef void (*MixSpatialize)(float *voices, unsigned stride, unsigned count,
+    const MixListener *listener);
+
+/** \brief Cross-correlate a reference of length samples with the signal at each of offsets
+ *  offsets: scores[k] = sum(reference[i] * signal[k + i]) for i < length, and k < offsets.
+ *  signal has length + offsets - 1 samples.  The time stretch uses it to find where the input
+ *  best continues the output.
+ */
+typedef void (*MixCorrelate)(float *scores, const float *reference, const float *signal,
+    unsigned length, unsigned offsets);
+
+/** \brief v-table for one implementation of the track mixer kernels */
+
+typedef struct {
+    const char *mName;
+    MixCopyGain mCopyGain;
+    MixAddGain mAddGain;
+    MixAdd mAdd;
+    MixLoad mLoad;
+    MixAccumulate mAccumulate;
+    MixClamp mClamp;
+    MixLoadFloat mLoadFloat;
+    MixAccumulateFloat mAccumulateFloat;
+    MixFilter mFilter;
+    MixDownmix mDownmix;
+    MixDownmixFloat mDownmixFloat;
+    MixBiquads mBiquads;
+    MixFdn mFdn;
+    MixPeak mPeak;
+    MixCrossfeed mCrossfeed;
+    MixButterflies mButterflies;
+    MixSpatialize mSpatialize;
+    MixCorrelate mCorrelate;
+} MixKernels;
+
+extern const MixKernels MixKernels_scalar;
+#if defined(__i386__) || defined(__x86_64__)
+extern const MixKernels MixKernels_sse2;
+extern const MixKernels MixKernels_avx2;
+#endif
+
+/** \brief Return the fastest kernels supported by the CPU we are running on */
+extern const MixKernels *MixKernels_get(void);
+
+/** \brief Return whether the specified kernels are supported by the CPU we are running on */
+extern int MixKernels_isSupported(const MixKernels *kernels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // !defined(__mixer_h)
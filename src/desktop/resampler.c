@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file resampler.c Track sample rate converter */
+
+#include "resampler.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Sinc filter design parameters
+#define SINC_HALF_TAPS 16       // half-width when upsampling, grows when downsampling
+#define SINC_PHASES 128         // rows in the table, coefficients are interpolated between rows
+#define SINC_CUTOFF 0.9         // fraction of the lower of the two Nyquist frequencies
+#define KAISER_BETA 8.0         // about 80 dB stop-band attenuation
+
+#define FRACTION_TO_FLOAT (1.0f / 4294967296.0f)
+
+
+/** \brief Zeroth order modified Bessel function of the first kind, for the Kaiser window */
+
+static double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0, y = x * x / 4.0;
+    unsigned k;
+    for (k = 1; k < 50 && term > sum * 1e-12; ++k) {
+        term *= y / ((double) k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+
+/** \brief Build the polyphase table. Row r has the coefficients for a position r / phases of
+ *  the way from one input frame to the next, and tap t of each row applies to the input frame
+ *  at distance t - (halfTaps - 1) - r / phases from the position.
+ */
+
+static void sinc_table(float *table, unsigned phases, unsigned halfTaps, double cutoff)
+{
+    unsigned taps = halfTaps * 2;
+    double i0Beta = bessel_i0(KAISER_BETA);
+    unsigned r, t;
+    for (r = 0; r <= phases; ++r) {
+        float *row = &table[r * taps];
+        double sum = 0.0;
+        for (t = 0; t < taps; ++t) {
+            double d = (double) t - (double) (halfTaps - 1) - (double) r / phases;
+            double ratio = d / halfTaps;
+            double coef = 0.0;
+            if (ratio > -1.0 && ratio < 1.0) {
+                double x = M_PI * cutoff * d;
+                coef = cutoff * (0.0 == x ? 1.0 : sin(x) / x) *
+                    bessel_i0(KAISER_BETA * sqrt(1.0 - ratio * ratio)) / i0Beta;
+            }
+            row[t] = (float) coef;
+            sum += coef;
+        }
+        // normalize each row for unity gain at DC, so there is no ripple on constant input
+        for (t = 0; t < taps; ++t) {
+            row[t] = (float) (row[t] / sum);
+        }
+    }
+}
+
+
+Resampler *Resampler_create(unsigned inputRate, unsigned outputRate, ResamplerQuality quality)
+{
+    assert(0 < inputRate && 0 < outputRate);
+    Resampler *resampler = (Resampler *) malloc(sizeof(Resampler));
+    if (NULL == resampler) {
+        return NULL;
+    }
+    resampler->mKernels = MixKernels_get();
+    resampler->mQuality = quality;
+    resampler->mInputRate = inputRate;
+    resampler->mOutputRate = outputRate;
+    uint64_t step = ((uint64_t) inputRate << 32) / outputRate;
+    resampler->mStep = (unsigned) (step >> 32);
+    resampler->mStepFraction = (uint32_t) step;
+    resampler->mPhases = 0;
+    resampler->mTable = NULL;
+    switch (quality) {
+    case RESAMPLER_LINEAR:
+        resampler->mHalfTaps = 1;
+        break;
+    case RESAMPLER_CUBIC:
+        resampler->mHalfTaps = 2;
+        break;
+    case RESAMPLER_SINC:
+    default:
+        {
+        resampler->mQuality = RESAMPLER_SINC;
+        // when downsampling, the cutoff moves down to the output Nyquist frequency,
+        // so the filter must be proportionally longer for the same transition band
+        double scale = inputRate > outputRate ? (double) outputRate / inputRate : 1.0;
+        unsigned halfTaps = (unsigned) ceil(SINC_HALF_TAPS / scale);
+        // the vector kernels need a multiple of 8 taps
+        halfTaps = (halfTaps + 3) & ~3;
+        if (RESAMPLER_MAX_HALF_TAPS < halfTaps) {
+            halfTaps = RESAMPLER_MAX_HALF_TAPS;
+        }
+        resampler->mHalfTaps = halfTaps;
+        resampler->mPhases = SINC_PHASES;
+        resampler->mTable = (float *) malloc((SINC_PHASES + 1) * halfTaps * 2 * sizeof(float));
+        if (NULL == resampler->mTable) {
+            free(resampler);
+            return NULL;
+        }
+        sinc_table(resampler->mTable, SINC_PHASES, halfTaps, SINC_CUTOFF * scale);
+        }
+        break;
+    }
+    // the history must always be able to hold the filter plus at least one output frame's step
+    assert(2 * resampler->mHalfTaps + resampler->mStep + 1 < RESAMPLER_HISTORY_FRAMES);
+    Resampler_reset(resampler);
+    return resampler;
+}
+
+
+void Resampler_destroy(Resampler *resampler)
+{
+    if (NULL != resampler) {
+        free(resampler->mTable);
+        free(resampler);
+    }
+}
+
+
+void Resampler_setSpeed(Resampler *resampler, float speed)
+{
+    assert(0.0f < speed);
+    uint64_t step = ((uint64_t) resampler->mInputRate << 32) / resampler->mOutputRate;
+    if (1.0f != speed) {
+        step = (uint64_t) ((double) step * speed);
+    }
+    resampler->mStep = (unsigned) (step >> 32);
+    resampler->mStepFraction = (uint32_t) step;
+    assert(2 * resampler->mHalfTaps + resampler->mStep + 1 < RESAMPLER_HISTORY_FRAMES);
+}
+
+
+void Resampler_reset(Resampler *resampler)
+{
+    // start with silence before the first input frame, so the first output frame is aligned
+    // with the first input frame and there is no delay other than the filter look-ahead
+    unsigned history = resampler->mHalfTaps - 1;
+    memset(resampler->mHistory[0], 0, history * sizeof(float));
+    memset(resampler->mHistory[1], 0, history * sizeof(float));
+    resampler->mIndex = history;
+    resampler->mFraction = 0;
+    resampler->mFill = history;
+    resampler->mStale = 0;
+}
+
+
+/** \brief Compute one output frame at the current position */
+
+static inline void interpolate(const Resampler *resampler, float *out)
+{
+    unsigned i = resampler->mIndex;
+    const float *left = resampler->mHistory[0];
+    const float *right = resampler->mHistory[1];
+    float f = resampler->mFraction * FRACTION_TO_FLOAT;
+    switch (resampler->mQuality) {
+    case RESAMPLER_LINEAR:
+        out[0] = left[i] + f * (left[i + 1] - left[i]);
+        out[1] = right[i] + f * (right[i + 1] - right[i]);
+        break;
+    case RESAMPLER_CUBIC:
+        {
+        unsigned channel;
+        for (channel = 0; channel < 2; ++channel) {
+            const float *x = &resampler->mHistory[channel][i];
+            out[channel] = x[0] + 0.5f * f * (x[1] - x[-1] + f * (2.0f * x[-1] - 5.0f * x[0] +
+                4.0f * x[1] - x[2] + f * (3.0f * (x[0] - x[1]) + x[2] - x[-1])));
+        }
+        }
+        break;
+    case RESAMPLER_SINC:
+    default:
+        {
+        unsigned halfTaps = resampler->mHalfTaps;
+        unsigned taps = halfTaps * 2;
+        // the upper bits of the fraction select the rows, the lower bits interpolate between them;
+        // this is done in fixed point, as f can round up to 1.0f which would overrun the table
+        uint64_t phase = (uint64_t) resampler->mFraction * resampler->mPhases;
+        unsigned row = (unsigned) (phase >> 32);
+        const float *coefs0 = &resampler->mTable[row * taps];
+        unsigned first = i - (halfTaps - 1);
+        (*resampler->mKernels->mFilter)(out, &left[first], &right[first], coefs0,
+            coefs0 + taps, (uint32_t) phase * FRACTION_TO_FLOAT, taps);
+        }
+        break;
+    }
+}
+
+
+unsigned Resampler_inputFrames(const Resampler *resampler, unsigned outFrames)
+{
+    if (0 == outFrames) {
+        return 0;
+    }
+    // position of the last output frame, in 32.32 fixed point
+    uint64_t step = ((uint64_t) resampler->mStep << 32) + resampler->mStepFraction;
+    uint64_t last = ((uint64_t) resampler->mIndex << 32) + resampler->mFraction +
+        (uint64_t) (outFrames - 1) * step;
+    // which needs the input frames up to halfTaps after it
+    uint64_t needed = (last >> 32) + resampler->mHalfTaps + 1;
+    return needed > resampler->mFill ? (unsigned) (needed - resampler->mFill) : 0;
+}
+
+
+unsigned Resampler_process(Resampler *resampler, float *out, unsigned outFrames,
+    const float *in, unsigned inFrames, unsigned *inUsed)
+{
+    unsigned halfTaps = resampler->mHalfTaps;
+    unsigned produced = 0, used = 0;
+    if (resampler->mStale) {
+        memset(resampler->mHistory[0], 0, resampler->mFill * sizeof(float));
+        memset(resampler->mHistory[1], 0, resampler->mFill * sizeof(float));
+        resampler->mStale = 0;
+    }
+    for (;;) {
+        // produce as many output frames as the history allows
+        while (produced < outFrames && resampler->mIndex + halfTaps < resampler->mFill) {
+            interpolate(resampler, out);
+            out += 2;
+            ++produced;
+            uint32_t fraction = resampler->mFraction + resampler->mStepFraction;
+            resampler->mIndex += resampler->mStep + (fraction < resampler->mFraction);
+            resampler->mFraction = fraction;
+        }
+        if (produced == outFrames || used == inFrames) {
+            break;
+        }
+        // discard the history which is no longer needed by the filter
+        unsigned discard = resampler->mIndex - (halfTaps - 1);
+        if (discard > resampler->mFill) {
+            // skipping past the end of the history, which only happens when downsampling
+            discard = resampler->mFill;
+        }
+        if (discard > 0) {
+            unsigned keep = resampler->mFill - discard;
+            memmove(resampler->mHistory[0], &resampler->mHistory[0][discard],
+                keep * sizeof(float));
+            memmove(resampler->mHistory[1], &resampler->mHistory[1][discard],
+                keep * sizeof(float));
+            resampler->mIndex -= discard;
+            resampler->mFill = keep;
+        }
+        // append more input, deinterleaved
+        unsigned count = RESAMPLER_HISTORY_FRAMES - resampler->mFill;
+        if (count > inFrames - used) {
+            count = inFrames - used;
+        }
+        assert(0 < count);
+        float *left = &resampler->mHistory[0][resampler->mFill];
+        float *right = &resampler->mHistory[1][resampler->mFill];
+        const float *src = &in[used * 2];
+        unsigned n;
+        for (n = 0; n < count; ++n, src += 2) {
+            left[n] = src[0];
+            right[n] = src[1];
+        }
+        resampler->mFill += count;
+        used += count;
+    }
+    *inUsed = used;
+    return produced;
+}
+
+
+unsigned Resampler_skip(Resampler *resampler, unsigned outFrames, unsigned inFrames,
+    unsigned *inUsed)
+{
+    unsigned halfTaps = resampler->mHalfTaps;
+    uint64_t step = ((uint64_t) resampler->mStep << 32) + resampler->mStepFraction;
+    uint64_t position = ((uint64_t) resampler->mIndex << 32) + resampler->mFraction;
+    // take only the input frames needed, or all of them if that is not enough
+    unsigned used = Resampler_inputFrames(resampler, outFrames);
+    if (used > inFrames) {
+        used = inFrames;
+    }
+    unsigned fill = resampler->mFill + used;
+    // the same output frames as Resampler_process, which produces while index + halfTaps < fill
+    unsigned produced = 0;
+    if (fill > halfTaps) {
+        uint64_t limit = (uint64_t) (fill - halfTaps) << 32;
+        if (position < limit) {
+            uint64_t count = (limit - position + step - 1) / step;
+            produced = count < outFrames ? (unsigned) count : outFrames;
+        }
+    }
+    position += produced * step;
+    // discard the history which is no longer needed by the filter, as Resampler_process does
+    unsigned index = (unsigned) (position >> 32);
+    unsigned discard = index > halfTaps - 1 ? index - (halfTaps - 1) : 0;
+    if (discard > fill) {
+        discard = fill;
+    }
+    resampler->mIndex = index - discard;
+    resampler->mFraction = (uint32_t) position;
+    resampler->mFill = fill - discard;
+    resampler->mStale = 1;
+    *inUsed = used;
+    return produced;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file resampler.h Track sample rate converter */
+
+#ifndef __resampler_h
+#define __resampler_h
+
+// The resampler converts interleaved float stereo frames at the track sample rate to
+// interleaved float stereo frames at the output mix sample rate; both are normalized like the
+// mixer bus, as the track is converted to stereo float before it is resampled.
+// Like the mixer kernels, it has no dependencies on the rest of the implementation.
+
+#include <stdint.h>
+#include "mixer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief Quality, and cost, of the interpolation between input frames */
+
+typedef enum {
+    RESAMPLER_LINEAR = 0,   ///< 2 taps, for when CPU matters more than aliasing
+    RESAMPLER_CUBIC  = 1,   ///< 4 taps Catmull-Rom spline
+    RESAMPLER_SINC   = 2    ///< Kaiser windowed sinc with polyphase coefficient table
+} ResamplerQuality;
+
+#define RESAMPLER_MAX_HALF_TAPS 64  // caps the sinc filter length for large downsampling ratios
+#define RESAMPLER_INPUT_FRAMES 512  // input frames converted per refill of the history
+#define RESAMPLER_HISTORY_FRAMES (RESAMPLER_INPUT_FRAMES + 2 * RESAMPLER_MAX_HALF_TAPS)
+
+/** \brief Per-track resampler state */
+
+typedef struct {
+    const MixKernels *mKernels;
+    ResamplerQuality mQuality;
+    unsigned mInputRate;    ///< Hz
+    unsigned mOutputRate;   ///< Hz
+    unsigned mStep;         ///< Integer part of input frames per output frame
+    uint32_t mStepFraction; ///< Fractional part of input frames per output frame, 0.32 fixed
+    unsigned mIndex;        ///< Index within mHistory of the input frame at or before position
+    uint32_t mFraction;     ///< Fractional part of position, 0.32 fixed
+    unsigned mFill;         ///< Number of valid frames in mHistory
+    int mStale;             ///< Whether mHistory holds frames skipped by Resampler_skip
+    unsigned mHalfTaps;     ///< Number of input frames used on each side of the position
+    unsigned mPhases;       ///< Number of rows in mTable, excluding the extra final row
+    float *mTable;          ///< For RESAMPLER_SINC, (mPhases + 1) rows of 2 * mHalfTaps coefs
+    /** Recent input frames, deinterleaved and normalized */
+    float mHistory[2][RESAMPLER_HISTORY_FRAMES];
+} Resampler;
+
+/** \brief Return a new resampler, or NULL if out of memory */
+extern Resampler *Resampler_create(unsigned inputRate, unsigned outputRate,
+    ResamplerQuality quality);
+
+extern void Resampler_destroy(Resampler *resampler);
+
+/** \brief Play the input at speed times its sample rate, such as for a Doppler shift; 1 restores
+ *  the nominal ratio.  The filter designed for the nominal ratio is kept, so a speed much above 1
+ *  can alias when downsampling.  The position is kept, and the change takes effect at once.
+ */
+extern void Resampler_setSpeed(Resampler *resampler, float speed);
+
+/** \brief Discard the history, such as after a clear, stop, or seek */
+extern void Resampler_reset(Resampler *resampler);
+
+/** \brief Return the number of input frames needed to produce outFrames output frames,
+ *  so that the caller can avoid converting more input than will be consumed
+ */
+extern unsigned Resampler_inputFrames(const Resampler *resampler, unsigned outFrames);
+
+/** \brief Convert at most inFrames input frames to at most outFrames output frames.
+ *  Returns the number of output frames, and sets *inUsed to the number of input frames consumed.
+ *  Input frames which are consumed but are needed by a later output frame are kept internally.
+ */
+extern unsigned Resampler_process(Resampler *resampler, float *out, unsigned outFrames,
+    const float *in, unsigned inFrames, unsigned *inUsed);
+
+/** \brief As Resampler_process, but only advance the position, without reading the input or
+ *  producing any output; for a track which is not being heard.  The next Resampler_process
+ *  resumes from silence, as after Resampler_reset, but keeps the position.
+ */
+extern unsigned Resampler_skip(Resampler *resampler, unsigned outFrames, unsigned inFrames,
+    unsigned *inUsed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // !defined(__resampler_h)
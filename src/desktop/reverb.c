@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file reverb.c Reverb of an output mix */
+
+#include "reverb.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Design parameters; the lengths are in frames at REVERB_BASE_RATE, and scaled to the sample rate
+#define REVERB_BASE_RATE 44100.0
+#define REVERB_HF_REFERENCE 5000.0  // Hz, where the I3DL2 HF levels and ratios apply
+#define REVERB_MAX_DELAY 400        // ms, the longest reflections delay plus reverb delay
+#define REVERB_MAX_DIFFUSION 0.7    // coefficient of the diffusers at a diffusion of 1000
+#define REVERB_SILENT 1e-5          // gain below which a part of the reverb is inaudible
+#define REVERB_TAIL 1.5             // decay times before the late reverb is silent, -90 dB
+
+// mutually prime, from 23 to 64 ms; a density of 0 halves them, for fewer resonances
+static const unsigned lineLengths[MIX_FDN_LINES] = {1031, 1327, 1523, 1801, 2053, 2311, 2539,
+    2803};
+// spread across the Hadamard basis, so the network is excited evenly from the first pass
+static const float inputSigns[MIX_FDN_LINES] = {1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f,
+    1.0f};
+static const unsigned diffuserLengths[REVERB_DIFFUSERS] = {113, 337};
+// ms after the first reflection
+static const double tapOffsets[REVERB_TAPS] = {0.0, 4.3, 9.7, 15.1};
+
+
+/** \brief Convert millibels to a linear gain */
+
+static double millibel_to_gain(int level)
+{
+    return pow(10.0, level / 2000.0);
+}
+
+
+/** \brief Return the pole of the one-pole low pass filter y[n] = x[n] + p * (y[n-1] - x[n]),
+ *  which has unity gain at DC, for the specified gain at the specified frequency
+ */
+
+static double lowpass_pole(double gain, double frequency, unsigned sampleRate)
+{
+    if (gain >= 1.0) {
+        return 0.0;
+    }
+    double w = 2.0 * M_PI * frequency / sampleRate;
+    if (w > M_PI) {
+        w = M_PI;
+    }
+    // |1 - p|^2 = gain^2 * |1 - p e^-jw|^2 is a quadratic in p, whose lower root is in [0, 1]
+    double g2 = gain * gain;
+    double a = g2 - 1.0;
+    double b = 1.0 - g2 * cos(w);
+    double p = (-b + sqrt(b * b - a * a)) / a;
+    // a pole of 1 would never pass anything at all
+    return p < 0.99 ? p : 0.99;
+}
+
+
+static unsigned ms_to_frames(double ms, unsigned sampleRate)
+{
+    return (unsigned) (ms * sampleRate / 1000.0 + 0.5);
+}
+
+
+static unsigned round_up_power_of_2(unsigned n)
+{
+    unsigned size = 1;
+    while (size < n) {
+        size <<= 1;
+    }
+    return size;
+}
+
+
+void Reverb_design(ReverbParams *params, const ReverbProperties *properties, int enabled,
+    unsigned sampleRate)
+{
+    double scale = sampleRate / REVERB_BASE_RATE;
+    double reflections = millibel_to_gain(properties->mReflectionsLevel);
+    double late = millibel_to_gain(properties->mReverbLevel);
+    double room = millibel_to_gain(properties->mRoomLevel);
+    params->mActive = enabled && (room * reflections > REVERB_SILENT ||
+        room * late > REVERB_SILENT);
+    params->mRoomGain = (float) room;
+    params->mRoomPole = (float) lowpass_pole(millibel_to_gain(properties->mRoomHFLevel),
+        REVERB_HF_REFERENCE, sampleRate);
+    // each output has two of the reflections, which are uncorrelated
+    unsigned t;
+    for (t = 0; t < REVERB_TAPS; ++t) {
+        params->mTaps[t] = ms_to_frames(properties->mReflectionsDelay + tapOffsets[t],
+            sampleRate);
+    }
+    params->mTapGain = (float) (reflections * sqrt(0.5));
+    params->mLateDelay = ms_to_frames(properties->mReflectionsDelay + properties->mReverbDelay,
+        sampleRate);
+    params->mDiffusion = (float) (REVERB_MAX_DIFFUSION * properties->mDiffusion / 1000.0);
+    unsigned d;
+    for (d = 0; d < REVERB_DIFFUSERS; ++d) {
+        params->mDiffuserDelays[d] = (unsigned) (diffuserLengths[d] * scale + 0.5);
+    }
+    // Each line loses 60 dB over the decay time, so its feedback gain depends on its length;
+    // the low pass filter of each line takes it down further at 5 kHz, for the HF decay time.
+    // HF decaying more slowly than LF would need a shelf, so the filter is flat then.
+    double decay = properties->mDecayTime / 1000.0;
+    double decayHF = decay * properties->mDecayHFRatio / 1000.0;
+    double lengthScale = (0.5 + 0.5 * properties->mDensity / 1000.0) * scale;
+    double normalize = 1.0 / sqrt((double) MIX_FDN_LINES);
+    double energy = 0.0;
+    unsigned longest = 0;
+    unsigned i;
+    for (i = 0; i < MIX_FDN_LINES; ++i) {
+        unsigned length = (unsigned) (lineLengths[i] * lengthScale + 0.5);
+        if (length < REVERB_BLOCK) {
+            length = REVERB_BLOCK;
+        }
+        params->mLengths[i] = length;
+        if (longest < length) {
+            longest = length;
+        }
+        double gain = pow(10.0, -3.0 * length / (decay * sampleRate));
+        double gainHF = pow(10.0, -3.0 * length / (decayHF * sampleRate));
+        params->mFdn.mDamping[i] = (float) lowpass_pole(gainHF / gain, REVERB_HF_REFERENCE,
+            sampleRate);
+        params->mFdn.mFeedback[i] = (float) (gain * normalize);
+        params->mFdn.mInput[i] = (float) (inputSigns[i] * normalize);
+        // the even lines go to the left output, and the odd lines to the right
+        params->mFdn.mLeft[i] = i & 1 ? 0.0f : 1.0f;
+        params->mFdn.mRight[i] = i & 1 ? 1.0f : 0.0f;
+        energy += gain * gain;
+    }
+    // The matrix keeps the energy in the network, apart from the feedback gains, so an impulse
+    // leaves about 1 / (1 - mean gain^2) of its energy in the lines, and half of that goes to each
+    // output; scale the output so that at a reverb level of 0 mB it has the energy of the input.
+    params->mLateGain = (float) (late * sqrt(2.0 * (1.0 - energy / MIX_FDN_LINES)));
+    unsigned tail = params->mTaps[REVERB_TAPS - 1];
+    unsigned lateTail = params->mLateDelay + longest +
+        (unsigned) (REVERB_TAIL * (decay > decayHF ? decay : decayHF) * sampleRate);
+    for (d = 0; d < REVERB_DIFFUSERS; ++d) {
+        lateTail += params->mDiffuserDelays[d];
+    }
+    params->mTail = tail > lateTail ? tail : lateTail;
+}
+
+
+Reverb *Reverb_create(unsigned sampleRate)
+{
+    Reverb *thiz = (Reverb *) malloc(sizeof(Reverb));
+    if (NULL == thiz) {
+        return NULL;
+    }
+    thiz->mKernels = MixKernels_get();
+    thiz->mSampleRate = sampleRate;
+    double scale = sampleRate / REVERB_BASE_RATE;
+    // room for the longest of each delay, at the highest density; the rings are all in one
+    // allocation
+    unsigned delaySize = round_up_power_of_2(ms_to_frames(REVERB_MAX_DELAY +
+        tapOffsets[REVERB_TAPS - 1], sampleRate) + REVERB_BLOCK + 1);
+    unsigned diffuserSize = round_up_power_of_2(
+        (unsigned) (diffuserLengths[REVERB_DIFFUSERS - 1] * scale + 0.5) + 1);
+    unsigned lineSize = round_up_power_of_2(
+        (unsigned) (lineLengths[MIX_FDN_LINES - 1] * scale + 0.5));
+    if (lineSize < REVERB_BLOCK) {
+        lineSize = REVERB_BLOCK;
+    }
+    thiz->mDelay = (float *) calloc(delaySize + REVERB_DIFFUSERS * diffuserSize +
+        MIX_FDN_LINES * lineSize, sizeof(float));
+    if (NULL == thiz->mDelay) {
+        free(thiz);
+        return NULL;
+    }
+    thiz->mDelayMask = delaySize - 1;
+    thiz->mDiffusers = thiz->mDelay + delaySize;
+    thiz->mDiffuserMask = diffuserSize - 1;
+    thiz->mLines = thiz->mDiffusers + REVERB_DIFFUSERS * diffuserSize;
+    thiz->mLineMask = lineSize - 1;
+    thiz->mDelayWrite = 0;
+    thiz->mLineWrite = 0;
+    thiz->mTail = 0;
+    thiz->mRoomState = 0.0f;
+    memset(thiz->mFdnState, 0, sizeof(thiz->mFdnState));
+    memset(&thiz->mParams, 0, sizeof(ReverbParams));
+    thiz->mParams.mActive = 0;
+    return thiz;
+}
+
+
+void Reverb_destroy(Reverb *thiz)
+{
+    if (NULL != thiz) {
+        free(thiz->mDelay);
+        free(thiz);
+    }
+}
+
+
+/** \brief Silence the reverb, so that nothing old is heard when it next has input */
+
+static void reverb_clear(Reverb *thiz)
+{
+    memset(thiz->mDelay, 0, (thiz->mDelayMask + 1 + REVERB_DIFFUSERS * (thiz->mDiffuserMask + 1)
+        + MIX_FDN_LINES * (thiz->mLineMask + 1)) * sizeof(float));
+    memset(thiz->mFdnState, 0, sizeof(thiz->mFdnState));
+    thiz->mRoomState = 0.0f;
+    thiz->mTail = 0;
+}
+
+
+void Reverb_setParams(Reverb *thiz, const ReverbParams *params)
+{
+    unsigned i;
+    for (i = 0; i < MIX_FDN_LINES; ++i) {
+        assert(REVERB_BLOCK <= params->mLengths[i] && params->mLengths[i] <= thiz->mLineMask + 1);
+    }
+    // the lines are only cleared when something is left in them that would now be wrong
+    if (0 < thiz->mTail && (!params->mActive ||
+            memcmp(params->mLengths, thiz->mParams.mLengths, sizeof(params->mLengths)))) {
+        reverb_clear(thiz);
+    }
+    thiz->mParams = *params;
+}
+
+
+/** \brief Copy frames floats out of a ring of mask + 1 floats, starting at index */
+
+static void ring_read(float *dst, const float *ring, unsigned mask, unsigned index,
+    unsigned frames)
+{
+    index &= mask;
+    unsigned first = mask + 1 - index;
+    if (first > frames) {
+        first = frames;
+    }
+    memcpy(dst, &ring[index], first * sizeof(float));
+    memcpy(dst + first, ring, (frames - first) * sizeof(float));
+}
+
+
+/** \brief Copy frames floats into a ring of mask + 1 floats, starting at index */
+
+static void ring_write(float *ring, unsigned mask, unsigned index, const float *src,
+    unsigned frames)
+{
+    index &= mask;
+    unsigned first = mask + 1 - index;
+    if (first > frames) {
+        first = frames;
+    }
+    memcpy(&ring[index], src, first * sizeof(float));
+    memcpy(ring, src + first, (frames - first) * sizeof(float));
+}
+
+
+/** \brief Run the reverb for at most REVERB_BLOCK frames, adding its output to bus */
+
+static void reverb_block(Reverb *thiz, float *bus, const float *aux, unsigned frames)
+{
+    assert(REVERB_BLOCK >= frames);
+    const ReverbParams *params = &thiz->mParams;
+    float *delay = thiz->mDelay;
+    unsigned mask = thiz->mDelayMask;
+    unsigned write = thiz->mDelayWrite;
+    unsigned n;
+
+    // the room: the sum of the sends to mono, at the room level, through the HF filter
+    float gain = params->mRoomGain * 0.5f;
+    float pole = params->mRoomPole;
+    float room = thiz->mRoomState;
+    for (n = 0; n < frames; ++n) {
+        float x = NULL != aux ? (aux[n * 2] + aux[n * 2 + 1]) * gain : 0.0f;
+        room = x + pole * (room - x);
+        delay[(write + n) & mask] = room;
+    }
+    thiz->mRoomState = fabsf(room) < 1e-15f ? 0.0f : room;
+
+    // the early reflections
+    float tapGain = params->mTapGain;
+    unsigned t;
+    for (t = 0; t < REVERB_TAPS; ++t) {
+        unsigned tap = write - params->mTaps[t];
+        float *out = &bus[t & 1];
+        for (n = 0; n < frames; ++n) {
+            out[n * 2] += tapGain * delay[(tap + n) & mask];
+        }
+    }
+
+    // the input of the late reverb, made denser by the diffusers
+    float *input = thiz->mInput;
+    unsigned late = write - params->mLateDelay;
+    for (n = 0; n < frames; ++n) {
+        input[n] = delay[(late + n) & mask];
+    }
+    float g = params->mDiffusion;
+    unsigned diffuserMask = thiz->mDiffuserMask;
+    unsigned d;
+    for (d = 0; d < REVERB_DIFFUSERS; ++d) {
+        float *diffuser = &thiz->mDiffusers[d * (diffuserMask + 1)];
+        unsigned back = write - params->mDiffuserDelays[d];
+        for (n = 0; n < frames; ++n) {
+            float delayed = diffuser[(back + n) & diffuserMask];
+            float v = input[n] + g * delayed;
+            diffuser[(write + n) & diffuserMask] = v;
+            input[n] = delayed - g * v;
+        }
+    }
+    thiz->mDelayWrite = write + frames;
+
+    // the late reverb: what comes out of each line during the block is read at once, as the
+    // lines are at least a block long, and then what the network puts back is written at once
+    float *block = thiz->mBlock;
+    unsigned lineMask = thiz->mLineMask;
+    unsigned lineWrite = thiz->mLineWrite;
+    unsigned i;
+    for (i = 0; i < MIX_FDN_LINES; ++i) {
+        ring_read(&block[i * frames], &thiz->mLines[i * (lineMask + 1)], lineMask,
+            lineWrite - params->mLengths[i], frames);
+    }
+    (*thiz->mKernels->mFdn)(thiz->mOutput, block, input, frames, &params->mFdn,
+        thiz->mFdnState);
+    for (i = 0; i < MIX_FDN_LINES; ++i) {
+        ring_write(&thiz->mLines[i * (lineMask + 1)], lineMask, lineWrite, &block[i * frames],
+            frames);
+    }
+    thiz->mLineWrite = lineWrite + frames;
+    (*thiz->mKernels->mAccumulateFloat)(bus, thiz->mOutput, frames, params->mLateGain,
+        params->mLateGain);
+}
+
+
+int Reverb_process(Reverb *thiz, float *bus, int busHasData, const float *aux, unsigned frames)
+{
+    if (!thiz->mParams.mActive) {
+        return busHasData;
+    }
+    if (NULL != aux) {
+        thiz->mTail = thiz->mParams.mTail;
+    } else if (0 == thiz->mTail) {
+        return busHasData;
+    }
+    if (!busHasData) {
+        memset(bus, 0, frames * 2 * sizeof(float));
+    }
+    unsigned done, block;
+    for (done = 0; done < frames; done += block) {
+        block = frames - done;
+        if (REVERB_BLOCK < block) {
+            block = REVERB_BLOCK;
+        }
+        reverb_block(thiz, &bus[done * 2], NULL != aux ? &aux[done * 2] : NULL, block);
+    }
+    if (NULL == aux) {
+        if (thiz->mTail > frames) {
+            thiz->mTail -= frames;
+        } else {
+            // the tail has decayed, so the reverb costs nothing until it has input again
+            reverb_clear(thiz);
+        }
+    }
+    return 1;
+}
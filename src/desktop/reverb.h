@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file reverb.h Reverb of an output mix */
+
+#ifndef __reverb_h
+#define __reverb_h
+
+// The reverb is an aux effect: the audio players send to an aux bus, and the reverb runs once
+// per pass on the sum, adding its output to the mix.  It follows the I3DL2 model used by
+// OpenSL ES: the room filters the input, a tapped delay line gives the early reflections, and a
+// feedback delay network gives the late reverb.  The parameters are designed by an application
+// thread, as that needs transcendental functions, and the mixer only copies them.
+// Like the mixer kernels, it has no dependencies on the rest of the implementation.
+
+#include "mixer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REVERB_TAPS 4       // early reflections, alternately to the left and right outputs
+#define REVERB_BLOCK 64     // frames per call of the feedback delay network kernel
+#define REVERB_DIFFUSERS 2  // all-pass filters between the delay line and the network
+
+/** \brief The I3DL2 properties, as in SLEnvironmentalReverbSettings */
+
+typedef struct {
+    int mRoomLevel;         ///< mB, of the whole reverb
+    int mRoomHFLevel;       ///< mB, of the whole reverb at 5 kHz relative to low frequencies
+    unsigned mDecayTime;    ///< ms, for the late reverb to decay by 60 dB at low frequencies
+    unsigned mDecayHFRatio; ///< permille, of the decay time at 5 kHz to that at low frequencies
+    int mReflectionsLevel;  ///< mB, of the early reflections relative to the room level
+    unsigned mReflectionsDelay; ///< ms, from the sound to the first reflection
+    int mReverbLevel;       ///< mB, of the late reverb relative to the room level
+    unsigned mReverbDelay;  ///< ms, from the first reflection to the late reverb
+    unsigned mDiffusion;    ///< permille, echo density of the late reverb
+    unsigned mDensity;      ///< permille, modal density of the late reverb
+} ReverbProperties;
+
+/** \brief Parameters of the reverb designed from its properties; all times are in frames */
+
+typedef struct {
+    int mActive;            ///< Whether the reverb can be heard at all
+    float mRoomGain;        ///< Gain of the input, for the room level
+    float mRoomPole;        ///< Pole of the one-pole low pass filter on the input, for room HF
+    unsigned mTaps[REVERB_TAPS];    ///< Delays of the early reflections
+    float mTapGain;         ///< Gain of each early reflection
+    unsigned mLateDelay;    ///< Delay of the input of the feedback delay network
+    float mDiffusion;       ///< Coefficient of the all-pass diffusers
+    unsigned mDiffuserDelays[REVERB_DIFFUSERS];
+    unsigned mLengths[MIX_FDN_LINES];   ///< Of the delay lines of the network
+    MixFdnCoefs mFdn;
+    float mLateGain;        ///< Gain of the output of the network, for the reverb level
+    unsigned mTail;         ///< How long the reverb takes to fall silent after its input stops
+} ReverbParams;
+
+/** \brief Per-output mix reverb state, only used by the mixer after creation */
+
+typedef struct {
+    const MixKernels *mKernels;
+    unsigned mSampleRate;   ///< Hz
+    ReverbParams mParams;   ///< The parameters in use
+    unsigned mTail;         ///< Frames to go before the reverb is silent, or 0 if it is
+    float mRoomState;       ///< Of the room low pass filter
+    float *mDelay;          ///< Ring of the filtered input, for the reflections and the network
+    unsigned mDelayMask;    ///< Size of mDelay - 1, a power of 2
+    unsigned mDelayWrite;   ///< Index of the next frame to be written to mDelay, unmasked
+    float *mDiffusers;      ///< REVERB_DIFFUSERS rings of mDiffuserMask + 1 frames
+    unsigned mDiffuserMask;
+    float *mLines;          ///< MIX_FDN_LINES rings of mLineMask + 1 frames
+    unsigned mLineMask;
+    unsigned mLineWrite;    ///< Index of the next frame to be written to each line, unmasked
+    float mFdnState[MIX_FDN_LINES];
+    float mInput[REVERB_BLOCK];     ///< Input of the network during a block
+    float mBlock[MIX_FDN_LINES * REVERB_BLOCK];     ///< Lines of the network during a block
+    float mOutput[REVERB_BLOCK * 2];    ///< Output of the network during a block
+} Reverb;
+
+/** \brief Design the parameters of a reverb at the specified sample rate; a reverb which is not
+ *  enabled is designed with the properties it would have, but inactive
+ */
+extern void Reverb_design(ReverbParams *params, const ReverbProperties *properties,
+    int enabled, unsigned sampleRate);
+
+/** \brief Return a new silent and inactive reverb at the specified sample rate, with room for
+ *  the longest delays, or NULL if out of memory
+ */
+extern Reverb *Reverb_create(unsigned sampleRate);
+
+extern void Reverb_destroy(Reverb *reverb);
+
+/** \brief Use new parameters from Reverb_design.  If the delay lines change length, or the
+ *  reverb becomes active, then the reverb starts again from silence.
+ */
+extern void Reverb_setParams(Reverb *reverb, const ReverbParams *params);
+
+/** \brief Run the reverb for frames frames of interleaved float stereo, which may be any
+ *  number up to the size of the bus, adding its output to bus; aux is its input, or NULL if
+ *  there is none.  If busHasData is zero then the bus is undefined and is written rather than
+ *  added to.  Returns whether the bus now has data, which it does unless it did not before and
+ *  the reverb is inactive or silent, which costs almost nothing.
+ */
+extern int Reverb_process(Reverb *reverb, float *bus, int busHasData, const float *aux,
+    unsigned frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // !defined(__reverb_h)
@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file stretch.c Track time stretch */
+
+#include "stretch.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Segment parameters: a hop of 15 ms keeps the pitch period of most voices and instruments
+// within one segment, and a search of 4 ms either side covers a period down to 125 Hz
+#define HOP_MS 15
+#define SEARCH_MS 4
+#define INPUT_FRAMES 512    // room for input beyond what the next segment needs
+
+#define ENERGY_EPSILON 1e-9f    // keeps the score of silence finite
+
+
+Stretch *Stretch_create(unsigned sampleRate)
+{
+    assert(0 < sampleRate);
+    Stretch *stretch = (Stretch *) malloc(sizeof(Stretch));
+    if (NULL == stretch) {
+        return NULL;
+    }
+    unsigned hop = sampleRate * HOP_MS / 1000;
+    unsigned search = sampleRate * SEARCH_MS / 1000;
+    stretch->mKernels = MixKernels_get();
+    stretch->mTempo = 1.0f;
+    stretch->mHop = hop;
+    stretch->mSearch = search;
+    // the furthest a segment reaches, from the continuation of the previous segment which is
+    // kept for the search, is a hop at the fastest tempo and a segment after the search
+    stretch->mCapacity = (unsigned) ceil(hop * STRETCH_TEMPO_MAX) + 2 * hop + 4 * search +
+        INPUT_FRAMES;
+    // one allocation for the buffers, which are all floats
+    size_t floats = 2 * hop +               // mWindow
+        stretch->mCapacity * 2 +            // mInput
+        stretch->mCapacity +                // mMono
+        hop * 2 +                           // mOverlap
+        hop * 2 +                           // mOutput
+        2 * search + 1;                     // mScores
+    float *buffers = (float *) malloc(floats * sizeof(float));
+    if (NULL == buffers) {
+        free(stretch);
+        return NULL;
+    }
+    stretch->mWindow = buffers;
+    stretch->mInput = stretch->mWindow + 2 * hop;
+    stretch->mMono = stretch->mInput + stretch->mCapacity * 2;
+    stretch->mOverlap = stretch->mMono + stretch->mCapacity;
+    stretch->mOutput = stretch->mOverlap + hop * 2;
+    stretch->mScores = stretch->mOutput + hop * 2;
+    // periodic Hann window, so that the halves of overlapping segments sum to unity
+    unsigned i;
+    for (i = 0; i < 2 * hop; ++i) {
+        stretch->mWindow[i] = (float) (0.5 - 0.5 * cos(M_PI * i / hop));
+    }
+    Stretch_reset(stretch);
+    return stretch;
+}
+
+
+void Stretch_destroy(Stretch *stretch)
+{
+    if (NULL != stretch) {
+        free(stretch->mWindow);
+        free(stretch);
+    }
+}
+
+
+void Stretch_setTempo(Stretch *stretch, float tempo)
+{
+    if (tempo < STRETCH_TEMPO_MIN) {
+        tempo = STRETCH_TEMPO_MIN;
+    } else if (tempo > STRETCH_TEMPO_MAX) {
+        tempo = STRETCH_TEMPO_MAX;
+    }
+    stretch->mTempo = tempo;
+}
+
+
+void Stretch_reset(Stretch *stretch)
+{
+    stretch->mFill = 0;
+    stretch->mNext = 0.0;
+    stretch->mTemplate = 0;
+    stretch->mPrimed = 0;
+    stretch->mSkipping = 0;
+    stretch->mPending = 0;
+}
+
+
+unsigned Stretch_inputFrames(const Stretch *stretch, unsigned outFrames)
+{
+    unsigned pending = stretch->mPending;
+    if (outFrames <= pending) {
+        return 0;
+    }
+    double advance = (double) stretch->mHop * stretch->mTempo;
+    if (stretch->mSkipping) {
+        // skipping only consumes input at the tempo, as Stretch_skip does
+        double needed = (outFrames - pending) * (double) stretch->mTempo + stretch->mNext;
+        return needed > 0.0 ? (unsigned) ceil(needed) : 0;
+    }
+    // the last segment needed, which after a reset is tempo hops after the first one at 0
+    unsigned segments = (outFrames - pending + stretch->mHop - 1) / stretch->mHop;
+    unsigned needed;
+    if (!stretch->mPrimed && 1 == segments) {
+        needed = 2 * stretch->mHop;
+    } else {
+        double next = stretch->mPrimed ? stretch->mNext + (segments - 1) * advance :
+            (segments - 1) * advance;
+        needed = (unsigned) next + stretch->mSearch + 2 * stretch->mHop;
+    }
+    unsigned fill = stretch->mFill;
+    if (needed <= fill) {
+        return 0;
+    }
+    needed -= fill;
+    return needed < stretch->mCapacity - fill ? needed : stretch->mCapacity - fill;
+}
+
+
+/** \brief Return where in mInput the segment which best continues the output starts, within
+ *  mSearch frames either side of its nominal start.  The score of each candidate is its
+ *  correlation with the continuation of the previous segment, normalized by its energy.
+ */
+
+static unsigned stretch_search(Stretch *stretch, unsigned nominal)
+{
+    unsigned hop = stretch->mHop;
+    unsigned first = nominal > stretch->mSearch ? nominal - stretch->mSearch : 0;
+    unsigned offsets = nominal + stretch->mSearch - first + 1;
+    const float *mono = &stretch->mMono[first];
+    float *scores = stretch->mScores;
+    (*stretch->mKernels->mCorrelate)(scores, &stretch->mMono[stretch->mTemplate], mono, hop,
+        offsets);
+    float energy = 0.0f;
+    unsigned i;
+    for (i = 0; i < hop; ++i) {
+        energy += mono[i] * mono[i];
+    }
+    // ties, such as in silence, go to the nominal start
+    unsigned best = nominal - first;
+    float bestScore = -INFINITY;
+    unsigned k;
+    for (k = 0; k < offsets; ++k) {
+        float score = scores[k] / sqrtf(energy + ENERGY_EPSILON);
+        if (score > bestScore || (score == bestScore && k == nominal - first)) {
+            bestScore = score;
+            best = k;
+        }
+        energy += mono[k + hop] * mono[k + hop] - mono[k] * mono[k];
+        if (energy < 0.0f) {
+            energy = 0.0f;
+        }
+    }
+    return first + best;
+}
+
+
+/** \brief Take the next segment into mOutput if there is enough input for it, and return whether
+ *  it was taken
+ */
+
+static int stretch_segment(Stretch *stretch)
+{
+    unsigned hop = stretch->mHop;
+    const float *window = stretch->mWindow;
+    float *output = stretch->mOutput;
+    float *overlap = stretch->mOverlap;
+    unsigned start, i;
+    if (!stretch->mPrimed) {
+        if (stretch->mFill < 2 * hop) {
+            return 0;
+        }
+        // there is nothing to overlap with, so the first half is taken as is
+        start = 0;
+        memcpy(output, stretch->mInput, hop * 2 * sizeof(float));
+        stretch->mNext = 0.0;
+        stretch->mPrimed = 1;
+    } else {
+        unsigned nominal = (unsigned) stretch->mNext;
+        if (stretch->mFill < nominal + stretch->mSearch + 2 * hop) {
+            return 0;
+        }
+        // the continuation of the previous segment is itself the best match, if it is there
+        start = nominal == stretch->mTemplate ? nominal : stretch_search(stretch, nominal);
+        const float *segment = &stretch->mInput[start * 2];
+        for (i = 0; i < hop * 2; ++i) {
+            output[i] = overlap[i] + window[i >> 1] * segment[i];
+        }
+    }
+    const float *second = &stretch->mInput[(start + hop) * 2];
+    for (i = 0; i < hop * 2; ++i) {
+        overlap[i] = window[hop + (i >> 1)] * second[i];
+    }
+    stretch->mTemplate = start + hop;
+    stretch->mNext += hop * (double) stretch->mTempo;
+    stretch->mPending = hop;
+
+    // discard the input before both the continuation and the next search
+    unsigned nominal = (unsigned) stretch->mNext;
+    unsigned discard = nominal > stretch->mSearch ? nominal - stretch->mSearch : 0;
+    if (discard > stretch->mTemplate) {
+        discard = stretch->mTemplate;
+    }
+    if (discard > 0) {
+        unsigned keep = stretch->mFill - discard;
+        memmove(stretch->mInput, &stretch->mInput[discard * 2], keep * 2 * sizeof(float));
+        memmove(stretch->mMono, &stretch->mMono[discard], keep * sizeof(float));
+        stretch->mFill = keep;
+        stretch->mTemplate -= discard;
+        stretch->mNext -= discard;
+    }
+    return 1;
+}
+
+
+unsigned Stretch_process(Stretch *stretch, float *out, unsigned outFrames,
+    const float *in, unsigned inFrames, unsigned *inUsed)
+{
+    if (stretch->mSkipping) {
+        // the input skipped is gone, so start over from this input
+        stretch->mSkipping = 0;
+        stretch->mNext = 0.0;
+    }
+    unsigned used = stretch->mCapacity - stretch->mFill;
+    if (used > inFrames) {
+        used = inFrames;
+    }
+    float *input = &stretch->mInput[stretch->mFill * 2];
+    float *mono = &stretch->mMono[stretch->mFill];
+    memcpy(input, in, used * 2 * sizeof(float));
+    unsigned n;
+    for (n = 0; n < used; ++n) {
+        mono[n] = 0.5f * (input[n * 2] + input[n * 2 + 1]);
+    }
+    stretch->mFill += used;
+    unsigned produced = 0;
+    while (produced < outFrames) {
+        if (0 == stretch->mPending && !stretch_segment(stretch)) {
+            break;
+        }
+        unsigned count = outFrames - produced;
+        if (count > stretch->mPending) {
+            count = stretch->mPending;
+        }
+        memcpy(&out[produced * 2], &stretch->mOutput[(stretch->mHop - stretch->mPending) * 2],
+            count * 2 * sizeof(float));
+        stretch->mPending -= count;
+        produced += count;
+    }
+    *inUsed = used;
+    return produced;
+}
+
+
+unsigned Stretch_skip(Stretch *stretch, unsigned outFrames, unsigned inFrames,
+    unsigned *inUsed)
+{
+    // the output already taken is skipped first
+    unsigned produced = outFrames < stretch->mPending ? outFrames : stretch->mPending;
+    // then the input after the nominal start of the next segment, at the tempo; mNext is left
+    // relative to the end of the input, so that the fraction of a frame, or a shortfall, carries
+    // over to the next skip
+    double tempo = stretch->mTempo;
+    double end = (double) stretch->mFill + inFrames;
+    double available = end - stretch->mNext;
+    if (available > 0.0) {
+        double count = floor(available / tempo);
+        if (count > outFrames - produced) {
+            count = outFrames - produced;
+        }
+        produced += (unsigned) count;
+        stretch->mNext += count * tempo;
+    }
+    stretch->mNext -= end;
+    stretch->mFill = 0;
+    stretch->mTemplate = 0;
+    stretch->mPrimed = 0;
+    stretch->mSkipping = 1;
+    stretch->mPending = 0;
+    *inUsed = inFrames;
+    return produced;
+}
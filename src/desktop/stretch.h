@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file stretch.h Track time stretch */
+
+#ifndef __stretch_h
+#define __stretch_h
+
+// The time stretch changes the tempo of interleaved float stereo frames without changing their
+// pitch, by waveform similarity overlap-add (WSOLA): the output is built from windowed segments
+// of the input overlapping by half, and each segment is taken from near where the tempo says it
+// should be, at the offset which best continues the output so far.  It runs at the output mix
+// sample rate, after the resampler if the track has one.
+// Like the mixer kernels, it has no dependencies on the rest of the implementation.
+
+#include "mixer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STRETCH_TEMPO_MIN 0.25f // slowest tempo, a quarter of the nominal speed
+#define STRETCH_TEMPO_MAX 4.0f  // fastest tempo
+
+/** \brief Per-track time stretch state */
+
+typedef struct {
+    const MixKernels *mKernels;
+    float mTempo;           ///< Input frames consumed per output frame, on average
+    unsigned mHop;          ///< Output frames per segment, half the segment length
+    unsigned mSearch;       ///< Segments are searched for this many frames either side
+    unsigned mCapacity;     ///< Size of mInput and mMono in frames
+    unsigned mFill;         ///< Number of valid frames in mInput and mMono
+    double mNext;           ///< Nominal start of the next segment within mInput, see Stretch_skip
+    unsigned mTemplate;     ///< Start of the natural continuation of the previous segment
+    int mPrimed;            ///< Whether a segment has been taken since the last reset or skip
+    int mSkipping;          ///< Whether the last call was Stretch_skip
+    unsigned mPending;      ///< Number of frames of mOutput not yet returned
+    float *mWindow;         ///< Hann window over two hops
+    float *mInput;          ///< Input frames, interleaved stereo
+    float *mMono;           ///< Mono sum of mInput, which is what the search correlates
+    float *mOverlap;        ///< Windowed second half of the previous segment, interleaved stereo
+    float *mOutput;         ///< Output of the latest segment, interleaved stereo
+    float *mScores;         ///< Correlation at each offset searched
+} Stretch;
+
+/** \brief Return a new time stretch at tempo 1 for the specified sample rate, or NULL if out
+ *  of memory
+ */
+extern Stretch *Stretch_create(unsigned sampleRate);
+
+extern void Stretch_destroy(Stretch *stretch);
+
+/** \brief Set the tempo, clamped to between STRETCH_TEMPO_MIN and STRETCH_TEMPO_MAX; it takes
+ *  effect from the next segment
+ */
+extern void Stretch_setTempo(Stretch *stretch, float tempo);
+
+/** \brief Discard the input and output, such as after a clear, stop, or seek */
+extern void Stretch_reset(Stretch *stretch);
+
+/** \brief Return the number of input frames needed to produce outFrames output frames, limited
+ *  to what the time stretch has room for, so that the caller can avoid converting more input
+ *  than will be consumed
+ */
+extern unsigned Stretch_inputFrames(const Stretch *stretch, unsigned outFrames);
+
+/** \brief Produce at most outFrames output frames.  As much of the inFrames input frames as there
+ *  is room for is kept internally, which is all of them if there are no more than
+ *  Stretch_inputFrames asked for.  Returns the number of output frames, and sets *inUsed to the
+ *  number of input frames kept.
+ */
+extern unsigned Stretch_process(Stretch *stretch, float *out, unsigned outFrames,
+    const float *in, unsigned inFrames, unsigned *inUsed);
+
+/** \brief As Stretch_process, but only advance at the tempo, without reading the input or
+ *  producing any output; for a track which is not being heard.  All inFrames are used.  The next
+ *  Stretch_process resumes from silence, as after Stretch_reset.
+ */
+extern unsigned Stretch_skip(Stretch *stretch, unsigned outFrames, unsigned inFrames,
+    unsigned *inUsed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // !defined(__stretch_h)
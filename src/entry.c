@@ -54,6 +54,19 @@ LI_API SLresult liCreateEngine(SLObjectItf *pEngine, SLuint32 numOptions,
         // default values
         SLboolean threadSafe = SL_BOOLEAN_TRUE;
         SLboolean lossOfControlGlobal = SL_BOOLEAN_FALSE;
+#ifdef USE_OUTPUTMIXEXT
+        SLuint32 mixerThreads = 0;
+        SLuint32 device = SL_DESKTOP_DEVICE_AUDIO;
+        SLuint32 clockPercent = 0;
+        SLboolean deferredCallbacks = SL_BOOLEAN_FALSE;
+        SLuint32 maxVoices = 0;
+        SLboolean silenceDetection = SL_BOOLEAN_TRUE;
+        SLuint32 periodFrames = DEVICE_PERIOD_FRAMES;
+        SLuint32 periods = DEVICE_PERIODS;
+        SLuint32 priority = 0;
+        SLuint32 sampleRate = DEVICE_SAMPLERATE;
+        SLuint32 channels = STEREO_CHANNELS;
+#endif
 
         // process engine options
         SLuint32 i;
@@ -67,6 +80,92 @@ LI_API SLresult liCreateEngine(SLObjectItf *pEngine, SLuint32 numOptions,
             case SL_ENGINEOPTION_LOSSOFCONTROL:
                 lossOfControlGlobal = SL_BOOLEAN_FALSE != (SLboolean) option->data; // normalize
                 break;
+#ifdef USE_OUTPUTMIXEXT
+            case SL_DESKTOP_ENGINEOPTION_MIXERTHREADS:
+                if (FORKJOIN_MAX_WORKERS < option->data) {
+                    SL_LOGE("engine option mixer threads=%u exceeds %u", option->data,
+                        FORKJOIN_MAX_WORKERS);
+                    result = SL_RESULT_PARAMETER_INVALID;
+                    break;
+                }
+                mixerThreads = option->data;
+                break;
+            case SL_DESKTOP_ENGINEOPTION_DEVICE:
+                switch (option->data) {
+                case SL_DESKTOP_DEVICE_AUDIO:
+                case SL_DESKTOP_DEVICE_NULL:
+#ifdef USE_SNDFILE
+                case SL_DESKTOP_DEVICE_WAVFILE:
+#endif
+#ifdef USE_ALSA
+                case SL_DESKTOP_DEVICE_ALSA:
+#endif
+                    device = option->data;
+                    break;
+                default:
+                    SL_LOGE("engine option device=%u is not supported", option->data);
+                    result = SL_RESULT_PARAMETER_INVALID;
+                    break;
+                }
+                break;
+            case SL_DESKTOP_ENGINEOPTION_CLOCK:
+                clockPercent = option->data;
+                break;
+            case SL_DESKTOP_ENGINEOPTION_DEFERREDCALLBACKS:
+                deferredCallbacks = SL_BOOLEAN_FALSE != (SLboolean) option->data; // normalize
+                break;
+            case SL_DESKTOP_ENGINEOPTION_MAXVOICES:
+                maxVoices = option->data;
+                break;
+            case SL_DESKTOP_ENGINEOPTION_SILENCEDETECTION:
+                silenceDetection = SL_BOOLEAN_FALSE != (SLboolean) option->data; // normalize
+                break;
+            case SL_DESKTOP_ENGINEOPTION_PERIODFRAMES:
+                if (DEVICE_MAX_PERIOD_FRAMES < option->data) {
+                    SL_LOGE("engine option period frames=%u exceeds %u", option->data,
+                        DEVICE_MAX_PERIOD_FRAMES);
+                    result = SL_RESULT_PARAMETER_INVALID;
+                    break;
+                }
+                periodFrames = 0 != option->data ? option->data : DEVICE_PERIOD_FRAMES;
+                break;
+            case SL_DESKTOP_ENGINEOPTION_PERIODS:
+                if (0 != option->data && (2 > option->data || DEVICE_MAX_PERIODS < option->data)) {
+                    SL_LOGE("engine option periods=%u is not from 2 to %u", option->data,
+                        DEVICE_MAX_PERIODS);
+                    result = SL_RESULT_PARAMETER_INVALID;
+                    break;
+                }
+                periods = 0 != option->data ? option->data : DEVICE_PERIODS;
+                break;
+            case SL_DESKTOP_ENGINEOPTION_PRIORITY:
+                if (99 < option->data) {
+                    SL_LOGE("engine option priority=%u exceeds 99", option->data);
+                    result = SL_RESULT_PARAMETER_INVALID;
+                    break;
+                }
+                priority = option->data;
+                break;
+            case SL_DESKTOP_ENGINEOPTION_SAMPLERATE:
+                if (0 != option->data && (DEVICE_MIN_SAMPLERATE > option->data ||
+                        DEVICE_MAX_SAMPLERATE < option->data)) {
+                    SL_LOGE("engine option sample rate=%u is not from %u to %u", option->data,
+                        DEVICE_MIN_SAMPLERATE, DEVICE_MAX_SAMPLERATE);
+                    result = SL_RESULT_PARAMETER_INVALID;
+                    break;
+                }
+                sampleRate = 0 != option->data ? option->data : DEVICE_SAMPLERATE;
+                break;
+            case SL_DESKTOP_ENGINEOPTION_CHANNELS:
+                if (DEVICE_MAX_CHANNELS < option->data) {
+                    SL_LOGE("engine option channels=%u exceeds %u", option->data,
+                        DEVICE_MAX_CHANNELS);
+                    result = SL_RESULT_PARAMETER_INVALID;
+                    break;
+                }
+                channels = 0 != option->data ? option->data : STEREO_CHANNELS;
+                break;
+#endif
             default:
                 SL_LOGE("unknown engine option: feature=%u data=%u",
                     option->feature, option->data);
@@ -157,6 +256,19 @@ LI_API SLresult liCreateEngine(SLObjectItf *pEngine, SLuint32 numOptions,
         // initialize fields related to an interface
         thiz->mObject.mLossOfControlMask = lossOfControlGlobal ? ~0 : 0;
         thiz->mEngine.mLossOfControlGlobal = lossOfControlGlobal;
+#ifdef USE_OUTPUTMIXEXT
+        thiz->mEngine.mMixerThreads = mixerThreads;
+        thiz->mEngine.mDevice = device;
+        thiz->mEngine.mClockPercent = clockPercent;
+        thiz->mEngine.mDeferredCallbacks = deferredCallbacks;
+        thiz->mEngine.mMaxVoices = maxVoices;
+        thiz->mEngine.mSilenceDetection = silenceDetection;
+        thiz->mEngine.mPeriodFrames = periodFrames;
+        thiz->mEngine.mPeriods = periods;
+        thiz->mEngine.mPriority = priority;
+        thiz->mEngine.mSampleRate = sampleRate;
+        thiz->mEngine.mChannels = channels;
+#endif
         thiz->mEngineCapabilities.mThreadSafe = threadSafe;
         IObject_Publish(&thiz->mObject);
         theOneTrueEngine = thiz;
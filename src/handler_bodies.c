@@ -164,7 +164,7 @@ unsigned handler_MediaPlayer_position(IObject *thiz)
     return ATTR_POSITION;
 }
 
-#else // !defined(ANDROID)
+#elif defined(USE_OUTPUTMIXEXT)
 
 // SL_OBJECTID_AUDIOPLAYER, ATTR_GAIN
 unsigned handler_AudioPlayer_gain(IObject *thiz)
@@ -174,4 +174,31 @@ unsigned handler_AudioPlayer_gain(IObject *thiz)
     return ATTR_GAIN;
 }
 
+
+// SL_OBJECTID_AUDIOPLAYER, ATTR_3D
+unsigned handler_AudioPlayer_3d(IObject *thiz)
+{
+    CAudioPlayer *ap = (CAudioPlayer *) thiz;
+    audioPlayer3DUpdate(ap);
+    return ATTR_3D;
+}
+
+
+// SL_OBJECTID_AUDIOPLAYER, ATTR_RATE
+unsigned handler_AudioPlayer_rate(IObject *thiz)
+{
+    CAudioPlayer *ap = (CAudioPlayer *) thiz;
+    audioPlayerRateUpdate(ap);
+    return ATTR_RATE;
+}
+
+
+// SL_OBJECTID_LISTENER, ATTR_3D
+unsigned handler_Listener_3d(IObject *thiz)
+{
+    CListener *listener = (CListener *) thiz;
+    listener3DUpdate(listener);
+    return ATTR_3D;
+}
+
 #endif
@@ -41,14 +41,14 @@ const AttributeHandler handlerTable[1 + XA_OBJECTID_CAMERADEVICE +
 #define _(id) ((id) - SL_OBJECTID_ENGINE + XA_OBJECTID_CAMERADEVICE + 1)
 
     [_(SL_OBJECTID_AUDIOPLAYER)] = {
-#ifdef ANDROID
         [ATTR_INDEX_GAIN]        = handler_AudioPlayer_gain,
-#endif
         [ATTR_INDEX_TRANSPORT]   = handler_AudioPlayer_transport,
         [ATTR_INDEX_POSITION]    = handler_AudioPlayer_position,
         [ATTR_INDEX_BQ_ENQUEUE]  = handler_AudioPlayer_bq_enqueue,
         [ATTR_INDEX_ABQ_ENQUEUE] = handler_AudioPlayer_abq_enqueue,
-        [ATTR_INDEX_PLAY_STATE]  = handler_AudioPlayer_play_state},
+        [ATTR_INDEX_PLAY_STATE]  = handler_AudioPlayer_play_state,
+        [ATTR_INDEX_3D]          = handler_AudioPlayer_3d,
+        [ATTR_INDEX_RATE]        = handler_AudioPlayer_rate},
 
     [_(SL_OBJECTID_AUDIORECORDER)] = {
         [ATTR_INDEX_TRANSPORT]   = handler_AudioRecorder_transport},
@@ -60,4 +60,7 @@ const AttributeHandler handlerTable[1 + XA_OBJECTID_CAMERADEVICE +
     [_(SL_OBJECTID_OUTPUTMIX)] = {
         [ATTR_INDEX_GAIN]        = handler_OutputMix_gain},
 
+    [_(SL_OBJECTID_LISTENER)] = {
+        [ATTR_INDEX_3D]          = handler_Listener_3d},
+
 };
@@ -40,7 +40,21 @@ extern unsigned handler_AudioRecorder_transport(IObject *thiz);
 extern unsigned handler_MidiPlayer_gain(IObject *thiz);
 extern unsigned handler_MidiPlayer_position(IObject *thiz);
 extern unsigned handler_OutputMix_gain(IObject *thiz);
+#define handler_AudioPlayer_3d          NULL
+#define handler_AudioPlayer_rate        NULL
+#define handler_Listener_3d             NULL
 #else
+#ifdef USE_OUTPUTMIXEXT
+extern unsigned handler_AudioPlayer_gain(IObject *thiz);
+extern unsigned handler_AudioPlayer_3d(IObject *thiz);
+extern unsigned handler_AudioPlayer_rate(IObject *thiz);
+extern unsigned handler_Listener_3d(IObject *thiz);
+#else
+#define handler_AudioPlayer_gain        NULL
+#define handler_AudioPlayer_3d          NULL
+#define handler_AudioPlayer_rate        NULL
+#define handler_Listener_3d             NULL
+#endif
 #define handler_MediaPlayer_gain        NULL
 #define handler_MediaPlayer_transport   NULL
 #define handler_MediaPlayer_position    NULL
@@ -128,6 +128,9 @@ const char * const interface_names[MPH_MAX] = {
     "ANDROIDAUTOMATICGAINCONTROL",
     "ANDROIDNOISESUPPRESSION",
 
+    // Wilhelm desktop extended interfaces, continued
+    "DESKTOPSTATISTICS",
+
 };
 
 
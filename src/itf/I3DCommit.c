@@ -27,11 +27,11 @@ static SLresult I3DCommit_Commit(SL3DCommitItf self)
     IObject *thisObject = InterfaceToIObject(thiz);
     object_lock_exclusive(thisObject);
     if (thiz->mDeferred) {
-        SLuint32 myGeneration = thiz->mGeneration;
-        do {
-            ++thiz->mWaiting;
-            object_cond_wait(thisObject);
-        } while (thiz->mGeneration == myGeneration);
+#ifdef USE_OUTPUTMIXEXT
+        // the mixers pick up the whole commit at the start of their next period, so there is
+        // nothing to wait for
+        IOutputMixExt_commit3D((CEngine *) thisObject);
+#endif
     }
     object_unlock_exclusive(thisObject);
     result = SL_RESULT_SUCCESS;
@@ -48,6 +48,12 @@ static SLresult I3DCommit_SetDeferred(SL3DCommitItf self, SLboolean deferred)
     IObject *thisObject = InterfaceToIObject(thiz);
     object_lock_exclusive(thisObject);
     thiz->mDeferred = SL_BOOLEAN_FALSE != deferred; // normalize
+#ifdef USE_OUTPUTMIXEXT
+    // changes staged before leaving deferred mode are not lost, but committed now
+    if (!thiz->mDeferred) {
+        IOutputMixExt_commit3D((CEngine *) thisObject);
+    }
+#endif
     object_unlock_exclusive(thisObject);
     result = SL_RESULT_SUCCESS;
 
@@ -65,6 +71,4 @@ void I3DCommit_init(void *self)
     I3DCommit *thiz = (I3DCommit *) self;
     thiz->mItf = &I3DCommit_Itf;
     thiz->mDeferred = SL_BOOLEAN_FALSE;
-    thiz->mGeneration = 0;
-    thiz->mWaiting = 0;
 }
@@ -17,6 +17,22 @@
 /* 3DDoppler implementation */
 
 #include "sles_allinclusive.h"
+#include <math.h>
+
+
+/** \brief Compute the Cartesian velocity from the spherical velocity which was set */
+
+static void velocity_cartesian(I3DDoppler *thiz)
+{
+    double azimuth = thiz->mVelocitySpherical.mAzimuth * (M_PI / 180000.0);
+    double elevation = thiz->mVelocitySpherical.mElevation * (M_PI / 180000.0);
+    double speed = thiz->mVelocitySpherical.mSpeed;
+    // as for the spherical location, see I3DLocation.c
+    thiz->mVelocityCartesian.x = (SLint32) lrint(speed * cos(elevation) * sin(azimuth));
+    thiz->mVelocityCartesian.y = (SLint32) lrint(speed * sin(elevation));
+    thiz->mVelocityCartesian.z = (SLint32) lrint(-speed * cos(elevation) * cos(azimuth));
+    thiz->mVelocityActive = CARTESIAN_COMPUTED_SPHERICAL_SET;
+}
 
 
 static SLresult I3DDoppler_SetVelocityCartesian(SL3DDopplerItf self, const SLVec3D *pVelocity)
@@ -31,7 +47,7 @@ static SLresult I3DDoppler_SetVelocityCartesian(SL3DDopplerItf self, const SLVec
         interface_lock_exclusive(thiz);
         thiz->mVelocityCartesian = velocityCartesian;
         thiz->mVelocityActive = CARTESIAN_SET_SPHERICAL_UNKNOWN;
-        interface_unlock_exclusive(thiz);
+        interface_unlock_exclusive_attributes(thiz, ATTR_3D);
         result = SL_RESULT_SUCCESS;
     }
 
@@ -49,8 +65,9 @@ static SLresult I3DDoppler_SetVelocitySpherical(SL3DDopplerItf self,
     thiz->mVelocitySpherical.mAzimuth = azimuth;
     thiz->mVelocitySpherical.mElevation = elevation;
     thiz->mVelocitySpherical.mSpeed = speed;
-    thiz->mVelocityActive = CARTESIAN_UNKNOWN_SPHERICAL_SET;
-    interface_unlock_exclusive(thiz);
+    // the spherical velocity is converted now, as the Cartesian velocity is what is heard
+    velocity_cartesian(thiz);
+    interface_unlock_exclusive_attributes(thiz, ATTR_3D);
     result = SL_RESULT_SUCCESS;
 
     SL_LEAVE_INTERFACE
@@ -83,12 +100,7 @@ static SLresult I3DDoppler_GetVelocityCartesian(SL3DDopplerItf self, SLVec3D *pV
                 thiz->mVelocityActive = CARTESIAN_REQUESTED_SPHERICAL_SET;
                 // fall through
             case CARTESIAN_REQUESTED_SPHERICAL_SET:
-                // matched by cond_broadcast in case multiple requesters
-#if 0
-                interface_cond_wait(thiz);
-#else
-                thiz->mVelocityActive = CARTESIAN_COMPUTED_SPHERICAL_SET;
-#endif
+                velocity_cartesian(thiz);
                 continue;
             default:
                 assert(SL_BOOLEAN_FALSE);
@@ -112,9 +124,9 @@ static SLresult I3DDoppler_SetDopplerFactor(SL3DDopplerItf self, SLpermille dopp
     SL_ENTER_INTERFACE
 
     I3DDoppler *thiz = (I3DDoppler *) self;
-    interface_lock_poke(thiz);
+    interface_lock_exclusive(thiz);
     thiz->mDopplerFactor = dopplerFactor;
-    interface_unlock_poke(thiz);
+    interface_unlock_exclusive_attributes(thiz, ATTR_3D);
     result = SL_RESULT_SUCCESS;
 
     SL_LEAVE_INTERFACE
@@ -35,12 +35,8 @@ static SLresult I3DGrouping_Set3DGroup(SL3DGroupingItf self, SLObjectItf group)
     }
     if (SL_RESULT_SUCCESS == result) {
         I3DGrouping *thiz = (I3DGrouping *) self;
-        IObject *thisObject = InterfaceToIObject(thiz);
-        unsigned id = thisObject->mInstanceID;
-        assert(0 != id);        // player object must be published by this point
-        --id;
-        assert(MAX_INSTANCE > id);
-        unsigned mask = 1 << id;
+        // player object must be published by this point
+        assert(0 != InterfaceToIObject(thiz)->mInstanceID);
         interface_lock_exclusive(thiz);
         C3DGroup *oldGroup = thiz->mGroup;
         if (newGroup != oldGroup) {
@@ -49,8 +45,8 @@ static SLresult I3DGrouping_Set3DGroup(SL3DGroupingItf self, SLObjectItf group)
                 IObject *oldGroupObject = &oldGroup->mObject;
                 // note that we already have a strong reference to the old group
                 object_lock_exclusive(oldGroupObject);
-                assert(oldGroup->mMemberMask & mask);
-                oldGroup->mMemberMask &= ~mask;
+                assert(0 < oldGroup->mMemberCount);
+                --oldGroup->mMemberCount;
                 ReleaseStrongRefAndUnlockExclusive(oldGroupObject);
             }
             // add this object to the new group's set of objects
@@ -59,8 +55,7 @@ static SLresult I3DGrouping_Set3DGroup(SL3DGroupingItf self, SLObjectItf group)
                 // we already have a strong reference to the new group, but we need to re-lock it
                 // so that we always lock objects in the same nesting order to prevent a deadlock
                 object_lock_exclusive(newGroupObject);
-                assert(!(newGroup->mMemberMask & mask));
-                newGroup->mMemberMask |= mask;
+                ++newGroup->mMemberCount;
                 object_unlock_exclusive(newGroupObject);
             }
             thiz->mGroup = newGroup;
@@ -108,11 +103,10 @@ void I3DGrouping_deinit(void *self)
     I3DGrouping *thiz = (I3DGrouping *) self;
     C3DGroup *group = thiz->mGroup;
     if (NULL != group) {
-        unsigned mask = 1 << (InterfaceToIObject(thiz)->mInstanceID - 1);
         IObject *groupObject = &group->mObject;
         object_lock_exclusive(groupObject);
-        assert(group->mMemberMask & mask);
-        group->mMemberMask &= ~mask;
+        assert(0 < group->mMemberCount);
+        --group->mMemberCount;
         ReleaseStrongRefAndUnlockExclusive(groupObject);
     }
 }
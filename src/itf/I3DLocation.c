@@ -17,6 +17,59 @@
 /* 3DLocation implementation */
 
 #include "sles_allinclusive.h"
+#include <math.h>
+
+/** \brief Length of the orientation vectors computed from angles or rotations */
+#define ORIENTATION_UNIT 65536
+
+
+/** \brief Compute the Cartesian location from the spherical location which was set */
+
+static void location_cartesian(I3DLocation *thiz)
+{
+    double azimuth = thiz->mLocationSpherical.mAzimuth * (M_PI / 180000.0);
+    double elevation = thiz->mLocationSpherical.mElevation * (M_PI / 180000.0);
+    double distance = thiz->mLocationSpherical.mDistance;
+    // the azimuth is clockwise from -z as seen from above, and the elevation is up from the x-z
+    thiz->mLocationCartesian.x = (SLint32) lrint(distance * cos(elevation) * sin(azimuth));
+    thiz->mLocationCartesian.y = (SLint32) lrint(distance * sin(elevation));
+    thiz->mLocationCartesian.z = (SLint32) lrint(-distance * cos(elevation) * cos(azimuth));
+    thiz->mLocationActive = CARTESIAN_COMPUTED_SPHERICAL_SET;
+}
+
+
+/** \brief Store a direction as an orientation vector of length ORIENTATION_UNIT */
+
+static void orientation_store(SLVec3D *out, const double *v)
+{
+    double length = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    double scale = length > 0.0 ? ORIENTATION_UNIT / length : 0.0;
+    out->x = (SLint32) lrint(v[0] * scale);
+    out->y = (SLint32) lrint(v[1] * scale);
+    out->z = (SLint32) lrint(v[2] * scale);
+}
+
+
+/** \brief Compute the orientation vectors from the orientation angles which were set */
+
+static void orientation_vectors(I3DLocation *thiz)
+{
+    double heading = thiz->mOrientationAngles.mHeading * (M_PI / 180000.0);
+    double pitch = thiz->mOrientationAngles.mPitch * (M_PI / 180000.0);
+    double roll = thiz->mOrientationAngles.mRoll * (M_PI / 180000.0);
+    // the heading turns clockwise from -z as seen from above, the pitch tilts the front up, and
+    // the roll then tilts the up vector to the right
+    double front[3] = {sin(heading) * cos(pitch), sin(pitch), -cos(heading) * cos(pitch)};
+    double right[3] = {cos(heading), 0.0, sin(heading)};
+    double level[3] = {right[1] * front[2] - right[2] * front[1],
+        right[2] * front[0] - right[0] * front[2], right[0] * front[1] - right[1] * front[0]};
+    double up[3] = {level[0] * cos(roll) + right[0] * sin(roll),
+        level[1] * cos(roll) + right[1] * sin(roll), level[2] * cos(roll) + right[2] * sin(roll)};
+    orientation_store(&thiz->mOrientationVectors.mFront, front);
+    orientation_store(&thiz->mOrientationVectors.mUp, up);
+    thiz->mOrientationVectors.mAbove = thiz->mOrientationVectors.mUp;
+    thiz->mOrientationActive = ANGLES_SET_VECTORS_COMPUTED;
+}
 
 
 static SLresult I3DLocation_SetLocationCartesian(SL3DLocationItf self, const SLVec3D *pLocation)
@@ -31,7 +84,7 @@ static SLresult I3DLocation_SetLocationCartesian(SL3DLocationItf self, const SLV
         interface_lock_exclusive(thiz);
         thiz->mLocationCartesian = locationCartesian;
         thiz->mLocationActive = CARTESIAN_SET_SPHERICAL_UNKNOWN;
-        interface_unlock_exclusive(thiz);
+        interface_unlock_exclusive_attributes(thiz, ATTR_3D);
         result = SL_RESULT_SUCCESS;
     }
 
@@ -54,8 +107,9 @@ static SLresult I3DLocation_SetLocationSpherical(SL3DLocationItf self,
         thiz->mLocationSpherical.mAzimuth = azimuth;
         thiz->mLocationSpherical.mElevation = elevation;
         thiz->mLocationSpherical.mDistance = distance;
-        thiz->mLocationActive = CARTESIAN_UNKNOWN_SPHERICAL_SET;
-        interface_unlock_exclusive(thiz);
+        // the spherical location is converted now, as the Cartesian location is what is heard
+        location_cartesian(thiz);
+        interface_unlock_exclusive_attributes(thiz, ATTR_3D);
         result = SL_RESULT_SUCCESS;
     }
 
@@ -89,12 +143,7 @@ static SLresult I3DLocation_Move(SL3DLocationItf self, const SLVec3D *pMovement)
                 thiz->mLocationActive = CARTESIAN_REQUESTED_SPHERICAL_SET;
                 // fall through
             case CARTESIAN_REQUESTED_SPHERICAL_SET:
-                // matched by cond_broadcast in case multiple requesters
-#if 0
-                interface_cond_wait(thiz);
-#else
-                thiz->mLocationActive = CARTESIAN_COMPUTED_SPHERICAL_SET;
-#endif
+                location_cartesian(thiz);
                 continue;
             default:
                 assert(SL_BOOLEAN_FALSE);
@@ -102,7 +151,7 @@ static SLresult I3DLocation_Move(SL3DLocationItf self, const SLVec3D *pMovement)
             }
             break;
         }
-        interface_unlock_exclusive(thiz);
+        interface_unlock_exclusive_attributes(thiz, ATTR_3D);
         result = SL_RESULT_SUCCESS;
     }
 
@@ -136,12 +185,7 @@ static SLresult I3DLocation_GetLocationCartesian(SL3DLocationItf self, SLVec3D *
                 thiz->mLocationActive = CARTESIAN_REQUESTED_SPHERICAL_SET;
                 // fall through
             case CARTESIAN_REQUESTED_SPHERICAL_SET:
-                // matched by cond_broadcast in case multiple requesters
-#if 0
-                interface_cond_wait(thiz);
-#else
-                thiz->mLocationActive = CARTESIAN_COMPUTED_SPHERICAL_SET;
-#endif
+                location_cartesian(thiz);
                 continue;
             default:
                 assert(SL_BOOLEAN_FALSE);
@@ -170,15 +214,30 @@ static SLresult I3DLocation_SetOrientationVectors(SL3DLocationItf self,
     } else {
         SLVec3D front = *pFront;
         SLVec3D above = *pAbove;
-        // NTH Check for vectors close to zero or close to parallel
-        I3DLocation *thiz = (I3DLocation *) self;
-        interface_lock_exclusive(thiz);
-        thiz->mOrientationVectors.mFront = front;
-        thiz->mOrientationVectors.mAbove = above;
-        thiz->mOrientationActive = ANGLES_UNKNOWN_VECTORS_SET;
-        thiz->mRotatePending = SL_BOOLEAN_FALSE;
-        interface_unlock_exclusive(thiz);
-        result = SL_RESULT_SUCCESS;
+        // the up vector is the part of the above vector which is perpendicular to the front
+        double f[3] = {front.x, front.y, front.z};
+        double a[3] = {above.x, above.y, above.z};
+        double right[3] = {f[1] * a[2] - f[2] * a[1], f[2] * a[0] - f[0] * a[2],
+            f[0] * a[1] - f[1] * a[0]};
+        double up[3] = {right[1] * f[2] - right[2] * f[1], right[2] * f[0] - right[0] * f[2],
+            right[0] * f[1] - right[1] * f[0]};
+        // zero or parallel vectors have no right vector, relative to the lengths of the vectors
+        double r2 = right[0] * right[0] + right[1] * right[1] + right[2] * right[2];
+        double f2 = f[0] * f[0] + f[1] * f[1] + f[2] * f[2];
+        double a2 = a[0] * a[0] + a[1] * a[1] + a[2] * a[2];
+        if (!(r2 > 1e-12 * f2 * a2)) {
+            result = SL_RESULT_PARAMETER_INVALID;
+        } else {
+            I3DLocation *thiz = (I3DLocation *) self;
+            interface_lock_exclusive(thiz);
+            thiz->mOrientationVectors.mFront = front;
+            thiz->mOrientationVectors.mAbove = above;
+            orientation_store(&thiz->mOrientationVectors.mUp, up);
+            thiz->mOrientationActive = ANGLES_UNKNOWN_VECTORS_SET;
+            thiz->mRotatePending = SL_BOOLEAN_FALSE;
+            interface_unlock_exclusive_attributes(thiz, ATTR_3D);
+            result = SL_RESULT_SUCCESS;
+        }
     }
 
     SL_LEAVE_INTERFACE
@@ -200,9 +259,9 @@ static SLresult I3DLocation_SetOrientationAngles(SL3DLocationItf self,
         thiz->mOrientationAngles.mHeading = heading;
         thiz->mOrientationAngles.mPitch = pitch;
         thiz->mOrientationAngles.mRoll = roll;
-        thiz->mOrientationActive = ANGLES_SET_VECTORS_UNKNOWN;
+        orientation_vectors(thiz);
         thiz->mRotatePending = SL_BOOLEAN_FALSE;
-        interface_unlock_exclusive(thiz);
+        interface_unlock_exclusive_attributes(thiz, ATTR_3D);
         result = SL_RESULT_SUCCESS;
     }
 
@@ -214,23 +273,39 @@ static SLresult I3DLocation_Rotate(SL3DLocationItf self, SLmillidegree theta, co
 {
     SL_ENTER_INTERFACE
 
-    if (!((-360000 <= theta) && (theta <= 360000)) || (NULL == pAxis)) {
+    if (!((-360000 <= theta) && (theta <= 360000)) || (NULL == pAxis) ||
+            (0 == pAxis->x && 0 == pAxis->y && 0 == pAxis->z)) {
         result = SL_RESULT_PARAMETER_INVALID;
     } else {
         SLVec3D axis = *pAxis;
-        // NTH Check that axis is not (close to) zero vector, length does not matter
+        double k[3] = {axis.x, axis.y, axis.z};
+        double length = sqrt(k[0] * k[0] + k[1] * k[1] + k[2] * k[2]);
+        k[0] /= length;
+        k[1] /= length;
+        k[2] /= length;
+        double angle = theta * (M_PI / 180000.0);
+        double c = cos(angle), s = sin(angle);
         I3DLocation *thiz = (I3DLocation *) self;
         interface_lock_exclusive(thiz);
-        while (thiz->mRotatePending)
-#if 0
-            interface_cond_wait(thiz);
-#else
-            break;
-#endif
+        // rotate the front and up vectors by Rodrigues' formula, which is cheap enough to apply
+        // now rather than defer: v' = v cos + (k x v) sin + k (k . v) (1 - cos)
+        SLVec3D *vectors[2] = {&thiz->mOrientationVectors.mFront, &thiz->mOrientationVectors.mUp};
+        unsigned i;
+        for (i = 0; i < 2; ++i) {
+            double v[3] = {vectors[i]->x, vectors[i]->y, vectors[i]->z};
+            double dot = (k[0] * v[0] + k[1] * v[1] + k[2] * v[2]) * (1.0 - c);
+            double rotated[3] = {
+                v[0] * c + (k[1] * v[2] - k[2] * v[1]) * s + k[0] * dot,
+                v[1] * c + (k[2] * v[0] - k[0] * v[2]) * s + k[1] * dot,
+                v[2] * c + (k[0] * v[1] - k[1] * v[0]) * s + k[2] * dot};
+            orientation_store(vectors[i], rotated);
+        }
+        thiz->mOrientationVectors.mAbove = thiz->mOrientationVectors.mUp;
+        thiz->mOrientationActive = ANGLES_UNKNOWN_VECTORS_SET;
         thiz->mTheta = theta;
         thiz->mAxis = axis;
-        thiz->mRotatePending = SL_BOOLEAN_TRUE;
-        interface_unlock_exclusive(thiz);
+        thiz->mRotatePending = SL_BOOLEAN_FALSE;
+        interface_unlock_exclusive_attributes(thiz, ATTR_3D);
         result = SL_RESULT_SUCCESS;
     }
 
@@ -283,11 +358,10 @@ void I3DLocation_init(void *self)
     thiz->mOrientationAngles.mHeading = 0;
     thiz->mOrientationAngles.mPitch = 0;
     thiz->mOrientationAngles.mRoll = 0;
-    memset(&thiz->mOrientationVectors, 0x55, sizeof(thiz->mOrientationVectors));
-    thiz->mOrientationActive = ANGLES_SET_VECTORS_UNKNOWN;
-    thiz->mTheta = 0x55555555;
-    thiz->mAxis.x = 0x55555555;
-    thiz->mAxis.y = 0x55555555;
-    thiz->mAxis.z = 0x55555555;
+    orientation_vectors(thiz);
+    thiz->mTheta = 0;
+    thiz->mAxis.x = 0;
+    thiz->mAxis.y = 0;
+    thiz->mAxis.z = 0;
     thiz->mRotatePending = SL_BOOLEAN_FALSE;
 }
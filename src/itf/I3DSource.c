@@ -24,9 +24,9 @@ static SLresult I3DSource_SetHeadRelative(SL3DSourceItf self, SLboolean headRela
     SL_ENTER_INTERFACE
 
     I3DSource *thiz = (I3DSource *) self;
-    interface_lock_poke(thiz);
+    interface_lock_exclusive(thiz);
     thiz->mHeadRelative = SL_BOOLEAN_FALSE != headRelative; // normalize
-    interface_unlock_poke(thiz);
+    interface_unlock_exclusive_attributes(thiz, ATTR_3D);
     result = SL_RESULT_SUCCESS;
 
     SL_LEAVE_INTERFACE
@@ -65,7 +65,7 @@ static SLresult I3DSource_SetRolloffDistances(SL3DSourceItf self,
         interface_lock_exclusive(thiz);
         thiz->mMinDistance = minDistance;
         thiz->mMaxDistance = maxDistance;
-        interface_unlock_exclusive(thiz);
+        interface_unlock_exclusive_attributes(thiz, ATTR_3D);
         result = SL_RESULT_SUCCESS;
     }
 
@@ -99,9 +99,9 @@ static SLresult I3DSource_SetRolloffMaxDistanceMute(SL3DSourceItf self, SLboolea
     SL_ENTER_INTERFACE
 
     I3DSource *thiz = (I3DSource *) self;
-    interface_lock_poke(thiz);
+    interface_lock_exclusive(thiz);
     thiz->mRolloffMaxDistanceMute = SL_BOOLEAN_FALSE != mute; // normalize
-    interface_unlock_poke(thiz);
+    interface_unlock_exclusive_attributes(thiz, ATTR_3D);
     result = SL_RESULT_SUCCESS;
 
     SL_LEAVE_INTERFACE
@@ -135,9 +135,9 @@ static SLresult I3DSource_SetRolloffFactor(SL3DSourceItf self, SLpermille rollof
         result = SL_RESULT_PARAMETER_INVALID;
     } else {
         I3DSource *thiz = (I3DSource *) self;
-        interface_lock_poke(thiz);
+        interface_lock_exclusive(thiz);
         thiz->mRolloffFactor = rolloffFactor;
-        interface_unlock_poke(thiz);
+        interface_unlock_exclusive_attributes(thiz, ATTR_3D);
         result = SL_RESULT_SUCCESS;
     }
 
@@ -202,9 +202,9 @@ static SLresult I3DSource_SetRolloffModel(SL3DSourceItf self, SLuint8 model)
     case SL_ROLLOFFMODEL_EXPONENTIAL:
         {
         I3DSource *thiz = (I3DSource *) self;
-        interface_lock_poke(thiz);
+        interface_lock_exclusive(thiz);
         thiz->mDistanceModel = model;
-        interface_unlock_poke(thiz);
+        interface_unlock_exclusive_attributes(thiz, ATTR_3D);
         result = SL_RESULT_SUCCESS;
         }
         break;
@@ -247,7 +247,7 @@ static SLresult I3DSource_SetCone(SL3DSourceItf self, SLmillidegree innerAngle,
         thiz->mConeInnerAngle = innerAngle;
         thiz->mConeOuterAngle = outerAngle;
         thiz->mConeOuterLevel = outerLevel;
-        interface_unlock_exclusive(thiz);
+        interface_unlock_exclusive_attributes(thiz, ATTR_3D);
         result = SL_RESULT_SUCCESS;
     }
 
@@ -20,11 +20,64 @@
 #ifdef ANDROID
 #include <audio_effects/effect_bassboost.h>
 #endif
+#ifdef USE_OUTPUTMIXEXT
+#include <math.h>
+#endif
 
 #define BASSBOOST_STRENGTH_MIN 0
 #define BASSBOOST_STRENGTH_MAX 1000
 
 
+#ifdef USE_OUTPUTMIXEXT
+
+#define BASSBOOST_FREQUENCY 100.0   // Hz, where the shelf turns over
+#define BASSBOOST_LEVEL_MAX 1200.0  // millibels of boost at the maximum strength
+
+/** \brief Design the low shelf for the current strength, and publish it to the mixer under a
+ *  sequence lock as IEqualizer_publish does; see bass_boost_update in IOutputMixExt.c.  The shelf
+ *  is the first section, as in the Audio EQ Cookbook, and the others pass through.  The mixer
+ *  applies less of the boost while it would clip.  Called with the interface locked exclusively.
+ */
+
+static void IBassBoost_publish(IBassBoost *thiz)
+{
+    MixBiquadCoefs coefs;
+    unsigned section;
+    for (section = 0; section < MIX_BIQUADS; ++section) {
+        coefs.mB0[section] = 1.0f;
+        coefs.mB1[section] = 0.0f;
+        coefs.mB2[section] = 0.0f;
+        coefs.mA1[section] = 0.0f;
+        coefs.mA2[section] = 0.0f;
+    }
+    SLboolean active = thiz->mEnabled && 0 < thiz->mStrength;
+    if (active) {
+        double A = pow(10.0, BASSBOOST_LEVEL_MAX * thiz->mStrength / BASSBOOST_STRENGTH_MAX /
+            4000.0);
+        // const after the engine is created, no lock needed
+        double w0 = 2.0 * M_PI * BASSBOOST_FREQUENCY / thiz->mThis->mEngine->mEngine.mSampleRate;
+        double cosw0 = cos(w0);
+        // shelf slope of 1
+        double twoSqrtAAlpha = sqrt(A) * sin(w0) * M_SQRT2;
+        double a0 = (A + 1.0) + (A - 1.0) * cosw0 + twoSqrtAAlpha;
+        coefs.mB0[0] = (float) (A * ((A + 1.0) - (A - 1.0) * cosw0 + twoSqrtAAlpha) / a0);
+        coefs.mB1[0] = (float) (2.0 * A * ((A - 1.0) - (A + 1.0) * cosw0) / a0);
+        coefs.mB2[0] = (float) (A * ((A + 1.0) - (A - 1.0) * cosw0 - twoSqrtAAlpha) / a0);
+        coefs.mA1[0] = (float) (-2.0 * ((A - 1.0) + (A + 1.0) * cosw0) / a0);
+        coefs.mA2[0] = (float) (((A + 1.0) + (A - 1.0) * cosw0 - twoSqrtAAlpha) / a0);
+    }
+    // there is only one writer, as we hold the lock
+    SLuint32 sequence = thiz->mCoefsSequence;
+    atomic_store_relaxed(&thiz->mCoefsSequence, sequence + 1);
+    atomic_fence_release();
+    thiz->mPublishedCoefs = coefs;
+    thiz->mPublishedActive = active;
+    atomic_store_release(&thiz->mCoefsSequence, sequence + 2);
+}
+
+#endif // USE_OUTPUTMIXEXT
+
+
 #if defined(ANDROID)
 /**
  * returns true if this interface is not associated with an initialized BassBoost effect
@@ -43,6 +96,9 @@ static SLresult IBassBoost_SetEnabled(SLBassBoostItf self, SLboolean enabled)
     interface_lock_exclusive(thiz);
     thiz->mEnabled = (SLboolean) enabled;
 #if !defined(ANDROID)
+#ifdef USE_OUTPUTMIXEXT
+    IBassBoost_publish(thiz);
+#endif
     result = SL_RESULT_SUCCESS;
 #else
     if (NO_BASSBOOST(thiz)) {
@@ -97,6 +153,9 @@ static SLresult IBassBoost_SetStrength(SLBassBoostItf self, SLpermille strength)
         interface_lock_exclusive(thiz);
 #if !defined(ANDROID)
         thiz->mStrength = strength;
+#ifdef USE_OUTPUTMIXEXT
+        IBassBoost_publish(thiz);
+#endif
         result = SL_RESULT_SUCCESS;
 #else
         if (NO_BASSBOOST(thiz)) {
@@ -188,6 +247,10 @@ void IBassBoost_init(void *self)
     thiz->mItf = &IBassBoost_Itf;
     thiz->mEnabled = SL_BOOLEAN_FALSE;
     thiz->mStrength = 0;
+#ifdef USE_OUTPUTMIXEXT
+    thiz->mCoefsSequence = 0;
+    IBassBoost_publish(thiz);
+#endif
 #if defined(ANDROID)
     memset(&thiz->mBassBoostDescriptor, 0, sizeof(effect_descriptor_t));
     // placement new (explicit constructor)
@@ -215,3 +278,16 @@ bool IBassBoost_Expose(void *self)
 #endif
     return true;
 }
+
+#ifdef USE_OUTPUTMIXEXT
+/** \brief Called by DynamicInterfaceManagement::RemoveInterface with the object locked, to take
+ *  the bass boost out of the mix
+ */
+
+void IBassBoost_Remove(void *self)
+{
+    IBassBoost *thiz = (IBassBoost *) self;
+    thiz->mEnabled = SL_BOOLEAN_FALSE;
+    IBassBoost_publish(thiz);
+}
+#endif
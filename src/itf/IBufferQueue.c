@@ -54,19 +54,33 @@ SLresult IBufferQueue_Enqueue(SLBufferQueueItf self, const void *pBuffer, SLuint
         result = SL_RESULT_PARAMETER_INVALID;
     } else {
         IBufferQueue *thiz = (IBufferQueue *) self;
+#ifdef USE_OUTPUTMIXEXT
+        // scanned before locking, as it reads the whole buffer if it is silent
+        SLboolean silent = IOutputMixExt_isSilent(thiz, pBuffer, size);
+#endif
         interface_lock_exclusive(thiz);
         BufferHeader *oldRear = thiz->mRear, *newRear;
         if ((newRear = oldRear + 1) == &thiz->mArray[thiz->mNumBuffers + 1]) {
             newRear = thiz->mArray;
         }
-        if (newRear == thiz->mFront) {
+        // the mixer advances the front without locking, so publish the new rear atomically
+        if (newRear == atomic_load_acquire(&thiz->mFront)) {
             result = SL_RESULT_BUFFER_INSUFFICIENT;
         } else {
             oldRear->mBuffer = pBuffer;
             oldRear->mSize = size;
-            thiz->mRear = newRear;
-            ++thiz->mState.count;
+#ifdef USE_OUTPUTMIXEXT
+            oldRear->mSilent = silent;
+#endif
+            atomic_store_release(&thiz->mRear, newRear);
+            atomic_inc_release(&thiz->mState.count);
             result = SL_RESULT_SUCCESS;
+#ifdef USE_OUTPUTMIXEXT
+            // an idle capture thread waits for a buffer, see desktop/Capture.c
+            if (SL_OBJECTID_AUDIORECORDER == InterfaceToObjectID(thiz)) {
+                interface_cond_broadcast(thiz);
+            }
+#endif
         }
         // set enqueue attribute if state is PLAYING and the first buffer is enqueued
         interface_unlock_exclusive_attributes(thiz, ((SL_RESULT_SUCCESS == result) &&
@@ -104,10 +118,22 @@ SLresult IBufferQueue_Clear(SLBufferQueueItf self)
 #ifdef USE_OUTPUTMIXEXT
     // mixer might be reading from the front buffer, so tread carefully here
     // NTH asynchronous cancel instead of blocking until mixer acknowledges
-    thiz->mClearRequested = SL_BOOLEAN_TRUE;
-    do {
-        interface_cond_wait(thiz);
-    } while (thiz->mClearRequested);
+    atomic_store_release(&thiz->mClearRequested, SL_BOOLEAN_TRUE);
+    if (SL_OBJECTID_AUDIOPLAYER == InterfaceToObjectID(thiz)) {
+        // the mixer doesn't lock the audio player, so we empty the queue once it has let go
+        audioPlayerAwaitMixer((CAudioPlayer *) thiz->mThis);
+        thiz->mFront = &thiz->mArray[0];
+        thiz->mRear = &thiz->mArray[0];
+        thiz->mState.count = 0;
+        thiz->mState.playIndex = 0;
+        atomic_store_release(&thiz->mClearRequested, SL_BOOLEAN_FALSE);
+    } else {
+        // wake the capture thread of an audio recorder if it is idle, and wait for it
+        interface_cond_broadcast(thiz);
+        do {
+            interface_cond_wait(thiz);
+        } while (thiz->mClearRequested);
+    }
 #endif
 
     interface_unlock_exclusive(thiz);
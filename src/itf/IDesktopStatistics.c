@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* DesktopStatistics implementation */
+
+#include "sles_allinclusive.h"
+#include <sched.h>
+#include <time.h>
+
+// The mixer counts as it goes, without locks, and publishes its counters here at the end of
+// each period under a sequence lock; see mix_statistics in IOutputMixExt.c.  So reading them
+// never delays the mixer, and needs no reference to the output mix, which might be going away.
+
+
+/** \brief Take a consistent copy of the mixer statistics most recently published */
+
+static void IDesktopStatistics_read(IDesktopStatistics *thiz, SLDesktopMixerStatistics *stats)
+{
+    for (;;) {
+        SLuint32 sequence = atomic_load_acquire(&thiz->mSequence);
+        if (sequence & 1) {
+            // the mixer is part way through publishing, which only takes a moment
+            sched_yield();
+            continue;
+        }
+        memcpy(stats, &thiz->mPublished, sizeof(SLDesktopMixerStatistics));
+        atomic_fence_acquire();
+        if (sequence == atomic_load_relaxed(&thiz->mSequence)) {
+            break;
+        }
+    }
+}
+
+
+static SLresult IDesktopStatistics_GetMixerStatistics(SLDesktopStatisticsItf self,
+    SLDesktopMixerStatistics *pStatistics)
+{
+    SL_ENTER_INTERFACE
+
+    if (NULL == pStatistics) {
+        result = SL_RESULT_PARAMETER_INVALID;
+    } else {
+        IDesktopStatistics *thiz = (IDesktopStatistics *) self;
+        IEngine *thisEngine = &thiz->mThis->mEngine->mEngine;
+        interface_lock_shared(thisEngine);
+        SLboolean hasOutputMix = NULL != thisEngine->mOutputMix;
+        interface_unlock_shared(thisEngine);
+        if (!hasOutputMix) {
+            result = SL_RESULT_PRECONDITIONS_VIOLATED;
+        } else {
+            IDesktopStatistics_read(thiz, pStatistics);
+            result = SL_RESULT_SUCCESS;
+        }
+    }
+
+    SL_LEAVE_INTERFACE
+}
+
+
+static SLresult IDesktopStatistics_GetPlayerStatistics(SLDesktopStatisticsItf self,
+    SLObjectItf player, SLDesktopPlayerStatistics *pStatistics)
+{
+    SL_ENTER_INTERFACE
+
+    if (NULL == pStatistics) {
+        result = SL_RESULT_PARAMETER_INVALID;
+    } else {
+        // check that it is a realized audio player, and keep it from being destroyed
+        CAudioPlayer *audioPlayer = (CAudioPlayer *) player;
+        result = AcquireStrongRef((IObject *) player, SL_OBJECTID_AUDIOPLAYER);
+        if (SL_RESULT_SUCCESS == result) {
+            object_lock_exclusive(&audioPlayer->mObject);
+            Track *track = audioPlayer->mTrack;
+            if (NULL == track) {
+                // the source is not a buffer queue, so the mixer doesn't see this player
+                result = SL_RESULT_FEATURE_UNSUPPORTED;
+            } else {
+                // the counts of a track are only written by the thread mixing it
+                pStatistics->underruns = atomic_load_relaxed(&track->mUnderruns);
+                pStatistics->bytesMixed = atomic_load_relaxed(&track->mBytesMixed);
+            }
+            ReleaseStrongRefAndUnlockExclusive(&audioPlayer->mObject);
+        }
+    }
+
+    SL_LEAVE_INTERFACE
+}
+
+
+static SLresult IDesktopStatistics_ResetStatistics(SLDesktopStatisticsItf self)
+{
+    SL_ENTER_INTERFACE
+
+    IDesktopStatistics *thiz = (IDesktopStatistics *) self;
+    // the mixer owns the counters, so it resets them itself at the start of the next period
+    atomic_store_release(&thiz->mResetRequested, SL_BOOLEAN_TRUE);
+    result = SL_RESULT_SUCCESS;
+
+    SL_LEAVE_INTERFACE
+}
+
+
+static SLresult IDesktopStatistics_SetDumpPeriod(SLDesktopStatisticsItf self,
+    SLmillisecond period)
+{
+    SL_ENTER_INTERFACE
+
+    IDesktopStatistics *thiz = (IDesktopStatistics *) self;
+    interface_lock_poke(thiz);
+    thiz->mDumpPeriod = period;
+    interface_unlock_poke(thiz);
+    result = SL_RESULT_SUCCESS;
+
+    SL_LEAVE_INTERFACE
+}
+
+
+static SLresult IDesktopStatistics_GetDumpPeriod(SLDesktopStatisticsItf self,
+    SLmillisecond *pPeriod)
+{
+    SL_ENTER_INTERFACE
+
+    if (NULL == pPeriod) {
+        result = SL_RESULT_PARAMETER_INVALID;
+    } else {
+        IDesktopStatistics *thiz = (IDesktopStatistics *) self;
+        interface_lock_peek(thiz);
+        SLmillisecond period = thiz->mDumpPeriod;
+        interface_unlock_peek(thiz);
+        *pPeriod = period;
+        result = SL_RESULT_SUCCESS;
+    }
+
+    SL_LEAVE_INTERFACE
+}
+
+
+static const struct SLDesktopStatisticsItf_ IDesktopStatistics_Itf = {
+    IDesktopStatistics_GetMixerStatistics,
+    IDesktopStatistics_GetPlayerStatistics,
+    IDesktopStatistics_ResetStatistics,
+    IDesktopStatistics_SetDumpPeriod,
+    IDesktopStatistics_GetDumpPeriod
+};
+
+void IDesktopStatistics_init(void *self)
+{
+    IDesktopStatistics *thiz = (IDesktopStatistics *) self;
+    thiz->mItf = &IDesktopStatistics_Itf;
+    memset(&thiz->mPublished, 0, sizeof(thiz->mPublished));
+    thiz->mSequence = 0;
+    thiz->mResetRequested = SL_BOOLEAN_FALSE;
+    thiz->mDumpPeriod = 0;
+    thiz->mDumpTime = 0;
+}
+
+
+/** \brief Called by the sync thread each time it runs, to log the mixer statistics if a dump
+ *  is due.  The interface need not have been exposed, as the dump period is then zero.
+ */
+
+void IDesktopStatistics_sync(CEngine *engine)
+{
+    IDesktopStatistics *thiz = &engine->mDesktopStatistics;
+    interface_lock_peek(thiz);
+    SLmillisecond period = thiz->mDumpPeriod;
+    interface_unlock_peek(thiz);
+    if (0 == period) {
+        return;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    long long now = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    // mDumpTime is only used by the sync thread
+    if (now - thiz->mDumpTime < period * 1000000LL) {
+        return;
+    }
+    thiz->mDumpTime = now;
+    SLDesktopMixerStatistics stats;
+    IDesktopStatistics_read(thiz, &stats);
+    SL_LOGI("mixer %u periods of %u us, mix time last %u mean %u max %u us, %u overruns, "
+        "%u underruns, jitter mean %u max %u us, %u worker misses, %u device xruns", stats.fills,
+        stats.period, stats.lastMixTime, stats.meanMixTime, stats.maxMixTime, stats.overruns,
+        stats.underruns, stats.meanJitter, stats.maxJitter, stats.workerMisses,
+        stats.deviceXruns);
+    // the histogram as "bucket:count" for each non-empty bucket, where bucket is log2 of us
+    char histogram[SL_DESKTOP_MIXTIME_BUCKETS * 16];
+    size_t length = 0;
+    unsigned i;
+    for (i = 0; i < SL_DESKTOP_MIXTIME_BUCKETS; ++i) {
+        if (0 < stats.mixTimeHistogram[i]) {
+            length += snprintf(&histogram[length], sizeof(histogram) - length, " %u:%u", i,
+                stats.mixTimeHistogram[i]);
+        }
+    }
+    histogram[length] = '\0';
+    SL_LOGI("mixer time histogram log2(us):periods%s", histogram);
+}
@@ -128,6 +128,8 @@ static SLresult IEffectSend_EnableEffectSend(SLEffectSendItf self,
             enableLevel->mSendLevel = initialLevel;
 #if !defined(ANDROID)
             result = SL_RESULT_SUCCESS;
+            // the mixer takes the send gains with the other gains of the audio player
+            interface_unlock_exclusive_attributes(thiz, ATTR_GAIN);
 #else
             // TODO do not repeat querying of CAudioPlayer, done inside getEnableLevel()
             CAudioPlayer *ap = (SL_OBJECTID_AUDIOPLAYER == InterfaceToObjectID(thiz)) ?
@@ -150,8 +152,8 @@ static SLresult IEffectSend_EnableEffectSend(SLEffectSendItf self,
                 SL_LOGE("EffectSend unknown aux effect %p", pAuxEffect);
                 result = SL_RESULT_PARAMETER_INVALID;
             }
-#endif
             interface_unlock_exclusive(thiz);
+#endif
         }
     }
 
@@ -204,10 +206,8 @@ static SLresult IEffectSend_SetDirectLevel(SLEffectSendItf self, SLmillibel dire
                 ap->mDirectLevel = directLevel;
 #if defined(ANDROID)
                 ap->mAmplFromDirectLevel = sles_to_android_amplification(directLevel);
-                interface_unlock_exclusive_attributes(thiz, ATTR_GAIN);
-#else
-                interface_unlock_exclusive(thiz);
 #endif
+                interface_unlock_exclusive_attributes(thiz, ATTR_GAIN);
             } else {
                 interface_unlock_exclusive(thiz);
             }
@@ -274,8 +274,10 @@ static SLresult IEffectSend_SetSendLevel(SLEffectSendItf self, const void *pAuxE
                 // into account the player volume level
                 result = android_fxSend_setSendLevel(ap, sendLevel + ap->mVolume.mLevel);
             }
-#endif
             interface_unlock_exclusive(thiz);
+#else
+            interface_unlock_exclusive_attributes(thiz, ATTR_GAIN);
+#endif
 
         }
     }
@@ -215,6 +215,8 @@ static SLresult IEngine_CreateAudioPlayer(SLEngineItf self, SLObjectItf *pPlayer
                     thiz->mDirectLevel = 0; // no attenuation
 #ifdef USE_OUTPUTMIXEXT
                     thiz->mTrack = NULL;
+                    thiz->mResampler = NULL;
+                    thiz->mStretch = NULL;
                     thiz->mGains[0] = 1.0f;
                     thiz->mGains[1] = 1.0f;
                     thiz->mDestroyRequested = SL_BOOLEAN_FALSE;
@@ -226,6 +228,7 @@ static SLresult IEngine_CreateAudioPlayer(SLEngineItf self, SLObjectItf *pPlayer
                     memset(&thiz->mSndFile.mMutex, 0, sizeof(pthread_mutex_t));
                     thiz->mSndFile.mEOF = SL_BOOLEAN_FALSE;
                     thiz->mSndFile.mWhich = 0;
+                    thiz->mSndFile.mFormat = SLESUT_PCM_INVALID;
                     memset(thiz->mSndFile.mBuffer, 0, sizeof(thiz->mSndFile.mBuffer));
 #endif
 #ifdef ANDROID
@@ -472,6 +475,8 @@ static SLresult IEngine_CreateAudioRecorder(SLEngineItf self, SLObjectItf *pReco
                             DATALOCATOR_MASK_URI
 #ifdef ANDROID
                             | DATALOCATOR_MASK_ANDROIDSIMPLEBUFFERQUEUE
+#elif defined(USE_OUTPUTMIXEXT)
+                            | DATALOCATOR_MASK_BUFFERQUEUE
 #endif
                             , DATAFORMAT_MASK_MIME | DATAFORMAT_MASK_PCM | DATAFORMAT_MASK_PCM_EX
                     );
@@ -490,12 +495,21 @@ static SLresult IEngine_CreateAudioRecorder(SLEngineItf self, SLObjectItf *pReco
                         SL_LOGE("Cannot create AudioRecorder: invalid source or sink");
                         break;
                     }
+#elif defined(USE_OUTPUTMIXEXT)
+                    result = CaptureDevice_checkSourceSink(thiz);
+                    if (SL_RESULT_SUCCESS != result) {
+                        SL_LOGE("Cannot create AudioRecorder: invalid source or sink");
+                        break;
+                    }
+                    // the capture device is started when the audio recorder is realized
+                    memset(&thiz->mCaptureDevice, 0, sizeof(CaptureDevice));
 #endif
 
-#ifdef ANDROID
+#if defined(ANDROID) || defined(USE_OUTPUTMIXEXT)
                     // Allocate memory for buffer queue
                     SLuint32 locatorType = thiz->mDataSink.mLocator.mLocatorType;
-                    if (locatorType == SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE) {
+                    if (locatorType == SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE ||
+                            locatorType == SL_DATALOCATOR_BUFFERQUEUE) {
                         thiz->mBufferQueue.mNumBuffers =
                             thiz->mDataSink.mLocator.mBufferQueue.numBuffers;
                         // inline allocation of circular Buffer Queue mArray, up to a typical max
@@ -656,7 +670,7 @@ static SLresult IEngine_Create3DGroup(SLEngineItf self, SLObjectItf *pGroup, SLu
             if (NULL == thiz) {
                 result = SL_RESULT_MEMORY_FAILURE;
             } else {
-                thiz->mMemberMask = 0;
+                thiz->mMemberCount = 0;
                 IObject_Publish(&thiz->mObject);
                 // return the new 3D group object
                 *pGroup = &thiz->mObject.mItf;
@@ -693,23 +707,23 @@ static SLresult IEngine_CreateOutputMix(SLEngineItf self, SLObjectItf *pMix, SLu
 #ifdef ANDROID
                 android_outputMix_create(thiz);
 #endif
-#ifdef USE_SDL
+#ifdef USE_OUTPUTMIXEXT
+                // the device renders the first output mix, and then switches to another one
+                // when it is destroyed, see COutputMix_PreDestroy
                 IEngine *thisEngine = &thiz->mObject.mEngine->mEngine;
                 interface_lock_exclusive(thisEngine);
-                bool unpause = false;
                 if (NULL == thisEngine->mOutputMix) {
-                    thisEngine->mOutputMix = thiz;
-                    unpause = true;
+                    atomic_store_release(&thisEngine->mOutputMix, thiz);
                 }
                 interface_unlock_exclusive(thisEngine);
+                // the output mix gets its zone, and its device is started, when it is realized
+                thiz->mZone = 0;
+                memset(&thiz->mNullDevice, 0, sizeof(NullDevice));
+#ifdef USE_ALSA
+                memset(&thiz->mAlsaDevice, 0, sizeof(AlsaDevice));
 #endif
-                IObject_Publish(&thiz->mObject);
-#ifdef USE_SDL
-                if (unpause) {
-                    // Enable SDL_callback to be called periodically by SDL's internal thread
-                    SDL_PauseAudio(0);
-                }
 #endif
+                IObject_Publish(&thiz->mObject);
                 // return the new output mix object
                 *pMix = &thiz->mObject.mItf;
             }
@@ -984,14 +998,22 @@ void IEngine_init(void *self)
 {
     IEngine *thiz = (IEngine *) self;
     thiz->mItf = &IEngine_Itf;
-    // mLossOfControlGlobal is initialized in slCreateEngine
-#ifdef USE_SDL
+    // mLossOfControlGlobal, mMixerThreads, mDevice, mClockPercent, mDeferredCallbacks,
+    // mMaxVoices, mSilenceDetection, mPeriodFrames, mPeriods, mPriority, mSampleRate and
+    // mChannels are initialized in slCreateEngine
+#ifdef USE_OUTPUTMIXEXT
     thiz->mOutputMix = NULL;
+    thiz->mOutputMixEpoch = 0;
+    thiz->mZoneMask = 0;
 #endif
     thiz->mInstanceCount = 1; // ourself
-    thiz->mInstanceMask = 0;
-    thiz->mChangedMask = 0;
+    thiz->mFullMask = 0;
+    thiz->mChangedGroupMask = 0;
     unsigned i;
+    for (i = 0; i < MAX_INSTANCE_GROUPS; ++i) {
+        thiz->mInstanceMasks[i] = 0;
+        thiz->mChangedMasks[i] = 0;
+    }
     for (i = 0; i < MAX_INSTANCE; ++i) {
         thiz->mInstances[i] = NULL;
     }
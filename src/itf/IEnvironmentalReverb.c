@@ -38,6 +38,19 @@ static inline bool NO_ENVREVERB(IEnvironmentalReverb* ier) {
 #endif
 
 
+#ifdef USE_OUTPUTMIXEXT
+/** \brief Publish the properties to the mixer, which implements the reverb of an output mix as
+ *  an aux effect.  Called with the interface locked exclusively, or during initialization.
+ */
+
+static void IEnvironmentalReverb_publish(IEnvironmentalReverb *thiz)
+{
+    IOutputMixExt_publishReverb(&thiz->mAuxReverb, &thiz->mProperties, SL_BOOLEAN_TRUE,
+        thiz->mThis->mEngine->mEngine.mSampleRate);
+}
+#endif
+
+
 static SLresult IEnvironmentalReverb_SetRoomLevel(SLEnvironmentalReverbItf self, SLmillibel room)
 {
     SL_ENTER_INTERFACE
@@ -60,6 +73,9 @@ static SLresult IEnvironmentalReverb_SetRoomLevel(SLEnvironmentalReverbItf self,
                     REVERB_PARAM_ROOM_LEVEL, &room);
             result = android_fx_statusToResult(status);
         }
+#endif
+#ifdef USE_OUTPUTMIXEXT
+        IEnvironmentalReverb_publish(thiz);
 #endif
         interface_unlock_exclusive(thiz);
     }
@@ -121,6 +137,9 @@ static SLresult IEnvironmentalReverb_SetRoomHFLevel(
                     REVERB_PARAM_ROOM_HF_LEVEL, &roomHF);
             result = android_fx_statusToResult(status);
         }
+#endif
+#ifdef USE_OUTPUTMIXEXT
+        IEnvironmentalReverb_publish(thiz);
 #endif
         interface_unlock_exclusive(thiz);
     }
@@ -180,6 +199,9 @@ static SLresult IEnvironmentalReverb_SetDecayTime(
                     REVERB_PARAM_DECAY_TIME, &decayTime);
             result = android_fx_statusToResult(status);
         }
+#endif
+#ifdef USE_OUTPUTMIXEXT
+        IEnvironmentalReverb_publish(thiz);
 #endif
         interface_unlock_exclusive(thiz);
     }
@@ -239,6 +261,9 @@ static SLresult IEnvironmentalReverb_SetDecayHFRatio(
                     REVERB_PARAM_DECAY_HF_RATIO, &decayHFRatio);
             result = android_fx_statusToResult(status);
         }
+#endif
+#ifdef USE_OUTPUTMIXEXT
+        IEnvironmentalReverb_publish(thiz);
 #endif
         interface_unlock_exclusive(thiz);
     }
@@ -300,6 +325,9 @@ static SLresult IEnvironmentalReverb_SetReflectionsLevel(
                     REVERB_PARAM_REFLECTIONS_LEVEL, &reflectionsLevel);
             result = android_fx_statusToResult(status);
         }
+#endif
+#ifdef USE_OUTPUTMIXEXT
+        IEnvironmentalReverb_publish(thiz);
 #endif
         interface_unlock_exclusive(thiz);
     }
@@ -359,6 +387,9 @@ static SLresult IEnvironmentalReverb_SetReflectionsDelay(
                     REVERB_PARAM_REFLECTIONS_DELAY, &reflectionsDelay);
             result = android_fx_statusToResult(status);
         }
+#endif
+#ifdef USE_OUTPUTMIXEXT
+        IEnvironmentalReverb_publish(thiz);
 #endif
         interface_unlock_exclusive(thiz);
     }
@@ -420,6 +451,9 @@ static SLresult IEnvironmentalReverb_SetReverbLevel(
                     REVERB_PARAM_REVERB_LEVEL, &reverbLevel);
             result = android_fx_statusToResult(status);
         }
+#endif
+#ifdef USE_OUTPUTMIXEXT
+        IEnvironmentalReverb_publish(thiz);
 #endif
         interface_unlock_exclusive(thiz);
     }
@@ -479,6 +513,9 @@ static SLresult IEnvironmentalReverb_SetReverbDelay(
                     REVERB_PARAM_REVERB_DELAY, &reverbDelay);
             result = android_fx_statusToResult(status);
         }
+#endif
+#ifdef USE_OUTPUTMIXEXT
+        IEnvironmentalReverb_publish(thiz);
 #endif
         interface_unlock_exclusive(thiz);
     }
@@ -538,6 +575,9 @@ static SLresult IEnvironmentalReverb_SetDiffusion(
                     REVERB_PARAM_DIFFUSION, &diffusion);
             result = android_fx_statusToResult(status);
         }
+#endif
+#ifdef USE_OUTPUTMIXEXT
+        IEnvironmentalReverb_publish(thiz);
 #endif
         interface_unlock_exclusive(thiz);
     }
@@ -597,6 +637,9 @@ static SLresult IEnvironmentalReverb_SetDensity(SLEnvironmentalReverbItf self,
                     REVERB_PARAM_DENSITY, &density);
             result = android_fx_statusToResult(status);
         }
+#endif
+#ifdef USE_OUTPUTMIXEXT
+        IEnvironmentalReverb_publish(thiz);
 #endif
         interface_unlock_exclusive(thiz);
     }
@@ -681,6 +724,9 @@ static SLresult IEnvironmentalReverb_SetEnvironmentalReverbProperties(SLEnvironm
                     REVERB_PARAM_PROPERTIES, &properties);
             result = android_fx_statusToResult(status);
         }
+#endif
+#ifdef USE_OUTPUTMIXEXT
+        IEnvironmentalReverb_publish(thiz);
 #endif
         interface_unlock_exclusive(thiz);
     } while (0);
@@ -767,6 +813,11 @@ void IEnvironmentalReverb_init(void *self)
     // placement new (explicit constructor)
     (void) new (&thiz->mEnvironmentalReverbEffect) android::sp<android::AudioEffect>();
 #endif
+#ifdef USE_OUTPUTMIXEXT
+    thiz->mAuxReverb.mReverb = NULL;
+    thiz->mAuxReverb.mSequence = 0;
+    thiz->mAuxReverb.mCopied = 0;
+#endif
 }
 
 void IEnvironmentalReverb_deinit(void *self)
@@ -776,6 +827,9 @@ void IEnvironmentalReverb_deinit(void *self)
     // explicit destructor
     thiz->mEnvironmentalReverbEffect.~sp();
 #endif
+#ifdef USE_OUTPUTMIXEXT
+    IOutputMixExt_destroyReverb(&((IEnvironmentalReverb *) self)->mAuxReverb);
+#endif
 }
 
 bool IEnvironmentalReverb_Expose(void *self)
@@ -787,6 +841,29 @@ bool IEnvironmentalReverb_Expose(void *self)
         SL_LOGE("EnvironmentalReverb initialization failed.");
         return false;
     }
+#endif
+#ifdef USE_OUTPUTMIXEXT
+    // only the reverb of an output mix is in the mix, as an aux effect; it is published here
+    // rather than by init, as it is unpublished by remove, and the interface has no other users
+    IEnvironmentalReverb *thiz = (IEnvironmentalReverb *) self;
+    if (SL_OBJECTID_OUTPUTMIX == InterfaceToObjectID(thiz)) {
+        IEnvironmentalReverb_publish(thiz);
+        return IOutputMixExt_exposeReverb(&thiz->mAuxReverb,
+            thiz->mThis->mEngine->mEngine.mSampleRate);
+    }
 #endif
     return true;
 }
+
+#ifdef USE_OUTPUTMIXEXT
+/** \brief Called by DynamicInterfaceManagement::RemoveInterface with the object locked, to take
+ *  the reverb out of the mix
+ */
+
+void IEnvironmentalReverb_Remove(void *self)
+{
+    IEnvironmentalReverb *thiz = (IEnvironmentalReverb *) self;
+    IOutputMixExt_publishReverb(&thiz->mAuxReverb, &thiz->mProperties, SL_BOOLEAN_FALSE,
+        thiz->mThis->mEngine->mEngine.mSampleRate);
+}
+#endif
@@ -20,15 +20,19 @@
 #ifdef ANDROID
 #include <audio_effects/effect_equalizer.h>
 #endif
+#ifdef USE_OUTPUTMIXEXT
+#include <math.h>
+#endif
 
 #define MAX_EQ_PRESETS 3
 
 #if !defined(ANDROID)
+// in milliHertz; the lowest band is a low shelf and the highest a high shelf
 static const struct EqualizerBand EqualizerBands[MAX_EQ_BANDS] = {
-    {1000, 1500, 2000},
-    {2000, 3000, 4000},
-    {4000, 5500, 7000},
-    {7000, 8000, 9000}
+    {20000, 100000, 250000},
+    {250000, 500000, 1000000},
+    {1000000, 2000000, 4000000},
+    {4000000, 10000000, 20000000}
 };
 
 static const struct EqualizerPreset {
@@ -42,6 +46,104 @@ static const struct EqualizerPreset {
 #endif
 
 
+#ifdef USE_OUTPUTMIXEXT
+
+#if MAX_EQ_BANDS > MIX_BIQUADS
+#error MAX_EQ_BANDS must not exceed MIX_BIQUADS
+#endif
+
+#define EQ_LEVEL_RANGE 1500 // millibels of cut or boost, as on Android
+#define EQ_MAX_CENTER 0.45  // highest center frequency designed, as a fraction of the sample rate
+
+/** \brief Design the biquad section of one band at the device sample rate, using the formulas of
+ *  the Audio EQ Cookbook by Robert Bristow-Johnson.  The shelves turn over at the center
+ *  frequency of their band, and the bandwidth of a peaking section is that of its band.  At low
+ *  sample rates, a center above EQ_MAX_CENTER is moved down to it, short of the Nyquist frequency.
+ */
+
+static void IEqualizer_design(MixBiquadCoefs *coefs, unsigned section,
+    const struct EqualizerBand *band, SLmillibel level, SLboolean lowShelf, SLboolean highShelf,
+    SLuint32 sampleRate)
+{
+    if (0 == level) {
+        coefs->mB0[section] = 1.0f;
+        coefs->mB1[section] = 0.0f;
+        coefs->mB2[section] = 0.0f;
+        coefs->mA1[section] = 0.0f;
+        coefs->mA2[section] = 0.0f;
+        return;
+    }
+    double center = band->mCenter / 1000.0;
+    if (center > EQ_MAX_CENTER * sampleRate) {
+        center = EQ_MAX_CENTER * sampleRate;
+    }
+    double A = pow(10.0, level / 4000.0);
+    double w0 = 2.0 * M_PI * center / sampleRate;
+    double cosw0 = cos(w0);
+    double b0, b1, b2, a0, a1, a2;
+    if (lowShelf || highShelf) {
+        // shelf slope of 1, the steepest without overshoot
+        double alpha = sin(w0) / 2.0 * M_SQRT2;
+        double twoSqrtAAlpha = 2.0 * sqrt(A) * alpha;
+        double sign = lowShelf ? 1.0 : -1.0;
+        b0 = A * ((A + 1.0) - sign * (A - 1.0) * cosw0 + twoSqrtAAlpha);
+        b1 = sign * 2.0 * A * ((A - 1.0) - sign * (A + 1.0) * cosw0);
+        b2 = A * ((A + 1.0) - sign * (A - 1.0) * cosw0 - twoSqrtAAlpha);
+        a0 = (A + 1.0) + sign * (A - 1.0) * cosw0 + twoSqrtAAlpha;
+        a1 = -sign * 2.0 * ((A - 1.0) + sign * (A + 1.0) * cosw0);
+        a2 = (A + 1.0) + sign * (A - 1.0) * cosw0 - twoSqrtAAlpha;
+    } else {
+        double Q = center / ((band->mMax - band->mMin) / 1000.0);
+        double alpha = sin(w0) / (2.0 * Q);
+        b0 = 1.0 + alpha * A;
+        b1 = -2.0 * cosw0;
+        b2 = 1.0 - alpha * A;
+        a0 = 1.0 + alpha / A;
+        a1 = -2.0 * cosw0;
+        a2 = 1.0 - alpha / A;
+    }
+    coefs->mB0[section] = (float) (b0 / a0);
+    coefs->mB1[section] = (float) (b1 / a0);
+    coefs->mB2[section] = (float) (b2 / a0);
+    coefs->mA1[section] = (float) (a1 / a0);
+    coefs->mA2[section] = (float) (a2 / a0);
+}
+
+
+/** \brief Design the filters for the current band levels, and publish them to the mixer under a
+ *  sequence lock; see equalizer_update in IOutputMixExt.c.  The design is done here, in the
+ *  application thread, so the mixer only copies the coefficients when they change.  The equalizer
+ *  is inactive while it is disabled or flat, so then it costs the mixer nothing.
+ *  Called with the interface locked exclusively.
+ */
+
+static void IEqualizer_publish(IEqualizer *thiz)
+{
+    MixBiquadCoefs coefs;
+    SLboolean active = SL_BOOLEAN_FALSE;
+    // const after the engine is created, no lock needed
+    SLuint32 sampleRate = thiz->mThis->mEngine->mEngine.mSampleRate;
+    unsigned band;
+    for (band = 0; band < MIX_BIQUADS; ++band) {
+        SLmillibel level = band < thiz->mNumBands ? thiz->mLevels[band] : 0;
+        if (0 != level) {
+            active = thiz->mEnabled;
+        }
+        IEqualizer_design(&coefs, band, &thiz->mBands[band], level, 0 == band,
+            thiz->mNumBands - 1 == band, sampleRate);
+    }
+    // there is only one writer, as we hold the lock
+    SLuint32 sequence = thiz->mCoefsSequence;
+    atomic_store_relaxed(&thiz->mCoefsSequence, sequence + 1);
+    atomic_fence_release();
+    thiz->mPublishedCoefs = coefs;
+    thiz->mPublishedActive = active;
+    atomic_store_release(&thiz->mCoefsSequence, sequence + 2);
+}
+
+#endif // USE_OUTPUTMIXEXT
+
+
 #if defined(ANDROID)
 /**
  * returns true if this interface is not associated with an initialized Equalizer effect
@@ -60,6 +162,9 @@ static SLresult IEqualizer_SetEnabled(SLEqualizerItf self, SLboolean enabled)
     interface_lock_exclusive(thiz);
     thiz->mEnabled = (SLboolean) enabled;
 #if !defined(ANDROID)
+#ifdef USE_OUTPUTMIXEXT
+    IEqualizer_publish(thiz);
+#endif
     result = SL_RESULT_SUCCESS;
 #else
     if (NO_EQ(thiz)) {
@@ -155,6 +260,9 @@ static SLresult IEqualizer_SetBandLevel(SLEqualizerItf self, SLuint16 band, SLmi
 #if !defined(ANDROID)
         thiz->mLevels[band] = level;
         thiz->mPreset = SL_EQUALIZER_UNDEFINED;
+#ifdef USE_OUTPUTMIXEXT
+        IEqualizer_publish(thiz);
+#endif
         result = SL_RESULT_SUCCESS;
 #else
         if (NO_EQ(thiz)) {
@@ -389,6 +497,9 @@ static SLresult IEqualizer_UsePreset(SLEqualizerItf self, SLuint16 index)
         for (band = 0; band < thiz->mNumBands; ++band)
             thiz->mLevels[band] = EqualizerPresets[index].mLevels[band];
         thiz->mPreset = index;
+#ifdef USE_OUTPUTMIXEXT
+        IEqualizer_publish(thiz);
+#endif
         interface_unlock_exclusive(thiz);
         result = SL_RESULT_SUCCESS;
 #else
@@ -486,14 +597,27 @@ void IEqualizer_init(void *self)
         thiz->mLevels[band] = 0;
 #endif
     // const fields
+#ifdef USE_OUTPUTMIXEXT
+    // the mixer implements the equalizer
+    thiz->mNumPresets = MAX_EQ_PRESETS;
+    thiz->mNumBands = MAX_EQ_BANDS;
+#else
     thiz->mNumPresets = 0;
     thiz->mNumBands = 0;
+#endif
 #if !defined(ANDROID)
     thiz->mBands = EqualizerBands;
     thiz->mPresets = EqualizerPresets;
 #endif
+#ifdef USE_OUTPUTMIXEXT
+    thiz->mBandLevelRangeMin = -EQ_LEVEL_RANGE;
+    thiz->mBandLevelRangeMax = EQ_LEVEL_RANGE;
+    thiz->mCoefsSequence = 0;
+    IEqualizer_publish(thiz);
+#else
     thiz->mBandLevelRangeMin = 0;
     thiz->mBandLevelRangeMax = 0;
+#endif
 #if defined(ANDROID)
     memset(&thiz->mEqDescriptor, 0, sizeof(effect_descriptor_t));
     // placement new (explicit constructor)
@@ -525,3 +649,16 @@ bool IEqualizer_Expose(void *self)
 #endif
     return true;
 }
+
+#ifdef USE_OUTPUTMIXEXT
+/** \brief Called by DynamicInterfaceManagement::RemoveInterface with the object locked, to take
+ *  the equalizer out of the mix
+ */
+
+void IEqualizer_Remove(void *self)
+{
+    IEqualizer *thiz = (IEqualizer *) self;
+    thiz->mEnabled = SL_BOOLEAN_FALSE;
+    IEqualizer_publish(thiz);
+}
+#endif
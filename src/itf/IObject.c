@@ -561,9 +561,11 @@ void IObject_Destroy(SLObjectItf self)
     // If object is published, then remove it from exposure to sync thread and debugger
     if (0 != i) {
         --i;
-        unsigned mask = 1 << i;
-        assert(thisEngine->mInstanceMask & mask);
-        thisEngine->mInstanceMask &= ~mask;
+        unsigned group = i / INSTANCE_GROUP;
+        unsigned mask = 1 << (i % INSTANCE_GROUP);
+        assert(thisEngine->mInstanceMasks[group] & mask);
+        thisEngine->mInstanceMasks[group] &= ~mask;
+        thisEngine->mFullMask &= ~(1 << group);
         assert(thisEngine->mInstances[i] == thiz);
         thisEngine->mInstances[i] = NULL;
     }
@@ -812,13 +814,21 @@ void IObject_Publish(IObject *thiz)
     IEngine *thisEngine = &thiz->mEngine->mEngine;
     interface_lock_exclusive(thisEngine);
     // construct earlier reserved a pending slot, but did not choose the actual slot number
-    unsigned availMask = ~thisEngine->mInstanceMask;
+    unsigned availGroups = ~thisEngine->mFullMask;
+    assert(availGroups);
+    unsigned group = ctz(availGroups);
+    assert(MAX_INSTANCE_GROUPS > group);
+    unsigned availMask = ~thisEngine->mInstanceMasks[group];
     assert(availMask);
-    unsigned i = ctz(availMask);
+    unsigned bit = ctz(availMask);
+    unsigned i = group * INSTANCE_GROUP + bit;
     assert(MAX_INSTANCE > i);
     assert(NULL == thisEngine->mInstances[i]);
     thisEngine->mInstances[i] = thiz;
-    thisEngine->mInstanceMask |= 1 << i;
+    thisEngine->mInstanceMasks[group] |= 1 << bit;
+    if (((unsigned) ~0) == thisEngine->mInstanceMasks[group]) {
+        thisEngine->mFullMask |= 1 << group;
+    }
     // avoid zero as a valid instance ID
     thiz->mInstanceID = i + 1;
     interface_unlock_exclusive(thisEngine);
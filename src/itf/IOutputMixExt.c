@@ -18,17 +18,15 @@
 
 #include "sles_allinclusive.h"
 #include <math.h>
+#include <sched.h>
+#include <time.h>
 
 
 // OutputMixExt is used by SDL, but is not specific to or dependent on SDL
 
-
-// stereo is a frame consisting of a pair of 16-bit PCM samples
-
-typedef struct {
-    short left;
-    short right;
-} stereo;
+#define MIX_PARALLEL_MIN_TRACKS 8   // fewer active tracks than this are always mixed serially
+#define MIX_DEADLINE_PERCENT 50     // of a pass, for the workers to finish after the last claim
+#define MIX_SERIAL_PASSES 256       // mixed serially after the workers miss the deadline
 
 
 /** \brief Summary of the gain, as an optimization for the mixer */
@@ -40,313 +38,1727 @@ typedef enum {
 } Summary;
 
 
-/** \brief Check whether a track has any data for us to read */
+/** \brief Allocate a track slot, adding a group if all are full, or return NULL.
+ *  Called with the output mix locked.
+ */
+
+static Track *track_alloc(IOutputMixExt *thiz)
+{
+    if (0 == thiz->mFreeMask) {
+        unsigned group = thiz->mNumGroups;
+        if (MAX_TRACK_GROUPS <= group) {
+            return NULL;
+        }
+        Track *tracks = (Track *) malloc(TRACK_GROUP * sizeof(Track));
+        if (NULL == tracks) {
+            return NULL;
+        }
+        unsigned i;
+        for (i = 0; i < TRACK_GROUP; ++i) {
+            tracks[i].mAudioPlayer = NULL;
+            tracks[i].mIndex = group * TRACK_GROUP + i;
+            tracks[i].mRequests = 0;
+            tracks[i].mAcknowledged = 0;
+        }
+        thiz->mTrackGroups[group] = tracks;
+        thiz->mActiveMasks[group] = 0;
+        thiz->mFreeMask |= 1 << group;
+        thiz->mNumGroups = group + 1;
+    }
+    unsigned group = ctz(thiz->mFreeMask);
+    unsigned i = ctz(~thiz->mActiveMasks[group]);
+    thiz->mActiveMasks[group] |= 1 << i;
+    if (0 == ~thiz->mActiveMasks[group]) {
+        thiz->mFreeMask &= ~(1 << group);
+    }
+    thiz->mGroupMask |= 1 << group;
+    return &thiz->mTrackGroups[group][i];
+}
+
+
+/** \brief Release a track slot. Called with the output mix locked, but possibly by several
+ *  mixer worker threads at once, so the masks are updated atomically; allocation can't happen
+ *  at the same time, as that needs the output mix lock which the callback thread holds.
+ */
+
+static void track_free(IOutputMixExt *thiz, Track *track)
+{
+    unsigned group = track->mIndex / TRACK_GROUP;
+    unsigned mask = 1 << (track->mIndex % TRACK_GROUP);
+    assert(group < thiz->mNumGroups && track == &thiz->mTrackGroups[group][track->mIndex %
+        TRACK_GROUP]);
+    assert(thiz->mActiveMasks[group] & mask);
+    atomic_or_release(&thiz->mFreeMask, 1 << group);
+    if (0 == atomic_and_fetch_release(&thiz->mActiveMasks[group], ~mask)) {
+        atomic_and_fetch_release(&thiz->mGroupMask, ~(1 << group));
+    }
+}
+
+
+/** \brief Refresh the mixer's copy of the gains from those published by audioPlayerGainUpdate,
+ *  and of the pitch and tempo published with them by audioPlayerRateUpdate.
+ *  The publication is a sequence lock, and the application thread might be preempted part way
+ *  through an update, so we make a bounded number of attempts and otherwise keep the old gains.
+ */
+
+static void track_gains(Track *track)
+{
+    unsigned attempts;
+    for (attempts = 0; attempts < 4; ++attempts) {
+        SLuint32 sequence = atomic_load_acquire(&track->mGainsSequence);
+        if (sequence & 1) {
+            continue;
+        }
+        float left = track->mPublishedGains[0];
+        float right = track->mPublishedGains[1];
+        float sends[AUX_MAX];
+        memcpy(sends, track->mPublishedSends, sizeof(sends));
+        float pitch = track->mPublishedPitch;
+        float tempo = track->mPublishedTempo;
+        atomic_fence_acquire();
+        if (sequence == atomic_load_relaxed(&track->mGainsSequence)) {
+            track->mGains[0] = left;
+            track->mGains[1] = right;
+            memcpy(track->mSends, sends, sizeof(sends));
+            track->mPitch = pitch;
+            track->mTempo = tempo;
+            break;
+        }
+    }
+}
+
+
+/** \brief 3D parameters of a voice at the listener, which leave its gains and speed at unity */
+
+static const float spatialNeutral[MIX_VOICE_INPUTS] = {
+    [MIX_VOICE_MIN_DISTANCE] = 1.0f,
+    [MIX_VOICE_MAX_DISTANCE] = 1.0f,
+    [MIX_VOICE_CONE_INNER] = -1.0f,
+    [MIX_VOICE_CONE_OUTER] = -1.0f,
+    [MIX_VOICE_CONE_LEVEL] = 1.0f
+};
+
+
+/** \brief The listener of an engine which has never published one: at the origin, facing -z */
+
+static const MixListener listenerDefault = {
+    {0.0f, 0.0f, 0.0f},
+    {0.0f, 0.0f, 0.0f},
+    {0.0f, 0.0f, -1.0f},
+    {1.0f, 0.0f, 0.0f},
+    1.0f
+};
+
+
+/** \brief Put the mixer's side of an equalizer into its initial state, which is inactive */
+
+static void equalizer_init(Equalizer *eq)
+{
+    memset(eq, 0, sizeof(Equalizer));
+    eq->mActive = SL_BOOLEAN_FALSE;
+}
+
+
+/** \brief Refresh the mixer's copy of the filters of an equalizer if they have been published
+ *  again, and return whether the equalizer is to be applied.  As for the gains, the publication
+ *  is a sequence lock; if we catch it part way through an update we keep the old filters, and try
+ *  again during the next pass.  The filters start from silence each time the equalizer becomes
+ *  active, so a stale tail is never heard.
+ */
+
+static SLboolean biquads_update(Equalizer *eq, const MixBiquadCoefs *publishedCoefs,
+    const SLboolean *publishedActive, SLuint32 *publishedSequence)
+{
+    SLuint32 sequence = atomic_load_acquire(publishedSequence);
+    if (sequence != eq->mSequence && !(sequence & 1)) {
+        MixBiquadCoefs coefs = *publishedCoefs;
+        SLboolean active = *publishedActive;
+        atomic_fence_acquire();
+        if (sequence == atomic_load_relaxed(publishedSequence)) {
+            if (active && !eq->mActive) {
+                memset(eq->mState, 0, sizeof(eq->mState));
+            }
+            eq->mCoefs = coefs;
+            eq->mActive = active;
+            eq->mSequence = sequence;
+        }
+    }
+    return eq->mActive;
+}
+
+
+/** \brief As biquads_update, for the filters published by IEqualizer_publish */
+
+static SLboolean equalizer_update(Equalizer *eq, IEqualizer *published)
+{
+    return biquads_update(eq, &published->mPublishedCoefs, &published->mPublishedActive,
+        &published->mCoefsSequence);
+}
+
+
+/** \brief As biquads_update, for the shelf published by IBassBoost_publish; the boost starts from
+ *  silence and in full each time it becomes active
+ */
+
+static SLboolean bass_boost_update(BassBoost *bassBoost, IBassBoost *published)
+{
+    SLboolean wasActive = bassBoost->mShelf.mActive;
+    if (!biquads_update(&bassBoost->mShelf, &published->mPublishedCoefs,
+            &published->mPublishedActive, &published->mCoefsSequence)) {
+        return SL_BOOLEAN_FALSE;
+    }
+    if (!wasActive) {
+        memset(bassBoost->mDry, 0, sizeof(bassBoost->mDry));
+        bassBoost->mDepth = 1.0f;
+    }
+    return SL_BOOLEAN_TRUE;
+}
+
+
+/** \brief Refresh the mixer's copy of the crossfeed published by IVirtualizer_publish, as for an
+ *  equalizer, and return whether the virtualizer is to be applied
+ */
+
+static SLboolean virtualizer_update(Virtualizer *virtualizer, IVirtualizer *published)
+{
+    SLuint32 sequence = atomic_load_acquire(&published->mCoefsSequence);
+    if (sequence != virtualizer->mSequence && !(sequence & 1)) {
+        MixCrossfeedCoefs coefs = published->mPublishedCoefs;
+        SLboolean active = published->mPublishedActive;
+        atomic_fence_acquire();
+        if (sequence == atomic_load_relaxed(&published->mCoefsSequence)) {
+            if (active && !virtualizer->mActive) {
+                memset(virtualizer->mLeft, 0, (MIX_CROSSFEED_TAPS - 1) * sizeof(float));
+                memset(virtualizer->mRight, 0, (MIX_CROSSFEED_TAPS - 1) * sizeof(float));
+            }
+            virtualizer->mCoefs = coefs;
+            virtualizer->mActive = active;
+            virtualizer->mSequence = sequence;
+        }
+    }
+    return virtualizer->mActive;
+}
+
+
+/** \brief Refresh a reverb's parameters if IOutputMixExt_publishReverb has changed them, as for
+ *  an equalizer, and return the reverb, or NULL if its interface has never been exposed
+ */
+
+static Reverb *reverb_update(AuxReverb *auxReverb)
+{
+    Reverb *reverb = atomic_load_acquire(&auxReverb->mReverb);
+    if (NULL == reverb) {
+        return NULL;
+    }
+    SLuint32 sequence = atomic_load_acquire(&auxReverb->mSequence);
+    if (sequence != auxReverb->mCopied && !(sequence & 1)) {
+        ReverbParams params = auxReverb->mPublished;
+        atomic_fence_acquire();
+        if (sequence == atomic_load_relaxed(&auxReverb->mSequence)) {
+            Reverb_setParams(reverb, &params);
+            auxReverb->mCopied = sequence;
+        }
+    }
+    return reverb;
+}
+
+
+/** \brief Discard what the resampler and time stretch of a track hold, after a clear or stop */
+
+static void track_reset(Track *track)
+{
+    Resampler *resampler = atomic_load_acquire(&track->mResampler);
+    if (NULL != resampler) {
+        Resampler_reset(resampler);
+    }
+    Stretch *stretch = atomic_load_acquire(&track->mStretch);
+    if (NULL != stretch) {
+        Stretch_reset(stretch);
+    }
+}
+
+
+/** \brief Start reading a buffer of the track's buffer queue */
+
+static void track_load(Track *track, const BufferHeader *header)
+{
+    track->mReader = header->mBuffer;
+    track->mAvail = header->mSize;
+    track->mSilent = header->mSilent;
+}
+
+
+/** \brief Refresh the mixer's copy of the play events state published by audioPlayerEventsUpdate,
+ *  which is a sequence lock as for the gains; a seek restarts the position.
+ */
+
+static void track_events(Track *track)
+{
+    unsigned attempts;
+    for (attempts = 0; attempts < 4; ++attempts) {
+        SLuint32 sequence = atomic_load_acquire(&track->mEventsSequence);
+        if (sequence & 1) {
+            continue;
+        }
+        PlayEvents events = track->mPublishedEvents;
+        atomic_fence_acquire();
+        if (sequence == atomic_load_relaxed(&track->mEventsSequence)) {
+            if (events.mSeeks != track->mEvents.mSeeks) {
+                track->mPositionBase = events.mSeekPosition;
+                track->mPositionFrames = 0;
+                track->mEventPosition = events.mSeekPosition;
+                // seek postpones the next head at new position callback
+                track->mUpdateFrames = 0;
+            }
+            if (events.mPostpones != track->mEvents.mPostpones) {
+                track->mUpdateFrames = 0;
+            }
+            track->mEvents = events;
+            break;
+        }
+    }
+}
+
+
+/** \brief Check whether a track has any data for us to read.
+ *  The mixer never locks the audio player.  The play state, the requests to clear, stop, or
+ *  destroy, and the buffer queue rear are published to us atomically, and we are the only writer
+ *  of the buffer queue front except while a clear is pending.  The application thread which makes a request then waits in
+ *  audioPlayerAwaitMixer until we have done our part and acknowledged it, and completes the
+ *  request itself with the audio player locked.
+ */
 
 static SLboolean track_check(Track *track)
 {
     assert(NULL != track);
-    SLboolean trackHasData = SL_BOOLEAN_FALSE;
 
-    CAudioPlayer *audioPlayer = track->mAudioPlayer;
-    if (NULL != audioPlayer) {
+    CAudioPlayer *audioPlayer = atomic_load_acquire(&track->mAudioPlayer);
+    if (NULL == audioPlayer) {
+        return SL_BOOLEAN_FALSE;
+    }
 
-        // track is initialized
+    // track is initialized
 
-        // FIXME This lock could block and result in stuttering;
-        // a trylock with retry or lockless solution would be ideal
-        object_lock_exclusive(&audioPlayer->mObject);
-        assert(audioPlayer->mTrack == track);
-
-        SLuint32 framesMixed = track->mFramesMixed;
-        if (0 != framesMixed) {
-            track->mFramesMixed = 0;
-            audioPlayer->mPlay.mFramesSinceLastSeek += framesMixed;
-            audioPlayer->mPlay.mFramesSincePositionUpdate += framesMixed;
-        }
-
-        SLboolean doBroadcast = SL_BOOLEAN_FALSE;
-        const BufferHeader *oldFront;
-
-        if (audioPlayer->mBufferQueue.mClearRequested) {
-            // application thread(s) that call BufferQueue::Clear while mixer is active
-            // will block synchronously until mixer acknowledges the Clear request
-            audioPlayer->mBufferQueue.mFront = &audioPlayer->mBufferQueue.mArray[0];
-            audioPlayer->mBufferQueue.mRear = &audioPlayer->mBufferQueue.mArray[0];
-            audioPlayer->mBufferQueue.mState.count = 0;
-            audioPlayer->mBufferQueue.mState.playIndex = 0;
-            audioPlayer->mBufferQueue.mClearRequested = SL_BOOLEAN_FALSE;
+    IBufferQueue *bufferQueue = track->mBufferQueue;
+    const BufferHeader *oldFront;
+
+    // the requests are published before the count of them
+    SLuint32 requests = atomic_load_acquire(&track->mRequests);
+    if (requests != track->mAcknowledged) {
+
+        if (atomic_load_relaxed(&audioPlayer->mDestroyRequested)) {
+            // an application thread that calls Object::Destroy while mixer is active waits
+            // in the PreDestroy hook until mixer acknowledges the Destroy request
+            atomic_store_release(&track->mAudioPlayer, NULL);
+            if (NULL != track->mDispatcher) {
+                // callbacks for this player might still be on the way, so the callback thread
+                // releases the track and acknowledges the request once it has caught up
+                atomic_or_acq_rel(&track->mDeferredEvents, DISPATCHER_RELEASE);
+                Dispatcher_schedule(track->mDispatcher, track);
+                return SL_BOOLEAN_FALSE;
+            }
+            COutputMix *outputMix = CAudioPlayer_GetOutputMix(audioPlayer);
+            track_free(&outputMix->mOutputMixExt, track);
+            atomic_store_release(&track->mAcknowledged, requests);
+            return SL_BOOLEAN_FALSE;
+        }
+
+        if (SL_PLAYSTATE_STOPPING == atomic_load_relaxed(&audioPlayer->mPlay.mState)) {
+            // application thread(s) called Play::SetPlayState(STOPPED), which rewinds the front
+            // buffer and the position; the application thread resets its own position fields
+            (void) atomic_exchange_acquire(&track->mFramesMixed, 0);
+            track->mPositionBase = 0;
+            track->mPositionFrames = 0;
+            track->mUpdateFrames = 0;
+            track->mEventPosition = 0;
+            // running dry before the first buffer after a restart is not an underrun
+            track->mStarved = SL_BOOLEAN_TRUE;
+            oldFront = bufferQueue->mFront;
+            if (oldFront != atomic_load_acquire(&bufferQueue->mRear)) {
+                track_load(track, oldFront);
+            }
+            track_reset(track);
+        }
+
+        if (atomic_load_relaxed(&bufferQueue->mClearRequested)) {
+            // application thread(s) that call BufferQueue::Clear while mixer is active wait
+            // until we let go of the front buffer, and then empty the queue
             track->mReader = NULL;
             track->mAvail = 0;
-            doBroadcast = SL_BOOLEAN_TRUE;
+            track->mStarved = SL_BOOLEAN_TRUE;
+            track_reset(track);
         }
 
-        if (audioPlayer->mDestroyRequested) {
-            // an application thread that calls Object::Destroy while mixer is active will block
-            // synchronously in the PreDestroy hook until mixer acknowledges the Destroy request
-            COutputMix *outputMix = CAudioPlayer_GetOutputMix(audioPlayer);
-            unsigned i = track - outputMix->mOutputMixExt.mTracks;
-            assert( /* 0 <= i && */ i < MAX_TRACK);
-            unsigned mask = 1 << i;
-            track->mAudioPlayer = NULL;
-            assert(outputMix->mOutputMixExt.mActiveMask & mask);
-            outputMix->mOutputMixExt.mActiveMask &= ~mask;
-            audioPlayer->mTrack = NULL;
-            audioPlayer->mDestroyRequested = SL_BOOLEAN_FALSE;
-            doBroadcast = SL_BOOLEAN_TRUE;
-            goto broadcast;
-        }
-
-        switch (audioPlayer->mPlay.mState) {
-
-        case SL_PLAYSTATE_PLAYING:  // continue playing current track data
-            if (0 < track->mAvail) {
-                trackHasData = SL_BOOLEAN_TRUE;
-                break;
-            }
+        atomic_store_release(&track->mAcknowledged, requests);
+    }
+
+    if (atomic_load_acquire(&bufferQueue->mClearRequested)) {
+        // the queue is being emptied, or will be once we acknowledge the request
+        return SL_BOOLEAN_FALSE;
+    }
+
+    SLuint32 state = atomic_load_acquire(&audioPlayer->mPlay.mState);
+    switch (state) {
+
+    case SL_PLAYSTATE_PLAYING:  // continue playing current track data
+        track_gains(track);
+        // before any frames are mixed, so that they count from a seek or postponement
+        track_events(track);
+        if (0 < track->mAvail) {
+            track->mStarved = SL_BOOLEAN_FALSE;
+            return SL_BOOLEAN_TRUE;
+        }
+
+        // try to get another buffer from queue
+        oldFront = bufferQueue->mFront;
+        if (oldFront != atomic_load_acquire(&bufferQueue->mRear)) {
+            track_load(track, oldFront);
+            track->mStarved = SL_BOOLEAN_FALSE;
+            // note that the buffer stays on the queue while we are reading
+            return SL_BOOLEAN_TRUE;
+        }
+        // no buffers on queue, so playable but not playing; that is an underrun if the track
+        // has been playing since it was started or last ran dry
+        if (!track->mStarved) {
+            track->mStarved = SL_BOOLEAN_TRUE;
+            atomic_store_relaxed(&track->mUnderruns, track->mUnderruns + 1);
+        }
+        // NTH should be able to call a desperation callback when completely starved,
+        // or call less often than every buffer based on high/low water-marks
+        break;
+
+    case SL_PLAYSTATE_STOPPING: // acknowledged above, or will be during the next pass
+    case SL_PLAYSTATE_STOPPED:  // idle
+    case SL_PLAYSTATE_PAUSED:   // idle
+        break;
+
+    default:
+        assert(SL_BOOLEAN_FALSE);
+        break;
+    }
+
+    return SL_BOOLEAN_FALSE;
+
+}
+
+
+/** \brief Advance the track reader past consumed bytes, and if that completes the current buffer
+ *  then remove it from the buffer queue and call the application's callback.
+ */
+
+static void track_advance(Track *track, unsigned consumed)
+{
+    track->mReader = (char *) track->mReader + consumed;
+    track->mAvail -= consumed;
+    if (track->mAvail == 0) {
+        // The buffer queue is not locked: the application only enqueues at the rear,
+        // and we are the only one to advance the front, so the count and play index
+        // are updated atomically.  The callback can only be registered while stopped,
+        // which needs our acknowledgement, so it can't change while we are playing.
+        IBufferQueue *bufferQueue = track->mBufferQueue;
+        const BufferHeader *oldFront, *newFront, *rear;
+        oldFront = bufferQueue->mFront;
+        rear = atomic_load_acquire(&bufferQueue->mRear);
+        // a buffer stays on queue while playing, so it better still be there
+        assert(oldFront != rear);
+        newFront = oldFront;
+        if (++newFront == &bufferQueue->mArray[bufferQueue->mNumBuffers + 1]) {
+            newFront = bufferQueue->mArray;
+        }
+        atomic_store_release(&bufferQueue->mFront, (BufferHeader *) newFront);
+        assert(0 < bufferQueue->mState.count);
+        atomic_dec_release(&bufferQueue->mState.count);
+        if (newFront != rear) {
+            // we don't acknowledge application requests between buffers
+            // within the same mixer frame
+            track_load(track, newFront);
+        }
+        // else we would set play state to playable but not playing during next mixer
+        // frame if the queue is still empty at that time
+        atomic_inc_release(&bufferQueue->mState.playIndex);
+        if (NULL != track->mDispatcher) {
+            // leave the callback to the callback thread, so application code can't delay us
+            atomic_inc_release(&track->mDeferredBuffers);
+            Dispatcher_schedule(track->mDispatcher, track);
+            return;
+        }
+        slBufferQueueCallback callback = bufferQueue->mCallback;
+        void *context = bufferQueue->mContext;
+        // The callback function is called on each buffer completion
+        if (NULL != callback) {
+            (*callback)((SLBufferQueueItf) bufferQueue, context);
+            // Maybe it enqueued another buffer, or maybe it didn't.
+            // We will find out later during the next mixer frame.
+        }
+    }
+}
+
+
+/** \brief Deliver the position-based play events which are due after this pass.  This is what
+ *  keeps the markers and update callbacks in step with the frames actually mixed, at whatever
+ *  speed the device consumes them.  The mixer keeps its own count of the position for them, so
+ *  it needn't lock the audio player.
+ */
+
+static void track_position(Track *track)
+{
+    CAudioPlayer *audioPlayer = atomic_load_acquire(&track->mAudioPlayer);
+    if (NULL == audioPlayer) {
+        return;
+    }
+    // const once the audio player is realized
+    SLuint32 sampleRateMilliHz = audioPlayer->mSampleRateMilliHz;
+    if (UNKNOWN_SAMPLERATE == sampleRateMilliHz) {
+        return;
+    }
+    SLuint32 events = 0;
+    SLmillisecond oldPosition = track->mEventPosition;
+    // this will overflow after 49 days, but no fix possible as it's part of the API
+    SLmillisecond position = (SLuint32) (((long long) track->mPositionFrames * 1000000LL) /
+        sampleRateMilliHz) + track->mPositionBase;
+    track->mEventPosition = position;
+    // the marker is reached once as the position moves forward past it
+    SLmillisecond markerPosition = track->mEvents.mMarkerPosition;
+    if ((SL_TIME_UNKNOWN != markerPosition) && (oldPosition < markerPosition) &&
+            (markerPosition <= position) &&
+            (SL_PLAYEVENT_HEADATMARKER & track->mEvents.mEventFlags)) {
+        events |= SL_PLAYEVENT_HEADATMARKER;
+    }
+    // make a good faith effort for the mean time between "head at new position" callbacks to
+    // occur at the requested update period, but there will be jitter
+    SLuint32 frameUpdatePeriod = track->mEvents.mFrameUpdatePeriod;
+    if ((0 != frameUpdatePeriod) && (track->mUpdateFrames >= frameUpdatePeriod) &&
+            (SL_PLAYEVENT_HEADATNEWPOS & track->mEvents.mEventFlags)) {
+        // if we overrun a requested update period, then reset the clock modulo the
+        // update period so that it appears to the application as one or more lost callbacks,
+        // but no additional jitter
+        if ((track->mUpdateFrames -= frameUpdatePeriod) >= frameUpdatePeriod) {
+            track->mUpdateFrames %= frameUpdatePeriod;
+        }
+        events |= SL_PLAYEVENT_HEADATNEWPOS;
+    }
+    if (0 == events) {
+        return;
+    }
+    if (NULL != track->mDispatcher) {
+        atomic_or_acq_rel(&track->mDeferredEvents, events);
+        Dispatcher_schedule(track->mDispatcher, track);
+        return;
+    }
+    slPlayCallback callback = track->mEvents.mCallback;
+    void *context = track->mEvents.mContext;
+    if (NULL != callback) {
+        if (events & SL_PLAYEVENT_HEADATMARKER) {
+            (*callback)(&audioPlayer->mPlay.mItf, context, SL_PLAYEVENT_HEADATMARKER);
+        }
+        if (events & SL_PLAYEVENT_HEADATNEWPOS) {
+            (*callback)(&audioPlayer->mPlay.mItf, context, SL_PLAYEVENT_HEADATNEWPOS);
+        }
+    }
+}
+
+
+/** \brief Convert source frames to interleaved stereo float normalized like the bus,
+ *  and return where they are; that might be the source itself.  A silent buffer is not read.
+ */
+
+static const float *track_convert(const MixKernels *kernels, MixLane *lane, const Track *track,
+    const void *source, unsigned frames)
+{
+    assert(MIXBUS_FRAMES >= frames);
+    unsigned channels = track->mChannels;
+    float *convert = lane->mConvert;
+    if (track->mSilent) {
+        memset(convert, 0, frames * STEREO_CHANNELS * sizeof(float));
+        return convert;
+    }
+    const float *decoded;
+    switch (track->mFormat) {
+    case SLESUT_PCM_S16:
+        if (STEREO_CHANNELS == channels) {
+            (*kernels->mLoad)(convert, (const short *) source, frames, 1.0f, 1.0f);
+        } else {
+            (*kernels->mDownmix)(convert, (const short *) source, frames, channels,
+                track->mDownmix);
+        }
+        return convert;
+    case SLESUT_PCM_FLOAT:
+        decoded = (const float *) source;
+        break;
+    default:
+        slesutPcmConvert(lane->mDecode, SLESUT_PCM_FLOAT, source, track->mFormat,
+            frames * channels, SLESUT_DITHER_NONE, NULL);
+        decoded = lane->mDecode;
+        break;
+    }
+    if (STEREO_CHANNELS == channels) {
+        return decoded;
+    }
+    (*kernels->mDownmixFloat)(convert, decoded, frames, channels, track->mDownmix);
+    return convert;
+}
+
+
+/** \brief Add frames frames of a track, from offset frames into the pass, to the aux buses of the
+ *  lane that it sends to, at its send gains.  The frames are 16-bit stereo if s16 is non-NULL,
+ *  and otherwise interleaved stereo float.  The first track to send to an aux bus during a pass
+ *  clears all passFrames of it, so that tracks which run dry part way through leave silence.
+ */
+
+static void mix_sends(const MixKernels *kernels, MixLane *lane, const Track *track,
+    unsigned sendMask, unsigned passFrames, unsigned offset, const short *s16,
+    const float *stereo, unsigned frames)
+{
+    while (0 != sendMask) {
+        unsigned aux = ctz(sendMask);
+        assert(AUX_MAX > aux);
+        sendMask &= sendMask - 1;
+        float *bus = lane->mAux[aux];
+        if (!lane->mAuxHasData[aux]) {
+            memset(bus, 0, passFrames * STEREO_CHANNELS * sizeof(float));
+            lane->mAuxHasData[aux] = SL_BOOLEAN_TRUE;
+        }
+        bus += offset * STEREO_CHANNELS;
+        float send = track->mSends[aux];
+        if (NULL != s16) {
+            (*kernels->mAccumulate)(bus, s16, frames, send, send);
+        } else {
+            (*kernels->mAccumulateFloat)(bus, stereo, frames, send, send);
+        }
+    }
+}
+
+
+/** \brief Mix one allocated track into the first frames of the bus of the specified lane,
+ *  and set the lane's mBusHasData if the track contributed to the mix.  The sends to the aux
+ *  effects are taken before the player's equalizer.
+ */
+
+static void mix_track(const MixKernels *kernels, MixLane *lane, Track *track, unsigned frames)
+{
+    // the lane totals the underruns counted by track_check, for the mixer statistics
+    SLuint32 underruns = track->mUnderruns;
+    if (!track_check(track)) {
+        // the frames mixed before the track ran dry still count
+        track_position(track);
+        lane->mUnderruns += track->mUnderruns - underruns;
+        return;
+    }
 
-            // try to get another buffer from queue
-            oldFront = audioPlayer->mBufferQueue.mFront;
-            if (oldFront != audioPlayer->mBufferQueue.mRear) {
-                assert(0 < audioPlayer->mBufferQueue.mState.count);
-                track->mReader = oldFront->mBuffer;
-                track->mAvail = oldFront->mSize;
-                // note that the buffer stays on the queue while we are reading
-                audioPlayer->mPlay.mState = SL_PLAYSTATE_PLAYING;
-                trackHasData = SL_BOOLEAN_TRUE;
+    // track is playing; if its player has an active equalizer, the track is mixed on its own
+    // first, so that it can be filtered before it is added to the bus
+    Resampler *resampler = atomic_load_acquire(&track->mResampler);
+    Stretch *stretch = atomic_load_acquire(&track->mStretch);
+    // the pitch and Doppler shift are both changes of speed of the resampler
+    if (NULL != resampler) {
+        Resampler_setSpeed(resampler, track->mPitch * track->mDopplerSpeed);
+    }
+    if (NULL != stretch) {
+        Stretch_setTempo(stretch, track->mTempo);
+    }
+    CAudioPlayer *audioPlayer = atomic_load_relaxed(&track->mAudioPlayer);
+    SLboolean equalized = equalizer_update(&track->mEqualizer, &audioPlayer->mEqualizer);
+    float *busWriter = equalized ? lane->mEqualize : lane->mBus;
+    float *const busStart = busWriter;
+    SLboolean accumulate = !equalized && lane->mBusHasData;
+    unsigned desired = frames;
+    SLboolean trackContributedToMix = SL_BOOLEAN_FALSE;
+    float gains[STEREO_CHANNELS];
+    Summary summaries[STEREO_CHANNELS];
+    unsigned channel;
+    for (channel = 0; channel < STEREO_CHANNELS; ++channel) {
+        float gain = track->mGains[channel] * track->mSpatialGains[channel];
+        gains[channel] = gain;
+        Summary summary;
+        if (gain <= 0.001) {
+            summary = GAIN_MUTE;
+        } else if (gain >= 0.999) {
+            summary = GAIN_UNITY;
+        } else {
+            summary = GAIN_OTHER;
+        }
+        summaries[channel] = summary;
+    }
+    if (GAIN_UNITY == summaries[0] && GAIN_UNITY == summaries[1]) {
+        gains[0] = gains[1] = 1.0f;
+    }
+    unsigned sendMask = 0;
+    unsigned aux;
+    for (aux = 0; aux < AUX_MAX; ++aux) {
+        if (track->mSends[aux] > 0.001) {
+            sendMask |= 1 << aux;
+        }
+    }
+    // a track which can't be heard is virtual: it is only advanced, without reading its samples
+    SLboolean audible = !track->mVirtual &&
+        (GAIN_MUTE != summaries[0] || GAIN_MUTE != summaries[1] || 0 != sendMask);
+    while (desired > 0) {
+        if (track->mAvail > 0) {
+            assert(NULL != track->mReader);
+            const void *source = track->mReader;
+            // mAvail is in bytes, but a partial frame at the end of a buffer is not mixed
+            unsigned avail = track->mAvail / track->mFrameSize;
+            unsigned actual, consumed;
+            // adding silence changes nothing, so a silent buffer mixed directly is skipped
+            // like a virtual track; the resampler, time stretch and equalizer are fed silence
+            // instead, so that they ring on
+            SLboolean skip = track->mSilent && !equalized && NULL == resampler &&
+                NULL == stretch;
+            if (audible && !skip && !accumulate && !trackContributedToMix) {
+                // the bus is loaded rather than accumulated, so clear what was skipped
+                memset(busStart, 0, (busWriter - busStart) * sizeof(float));
+            }
+            if (skip) {
+                actual = desired < avail ? desired : avail;
+                consumed = actual;
+                if (audible && !accumulate && trackContributedToMix) {
+                    memset(busWriter, 0, actual * STEREO_CHANNELS * sizeof(float));
+                }
+            } else if (NULL == resampler && NULL == stretch && SLESUT_PCM_S16 == track->mFormat &&
+                    STEREO_CHANNELS == track->mChannels && !track->mSilent) {
+                actual = desired < avail ? desired : avail;
+                consumed = actual;
+                // accumulate into the wide bus, so tracks can't wrap or lose precision
+                if (audible) {
+                    if (accumulate) {
+                        (*kernels->mAccumulate)(busWriter, (const short *) source, actual,
+                            gains[0], gains[1]);
+                    } else {
+                        (*kernels->mLoad)(busWriter, (const short *) source, actual,
+                            gains[0], gains[1]);
+                    }
+                    if (0 != sendMask) {
+                        mix_sends(kernels, lane, track, sendMask, frames, frames - desired,
+                            (const short *) source, NULL, actual);
+                    }
+                }
+            } else if (NULL == resampler && NULL == stretch) {
+                actual = desired < avail ? desired : avail;
+                consumed = actual;
+                if (audible) {
+                    const float *stereo = track_convert(kernels, lane, track, source, actual);
+                    if (accumulate) {
+                        (*kernels->mAccumulateFloat)(busWriter, stereo, actual, gains[0],
+                            gains[1]);
+                    } else {
+                        (*kernels->mLoadFloat)(busWriter, stereo, actual, gains[0],
+                            gains[1]);
+                    }
+                    if (0 != sendMask) {
+                        mix_sends(kernels, lane, track, sendMask, frames, frames - desired,
+                            NULL, stereo, actual);
+                    }
+                }
+            } else if (!audible) {
+                // the resampler and time stretch positions still advance, so the track stays
+                // in sync
+                if (NULL == stretch) {
+                    actual = Resampler_skip(resampler, desired, avail, &consumed);
+                } else {
+                    unsigned count = Stretch_inputFrames(stretch, desired), used;
+                    if (NULL != resampler) {
+                        count = Resampler_skip(resampler, count, avail, &consumed);
+                    } else {
+                        consumed = count = count < avail ? count : avail;
+                    }
+                    actual = Stretch_skip(stretch, desired, count, &used);
+                    assert(used == count);
+                }
             } else {
-                // no buffers on queue, so playable but not playing
-                // NTH should be able to call a desperation callback when completely starved,
-                // or call less often than every buffer based on high/low water-marks
+                // the source is converted to stereo float first, but only as much of it
+                // as the resampler or time stretch will consume
+                float *scratch = lane->mScratch;
+                const float *stereo;
+                unsigned count = NULL != stretch ? Stretch_inputFrames(stretch, desired) :
+                    desired;
+                if (count > MIXBUS_FRAMES) {
+                    count = MIXBUS_FRAMES;
+                }
+                if (NULL != resampler) {
+                    // the frames the resampler is to produce, at the device rate
+                    unsigned resampled = count;
+                    count = Resampler_inputFrames(resampler, resampled);
+                    if (count > avail) {
+                        count = avail;
+                    }
+                    if (count > MIXBUS_FRAMES) {
+                        count = MIXBUS_FRAMES;
+                    }
+                    stereo = track_convert(kernels, lane, track, source, count);
+                    float *out = NULL != stretch ? lane->mStretch : scratch;
+                    count = Resampler_process(resampler, out, resampled, stereo, count,
+                        &consumed);
+                    stereo = out;
+                } else {
+                    if (count > avail) {
+                        count = avail;
+                    }
+                    stereo = track_convert(kernels, lane, track, source, count);
+                    consumed = count;
+                }
+                if (NULL != stretch) {
+                    unsigned used;
+                    actual = Stretch_process(stretch, scratch, desired, stereo, count, &used);
+                    assert(used == count);
+                } else {
+                    actual = count;
+                }
+                if (accumulate) {
+                    (*kernels->mAccumulateFloat)(busWriter, scratch, actual, gains[0], gains[1]);
+                } else {
+                    (*kernels->mLoadFloat)(busWriter, scratch, actual, gains[0], gains[1]);
+                }
+                if (0 != sendMask) {
+                    mix_sends(kernels, lane, track, sendMask, frames, frames - desired, NULL,
+                        scratch, actual);
+                }
+            }
+            if (audible && !skip) {
+                trackContributedToMix = SL_BOOLEAN_TRUE;
+            }
+            busWriter += actual * STEREO_CHANNELS;
+            desired -= actual;
+            // a trailing partial frame is discarded
+            unsigned bytes = 0 == avail ? track->mAvail : consumed * track->mFrameSize;
+            atomic_store_relaxed(&track->mBytesMixed, track->mBytesMixed + bytes);
+            track_advance(track, bytes);
+            // position is in frames at the track sample rate, so count the input frames;
+            // folded into the play position by audioPlayerFramesMixedUpdate
+            atomic_add_release(&track->mFramesMixed, consumed);
+            track->mPositionFrames += consumed;
+            track->mUpdateFrames += consumed;
+            continue;
+        }
+        // we need more data: desired > 0 but actual == 0
+        if (track_check(track)) {
+            continue;
+        }
+        // underflow: clear out rest of partial bus (NTH synthesize comfort noise)
+        if (!accumulate && trackContributedToMix) {
+            memset(busWriter, 0, desired * STEREO_CHANNELS * sizeof(float));
+        }
+        break;
+    }
+    if (trackContributedToMix) {
+        if (equalized) {
+            // the rest of the track's buffer was cleared if it ran dry, so the filters ring on
+            (*kernels->mBiquads)(lane->mEqualize, frames, &track->mEqualizer.mCoefs,
+                track->mEqualizer.mState);
+            if (lane->mBusHasData) {
+                (*kernels->mAccumulateFloat)(lane->mBus, lane->mEqualize, frames, 1.0f, 1.0f);
+            } else {
+                (*kernels->mLoadFloat)(lane->mBus, lane->mEqualize, frames, 1.0f, 1.0f);
             }
+        }
+        lane->mBusHasData = SL_BOOLEAN_TRUE;
+    }
+    track_position(track);
+    lane->mUnderruns += track->mUnderruns - underruns;
+}
+
+
+/** \brief Partially sort keys into descending order, so that the first k are the k largest.
+ *  The keys are distinct.  This is a quickselect, so it takes linear time on average.
+ */
 
-            // copy gains from audio player to track
-            track->mGains[0] = audioPlayer->mGains[0];
-            track->mGains[1] = audioPlayer->mGains[1];
+static void voices_select(unsigned long long *keys, unsigned n, unsigned k)
+{
+    unsigned lo = 0, hi = n;
+    while (hi - lo > 1) {
+        unsigned long long pivot = keys[lo + (hi - lo) / 2];
+        keys[lo + (hi - lo) / 2] = keys[hi - 1];
+        keys[hi - 1] = pivot;
+        unsigned store = lo, i;
+        for (i = lo; i < hi - 1; ++i) {
+            if (keys[i] > pivot) {
+                unsigned long long key = keys[i];
+                keys[i] = keys[store];
+                keys[store++] = key;
+            }
+        }
+        keys[hi - 1] = keys[store];
+        keys[store] = pivot;
+        // now keys[lo, store) are larger than the pivot, and keys (store, hi) are smaller
+        if (store == k || store + 1 == k) {
             break;
+        }
+        if (store > k) {
+            hi = store;
+        } else {
+            lo = store + 1;
+        }
+    }
+}
+
 
-        case SL_PLAYSTATE_STOPPING: // application thread(s) called Play::SetPlayState(STOPPED)
-            audioPlayer->mPlay.mPosition = (SLmillisecond) 0;
-            audioPlayer->mPlay.mFramesSinceLastSeek = 0;
-            audioPlayer->mPlay.mFramesSincePositionUpdate = 0;
-            audioPlayer->mPlay.mLastSeekPosition = 0;
-            audioPlayer->mPlay.mState = SL_PLAYSTATE_STOPPED;
-            // stop cancels a pending seek
-            audioPlayer->mSeek.mPos = SL_TIME_UNKNOWN;
-            oldFront = audioPlayer->mBufferQueue.mFront;
-            if (oldFront != audioPlayer->mBufferQueue.mRear) {
-                assert(0 < audioPlayer->mBufferQueue.mState.count);
-                track->mReader = oldFront->mBuffer;
-                track->mAvail = oldFront->mSize;
+/** \brief Choose the tracks to be mixed during this fill, when more than mMaxVoices are playing.
+ *  Tracks are ranked by the priority of their audio player, then by their loudest gain, and then
+ *  tracks which were mixed during the last fill are preferred, so that tracks of equal rank
+ *  don't keep swapping.  The rest are virtual for this fill.  Silent tracks are not counted,
+ *  as they are only advanced anyway.
+ */
+
+static void mix_voices(IOutputMixExt *thiz, unsigned groupMask)
+{
+    unsigned long long *keys = thiz->mVoiceKeys;
+    unsigned numKeys = 0;
+    while (0 != groupMask) {
+        unsigned group = ctz(groupMask);
+        groupMask &= groupMask - 1;
+        unsigned activeMask = thiz->mActiveMasks[group];
+        Track *tracks = thiz->mTrackGroups[group];
+        while (0 != activeMask) {
+            unsigned i = ctz(activeMask);
+            activeMask &= activeMask - 1;
+            Track *track = &tracks[i];
+            SLboolean wasVirtual = track->mVirtual;
+            track->mVirtual = SL_BOOLEAN_FALSE;
+            // these are only hints, as track_check decides whether the track is really playing
+            CAudioPlayer *audioPlayer = atomic_load_acquire(&track->mAudioPlayer);
+            if (NULL == audioPlayer ||
+                    SL_PLAYSTATE_PLAYING != atomic_load_relaxed(&audioPlayer->mPlay.mState)) {
+                continue;
+            }
+            float left = track->mGains[0] * track->mSpatialGains[0];
+            float right = track->mGains[1] * track->mSpatialGains[1];
+            float gain = left > right ? left : right;
+            if (gain <= 0.001) {
+                continue;
             }
-            doBroadcast = SL_BOOLEAN_TRUE;
+            // The key is the priority with its sign flipped so it compares as unsigned, then
+            // the upper bits of the gain, which compare as an unsigned integer as it's positive,
+            // then whether it was mixed last time, and the index (10 bits) to make it distinct
+            union {
+                float f;
+                uint32_t u;
+            } gainBits;
+            gainBits.f = gain;
+#if USE_PROFILES & USE_PROFILES_BASE
+            uint32_t priority = (uint32_t) atomic_load_relaxed(&audioPlayer->mObject.mPriority);
+#else
+            // without Object::SetPriority, voices are only ranked by level
+            uint32_t priority = (uint32_t) SL_PRIORITY_NORMAL;
+#endif
+            keys[numKeys++] = ((unsigned long long) (priority ^ 0x80000000) << 32) |
+                ((unsigned long long) (gainBits.u >> 10) << 11) |
+                ((unsigned long long) !wasVirtual << 10) | track->mIndex;
+        }
+    }
+    unsigned maxVoices = thiz->mMaxVoices;
+    if (numKeys <= maxVoices) {
+        thiz->mNumVirtual = 0;
+        return;
+    }
+    voices_select(keys, numKeys, maxVoices);
+    unsigned n;
+    for (n = maxVoices; n < numKeys; ++n) {
+        unsigned index = (unsigned) (keys[n] & (MAX_TRACK - 1));
+        thiz->mTrackGroups[index / TRACK_GROUP][index % TRACK_GROUP].mVirtual = SL_BOOLEAN_TRUE;
+    }
+    thiz->mNumVirtual = numKeys - maxVoices;
+}
+
+
+/** \brief Spatialize the playing 3D tracks, once per fill.  Their parameters are gathered into
+ *  a batch of voices, the spatialize kernel runs over the whole batch at once, and the results
+ *  are scattered back to the tracks: the gains are applied with the track's own gains, and the
+ *  speed is that of its resampler.  The application only publishes parameters, so the cost of
+ *  moving a voice or the listener doesn't depend on how many voices there are.
+ */
+
+static void mix_spatialize(IOutputMixExt *thiz, Spatial *spatial, unsigned groupMask)
+{
+    Track **voiceTracks = thiz->mVoiceTracks;
+    unsigned count = 0;
+    while (0 != groupMask) {
+        unsigned group = ctz(groupMask);
+        groupMask &= groupMask - 1;
+        unsigned activeMask = thiz->mActiveMasks[group];
+        Track *tracks = thiz->mTrackGroups[group];
+        while (0 != activeMask) {
+            unsigned i = ctz(activeMask);
+            activeMask &= activeMask - 1;
+            Track *track = &tracks[i];
+            // the audio player first, as a track is reset before it is given to a new player;
+            // as for mix_voices, the play state is only a hint
+            CAudioPlayer *audioPlayer = atomic_load_acquire(&track->mAudioPlayer);
+            if (NULL == audioPlayer || !atomic_load_acquire(&track->mSpatialized) ||
+                    SL_PLAYSTATE_PLAYING != atomic_load_relaxed(&audioPlayer->mPlay.mState)) {
+                continue;
+            }
+            voiceTracks[count++] = track;
+        }
+    }
+    if (0 == count) {
+        return;
+    }
+
+    // The columns of every track and the listener are published under the one sequence of the
+    // engine, so the batch is copied as a whole, and a fill sees all of a commit or none of it.
+    // If the application keeps publishing, the batch falls back to the last good copies.
+    float *voices = thiz->mVoices;
+    MixListener listener;
+    SLboolean listenerPublished = SL_BOOLEAN_FALSE;
+    SLboolean fresh = SL_BOOLEAN_FALSE;
+    unsigned attempts, n, row;
+    for (attempts = 0; attempts < 4 && !fresh; ++attempts) {
+        SLuint32 sequence = atomic_load_acquire(&spatial->mSequence);
+        if (sequence & 1) {
+            continue;
+        }
+        for (n = 0; n < count; ++n) {
+            const float *published = voiceTracks[n]->mSpatialPublished;
+            for (row = 0; row < MIX_VOICE_INPUTS; ++row) {
+                voices[row * MAX_TRACK + n] = published[row];
+            }
+        }
+        listener = spatial->mListener;
+        listenerPublished = spatial->mListenerPublished;
+        atomic_fence_acquire();
+        fresh = sequence == atomic_load_relaxed(&spatial->mSequence);
+    }
+    for (n = 0; n < count; ++n) {
+        float *copy = voiceTracks[n]->mSpatial;
+        for (row = 0; row < MIX_VOICE_INPUTS; ++row) {
+            if (fresh) {
+                copy[row] = voices[row * MAX_TRACK + n];
+            } else {
+                voices[row * MAX_TRACK + n] = copy[row];
+            }
+        }
+    }
+    if (fresh && listenerPublished) {
+        thiz->mListener = listener;
+    }
+
+    (*thiz->mKernels->mSpatialize)(voices, MAX_TRACK, count, &thiz->mListener);
+    for (n = 0; n < count; ++n) {
+        Track *track = voiceTracks[n];
+        track->mSpatialGains[0] = voices[MIX_VOICE_GAIN_LEFT * MAX_TRACK + n];
+        track->mSpatialGains[1] = voices[MIX_VOICE_GAIN_RIGHT * MAX_TRACK + n];
+        // applied with the pitch by mix_track
+        track->mDopplerSpeed = voices[MIX_VOICE_SPEED * MAX_TRACK + n];
+    }
+}
+
+
+/** \brief Start a pass on a lane: none of its buses have data yet */
+
+static void lane_begin(MixLane *lane)
+{
+    lane->mBusHasData = SL_BOOLEAN_FALSE;
+    unsigned aux;
+    for (aux = 0; aux < AUX_MAX; ++aux) {
+        lane->mAuxHasData[aux] = SL_BOOLEAN_FALSE;
+    }
+}
+
+
+/** \brief Mix the active tracks serially into the first frames of the callback thread's bus,
+ *  and their sends into its aux buses.  Returns whether any track contributed to the mix; if none
+ *  did, then the bus contents are undefined.
+ */
+
+static SLboolean mix_bus(IOutputMixExt *thiz, unsigned groupMask, unsigned frames)
+{
+    const MixKernels *kernels = thiz->mKernels;
+    MixLane *lane = &thiz->mLane;
+    lane_begin(lane);
+    while (0 != groupMask) {
+        unsigned group = ctz(groupMask);
+        assert(MAX_TRACK_GROUPS > group);
+        groupMask &= groupMask - 1;
+        // a track might be released while we are mixing it, so take a copy of the group's mask
+        unsigned activeMask = thiz->mActiveMasks[group];
+        Track *tracks = thiz->mTrackGroups[group];
+        while (0 != activeMask) {
+            unsigned i = ctz(activeMask);
+            assert(TRACK_GROUP > i);
+            activeMask &= activeMask - 1;
+            mix_track(kernels, lane, &tracks[i], frames);
+        }
+    }
+    return lane->mBusHasData;
+}
+
+
+/** \brief Claim tracks from the work list one at a time, and mix each into the specified lane,
+ *  until none are left
+ */
+
+static void mix_claim(IOutputMixExt *thiz, MixLane *lane)
+{
+    const MixKernels *kernels = thiz->mKernels;
+    unsigned numWork = thiz->mNumWork;
+    unsigned frames = thiz->mPassFrames;
+    for (;;) {
+        unsigned i = atomic_fetch_inc_relaxed(&thiz->mNextWork);
+        if (i >= numWork) {
             break;
+        }
+        mix_track(kernels, lane, thiz->mWork[i], frames);
+    }
+}
+
+
+/** \brief Fork-join work function of each mixer worker thread */
+
+static void mix_worker(void *context, unsigned worker)
+{
+    IOutputMixExt *thiz = (IOutputMixExt *) context;
+    assert(0 < worker);
+    mix_claim(thiz, &thiz->mWorkerLanes[worker - 1]);
+}
+
+
+/** \brief As mix_bus, but share the active tracks between the callback thread and the workers.
+ *  Each thread mixes whole tracks into its own lane's bus, so a track is only ever touched by
+ *  one thread during a pass, and then the callback thread sums the workers' buses into its own.
+ *  The callback thread claims tracks too, so if a worker is slow to wake up then the callback
+ *  thread simply mixes more of the tracks itself.
+ */
+
+static SLboolean mix_parallel(IOutputMixExt *thiz, unsigned groupMask, unsigned frames)
+{
+    // flatten the active tracks, so that they can be claimed one at a time
+    unsigned numWork = 0;
+    while (0 != groupMask) {
+        unsigned group = ctz(groupMask);
+        assert(MAX_TRACK_GROUPS > group);
+        groupMask &= groupMask - 1;
+        unsigned activeMask = thiz->mActiveMasks[group];
+        Track *tracks = thiz->mTrackGroups[group];
+        while (0 != activeMask) {
+            unsigned i = ctz(activeMask);
+            assert(TRACK_GROUP > i);
+            activeMask &= activeMask - 1;
+            thiz->mWork[numWork++] = &tracks[i];
+        }
+    }
+    thiz->mNumWork = numWork;
+    thiz->mNextWork = 0;
+    thiz->mPassFrames = frames;
+    MixLane *lane = &thiz->mLane;
+    lane_begin(lane);
+    ForkJoin *forkJoin = thiz->mForkJoin;
+    unsigned numWorkers = forkJoin->mNumWorkers;
+    // waking the workers costs more than mixing a few tracks
+    if (numWork < MIX_PARALLEL_MIN_TRACKS) {
+        mix_claim(thiz, lane);
+        return lane->mBusHasData;
+    }
+    unsigned worker;
+    for (worker = 0; worker < numWorkers; ++worker) {
+        lane_begin(&thiz->mWorkerLanes[worker]);
+    }
+    ForkJoin_fork(forkJoin, mix_worker, thiz);
+    mix_claim(thiz, lane);
+    // All tracks have now been claimed, and the workers are finishing the last of them.  We must
+    // wait for them regardless, as they own those tracks and their buses, but if they took more
+    // than the deadline then they are being starved of CPU, so mix serially for a while.
+    unsigned deadlineNs = (unsigned) ((unsigned long long) frames * 1000000000ULL *
+        MIX_DEADLINE_PERCENT / 100 / thiz->mSampleRate);
+    if (!ForkJoin_join(forkJoin, deadlineNs)) {
+        // counted rather than logged, as logging could make this thread miss its own deadline
+        ++thiz->mStatistics.mCounters.workerMisses;
+        thiz->mSerialPasses = MIX_SERIAL_PASSES;
+    }
+    const MixKernels *kernels = thiz->mKernels;
+    for (worker = 0; worker < numWorkers; ++worker) {
+        const MixLane *workerLane = &thiz->mWorkerLanes[worker];
+        unsigned aux;
+        for (aux = 0; aux < AUX_MAX; ++aux) {
+            if (!workerLane->mAuxHasData[aux]) {
+                continue;
+            }
+            if (lane->mAuxHasData[aux]) {
+                (*kernels->mAccumulateFloat)(lane->mAux[aux], workerLane->mAux[aux], frames,
+                    1.0f, 1.0f);
+            } else {
+                (*kernels->mLoadFloat)(lane->mAux[aux], workerLane->mAux[aux], frames, 1.0f,
+                    1.0f);
+                lane->mAuxHasData[aux] = SL_BOOLEAN_TRUE;
+            }
+        }
+        if (!workerLane->mBusHasData) {
+            continue;
+        }
+        if (lane->mBusHasData) {
+            (*kernels->mAccumulateFloat)(lane->mBus, workerLane->mBus, frames, 1.0f, 1.0f);
+        } else {
+            (*kernels->mLoadFloat)(lane->mBus, workerLane->mBus, frames, 1.0f, 1.0f);
+            lane->mBusHasData = SL_BOOLEAN_TRUE;
+        }
+    }
+    return lane->mBusHasData;
+}
+
+
+/** \brief Run each reverb of the output mix once, on the sum of the sends to it, adding its
+ *  output to the callback thread's bus.  Returns whether the bus now has data.
+ */
+
+static SLboolean mix_aux(IOutputMixExt *thiz, COutputMix *outputMix, unsigned frames,
+    SLboolean busHasData)
+{
+    AuxReverb *auxReverbs[AUX_MAX];
+    auxReverbs[AUX_ENVIRONMENTALREVERB] = &outputMix->mEnvironmentalReverb.mAuxReverb;
+    auxReverbs[AUX_PRESETREVERB] = &outputMix->mPresetReverb.mAuxReverb;
+    MixLane *lane = &thiz->mLane;
+    unsigned aux;
+    for (aux = 0; aux < AUX_MAX; ++aux) {
+        Reverb *reverb = reverb_update(auxReverbs[aux]);
+        if (NULL != reverb && Reverb_process(reverb, lane->mBus, busHasData,
+                lane->mAuxHasData[aux] ? lane->mAux[aux] : NULL, frames)) {
+            busHasData = SL_BOOLEAN_TRUE;
+        }
+    }
+    return busHasData;
+}
+
+
+/** \brief Apply the virtualizer to the final mix: each channel is deinterleaved after its history,
+ *  fed across to the other channel, and the end of it kept as the history of the next pass
+ */
+
+static void mix_virtualizer(const MixKernels *kernels, Virtualizer *virtualizer, float *bus,
+    unsigned frames)
+{
+    float *left = &virtualizer->mLeft[MIX_CROSSFEED_TAPS - 1];
+    float *right = &virtualizer->mRight[MIX_CROSSFEED_TAPS - 1];
+    unsigned i;
+    for (i = 0; i < frames; ++i) {
+        left[i] = bus[i * STEREO_CHANNELS];
+        right[i] = bus[i * STEREO_CHANNELS + 1];
+    }
+    (*kernels->mCrossfeed)(bus, left, right, frames, &virtualizer->mCoefs);
+    memmove(virtualizer->mLeft, &virtualizer->mLeft[frames],
+        (MIX_CROSSFEED_TAPS - 1) * sizeof(float));
+    memmove(virtualizer->mRight, &virtualizer->mRight[frames],
+        (MIX_CROSSFEED_TAPS - 1) * sizeof(float));
+}
+
+
+#define BASSBOOST_CEILING 1.0f  // peak of the boosted mix which is not to be exceeded, full scale
+#define BASSBOOST_RELEASE 0.05f // fraction of the remaining cut in the boost restored per pass
+
+/** \brief Apply the bass boost to the final mix.  The shelf is applied in full, and if that would
+ *  clip, the result is blended back with the dry mix just enough that it would not, as far as the
+ *  peaks of the two tell.  The boost is cut at once, and restored gradually over later passes.
+ */
+
+static void mix_bass_boost(const MixKernels *kernels, BassBoost *bassBoost, float *bus,
+    unsigned frames)
+{
+    float *dry = bassBoost->mDry;
+    (*kernels->mLoadFloat)(&dry[(MIX_BIQUADS - 1) * STEREO_CHANNELS], bus, frames, 1.0f, 1.0f);
+    (*kernels->mBiquads)(bus, frames, &bassBoost->mShelf.mCoefs, bassBoost->mShelf.mState);
+    float depth = bassBoost->mDepth + (1.0f - bassBoost->mDepth) * BASSBOOST_RELEASE;
+    if (depth > 0.999f) {
+        depth = 1.0f;
+    }
+    float wetPeak = (*kernels->mPeak)(bus, frames);
+    if (wetPeak > BASSBOOST_CEILING) {
+        float dryPeak = (*kernels->mPeak)(dry, frames);
+        float limit = dryPeak < BASSBOOST_CEILING ?
+            (BASSBOOST_CEILING - dryPeak) / (wetPeak - dryPeak) : 0.0f;
+        if (depth > limit) {
+            depth = limit;
+        }
+    }
+    bassBoost->mDepth = depth;
+    if (depth < 1.0f) {
+        (*kernels->mLoadFloat)(bus, bus, frames, depth, depth);
+        (*kernels->mAccumulateFloat)(bus, dry, frames, 1.0f - depth, 1.0f - depth);
+    }
+    memmove(dry, &dry[frames * STEREO_CHANNELS],
+        (MIX_BIQUADS - 1) * STEREO_CHANNELS * sizeof(float));
+}
+
+
+/** \brief Apply the effects of the output mix to the final mix, in the order equalizer,
+ *  virtualizer, bass boost.  An active effect runs on silence when nothing else was mixed, so that
+ *  its filters ring on.  Returns whether the bus now has data.
+ */
+
+static SLboolean mix_effects(IOutputMixExt *thiz, COutputMix *outputMix, unsigned frames,
+    SLboolean busHasData)
+{
+    const MixKernels *kernels = thiz->mKernels;
+    float *bus = thiz->mLane.mBus;
+    SLboolean equalized = equalizer_update(&thiz->mEqualizer, &outputMix->mEqualizer);
+    SLboolean virtualized = virtualizer_update(&thiz->mVirtualizer, &outputMix->mVirtualizer);
+    SLboolean boosted = bass_boost_update(&thiz->mBassBoost, &outputMix->mBassBoost);
+    if (!busHasData) {
+        if (!(equalized || virtualized || boosted)) {
+            return SL_BOOLEAN_FALSE;
+        }
+        memset(bus, 0, frames * STEREO_CHANNELS * sizeof(float));
+    }
+    if (equalized) {
+        (*kernels->mBiquads)(bus, frames, &thiz->mEqualizer.mCoefs, thiz->mEqualizer.mState);
+    }
+    if (virtualized) {
+        mix_virtualizer(kernels, &thiz->mVirtualizer, bus, frames);
+    }
+    if (boosted) {
+        mix_bass_boost(kernels, &thiz->mBassBoost, bus, frames);
+    }
+    return SL_BOOLEAN_TRUE;
+}
+
+
+/** \brief Return the monotonic clock in nanoseconds */
+
+static long long mix_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+/** \brief Restart the mixer statistics and those of every track from zero */
+
+static void mix_reset(IOutputMixExt *thiz)
+{
+    memset(&thiz->mStatistics, 0, sizeof(MixStatistics));
+    thiz->mLane.mUnderruns = 0;
+    if (NULL != thiz->mForkJoin) {
+        unsigned worker;
+        for (worker = 0; worker < thiz->mForkJoin->mNumWorkers; ++worker) {
+            thiz->mWorkerLanes[worker].mUnderruns = 0;
+        }
+    }
+    // free tracks too, as they are not reset when allocated again
+    unsigned group;
+    for (group = 0; group < thiz->mNumGroups; ++group) {
+        Track *tracks = thiz->mTrackGroups[group];
+        unsigned i;
+        for (i = 0; i < TRACK_GROUP; ++i) {
+            atomic_store_relaxed(&tracks[i].mUnderruns, 0);
+            atomic_store_relaxed(&tracks[i].mBytesMixed, 0);
+        }
+    }
+}
+
+
+/** \brief Account for a fill of the specified frames which started at start, and if publish,
+ *  publish the statistics to the engine.  This is cheap enough to do for every fill, so it always
+ *  is.  Only the output mix of the engine publishes, as IDesktopStatistics describes one mixer.
+ */
+
+static void mix_statistics(IOutputMixExt *thiz, long long start, unsigned frames,
+    SLboolean publish)
+{
+    MixStatistics *statistics = &thiz->mStatistics;
+    SLDesktopMixerStatistics *counters = &statistics->mCounters;
+    SLuint32 mixTime = (SLuint32) ((mix_now() - start) / 1000);
+    SLuint32 period = (SLuint32) ((unsigned long long) frames * 1000000ULL / thiz->mSampleRate);
+    if (0 != statistics->mLastStart) {
+        // the previous fill asked for counters->period of audio, so the device should be back
+        // for more that much later
+        long long interval = (start - statistics->mLastStart) / 1000;
+        long long jitter = interval - counters->period;
+        SLuint32 magnitude = (SLuint32) (jitter < 0 ? -jitter : jitter);
+        statistics->mJitterSum += magnitude;
+        ++statistics->mJitters;
+        if (counters->maxJitter < magnitude) {
+            counters->maxJitter = magnitude;
+        }
+    }
+    statistics->mLastStart = start;
+    ++counters->fills;
+    counters->period = period;
+    counters->lastMixTime = mixTime;
+    statistics->mMixTimeSum += mixTime;
+    if (counters->maxMixTime < mixTime) {
+        counters->maxMixTime = mixTime;
+    }
+    if (mixTime > period) {
+        ++counters->overruns;
+    }
+    unsigned bucket = 0;
+    while (SL_DESKTOP_MIXTIME_BUCKETS - 1 > bucket && 0 != (mixTime >> (bucket + 1))) {
+        ++bucket;
+    }
+    ++counters->mixTimeHistogram[bucket];
+    if (!publish) {
+        return;
+    }
+    // the workers are idle, so their lanes can be read
+    SLuint32 underruns = thiz->mLane.mUnderruns;
+    if (NULL != thiz->mForkJoin) {
+        unsigned worker;
+        for (worker = 0; worker < thiz->mForkJoin->mNumWorkers; ++worker) {
+            underruns += thiz->mWorkerLanes[worker].mUnderruns;
+        }
+    }
+    // publish under a sequence lock, as in audioPlayerGainUpdate
+    IDesktopStatistics *published = &thiz->mThis->mEngine->mDesktopStatistics;
+    SLuint32 sequence = published->mSequence;
+    atomic_store_relaxed(&published->mSequence, sequence + 1);
+    atomic_fence_release();
+    published->mPublished = *counters;
+    published->mPublished.meanMixTime = (SLuint32) (statistics->mMixTimeSum / counters->fills);
+    published->mPublished.underruns = underruns;
+    published->mPublished.meanJitter = 0 == statistics->mJitters ? 0 :
+        (SLuint32) (statistics->mJitterSum / statistics->mJitters);
+    atomic_store_release(&published->mSequence, sequence + 2);
+}
+
+
+/** \brief Write frames of the clamped stereo mix to a device which is not stereo: a mono device
+ *  gets the average of the two channels, and a device with more channels gets them on its first
+ *  two, front left and front right, and silence on the others
+ */
+
+static void mix_expand(short *dst, const short *stereo, unsigned frames, unsigned channels)
+{
+    unsigned i;
+    if (1 == channels) {
+        for (i = 0; i < frames; ++i) {
+            dst[i] = (short) (((int) stereo[i * STEREO_CHANNELS] +
+                (int) stereo[i * STEREO_CHANNELS + 1]) >> 1);
+        }
+        return;
+    }
+    assert(STEREO_CHANNELS < channels);
+    memset(dst, 0, frames * channels * sizeof(short));
+    for (i = 0; i < frames; ++i, dst += channels) {
+        dst[0] = stereo[i * STEREO_CHANNELS];
+        dst[1] = stereo[i * STEREO_CHANNELS + 1];
+    }
+}
+
+
+/** \brief This is the track mixer: fill the specified 16-bit PCM buffer, with the device's
+ *  channels
+ */
+
+void IOutputMixExt_FillBuffer(SLOutputMixExtItf self, void *pBuffer, SLuint32 size)
+{
+    SL_ENTER_INTERFACE_VOID
+
+    IOutputMixExt *thiz = (IOutputMixExt *) self;
+    // Only whole frames of 16-bit PCM are filled
+    unsigned channels = thiz->mChannels;
+    unsigned frames = size / (channels * sizeof(short));
+    IObject *thisObject = thiz->mThis;
+    long long start = mix_now();
+    // This lock should never block, except when the application destroys the output mix object
+    object_lock_exclusive(thisObject);
+    // with a device per output mix, the others render too, but only this one has statistics
+    SLboolean primary = (COutputMix *) thisObject ==
+        atomic_load_acquire(&thisObject->mEngine->mEngine.mOutputMix);
+    if (primary &&
+            atomic_load_acquire(&thisObject->mEngine->mDesktopStatistics.mResetRequested)) {
+        mix_reset(thiz);
+        atomic_store_relaxed(&thisObject->mEngine->mDesktopStatistics.mResetRequested,
+            SL_BOOLEAN_FALSE);
+    }
+    unsigned groupMask = thiz->mGroupMask;
+    if (0 != groupMask) {
+        mix_spatialize(thiz, &thisObject->mEngine->mSpatial, groupMask);
+    }
+    if (0 < thiz->mMaxVoices) {
+        mix_voices(thiz, groupMask);
+    }
+    // Mix at most one bus worth of frames at a time, then convert once to the device format
+    short *dst = (short *) pBuffer;
+    unsigned remaining = frames;
+    while (remaining > 0) {
+        unsigned actual = remaining;
+        if (MIXBUS_FRAMES < actual) {
+            actual = MIXBUS_FRAMES;
+        }
+        SLboolean busHasData;
+        if (NULL != thiz->mForkJoin && 0 == thiz->mSerialPasses) {
+            busHasData = mix_parallel(thiz, groupMask, actual);
+        } else {
+            if (0 < thiz->mSerialPasses) {
+                --thiz->mSerialPasses;
+            }
+            busHasData = mix_bus(thiz, groupMask, actual);
+        }
+        busHasData = mix_aux(thiz, (COutputMix *) thisObject, actual, busHasData);
+        busHasData = mix_effects(thiz, (COutputMix *) thisObject, actual, busHasData);
+        // the visualization, if any, sees the final mix before it is clamped
+        Visualizer *visualizer =
+            atomic_load_acquire(&((COutputMix *) thisObject)->mVisualization.mVisualizer);
+        if (NULL != visualizer) {
+            Visualizer_write(visualizer, busHasData ? thiz->mLane.mBus : NULL, actual);
+        }
+        if (!busHasData) {
+            // No active tracks, so output silence
+            memset(dst, 0, actual * channels * sizeof(short));
+        } else if (STEREO_CHANNELS == channels) {
+            (*thiz->mKernels->mClamp)(dst, thiz->mLane.mBus, actual);
+        } else {
+            (*thiz->mKernels->mClamp)(thiz->mClamped, thiz->mLane.mBus, actual);
+            mix_expand(dst, thiz->mClamped, actual, channels);
+        }
+        dst += actual * channels;
+        remaining -= actual;
+    }
+    mix_statistics(thiz, start, frames, primary);
+    if (NULL != thiz->mDispatcher) {
+        Dispatcher_wake(thiz->mDispatcher);
+    }
+    object_unlock_exclusive(thisObject);
+
+    SL_LEAVE_INTERFACE_VOID
+}
+
+
+// The device finds the output mix to render without taking the engine lock, which application
+// threads hold while creating and destroying objects.  IEngine::mOutputMix is read and replaced
+// atomically, and reclaimed as in read-copy-update: the device makes IEngine::mOutputMixEpoch odd
+// for as long as it might be using the output mix it loaded, so once the epoch is seen to be even,
+// or to have moved on, the device can no longer be rendering an output mix which was replaced
+// before the epoch was read.  Only SL_DESKTOP_DEVICE_AUDIO renders this way, and there is only
+// one of it per engine, so one epoch suffices; the other devices each render their own output mix,
+// see COutputMix_openDevice.
+
+/** \brief Called by the device's thread to render a buffer of the engine's current output mix, or
+ *  silence if there is none.  Returns whether there was an output mix.
+ */
+
+SLboolean IOutputMixExt_render(IEngine *thisEngine, void *pBuffer, SLuint32 size)
+{
+    // only this thread writes the epoch
+    SLuint32 epoch = thisEngine->mOutputMixEpoch;
+    atomic_store_relaxed(&thisEngine->mOutputMixEpoch, epoch + 1);
+    // the odd epoch is visible to IOutputMixExt_synchronize before the output mix is loaded
+    atomic_fence_seq_cst();
+    COutputMix *outputMix = atomic_load_acquire(&thisEngine->mOutputMix);
+    if (NULL != outputMix) {
+        IOutputMixExt_FillBuffer(&outputMix->mOutputMixExt.mItf, pBuffer, size);
+    } else {
+        memset(pBuffer, 0, size);
+    }
+    atomic_store_release(&thisEngine->mOutputMixEpoch, epoch + 2);
+    return NULL != outputMix;
+}
+
+
+/** \brief Called after replacing IEngine::mOutputMix, to wait until the device is no longer
+ *  rendering the output mix which it replaced; that takes at most one buffer.  The caller has
+ *  the replaced output mix locked, and it is unlocked while waiting, as the device needs the lock
+ *  to finish the buffer.
+ */
+
+void IOutputMixExt_synchronize(IEngine *thisEngine, COutputMix *replaced)
+{
+    // the replacement is visible to IOutputMixExt_render before the epoch is loaded
+    atomic_fence_seq_cst();
+    SLuint32 epoch = atomic_load_acquire(&thisEngine->mOutputMixEpoch);
+    if (epoch & 1) {
+        object_unlock_exclusive(&replaced->mObject);
+        while (epoch == atomic_load_acquire(&thisEngine->mOutputMixEpoch)) {
+            sched_yield();
+        }
+        object_lock_exclusive(&replaced->mObject);
+    }
+}
+
+
+static const struct SLOutputMixExtItf_ IOutputMixExt_Itf = {
+    IOutputMixExt_FillBuffer
+};
+
+void IOutputMixExt_init(void *self)
+{
+    IOutputMixExt *thiz = (IOutputMixExt *) self;
+    thiz->mItf = &IOutputMixExt_Itf;
+    thiz->mGroupMask = 0;
+    thiz->mFreeMask = 0;
+    thiz->mNumGroups = 0;
+    thiz->mKernels = MixKernels_get();
+    // const after the engine is created, no lock needed
+    thiz->mSampleRate = thiz->mThis->mEngine->mEngine.mSampleRate;
+    thiz->mChannels = thiz->mThis->mEngine->mEngine.mChannels;
+    thiz->mResamplerQuality = RESAMPLER_SINC;
+    equalizer_init(&thiz->mEqualizer);
+    equalizer_init(&thiz->mBassBoost.mShelf);
+    thiz->mBassBoost.mDepth = 1.0f;
+    memset(&thiz->mVirtualizer, 0, sizeof(Virtualizer));
+    thiz->mVirtualizer.mActive = SL_BOOLEAN_FALSE;
+    unsigned i;
+    for (i = 0; i < MAX_TRACK_GROUPS; ++i) {
+        thiz->mActiveMasks[i] = 0;
+        thiz->mTrackGroups[i] = NULL;
+    }
+    thiz->mForkJoin = NULL;
+    thiz->mWorkerLanes = NULL;
+    thiz->mNumWork = 0;
+    thiz->mNextWork = 0;
+    thiz->mPassFrames = 0;
+    thiz->mSerialPasses = 0;
+    thiz->mDispatcher = NULL;
+    thiz->mMaxVoices = 0;
+    thiz->mNumVirtual = 0;
+    thiz->mListener = listenerDefault;
+    thiz->mLane.mUnderruns = 0;
+    memset(&thiz->mStatistics, 0, sizeof(MixStatistics));
+    thiz->mDestroying = SL_BOOLEAN_FALSE;
+}
+
+void IOutputMixExt_deinit(void *self)
+{
+    IOutputMixExt *thiz = (IOutputMixExt *) self;
+    // all audio players on this output mix have already been destroyed
+    assert(0 == thiz->mGroupMask);
+    unsigned i;
+    for (i = 0; i < thiz->mNumGroups; ++i) {
+        free(thiz->mTrackGroups[i]);
+        thiz->mTrackGroups[i] = NULL;
+    }
+    thiz->mNumGroups = 0;
+    thiz->mFreeMask = 0;
+    // the mixer has already acknowledged the destroy request, so the workers are idle,
+    // and the callback thread has released the tracks of all the audio players
+    IOutputMixExt_stopThreads((COutputMix *) thiz->mThis);
+}
+
 
-        case SL_PLAYSTATE_STOPPED:  // idle
-        case SL_PLAYSTATE_PAUSED:   // idle
-            break;
+/** \brief Called by OutputMix::Realize to start the worker threads for parallel mixing.
+ *  Parallel mixing is optional, so if the workers can't be started then we mix serially.
+ *  Called with the output mix locked, as are all realize hooks.
+ */
 
-        default:
-            assert(SL_BOOLEAN_FALSE);
-            break;
-        }
+void IOutputMixExt_startWorkers(COutputMix *outputMix, unsigned numWorkers)
+{
+    IOutputMixExt *thiz = &outputMix->mOutputMixExt;
+    assert(NULL == thiz->mForkJoin && 0 < numWorkers);
+    MixLane *lanes = (MixLane *) malloc(numWorkers * sizeof(MixLane));
+    if (NULL == lanes) {
+        SL_LOGW("no memory for %u mixer workers, mixing serially", numWorkers);
+        return;
+    }
+    ForkJoin *forkJoin = ForkJoin_create(numWorkers);
+    if (NULL == forkJoin) {
+        SL_LOGW("unable to start %u mixer workers, mixing serially", numWorkers);
+        free(lanes);
+        return;
+    }
+    unsigned worker;
+    for (worker = 0; worker < numWorkers; ++worker) {
+        lanes[worker].mUnderruns = 0;
+    }
+    thiz->mWorkerLanes = lanes;
+    thiz->mForkJoin = forkJoin;
+}
 
-broadcast:
-        if (doBroadcast) {
-            object_cond_broadcast(&audioPlayer->mObject);
-        }
 
-        object_unlock_exclusive(&audioPlayer->mObject);
+/** \brief Called by OutputMix::Realize to start the thread for deferred callbacks.
+ *  If it can't be started then callbacks are made by the mixer as usual.
+ *  Called with the output mix locked, as are all realize hooks.
+ */
 
+void IOutputMixExt_startDispatcher(COutputMix *outputMix)
+{
+    IOutputMixExt *thiz = &outputMix->mOutputMixExt;
+    assert(NULL == thiz->mDispatcher);
+    Dispatcher *dispatcher = Dispatcher_create();
+    if (NULL == dispatcher) {
+        SL_LOGW("unable to start callback thread, calling back from the mixer");
+        return;
     }
+    thiz->mDispatcher = dispatcher;
+}
+
 
-    return trackHasData;
+/** \brief Stop the worker threads and the callback thread, if they were started, so that the
+ *  output mix can be realized again.  Called by OutputMix::Realize if the device can't be opened,
+ *  when no audio player can have used them yet, and when the output mix is destroyed.
+ */
 
+void IOutputMixExt_stopThreads(COutputMix *outputMix)
+{
+    IOutputMixExt *thiz = &outputMix->mOutputMixExt;
+    ForkJoin_destroy(thiz->mForkJoin);
+    thiz->mForkJoin = NULL;
+    free(thiz->mWorkerLanes);
+    thiz->mWorkerLanes = NULL;
+    Dispatcher_destroy(thiz->mDispatcher);
+    thiz->mDispatcher = NULL;
 }
 
 
-/** \brief This is the track mixer: fill the specified 16-bit stereo PCM buffer */
+/** \brief Called by the callback thread to release the track of an audio player whose
+ *  destruction was requested by CAudioPlayer_PreDestroy and seen by the mixer, once it has caught
+ *  up with the player's callbacks, and to acknowledge the request in place of the mixer
+ */
 
-void IOutputMixExt_FillBuffer(SLOutputMixExtItf self, void *pBuffer, SLuint32 size)
+void IOutputMixExt_releaseTrack(Track *track)
 {
-    SL_ENTER_INTERFACE_VOID
-
-    // Force to be a multiple of a frame, assumes stereo 16-bit PCM
-    size &= ~3;
-    SLboolean mixBufferHasData = SL_BOOLEAN_FALSE;
-    IOutputMixExt *thiz = (IOutputMixExt *) self;
-    IObject *thisObject = thiz->mThis;
-    // This lock should never block, except when the application destroys the output mix object
-    object_lock_exclusive(thisObject);
-    unsigned activeMask;
-    // If the output mix is marked for destruction, then acknowledge the request
-    if (thiz->mDestroyRequested) {
-        IEngine *thisEngine = &thisObject->mEngine->mEngine;
-        interface_lock_exclusive(thisEngine);
-        assert(&thisEngine->mOutputMix->mObject == thisObject);
-        thisEngine->mOutputMix = NULL;
-        // Note we don't attempt to connect another output mix, even if there is one
-        interface_unlock_exclusive(thisEngine);
-        // Acknowledge the destroy request, and notify the pre-destroy hook
-        thiz->mDestroyRequested = SL_BOOLEAN_FALSE;
-        object_cond_broadcast(thisObject);
-        activeMask = 0;
-    } else {
-        activeMask = thiz->mActiveMask;
-    }
-    while (activeMask) {
-        unsigned i = ctz(activeMask);
-        assert(MAX_TRACK > i);
-        activeMask &= ~(1 << i);
-        Track *track = &thiz->mTracks[i];
+    CAudioPlayer *audioPlayer = track->mDeferredPlayer;
+    assert(NULL == track->mAudioPlayer);
+    COutputMix *outputMix = CAudioPlayer_GetOutputMix(audioPlayer);
+    // as when the mixer frees a track, the output mix lock excludes allocation, so the track
+    // can't be given to another player, which could make requests, before we acknowledge
+    object_lock_exclusive(&outputMix->mObject);
+    track_free(&outputMix->mOutputMixExt, track);
+    atomic_store_release(&track->mAcknowledged, atomic_load_acquire(&track->mRequests));
+    object_unlock_exclusive(&outputMix->mObject);
+}
 
-        // track is allocated
 
-        if (!track_check(track)) {
-            continue;
-        }
+/** \brief Called when an IEnvironmentalReverb or IPresetReverb is exposed on an output mix, to
+ *  create the mixer's reverb for it at the device sample rate.  Returns false if out of memory.
+ */
 
-        // track is playing
-        void *dstWriter = pBuffer;
-        unsigned desired = size;
-        SLboolean trackContributedToMix = SL_BOOLEAN_FALSE;
-        float gains[STEREO_CHANNELS];
-        Summary summaries[STEREO_CHANNELS];
-        unsigned channel;
-        for (channel = 0; channel < STEREO_CHANNELS; ++channel) {
-            float gain = track->mGains[channel];
-            gains[channel] = gain;
-            Summary summary;
-            if (gain <= 0.001) {
-                summary = GAIN_MUTE;
-            } else if (gain >= 0.999) {
-                summary = GAIN_UNITY;
-            } else {
-                summary = GAIN_OTHER;
-            }
-            summaries[channel] = summary;
-        }
-        while (desired > 0) {
-            unsigned actual = desired;
-            if (track->mAvail < actual) {
-                actual = track->mAvail;
-            }
-            // force actual to be a frame multiple
-            if (actual > 0) {
-                assert(NULL != track->mReader);
-                stereo *mixBuffer = (stereo *) dstWriter;
-                const stereo *source = (const stereo *) track->mReader;
-                unsigned j;
-                if (GAIN_MUTE != summaries[0] || GAIN_MUTE != summaries[1]) {
-                    if (mixBufferHasData) {
-                        // apply gain during add
-                        if (GAIN_UNITY != summaries[0] || GAIN_UNITY != summaries[1]) {
-                            for (j = 0; j < actual; j += sizeof(stereo), ++mixBuffer, ++source) {
-                                mixBuffer->left += (short) (source->left * track->mGains[0]);
-                                mixBuffer->right += (short) (source->right * track->mGains[1]);
-                            }
-                        // no gain adjustment needed, so do a simple add
-                        } else {
-                            for (j = 0; j < actual; j += sizeof(stereo), ++mixBuffer, ++source) {
-                                mixBuffer->left += source->left;
-                                mixBuffer->right += source->right;
-                            }
-                        }
-                    } else {
-                        // apply gain during copy
-                        if (GAIN_UNITY != summaries[0] || GAIN_UNITY != summaries[1]) {
-                            for (j = 0; j < actual; j += sizeof(stereo), ++mixBuffer, ++source) {
-                                mixBuffer->left = (short) (source->left * track->mGains[0]);
-                                mixBuffer->right = (short) (source->right * track->mGains[1]);
-                            }
-                        // no gain adjustment needed, so do a simple copy
-                        } else {
-                            memcpy(dstWriter, track->mReader, actual);
-                        }
-                    }
-                    trackContributedToMix = SL_BOOLEAN_TRUE;
-                }
-                dstWriter = (char *) dstWriter + actual;
-                desired -= actual;
-                track->mReader = (char *) track->mReader + actual;
-                track->mAvail -= actual;
-                if (track->mAvail == 0) {
-                    IBufferQueue *bufferQueue = &track->mAudioPlayer->mBufferQueue;
-                    interface_lock_exclusive(bufferQueue);
-                    const BufferHeader *oldFront, *newFront, *rear;
-                    oldFront = bufferQueue->mFront;
-                    rear = bufferQueue->mRear;
-                    // a buffer stays on queue while playing, so it better still be there
-                    assert(oldFront != rear);
-                    newFront = oldFront;
-                    if (++newFront == &bufferQueue->mArray[bufferQueue->mNumBuffers + 1]) {
-                        newFront = bufferQueue->mArray;
-                    }
-                    bufferQueue->mFront = (BufferHeader *) newFront;
-                    assert(0 < bufferQueue->mState.count);
-                    --bufferQueue->mState.count;
-                    if (newFront != rear) {
-                        // we don't acknowledge application requests between buffers
-                        // within the same mixer frame
-                        assert(0 < bufferQueue->mState.count);
-                        track->mReader = newFront->mBuffer;
-                        track->mAvail = newFront->mSize;
-                    }
-                    // else we would set play state to playable but not playing during next mixer
-                    // frame if the queue is still empty at that time
-                    ++bufferQueue->mState.playIndex;
-                    slBufferQueueCallback callback = bufferQueue->mCallback;
-                    void *context = bufferQueue->mContext;
-                    interface_unlock_exclusive(bufferQueue);
-                    // The callback function is called on each buffer completion
-                    if (NULL != callback) {
-                        (*callback)((SLBufferQueueItf) bufferQueue, context);
-                        // Maybe it enqueued another buffer, or maybe it didn't.
-                        // We will find out later during the next mixer frame.
-                    }
-                }
-                // no lock, but safe because noone else updates this field
-                track->mFramesMixed += actual >> 2;    // sizeof(short) * STEREO_CHANNELS
-                continue;
-            }
-            // we need more data: desired > 0 but actual == 0
-            if (track_check(track)) {
-                continue;
-            }
-            // underflow: clear out rest of partial buffer (NTH synthesize comfort noise)
-            if (!mixBufferHasData && trackContributedToMix) {
-                memset(dstWriter, 0, actual);
-            }
-            break;
-        }
-        if (trackContributedToMix) {
-            mixBufferHasData = SL_BOOLEAN_TRUE;
+bool IOutputMixExt_exposeReverb(AuxReverb *auxReverb, SLuint32 sampleRate)
+{
+    if (NULL == auxReverb->mReverb) {
+        Reverb *reverb = Reverb_create(sampleRate);
+        if (NULL == reverb) {
+            return false;
         }
+        // the parameters already published are copied by the mixer on its next pass
+        atomic_store_release(&auxReverb->mReverb, reverb);
     }
-    object_unlock_exclusive(thisObject);
-    // No active tracks, so output silence
-    if (!mixBufferHasData) {
-        memset(pBuffer, 0, size);
-    }
+    return true;
+}
 
-    SL_LEAVE_INTERFACE_VOID
+
+/** \brief Design the parameters of a reverb from its properties, and publish them to the mixer,
+ *  which copies them without locking the interface.  Called with the interface locked
+ *  exclusively, or by its expose hook, when it has no other users.
+ */
+
+void IOutputMixExt_publishReverb(AuxReverb *auxReverb,
+    const SLEnvironmentalReverbSettings *properties, SLboolean enabled, SLuint32 sampleRate)
+{
+    ReverbProperties reverbProperties;
+    reverbProperties.mRoomLevel = properties->roomLevel;
+    reverbProperties.mRoomHFLevel = properties->roomHFLevel;
+    reverbProperties.mDecayTime = properties->decayTime;
+    reverbProperties.mDecayHFRatio = properties->decayHFRatio;
+    reverbProperties.mReflectionsLevel = properties->reflectionsLevel;
+    reverbProperties.mReflectionsDelay = properties->reflectionsDelay;
+    reverbProperties.mReverbLevel = properties->reverbLevel;
+    reverbProperties.mReverbDelay = properties->reverbDelay;
+    reverbProperties.mDiffusion = properties->diffusion;
+    reverbProperties.mDensity = properties->density;
+    ReverbParams params;
+    Reverb_design(&params, &reverbProperties, SL_BOOLEAN_FALSE != enabled, sampleRate);
+    // there is only one writer, as the caller holds the lock
+    SLuint32 sequence = auxReverb->mSequence;
+    atomic_store_relaxed(&auxReverb->mSequence, sequence + 1);
+    atomic_fence_release();
+    auxReverb->mPublished = params;
+    atomic_store_release(&auxReverb->mSequence, sequence + 2);
 }
 
 
-static const struct SLOutputMixExtItf_ IOutputMixExt_Itf = {
-    IOutputMixExt_FillBuffer
-};
+/** \brief Called when the output mix is destroyed, after the mixer has stopped */
 
-void IOutputMixExt_init(void *self)
+void IOutputMixExt_destroyReverb(AuxReverb *auxReverb)
 {
-    IOutputMixExt *thiz = (IOutputMixExt *) self;
-    thiz->mItf = &IOutputMixExt_Itf;
-    thiz->mActiveMask = 0;
-    Track *track = &thiz->mTracks[0];
-    unsigned i;
-    for (i = 0; i < MAX_TRACK; ++i, ++track) {
-        track->mAudioPlayer = NULL;
-    }
-    thiz->mDestroyRequested = SL_BOOLEAN_FALSE;
+    Reverb_destroy(auxReverb->mReverb);
+    auxReverb->mReverb = NULL;
 }
 
 
@@ -362,16 +1774,10 @@ SLresult IOutputMixExt_checkAudioPlayerSourceSink(CAudioPlayer *thiz)
 #ifdef ANDROID
     case SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE:
 #endif
-        switch (thiz->mDataSource.mFormat.mFormatType) {
-        case SL_DATAFORMAT_PCM:
-#ifdef USE_SDL
-            // SDL is hard-coded to 44.1 kHz, and there is no sample rate converter
-            if (SL_SAMPLINGRATE_44_1 != thiz->mDataSource.mFormat.mPCM.samplesPerSec)
-                return SL_RESULT_CONTENT_UNSUPPORTED;
-#endif
-            break;
-        default:
-            break;
+        // any sample rate accepted by checkDataFormat is resampled to the device rate,
+        // and any sample format is converted to float
+        if (SLESUT_PCM_INVALID == slesutPcmFormatOf(&thiz->mDataSource.mFormat.mPCM)) {
+            return SL_RESULT_CONTENT_UNSUPPORTED;
         }
         break;
     default:
@@ -381,6 +1787,7 @@ SLresult IOutputMixExt_checkAudioPlayerSourceSink(CAudioPlayer *thiz)
     // check the sink for compatibility
     const SLDataSink *pAudioSnk = &thiz->mDataSink.u.mSink;
     Track *track = NULL;
+    Dispatcher *dispatcher = NULL;
     switch (*(SLuint32 *)pAudioSnk->pLocator) {
     case SL_DATALOCATOR_OUTPUTMIX:
         {
@@ -389,17 +1796,14 @@ SLresult IOutputMixExt_checkAudioPlayerSourceSink(CAudioPlayer *thiz)
             pAudioSnk->pLocator)->outputMix)->mOutputMixExt;
         // allocate an entry within OutputMix for this track
         interface_lock_exclusive(omExt);
-        unsigned availMask = ~omExt->mActiveMask;
-        if (!availMask) {
+        track = track_alloc(omExt);
+        if (NULL == track) {
             interface_unlock_exclusive(omExt);
-            // All track slots full in output mix
+            // All track slots full in output mix, or out of memory for another group
             return SL_RESULT_MEMORY_FAILURE;
         }
-        unsigned i = ctz(availMask);
-        assert(MAX_TRACK > i);
-        omExt->mActiveMask |= 1 << i;
-        track = &omExt->mTracks[i];
         track->mAudioPlayer = NULL;    // only field that is accessed before full initialization
+        dispatcher = omExt->mDispatcher;
         interface_unlock_exclusive(omExt);
         thiz->mTrack = track;
         thiz->mGains[0] = 1.0f;
@@ -413,17 +1817,276 @@ SLresult IOutputMixExt_checkAudioPlayerSourceSink(CAudioPlayer *thiz)
 
     assert(NULL != track);
     track->mBufferQueue = &thiz->mBufferQueue;
-    track->mAudioPlayer = thiz;
     track->mReader = NULL;
     track->mAvail = 0;
+    track->mSilent = SL_BOOLEAN_FALSE;
+    track->mFormat = SLESUT_PCM_S16;       // until the sample format is known
+    track->mChannels = STEREO_CHANNELS;    // until the channel count is known
+    track->mFrameSize = STEREO_CHANNELS * sizeof(short);
+    track->mResampler = NULL;   // until the sample rate is known
+    track->mStretch = NULL;     // until the tempo is changed
     track->mGains[0] = 1.0f;
     track->mGains[1] = 1.0f;
+    track->mPublishedGains[0] = 1.0f;
+    track->mPublishedGains[1] = 1.0f;
+    memset(track->mSends, 0, sizeof(track->mSends));
+    memset(track->mPublishedSends, 0, sizeof(track->mPublishedSends));
+    track->mPitch = 1.0f;
+    track->mPublishedPitch = 1.0f;
+    track->mTempo = 1.0f;
+    track->mPublishedTempo = 1.0f;
+    track->mGainsSequence = 0;
     track->mFramesMixed = 0;
+    track->mVirtual = SL_BOOLEAN_FALSE;
+    equalizer_init(&track->mEqualizer);
+    track->mSpatialized = SL_BOOLEAN_FALSE;
+    memcpy(track->mSpatialPublished, spatialNeutral, sizeof(spatialNeutral));
+    memcpy(track->mSpatial, spatialNeutral, sizeof(spatialNeutral));
+    track->mSpatialPending = SL_BOOLEAN_FALSE;
+    track->mSpatialNext = NULL;
+    track->mSpatialGains[0] = 1.0f;
+    track->mSpatialGains[1] = 1.0f;
+    track->mDopplerSpeed = 1.0f;
+    track->mStarved = SL_BOOLEAN_TRUE;
+    track->mUnderruns = 0;
+    track->mBytesMixed = 0;
+    track->mDispatcher = dispatcher;
+    track->mDeferredPlayer = thiz;
+    track->mDeferredScheduled = 0;
+    track->mDeferredBuffers = 0;
+    track->mDeferredEvents = 0;
+    track->mDeferredTime = 0;
+    memset(&track->mPublishedEvents, 0, sizeof(PlayEvents));
+    track->mPublishedEvents.mMarkerPosition = SL_TIME_UNKNOWN;
+    track->mEvents = track->mPublishedEvents;
+    track->mEventsSequence = 0;
+    track->mPositionBase = 0;
+    track->mPositionFrames = 0;
+    track->mUpdateFrames = 0;
+    track->mEventPosition = 0;
+    // the mixer might already be examining this track slot, so publish it last
+    atomic_store_release(&track->mAudioPlayer, thiz);
+    return SL_RESULT_SUCCESS;
+}
+
+
+/** \brief Return the conventional channel mask for a channel count */
+
+static SLuint32 channelMaskDefault(unsigned channels)
+{
+    switch (channels) {
+    case 1:
+        return SL_SPEAKER_FRONT_CENTER;
+    case 2:
+        return SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT;
+    case 4:
+        return SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT | SL_SPEAKER_BACK_LEFT |
+            SL_SPEAKER_BACK_RIGHT;
+    case 6:
+        return SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT | SL_SPEAKER_FRONT_CENTER |
+            SL_SPEAKER_LOW_FREQUENCY | SL_SPEAKER_BACK_LEFT | SL_SPEAKER_BACK_RIGHT;
+    case 8:
+        return SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT | SL_SPEAKER_FRONT_CENTER |
+            SL_SPEAKER_LOW_FREQUENCY | SL_SPEAKER_BACK_LEFT | SL_SPEAKER_BACK_RIGHT |
+            SL_SPEAKER_SIDE_LEFT | SL_SPEAKER_SIDE_RIGHT;
+    default:
+        return 0;
+    }
+}
+
+
+/** \brief Build the matrix which downmixes a source with the specified channels to stereo.
+ *  The channels are interleaved in increasing order of their speaker position bit.
+ *  Center, LFE, and surround channels are folded in at -3 dB, which can exceed full scale,
+ *  but the bus has headroom and is clamped once after all tracks are mixed.
+ */
+
+static void track_downmix(Track *track, unsigned channels, SLuint32 channelMask)
+{
+    float *left = &track->mDownmix[0];
+    float *right = &track->mDownmix[MIX_MAX_CHANNELS];
+    unsigned channel;
+    for (channel = 0; channel < MIX_MAX_CHANNELS; ++channel) {
+        left[channel] = 0.0f;
+        right[channel] = 0.0f;
+    }
+    if (1 == channels) {
+        // a mono source is heard on both sides, whichever speaker it is nominally for
+        left[0] = 1.0f;
+        right[0] = 1.0f;
+        return;
+    }
+    // a mask which doesn't describe the channels is replaced by the conventional one
+    if ((unsigned) __builtin_popcount(channelMask) != channels) {
+        channelMask = channelMaskDefault(channels);
+    }
+    for (channel = 0; channel < channels && 0 != channelMask; ++channel) {
+        SLuint32 speaker = channelMask & -channelMask;
+        channelMask &= ~speaker;
+        switch (speaker) {
+        case SL_SPEAKER_FRONT_LEFT:
+            left[channel] = 1.0f;
+            break;
+        case SL_SPEAKER_FRONT_RIGHT:
+            right[channel] = 1.0f;
+            break;
+        case SL_SPEAKER_FRONT_CENTER:
+        case SL_SPEAKER_LOW_FREQUENCY:
+            left[channel] = (float) M_SQRT1_2;
+            right[channel] = (float) M_SQRT1_2;
+            break;
+        case SL_SPEAKER_BACK_LEFT:
+        case SL_SPEAKER_SIDE_LEFT:
+        case SL_SPEAKER_FRONT_LEFT_OF_CENTER:
+            left[channel] = (float) M_SQRT1_2;
+            break;
+        case SL_SPEAKER_BACK_RIGHT:
+        case SL_SPEAKER_SIDE_RIGHT:
+        case SL_SPEAKER_FRONT_RIGHT_OF_CENTER:
+            right[channel] = (float) M_SQRT1_2;
+            break;
+        default:
+            // back center, and the top speakers
+            left[channel] = 0.5f;
+            right[channel] = 0.5f;
+            break;
+        }
+    }
+}
+
+
+/** \brief Allocate a resampler for the track of an audio player if it has none yet.  Called when
+ *  the player is realized, or with it locked when a pitch or Doppler shift first needs one; the
+ *  resampler is published to the mixer, which might already be playing the track.
+ */
+
+static SLresult audioPlayerResampler(CAudioPlayer *thiz)
+{
+    SLuint32 sampleRateMilliHz = thiz->mSampleRateMilliHz;
+    if (NULL != thiz->mResampler || UNKNOWN_SAMPLERATE == sampleRateMilliHz) {
+        return SL_RESULT_SUCCESS;
+    }
+    // Not locked, as the mixer holds the output mix lock while calling the buffer queue callback,
+    // which might lock this audio player; these fields are const after initialization anyway.
+    IOutputMixExt *omExt = &CAudioPlayer_GetOutputMix(thiz)->mOutputMixExt;
+    Resampler *resampler = Resampler_create(sampleRateMilliHz / 1000, omExt->mSampleRate,
+        omExt->mResamplerQuality);
+    if (NULL == resampler) {
+        return SL_RESULT_MEMORY_FAILURE;
+    }
+    thiz->mResampler = resampler;
+    atomic_store_release(&thiz->mTrack->mResampler, resampler);
     return SL_RESULT_SUCCESS;
 }
 
 
-/** \brief Called when a gain-related field (mute, solo, volume, stereo position, etc.) updated */
+/** \brief Called by CAudioPlayer_Realize, when the format, channel count and sample rate are
+ *  known, to set up the conversion of the track to stereo float, and to allocate a resampler
+ *  for the track if the sample rate differs from the device sample rate
+ */
+
+SLresult IOutputMixExt_realizeAudioPlayer(CAudioPlayer *thiz)
+{
+    Track *track = thiz->mTrack;
+    if (NULL == track) {
+        return SL_RESULT_SUCCESS;
+    }
+    // a 3D player is spatialized from the start, even if it is never moved
+    audioPlayer3DUpdate(thiz);
+    // and a file player has an update period from the start
+    audioPlayerEventsUpdate(thiz, SL_BOOLEAN_FALSE, SL_BOOLEAN_FALSE);
+    // The track can't be playing yet, so the mixer isn't reading these fields; it will see them
+    // after it observes the play state change.
+    unsigned channels = thiz->mNumChannels;
+    if (UNKNOWN_NUMCHANNELS != channels) {
+        assert(0 < channels && MIX_MAX_CHANNELS >= channels);
+        SLuint32 channelMask = 0;
+        slesutPcmFormat format = SLESUT_PCM_S16;
+        switch (thiz->mDataSource.mFormat.mFormatType) {
+        case SL_DATAFORMAT_PCM:
+        case SL_ANDROID_DATAFORMAT_PCM_EX:
+            channelMask = thiz->mDataSource.mFormat.mPCM.channelMask;
+            format = slesutPcmFormatOf(&thiz->mDataSource.mFormat.mPCM);
+            break;
+        default:
+#ifdef USE_SNDFILE
+            if (NULL != thiz->mSndFile.mSNDFILE) {
+                format = thiz->mSndFile.mFormat;
+            }
+#endif
+            break;
+        }
+        assert(SLESUT_PCM_INVALID != format);
+        track_downmix(track, channels, channelMask);
+        track->mFormat = format;
+        track->mChannels = channels;
+        track->mFrameSize = channels * slesutPcmSampleSize(format);
+    }
+    SLuint32 sampleRateMilliHz = thiz->mSampleRateMilliHz;
+    if (UNKNOWN_SAMPLERATE == sampleRateMilliHz) {
+        return SL_RESULT_SUCCESS;
+    }
+    SLuint32 deviceRate = CAudioPlayer_GetOutputMix(thiz)->mOutputMixExt.mSampleRate;
+    // the Doppler shift of a 3D player is a change of speed, which needs a resampler
+    if (sampleRateMilliHz / 1000 == deviceRate &&
+            !(IsInterfaceInitialized(&thiz->mObject, MPH_3DLOCATION) &&
+            IsInterfaceInitialized(&thiz->mObject, MPH_3DDOPPLER))) {
+        return SL_RESULT_SUCCESS;
+    }
+    return audioPlayerResampler(thiz);
+}
+
+
+/** \brief Called by CAudioPlayer_Destroy, after the mixer has released the track */
+
+void IOutputMixExt_destroyAudioPlayer(CAudioPlayer *thiz)
+{
+    Resampler_destroy(thiz->mResampler);
+    thiz->mResampler = NULL;
+    Stretch_destroy(thiz->mStretch);
+    thiz->mStretch = NULL;
+    // a commit must not publish to the track once it is given to another player
+    Track *track = thiz->mTrack;
+    if (NULL != track) {
+        CEngine *engine = thiz->mObject.mEngine;
+        object_lock_exclusive(&engine->mObject);
+        if (track->mSpatialPending) {
+            Track **link = &engine->mSpatial.mStaged;
+            while (track != *link) {
+                link = &(*link)->mSpatialNext;
+            }
+            *link = track->mSpatialNext;
+            track->mSpatialPending = SL_BOOLEAN_FALSE;
+        }
+        object_unlock_exclusive(&engine->mObject);
+    }
+}
+
+
+/** \brief Called by BufferQueue::Enqueue without the lock, to decide whether a buffer is all
+ *  silence and so need not be read by the mixer.  The sample format is const once the audio
+ *  player is realized, which it must be for the application to have its buffer queue.
+ */
+
+SLboolean IOutputMixExt_isSilent(IBufferQueue *bufferQueue, const void *buffer, SLuint32 size)
+{
+    if (SL_OBJECTID_AUDIOPLAYER != InterfaceToObjectID(bufferQueue)) {
+        return SL_BOOLEAN_FALSE;
+    }
+    CAudioPlayer *audioPlayer = (CAudioPlayer *) bufferQueue->mThis;
+    Track *track = audioPlayer->mTrack;
+    // const after the engine is created, no lock needed
+    if (NULL == track || !audioPlayer->mObject.mEngine->mEngine.mSilenceDetection) {
+        return SL_BOOLEAN_FALSE;
+    }
+    slesutPcmFormat format = track->mFormat;
+    return slesutPcmIsSilent(buffer, format, size / slesutPcmSampleSize(format));
+}
+
+
+/** \brief Called when a gain-related field (mute, solo, volume, stereo position, effect sends,
+ *  etc.) updated
+ */
 
 void audioPlayerGainUpdate(CAudioPlayer *audioPlayer)
 {
@@ -433,6 +2096,8 @@ void audioPlayerGainUpdate(CAudioPlayer *audioPlayer)
     SLmillibel level = audioPlayer->mVolume.mLevel;
     SLboolean enableStereoPosition = audioPlayer->mVolume.mEnableStereoPosition;
     SLpermille stereoPosition = audioPlayer->mVolume.mStereoPosition;
+    float sends[AUX_MAX];
+    unsigned aux;
 
     if (soloMask) {
         muteMask |= ~soloMask;
@@ -440,8 +2105,19 @@ void audioPlayerGainUpdate(CAudioPlayer *audioPlayer)
     if (mute || !(~muteMask & 3)) {
         audioPlayer->mGains[0] = 0.0f;
         audioPlayer->mGains[1] = 0.0f;
+        for (aux = 0; aux < AUX_MAX; ++aux) {
+            sends[aux] = 0.0f;
+        }
     } else {
         float playerGain = powf(10.0f, level / 2000.0f);
+        // the reverbs take a mono sum, so the sends ignore the stereo position, and they are
+        // independent of the direct level, which only attenuates the dry signal
+        for (aux = 0; aux < AUX_MAX; ++aux) {
+            const struct EnableLevel *enableLevel = &audioPlayer->mEffectSend.mEnableLevels[aux];
+            sends[aux] = enableLevel->mEnable ?
+                playerGain * powf(10.0f, enableLevel->mSendLevel / 2000.0f) : 0.0f;
+        }
+        playerGain *= powf(10.0f, audioPlayer->mDirectLevel / 2000.0f);
         unsigned channel;
         for (channel = 0; channel < STEREO_CHANNELS; ++channel) {
             float gain;
@@ -470,4 +2146,338 @@ void audioPlayerGainUpdate(CAudioPlayer *audioPlayer)
             audioPlayer->mGains[channel] = gain;
         }
     }
+
+    // publish the gains to the mixer, which reads them without locking the audio player
+    Track *track = audioPlayer->mTrack;
+    if (NULL != track) {
+        SLuint32 sequence = track->mGainsSequence;
+        atomic_store_relaxed(&track->mGainsSequence, sequence + 1);
+        atomic_fence_release();
+        track->mPublishedGains[0] = audioPlayer->mGains[0];
+        track->mPublishedGains[1] = audioPlayer->mGains[1];
+        for (aux = 0; aux < AUX_MAX; ++aux) {
+            track->mPublishedSends[aux] = sends[aux];
+        }
+        atomic_store_release(&track->mGainsSequence, sequence + 2);
+    }
+}
+
+
+#define PITCH_MIN 0.25f     // lowest pitch, as a speed of the resampler, two octaves down
+#define PITCH_MAX 4.0f      // highest pitch, two octaves up
+
+/** \brief Called with the audio player locked when its playback rate, rate pitch, or pitch changes,
+ *  to publish the pitch and tempo of its track to the mixer.  The playback rate and rate pitch
+ *  both scale the speed, and the pitch follows the speed unless the playback rate is pitch
+ *  corrected; the pitch interface then shifts the pitch alone.  The resampler plays the pitch, and
+ *  the time stretch makes up the difference between it and the speed.  Each is allocated the
+ *  first time it is needed, and then kept, as the mixer might be using it.
+ */
+
+void audioPlayerRateUpdate(CAudioPlayer *audioPlayer)
+{
+    Track *track = audioPlayer->mTrack;
+    if (NULL == track) {
+        return;
+    }
+    IObject *thisObject = &audioPlayer->mObject;
+    float speed = 1.0f, pitch = 1.0f;
+    if (IsInterfaceInitialized(thisObject, MPH_PLAYBACKRATE)) {
+        const IPlaybackRate *playbackRate = &audioPlayer->mPlaybackRate;
+        speed = playbackRate->mRate / 1000.0f;
+        if (!(playbackRate->mProperties & SL_RATEPROP_PITCHCORAUDIO)) {
+            pitch = speed;
+        }
+    }
+    if (IsInterfaceInitialized(thisObject, MPH_RATEPITCH)) {
+        float rate = audioPlayer->mRatePitch.mRate / 1000.0f;
+        speed *= rate;
+        pitch *= rate;
+    }
+    if (IsInterfaceInitialized(thisObject, MPH_PITCH)) {
+        pitch *= audioPlayer->mPitch.mPitch / 1000.0f;
+    }
+    if (pitch < PITCH_MIN) {
+        pitch = PITCH_MIN;
+    } else if (pitch > PITCH_MAX) {
+        pitch = PITCH_MAX;
+    }
+    // if either stage can't be allocated, the speed is kept in preference to the pitch
+    if (1.0f != pitch && SL_RESULT_SUCCESS != audioPlayerResampler(audioPlayer)) {
+        pitch = 1.0f;
+    }
+    float tempo = speed / pitch;
+    if (1.0f != tempo && NULL == audioPlayer->mStretch) {
+        Stretch *stretch = Stretch_create(
+            CAudioPlayer_GetOutputMix(audioPlayer)->mOutputMixExt.mSampleRate);
+        if (NULL == stretch) {
+            tempo = 1.0f;
+        } else {
+            audioPlayer->mStretch = stretch;
+            atomic_store_release(&track->mStretch, stretch);
+        }
+    }
+
+    // published with the gains
+    SLuint32 sequence = track->mGainsSequence;
+    atomic_store_relaxed(&track->mGainsSequence, sequence + 1);
+    atomic_fence_release();
+    track->mPublishedPitch = pitch;
+    track->mPublishedTempo = tempo;
+    atomic_store_release(&track->mGainsSequence, sequence + 2);
+}
+
+
+/* Interface initialization hooks, for the defaults of the 3D interfaces a player didn't request */
+
+extern void
+    I3DDoppler_init(void *),
+    I3DSource_init(void *);
+
+
+/** \brief Begin publishing to the 3D state of an engine, which is locked, see mix_spatialize */
+
+static void spatial_begin(Spatial *spatial)
+{
+    atomic_store_relaxed(&spatial->mSequence, spatial->mSequence + 1);
+    atomic_fence_release();
+}
+
+
+/** \brief End publishing to the 3D state of an engine */
+
+static void spatial_end(Spatial *spatial)
+{
+    atomic_store_release(&spatial->mSequence, spatial->mSequence + 1);
+}
+
+
+/** \brief Convert a vector in millimeters, or millimeters per second, to meters */
+
+static void vector_meters(float *out, const SLVec3D *in)
+{
+    out[0] = in->x / 1000.0f;
+    out[1] = in->y / 1000.0f;
+    out[2] = in->z / 1000.0f;
+}
+
+
+/** \brief Normalize a direction to a unit vector, or to zero if it has no length */
+
+static void vector_unit(float *out, const SLVec3D *in)
+{
+    float x = (float) in->x, y = (float) in->y, z = (float) in->z;
+    float length = sqrtf(x * x + y * y + z * z);
+    float scale = length > 0.0f ? 1.0f / length : 0.0f;
+    out[0] = x * scale;
+    out[1] = y * scale;
+    out[2] = z * scale;
+}
+
+
+/** \brief Called with the audio player locked when its 3D location, 3D source, or 3D Doppler
+ *  changes, to publish its column of the batch of voices to the mixer.  Only the parameters are
+ *  converted here; the gains and speed are computed by mix_spatialize.  A player is 3D if it has
+ *  a 3D location, and the 3D source and Doppler are optional.
+ */
+
+void audioPlayer3DUpdate(CAudioPlayer *audioPlayer)
+{
+    Track *track = audioPlayer->mTrack;
+    IObject *thisObject = &audioPlayer->mObject;
+    if (NULL == track || !IsInterfaceInitialized(thisObject, MPH_3DLOCATION)) {
+        return;
+    }
+    const I3DLocation *location = &audioPlayer->m3DLocation;
+    I3DSource source;
+    if (IsInterfaceInitialized(thisObject, MPH_3DSOURCE)) {
+        source = audioPlayer->m3DSource;
+    } else {
+        I3DSource_init(&source);
+    }
+    I3DDoppler doppler;
+    if (IsInterfaceInitialized(thisObject, MPH_3DDOPPLER)) {
+        doppler = audioPlayer->m3DDoppler;
+    } else {
+        I3DDoppler_init(&doppler);
+        doppler.mDopplerFactor = 0;
+    }
+    float column[MIX_VOICE_INPUTS];
+    vector_meters(&column[MIX_VOICE_X], &location->mLocationCartesian);
+    vector_meters(&column[MIX_VOICE_VX], &doppler.mVelocityCartesian);
+    vector_unit(&column[MIX_VOICE_FRONT_X], &location->mOrientationVectors.mFront);
+    column[MIX_VOICE_RELATIVE] = source.mHeadRelative ? 1.0f : 0.0f;
+    column[MIX_VOICE_MIN_DISTANCE] = source.mMinDistance / 1000.0f;
+    column[MIX_VOICE_MAX_DISTANCE] = source.mMaxDistance / 1000.0f;
+    column[MIX_VOICE_ROLLOFF] = source.mRolloffFactor / 1000.0f;
+    column[MIX_VOICE_LINEAR] = SL_ROLLOFFMODEL_LINEAR == source.mDistanceModel ? 1.0f : 0.0f;
+    column[MIX_VOICE_MUTE] = source.mRolloffMaxDistanceMute ? 1.0f : 0.0f;
+    // the cone angles are the full angles in millidegrees, and the kernel takes half of each
+    column[MIX_VOICE_CONE_INNER] = cosf(source.mConeInnerAngle * (float) (M_PI / 360000.0));
+    column[MIX_VOICE_CONE_OUTER] = cosf(source.mConeOuterAngle * (float) (M_PI / 360000.0));
+    column[MIX_VOICE_CONE_LEVEL] = powf(10.0f, source.mConeOuterLevel / 2000.0f);
+    column[MIX_VOICE_DOPPLER] = doppler.mDopplerFactor / 1000.0f;
+    // a 3D Doppler added after the player was realized needs a resampler from now on
+    if (IsInterfaceInitialized(thisObject, MPH_3DDOPPLER)) {
+        (void) audioPlayerResampler(audioPlayer);
+    }
+
+    // while 3D commits are deferred, the column is staged until the next commit
+    CEngine *engine = thisObject->mEngine;
+    Spatial *spatial = &engine->mSpatial;
+    object_lock_exclusive(&engine->mObject);
+    if (engine->m3DCommit.mDeferred) {
+        memcpy(track->mSpatialStaged, column, sizeof(column));
+        if (!track->mSpatialPending) {
+            track->mSpatialPending = SL_BOOLEAN_TRUE;
+            track->mSpatialNext = spatial->mStaged;
+            spatial->mStaged = track;
+        }
+    } else {
+        spatial_begin(spatial);
+        memcpy(track->mSpatialPublished, column, sizeof(column));
+        spatial_end(spatial);
+    }
+    object_unlock_exclusive(&engine->mObject);
+    atomic_store_release(&track->mSpatialized, SL_BOOLEAN_TRUE);
+}
+
+
+/** \brief Called with the listener locked when its 3D location or 3D Doppler changes, to publish
+ *  it to the mixers of the engine
+ */
+
+void listener3DUpdate(CListener *listener)
+{
+    IObject *thisObject = &listener->mObject;
+    MixListener published = listenerDefault;
+    if (IsInterfaceInitialized(thisObject, MPH_3DLOCATION)) {
+        const I3DLocation *location = &listener->m3DLocation;
+        vector_meters(published.mPosition, &location->mLocationCartesian);
+        float up[3];
+        vector_unit(published.mFront, &location->mOrientationVectors.mFront);
+        vector_unit(up, &location->mOrientationVectors.mUp);
+        // front and up are perpendicular unit vectors, so their cross product is a unit vector
+        published.mRight[0] = published.mFront[1] * up[2] - published.mFront[2] * up[1];
+        published.mRight[1] = published.mFront[2] * up[0] - published.mFront[0] * up[2];
+        published.mRight[2] = published.mFront[0] * up[1] - published.mFront[1] * up[0];
+    }
+    if (IsInterfaceInitialized(thisObject, MPH_3DDOPPLER)) {
+        const I3DDoppler *doppler = &listener->m3DDoppler;
+        vector_meters(published.mVelocity, &doppler->mVelocityCartesian);
+        published.mDopplerFactor = doppler->mDopplerFactor / 1000.0f;
+    }
+
+    // An application might create more than one listener, so the engine lock serializes their
+    // updates, and the last one wins.  The lock order is the object, then the engine.
+    CEngine *engine = thisObject->mEngine;
+    Spatial *spatial = &engine->mSpatial;
+    object_lock_exclusive(&engine->mObject);
+    if (engine->m3DCommit.mDeferred) {
+        spatial->mStagedListener = published;
+        spatial->mListenerStaged = SL_BOOLEAN_TRUE;
+    } else {
+        spatial_begin(spatial);
+        spatial->mListener = published;
+        spatial->mListenerPublished = SL_BOOLEAN_TRUE;
+        spatial_end(spatial);
+    }
+    object_unlock_exclusive(&engine->mObject);
+}
+
+
+/** \brief Called with the engine locked by I3DCommit, to publish the 3D changes staged since the
+ *  last commit all at once.  The mixers pick them up at the start of their next fill.
+ */
+
+void IOutputMixExt_commit3D(CEngine *engine)
+{
+    Spatial *spatial = &engine->mSpatial;
+    if (NULL == spatial->mStaged && !spatial->mListenerStaged) {
+        return;
+    }
+    spatial_begin(spatial);
+    Track *track;
+    for (track = spatial->mStaged; NULL != track; track = track->mSpatialNext) {
+        memcpy(track->mSpatialPublished, track->mSpatialStaged, sizeof(track->mSpatialStaged));
+        track->mSpatialPending = SL_BOOLEAN_FALSE;
+    }
+    spatial->mStaged = NULL;
+    if (spatial->mListenerStaged) {
+        spatial->mListener = spatial->mStagedListener;
+        spatial->mListenerPublished = SL_BOOLEAN_TRUE;
+        spatial->mListenerStaged = SL_BOOLEAN_FALSE;
+    }
+    spatial_end(spatial);
+}
+
+
+/** \brief Called with the audio player locked, to fold the frames mixed since the last call
+ *  into the play position
+ */
+
+void audioPlayerFramesMixedUpdate(CAudioPlayer *audioPlayer)
+{
+    Track *track = audioPlayer->mTrack;
+    if (NULL != track) {
+        SLuint32 framesMixed = atomic_exchange_acquire(&track->mFramesMixed, 0);
+        audioPlayer->mPlay.mFramesSinceLastSeek += framesMixed;
+    }
+}
+
+
+/** \brief Called with the audio player locked when the state of its play interface that the
+ *  position-based play events depend on changes, to publish it to the mixer, which delivers those
+ *  events; see track_position.  A seek restarts the position from IPlay::mLastSeekPosition, and a
+ *  postponement restarts the update period.
+ */
+
+void audioPlayerEventsUpdate(CAudioPlayer *audioPlayer, SLboolean seek, SLboolean postpone)
+{
+    Track *track = audioPlayer->mTrack;
+    if (NULL == track) {
+        return;
+    }
+    IPlay *thisPlay = &audioPlayer->mPlay;
+    PlayEvents *published = &track->mPublishedEvents;
+    SLuint32 sequence = track->mEventsSequence;
+    atomic_store_relaxed(&track->mEventsSequence, sequence + 1);
+    atomic_fence_release();
+    published->mCallback = thisPlay->mCallback;
+    published->mContext = thisPlay->mContext;
+    published->mEventFlags = thisPlay->mEventFlags;
+    published->mMarkerPosition = thisPlay->mMarkerPosition;
+    published->mFrameUpdatePeriod = thisPlay->mFrameUpdatePeriod;
+    if (seek) {
+        published->mSeekPosition = thisPlay->mLastSeekPosition;
+        ++published->mSeeks;
+    }
+    if (postpone) {
+        ++published->mPostpones;
+    }
+    atomic_store_release(&track->mEventsSequence, sequence + 2);
+}
+
+
+/** \brief Called by an application thread with the audio player locked, after it has requested
+ *  the mixer to clear, stop, or destroy, to wait until the mixer acknowledges the request; the
+ *  caller then completes it.  The mixer doesn't lock the audio player, so it can't signal the
+ *  condition variable.  Instead it publishes the number of requests it has acknowledged, which
+ *  we poll with the audio player unlocked, as IOutputMixExt_synchronize waits for a mix; the mixer
+ *  acknowledges at its next pass, so that takes a few polls at most.
+ */
+
+void audioPlayerAwaitMixer(CAudioPlayer *audioPlayer)
+{
+    Track *track = audioPlayer->mTrack;
+    if (NULL == track) {
+        return;
+    }
+    SLuint32 request = track->mRequests + 1;
+    atomic_store_release(&track->mRequests, request);
+    while ((SLint32) (atomic_load_acquire(&track->mAcknowledged) - request) < 0) {
+        object_unlock_exclusive(&audioPlayer->mObject);
+        usleep(1000);
+        object_lock_exclusive(&audioPlayer->mObject);
+    }
 }
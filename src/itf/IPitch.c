@@ -28,9 +28,9 @@ static SLresult IPitch_SetPitch(SLPitchItf self, SLpermille pitch)
     if (!(thiz->mMinPitch <= pitch && pitch <= thiz->mMaxPitch)) {
         result = SL_RESULT_PARAMETER_INVALID;
     } else {
-        interface_lock_poke(thiz);
+        interface_lock_exclusive(thiz);
         thiz->mPitch = pitch;
-        interface_unlock_poke(thiz);
+        interface_unlock_exclusive_attributes(thiz, ATTR_RATE);
         result = SL_RESULT_SUCCESS;
     }
 
@@ -93,6 +93,11 @@ void IPitch_init(void *self)
     thiz->mItf = &IPitch_Itf;
     thiz->mPitch = 1000;
     // const
+#ifdef USE_OUTPUTMIXEXT
+    // the desktop mixer shifts the pitch with its resampler, which can't play backwards
+    thiz->mMinPitch = 500;
+#else
     thiz->mMinPitch = -500;
+#endif
     thiz->mMaxPitch = 2000;
 }
@@ -19,6 +19,20 @@
 #include "sles_allinclusive.h"
 
 
+#ifdef USE_OUTPUTMIXEXT
+/** \brief Called with the interface locked, to publish the state which the position-based play
+ *  events of an audio player depend on to its mixer; see audioPlayerEventsUpdate
+ */
+
+static void play_events_update(IPlay *thiz, SLboolean postpone)
+{
+    if (SL_OBJECTID_AUDIOPLAYER == InterfaceToObjectID(thiz)) {
+        audioPlayerEventsUpdate((CAudioPlayer *) thiz->mThis, SL_BOOLEAN_FALSE, postpone);
+    }
+}
+#endif
+
+
 static SLresult IPlay_SetPlayState(SLPlayItf self, SLuint32 state)
 {
     SL_ENTER_INTERFACE
@@ -39,7 +53,7 @@ static SLresult IPlay_SetPlayState(SLPlayItf self, SLuint32 state)
         SLuint32 oldState = thiz->mState;
         if (state != oldState) {
 #ifdef USE_OUTPUTMIXEXT
-          for (;; interface_cond_wait(thiz)) {
+          for (;; interface_cond_wait(thiz), oldState = thiz->mState) {
 
             // We are comparing the old state (left) vs. new state (right).
             // Note that the old state is 3 bits wide, but new state is only 2 bits wide.
@@ -49,7 +63,7 @@ static SLresult IPlay_SetPlayState(SLPlayItf self, SLuint32 state)
             case (SL_PLAYSTATE_STOPPED  << 2) | SL_PLAYSTATE_STOPPED:
             case (SL_PLAYSTATE_PAUSED   << 2) | SL_PLAYSTATE_PAUSED:
             case (SL_PLAYSTATE_PLAYING  << 2) | SL_PLAYSTATE_PLAYING:
-               // no-op, and unreachable due to earlier "if (state != oldState)"
+               // no-op, after someone else made the same transition while we waited
                 break;
 
             case (SL_PLAYSTATE_STOPPED  << 2) | SL_PLAYSTATE_PLAYING:
@@ -65,8 +79,8 @@ static SLresult IPlay_SetPlayState(SLPlayItf self, SLuint32 state)
 
             case (SL_PLAYSTATE_STOPPED  << 2) | SL_PLAYSTATE_PAUSED:
             case (SL_PLAYSTATE_PLAYING  << 2) | SL_PLAYSTATE_PAUSED:
-                // easy
-                thiz->mState = state;
+                // easy, but the mixer reads the play state without locking
+                atomic_store_release(&thiz->mState, state);
                 break;
 
             case (SL_PLAYSTATE_STOPPING << 2) | SL_PLAYSTATE_STOPPED:
@@ -81,8 +95,20 @@ static SLresult IPlay_SetPlayState(SLPlayItf self, SLuint32 state)
             case (SL_PLAYSTATE_PAUSED   << 2) | SL_PLAYSTATE_STOPPED:
             case (SL_PLAYSTATE_PLAYING  << 2) | SL_PLAYSTATE_STOPPED:
                 // tell mixer to stop, then wait for mixer to acknowledge the request to stop
-                thiz->mState = SL_PLAYSTATE_STOPPING;
-                continue;
+                atomic_store_release(&thiz->mState, SL_PLAYSTATE_STOPPING);
+                if (NULL != audioPlayer) {
+                    audioPlayerAwaitMixer(audioPlayer);
+                    // the mixer has rewound the front buffer, and we rewind the position
+                    thiz->mPosition = (SLmillisecond) 0;
+                    thiz->mFramesSinceLastSeek = 0;
+                    thiz->mLastSeekPosition = 0;
+                    // stop cancels a pending seek
+                    audioPlayer->mSeek.mPos = SL_TIME_UNKNOWN;
+                }
+                atomic_store_release(&thiz->mState, SL_PLAYSTATE_STOPPED);
+                // wake anyone else who waited for our transition
+                interface_cond_broadcast(thiz);
+                break;
 
             default:
                 // unexpected state
@@ -222,6 +248,18 @@ static SLresult IPlay_GetPosition(SLPlayItf self, SLmillisecond *pMsec)
         // if a seek is pending, then lie about current position so the seek appears synchronous
         if (SL_OBJECTID_AUDIOPLAYER == InterfaceToObjectID(thiz)) {
             CAudioPlayer *audioPlayer = (CAudioPlayer *) thiz->mThis;
+#ifdef USE_OUTPUTMIXEXT
+            // the periodic updates only happen while position events are enabled, so otherwise
+            // derive the position from the frames mixed so far, without consuming them
+            Track *track = audioPlayer->mTrack;
+            SLuint32 sampleRateMilliHz = audioPlayer->mSampleRateMilliHz;
+            if (NULL != track && UNKNOWN_SAMPLERATE != sampleRateMilliHz) {
+                SLuint32 frames = thiz->mFramesSinceLastSeek +
+                    atomic_load_acquire(&track->mFramesMixed);
+                position = (SLuint32) (((long long) frames * 1000000LL) / sampleRateMilliHz) +
+                    thiz->mLastSeekPosition;
+            }
+#endif
             SLmillisecond pos = audioPlayer->mSeek.mPos;
             if (SL_TIME_UNKNOWN != pos) {
                 position = pos;
@@ -245,6 +283,9 @@ static SLresult IPlay_RegisterCallback(SLPlayItf self, slPlayCallback callback,
     interface_lock_exclusive(thiz);
     thiz->mCallback = callback;
     thiz->mContext = pContext;
+#ifdef USE_OUTPUTMIXEXT
+    play_events_update(thiz, SL_BOOLEAN_FALSE);
+#endif
     // omits _attributes b/c noone cares deeply enough about these fields to need quick notification
     interface_unlock_exclusive(thiz);
     result = SL_RESULT_SUCCESS;
@@ -266,12 +307,13 @@ static SLresult IPlay_SetCallbackEventsMask(SLPlayItf self, SLuint32 eventFlags)
         if (thiz->mEventFlags != eventFlags) {
 #ifdef USE_OUTPUTMIXEXT
             // enabling the "head at new position" play event will postpone the next update event
-            if (!(thiz->mEventFlags & SL_PLAYEVENT_HEADATNEWPOS) &&
-                    (eventFlags & SL_PLAYEVENT_HEADATNEWPOS)) {
-                thiz->mFramesSincePositionUpdate = 0;
-            }
+            SLboolean postpone = !(thiz->mEventFlags & SL_PLAYEVENT_HEADATNEWPOS) &&
+                    (eventFlags & SL_PLAYEVENT_HEADATNEWPOS);
 #endif
             thiz->mEventFlags = eventFlags;
+#ifdef USE_OUTPUTMIXEXT
+            play_events_update(thiz, postpone);
+#endif
             interface_unlock_exclusive_attributes(thiz, ATTR_TRANSPORT);
         } else {
             interface_unlock_exclusive(thiz);
@@ -314,6 +356,9 @@ static SLresult IPlay_SetMarkerPosition(SLPlayItf self, SLmillisecond mSec)
         interface_lock_exclusive(thiz);
         if (thiz->mMarkerPosition != mSec) {
             thiz->mMarkerPosition = mSec;
+#ifdef USE_OUTPUTMIXEXT
+            play_events_update(thiz, SL_BOOLEAN_FALSE);
+#endif
             if (thiz->mEventFlags & SL_PLAYEVENT_HEADATMARKER) {
                 significant = true;
             }
@@ -340,6 +385,9 @@ static SLresult IPlay_ClearMarkerPosition(SLPlayItf self)
     // clearing the marker position is equivalent to setting the marker to SL_TIME_UNKNOWN
     if (thiz->mMarkerPosition != SL_TIME_UNKNOWN) {
         thiz->mMarkerPosition = SL_TIME_UNKNOWN;
+#ifdef USE_OUTPUTMIXEXT
+        play_events_update(thiz, SL_BOOLEAN_FALSE);
+#endif
         if (thiz->mEventFlags & SL_PLAYEVENT_HEADATMARKER) {
             significant = true;
         }
@@ -400,7 +448,7 @@ static SLresult IPlay_SetPositionUpdatePeriod(SLPlayItf self, SLmillisecond mSec
                 }
                 thiz->mFrameUpdatePeriod = frameUpdatePeriod;
                 // setting a new update period postpones the next callback
-                thiz->mFramesSincePositionUpdate = 0;
+                audioPlayerEventsUpdate(audioPlayer, SL_BOOLEAN_FALSE, SL_BOOLEAN_TRUE);
             }
 #endif
             if (thiz->mEventFlags & SL_PLAYEVENT_HEADATNEWPOS) {
@@ -469,6 +517,5 @@ void IPlay_init(void *self)
     thiz->mFrameUpdatePeriod = 0;   // because we don't know the sample rate yet
     thiz->mLastSeekPosition = 0;
     thiz->mFramesSinceLastSeek = 0;
-    thiz->mFramesSincePositionUpdate = 0;
 #endif
 }
@@ -43,7 +43,8 @@ static SLresult IPlaybackRate_SetRate(SLPlaybackRateItf self, SLpermille rate)
         if (SL_RESULT_SUCCESS == result) {
             thiz->mRate = rate;
         }
-        interface_unlock_exclusive(thiz);
+        interface_unlock_exclusive_attributes(thiz,
+            SL_RESULT_SUCCESS == result ? ATTR_RATE : ATTR_NONE);
     }
 
     SL_LEAVE_INTERFACE
@@ -98,7 +99,8 @@ static SLresult IPlaybackRate_SetPropertyConstraints(SLPlaybackRateItf self, SLu
         if (result == SL_RESULT_SUCCESS) {
             thiz->mProperties = constraints;
         }
-        interface_unlock_exclusive(thiz);
+        interface_unlock_exclusive_attributes(thiz,
+            SL_RESULT_SUCCESS == result ? ATTR_RATE : ATTR_NONE);
     }
 
     SL_LEAVE_INTERFACE
@@ -194,8 +196,16 @@ void IPlaybackRate_init(void *self)
     // const after initialization; these are default values which may be overwritten
     // during object creation but will not be modified after that
     // (e.g. for an Android AudioPlayer, see sles_to_android_audioPlayerCreate)
+#ifdef USE_OUTPUTMIXEXT
+    // the desktop mixer resamples, or time stretches if pitch corrected, over any rate in range
+    thiz->mMinRate = 500;
+    thiz->mMaxRate = 2000;
+    thiz->mStepSize = 0;
+    thiz->mCapabilities = SL_RATEPROP_NOPITCHCORAUDIO | SL_RATEPROP_PITCHCORAUDIO;
+#else
     thiz->mMinRate = 1000;
     thiz->mMaxRate = 1000;
     thiz->mStepSize = 0;
     thiz->mCapabilities = SL_RATEPROP_NOPITCHCORAUDIO;
+#endif
 }
@@ -27,6 +27,32 @@ static inline bool NO_PRESETREVERB(IPresetReverb* ipr) {
 }
 #endif
 
+#ifdef USE_OUTPUTMIXEXT
+/** \brief The I3DL2 properties of each preset, indexed by SL_REVERBPRESET_* */
+
+static const SLEnvironmentalReverbSettings PresetReverbSettings[SL_REVERBPRESET_PLATE + 1] = {
+    SL_I3DL2_ENVIRONMENT_PRESET_DEFAULT,    // SL_REVERBPRESET_NONE, not used
+    SL_I3DL2_ENVIRONMENT_PRESET_SMALLROOM,
+    SL_I3DL2_ENVIRONMENT_PRESET_MEDIUMROOM,
+    SL_I3DL2_ENVIRONMENT_PRESET_LARGEROOM,
+    SL_I3DL2_ENVIRONMENT_PRESET_MEDIUMHALL,
+    SL_I3DL2_ENVIRONMENT_PRESET_LARGEHALL,
+    SL_I3DL2_ENVIRONMENT_PRESET_PLATE
+};
+
+/** \brief Publish the preset to the mixer, which implements the reverb of an output mix as an
+ *  aux effect.  Called with the interface locked exclusively, or by expose or remove.
+ */
+
+static void IPresetReverb_publish(IPresetReverb *thiz, SLboolean enabled)
+{
+    assert(SL_REVERBPRESET_PLATE >= thiz->mPreset);
+    IOutputMixExt_publishReverb(&thiz->mAuxReverb, &PresetReverbSettings[thiz->mPreset],
+        enabled && SL_REVERBPRESET_NONE != thiz->mPreset,
+        thiz->mThis->mEngine->mEngine.mSampleRate);
+}
+#endif
+
 static SLresult IPresetReverb_SetPreset(SLPresetReverbItf self, SLuint16 preset)
 {
     SL_ENTER_INTERFACE
@@ -51,6 +77,9 @@ static SLresult IPresetReverb_SetPreset(SLPresetReverbItf self, SLuint16 preset)
             android::status_t status = android_prev_setPreset(thiz->mPresetReverbEffect, preset);
             result = android_fx_statusToResult(status);
         }
+#endif
+#ifdef USE_OUTPUTMIXEXT
+        IPresetReverb_publish(thiz, SL_BOOLEAN_TRUE);
 #endif
         interface_unlock_exclusive(thiz);
         break;
@@ -110,6 +139,11 @@ void IPresetReverb_init(void *self)
     // placement new (explicit constructor)
     (void) new (&thiz->mPresetReverbEffect) android::sp<android::AudioEffect>();
 #endif
+#ifdef USE_OUTPUTMIXEXT
+    thiz->mAuxReverb.mReverb = NULL;
+    thiz->mAuxReverb.mSequence = 0;
+    thiz->mAuxReverb.mCopied = 0;
+#endif
 }
 
 void IPresetReverb_deinit(void *self)
@@ -119,6 +153,9 @@ void IPresetReverb_deinit(void *self)
     // explicit destructor
     thiz->mPresetReverbEffect.~sp();
 #endif
+#ifdef USE_OUTPUTMIXEXT
+    IOutputMixExt_destroyReverb(&((IPresetReverb *) self)->mAuxReverb);
+#endif
 }
 
 bool IPresetReverb_Expose(void *self)
@@ -129,6 +166,26 @@ bool IPresetReverb_Expose(void *self)
         SL_LOGE("PresetReverb initialization failed.");
         return false;
     }
+#endif
+#ifdef USE_OUTPUTMIXEXT
+    // as for IEnvironmentalReverb_Expose
+    IPresetReverb *thiz = (IPresetReverb *) self;
+    if (SL_OBJECTID_OUTPUTMIX == InterfaceToObjectID(thiz)) {
+        IPresetReverb_publish(thiz, SL_BOOLEAN_TRUE);
+        return IOutputMixExt_exposeReverb(&thiz->mAuxReverb,
+            thiz->mThis->mEngine->mEngine.mSampleRate);
+    }
 #endif
     return true;
 }
+
+#ifdef USE_OUTPUTMIXEXT
+/** \brief Called by DynamicInterfaceManagement::RemoveInterface with the object locked, to take
+ *  the reverb out of the mix
+ */
+
+void IPresetReverb_Remove(void *self)
+{
+    IPresetReverb_publish((IPresetReverb *) self, SL_BOOLEAN_FALSE);
+}
+#endif
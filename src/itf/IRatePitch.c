@@ -27,9 +27,9 @@ static SLresult IRatePitch_SetRate(SLRatePitchItf self, SLpermille rate)
     if (!(thiz->mMinRate <= rate && rate <= thiz->mMaxRate)) {
         result = SL_RESULT_PARAMETER_INVALID;
     } else {
-        interface_lock_poke(thiz);
+        interface_lock_exclusive(thiz);
         thiz->mRate = rate;
-        interface_unlock_poke(thiz);
+        interface_unlock_exclusive_attributes(thiz, ATTR_RATE);
         result = SL_RESULT_SUCCESS;
     }
 
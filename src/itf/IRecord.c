@@ -30,9 +30,16 @@ static SLresult IRecord_SetRecordState(SLRecordItf self, SLuint32 state)
         {
         IRecord *thiz = (IRecord *) self;
         interface_lock_exclusive(thiz);
-        thiz->mState = state;
+#ifdef USE_OUTPUTMIXEXT
+        SLuint32 oldState = thiz->mState;
+#endif
+        // the capture thread reads the state without locking
+        atomic_store_release(&thiz->mState, state);
 #ifdef ANDROID
         android_audioRecorder_setRecordState(InterfaceToCAudioRecorder(thiz), state);
+#endif
+#ifdef USE_OUTPUTMIXEXT
+        audioRecorderStateUpdate(InterfaceToCAudioRecorder(thiz), oldState);
 #endif
         interface_unlock_exclusive(thiz);
         result = SL_RESULT_SUCCESS;
@@ -102,6 +109,7 @@ static SLresult IRecord_GetPosition(SLRecordItf self, SLmillisecond *pMsec)
             position = thiz->mPosition;
         }
 #else
+        // on the desktop, the capture thread keeps mPosition up to date as it fills buffers
         position = thiz->mPosition;
 #endif
         interface_unlock_shared(thiz);
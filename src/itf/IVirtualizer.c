@@ -20,11 +20,65 @@
 #ifdef ANDROID
 #include <audio_effects/effect_virtualizer.h>
 #endif
+#ifdef USE_OUTPUTMIXEXT
+#include <math.h>
+#endif
 
 #define VIRTUALIZER_STRENGTH_MIN 0
 #define VIRTUALIZER_STRENGTH_MAX 1000
 
 
+#ifdef USE_OUTPUTMIXEXT
+
+#define VIRTUALIZER_DELAY 0.00025   // seconds, about the delay between the ears
+#define VIRTUALIZER_CUTOFF 1000.0   // Hz, above which the head shadows the far ear
+#define VIRTUALIZER_CROSS_MAX 0.5   // gain of the crossfeed relative to the direct path
+
+/** \brief Design the crossfeed for the current strength, and publish it to the mixer under a
+ *  sequence lock as IEqualizer_publish does; see virtualizer_update in IOutputMixExt.c.  In place
+ *  of head related transfer functions, each channel is also heard at the other ear, delayed and
+ *  low pass filtered by a one-pole filter, truncated to the taps of the crossfeed.  Mono content
+ *  keeps its level at low frequencies.  Called with the interface locked exclusively.
+ */
+
+static void IVirtualizer_publish(IVirtualizer *thiz)
+{
+    MixCrossfeedCoefs coefs;
+    SLboolean active = thiz->mEnabled && 0 < thiz->mStrength;
+    double cross = active ? VIRTUALIZER_CROSS_MAX * thiz->mStrength / VIRTUALIZER_STRENGTH_MAX :
+        0.0;
+    double direct = 1.0 / (1.0 + cross);
+    // const after the engine is created, no lock needed
+    SLuint32 sampleRate = thiz->mThis->mEngine->mEngine.mSampleRate;
+    double pole = exp(-2.0 * M_PI * VIRTUALIZER_CUTOFF / sampleRate);
+    // at high sample rates the delay is limited so that the filter still has some taps
+    unsigned delay = (unsigned) (VIRTUALIZER_DELAY * sampleRate + 0.5);
+    if (MIX_CROSSFEED_TAPS / 2 < delay) {
+        delay = MIX_CROSSFEED_TAPS / 2;
+    }
+    double taps[MIX_CROSSFEED_TAPS];
+    double sum = 0.0;
+    unsigned i;
+    for (i = 0; i < MIX_CROSSFEED_TAPS; ++i) {
+        taps[i] = i < delay ? 0.0 : pow(pole, (double) (i - delay));
+        sum += taps[i];
+    }
+    coefs.mDirect = (float) direct;
+    for (i = 0; i < MIX_CROSSFEED_TAPS; ++i) {
+        coefs.mCross[i] = (float) (direct * cross * taps[i] / sum);
+    }
+    // there is only one writer, as we hold the lock
+    SLuint32 sequence = thiz->mCoefsSequence;
+    atomic_store_relaxed(&thiz->mCoefsSequence, sequence + 1);
+    atomic_fence_release();
+    thiz->mPublishedCoefs = coefs;
+    thiz->mPublishedActive = active;
+    atomic_store_release(&thiz->mCoefsSequence, sequence + 2);
+}
+
+#endif // USE_OUTPUTMIXEXT
+
+
 #if defined(ANDROID)
 /**
  * returns true if this interface is not associated with an initialized Virtualizer effect
@@ -43,6 +97,9 @@ static SLresult IVirtualizer_SetEnabled(SLVirtualizerItf self, SLboolean enabled
     interface_lock_exclusive(thiz);
     thiz->mEnabled = (SLboolean) enabled;
 #if !defined(ANDROID)
+#ifdef USE_OUTPUTMIXEXT
+    IVirtualizer_publish(thiz);
+#endif
     result = SL_RESULT_SUCCESS;
 #else
     if (NO_VIRTUALIZER(thiz)) {
@@ -99,6 +156,9 @@ static SLresult IVirtualizer_SetStrength(SLVirtualizerItf self, SLpermille stren
         interface_lock_exclusive(thiz);
 #if !defined(ANDROID)
         thiz->mStrength = strength;
+#ifdef USE_OUTPUTMIXEXT
+        IVirtualizer_publish(thiz);
+#endif
         result = SL_RESULT_SUCCESS;
 #else
         if (NO_VIRTUALIZER(thiz)) {
@@ -190,6 +250,10 @@ void IVirtualizer_init(void *self)
     thiz->mItf = &IVirtualizer_Itf;
     thiz->mEnabled = SL_BOOLEAN_FALSE;
     thiz->mStrength = 0;
+#ifdef USE_OUTPUTMIXEXT
+    thiz->mCoefsSequence = 0;
+    IVirtualizer_publish(thiz);
+#endif
 #if defined(ANDROID)
     memset(&thiz->mVirtualizerDescriptor, 0, sizeof(effect_descriptor_t));
     // placement new (explicit constructor)
@@ -217,3 +281,16 @@ bool IVirtualizer_Expose(void *self)
 #endif
     return true;
 }
+
+#ifdef USE_OUTPUTMIXEXT
+/** \brief Called by DynamicInterfaceManagement::RemoveInterface with the object locked, to take
+ *  the virtualizer out of the mix
+ */
+
+void IVirtualizer_Remove(void *self)
+{
+    IVirtualizer *thiz = (IVirtualizer *) self;
+    thiz->mEnabled = SL_BOOLEAN_FALSE;
+    IVirtualizer_publish(thiz);
+}
+#endif
@@ -32,8 +32,27 @@ static SLresult IVisualization_RegisterVisualizationCallback(SLVisualizationItf
         thiz->mCallback = callback;
         thiz->mContext = pContext;
         thiz->mRate = rate;
-        interface_unlock_exclusive(thiz);
         result = SL_RESULT_SUCCESS;
+#ifdef USE_OUTPUTMIXEXT
+        // only the visualization of an output mix is implemented, by a thread fed by the mixer
+        if (SL_OBJECTID_OUTPUTMIX == InterfaceToObjectID(thiz)) {
+            Visualizer *visualizer = thiz->mVisualizer;
+            if (NULL == visualizer && NULL != callback) {
+                visualizer = Visualizer_create(
+                    thiz->mThis->mEngine->mEngine.mSampleRate);
+                if (NULL == visualizer) {
+                    thiz->mCallback = NULL;
+                    result = SL_RESULT_RESOURCE_ERROR;
+                } else {
+                    atomic_store_release(&thiz->mVisualizer, visualizer);
+                }
+            }
+            if (NULL != visualizer) {
+                Visualizer_setCallback(visualizer, callback, pContext, rate);
+            }
+        }
+#endif
+        interface_unlock_exclusive(thiz);
     }
 
     SL_LEAVE_INTERFACE
@@ -67,4 +86,17 @@ void IVisualization_init(void *self)
     thiz->mCallback = NULL;
     thiz->mContext = NULL;
     thiz->mRate = 20000;
+#ifdef USE_OUTPUTMIXEXT
+    thiz->mVisualizer = NULL;
+#endif
+}
+
+void IVisualization_deinit(void *self)
+{
+#ifdef USE_OUTPUTMIXEXT
+    // the mixer has already acknowledged the destruction of the output mix
+    IVisualization *thiz = (IVisualization *) self;
+    Visualizer_destroy(thiz->mVisualizer);
+    thiz->mVisualizer = NULL;
+#endif
 }
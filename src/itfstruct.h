@@ -53,7 +53,7 @@ typedef struct Object_interface {
 #else
     SLuint8 mPadding;
 #endif
-    SLuint8 mStrongRefCount;        // number of strong references to this object
+    SLuint16 mStrongRefCount;       // number of strong references to this object
     // (object cannot be destroyed as long as > 0, and referrers _prefer_ it stay in Realized state)
     // for best alignment, do not add any fields here
 #define INTERFACES_Default 1
@@ -66,9 +66,7 @@ typedef struct Object_interface {
 typedef struct {
     const struct SL3DCommitItf_ *mItf;
     IObject *mThis;
-    SLboolean mDeferred;
-    SLuint32 mGeneration;   // incremented each master clock cycle
-    SLuint32 mWaiting;      // number of threads waiting in Commit
+    SLboolean mDeferred;    // whether 3D changes are staged until the next Commit
 } I3DCommit;
 
 enum CartesianSphericalActive {
@@ -140,7 +138,7 @@ typedef struct {
         SLVec3D mUp;
     } mOrientationVectors;
     enum AnglesVectorsActive mOrientationActive;
-    // Rotations can be slow, so are deferred.
+    // The last rotation, which is applied to the orientation vectors immediately
     SLmillidegree mTheta;
     SLVec3D mAxis;
     SLboolean mRotatePending;
@@ -165,7 +163,7 @@ typedef struct {
         SLVec3D mUp;
     } mOrientationVectors;
     enum AnglesVectorsActive mOrientationActive;
-    // Rotations can be slow, so are deferred.
+    // The last rotation, which is applied to the orientation vectors immediately
     SLmillidegree mTheta;
     SLVec3D mAxis;
     SLboolean mRotatePending;
@@ -218,6 +216,12 @@ typedef struct {
     IObject *mThis;
     SLboolean mEnabled;
     SLpermille mStrength;
+#ifdef USE_OUTPUTMIXEXT
+    // Low shelf designed by the application thread for the mixer, see IBassBoost_publish
+    MixBiquadCoefs mPublishedCoefs;
+    SLboolean mPublishedActive; ///< Whether the mixer is to apply mPublishedCoefs
+    SLuint32 mCoefsSequence;    ///< Odd while mPublishedCoefs is being updated
+#endif
 #if defined(ANDROID)
     effect_descriptor_t mBassBoostDescriptor;
     android::sp<android::AudioEffect> mBassBoostEffect;
@@ -244,6 +248,20 @@ typedef struct BufferQueue_interface {
     BufferHeader mTypical[BUFFER_HEADER_TYPICAL+1];
 } IBufferQueue;
 
+#ifdef USE_OUTPUTMIXEXT
+typedef struct {
+    const struct SLDesktopStatisticsItf_ *mItf;
+    IObject *mThis;
+    // Published by the mixer at the end of each period, see mix_statistics
+    SLDesktopMixerStatistics mPublished;
+    SLuint32 mSequence;         ///< Odd while the mixer is updating mPublished
+    SLboolean mResetRequested;  ///< Set by ResetStatistics, cleared by the mixer once done
+    // Periodic dump, see IDesktopStatistics_sync
+    SLmillisecond mDumpPeriod;  ///< 0 for none
+    long long mDumpTime;        ///< When the sync thread last logged, in monotonic nanoseconds
+} IDesktopStatistics;
+#endif
+
 #define MAX_DEVICE 2    // hard-coded array size for default in/out
 
 typedef struct {
@@ -272,12 +290,6 @@ struct EnableLevel {
     SLmillibel mSendLevel;
 };
 
-// indexes into IEffectSend.mEnableLevels
-
-#define AUX_ENVIRONMENTALREVERB 0
-#define AUX_PRESETREVERB        1
-#define AUX_MAX                 2
-
 typedef struct {
     const struct SLEffectSendItf_ *mItf;
     IObject *mThis;
@@ -288,14 +300,35 @@ typedef struct Engine_interface {
     const struct SLEngineItf_ *mItf;
     IObject *mThis;
     SLboolean mLossOfControlGlobal;
-#ifdef USE_SDL
-    COutputMix *mOutputMix; // SDL pulls PCM from an arbitrary IOutputMixExt
+#ifdef USE_OUTPUTMIXEXT
+    // the device pulls PCM from the current output mix, which it loads atomically without the
+    // engine lock; written with the engine locked, see IOutputMixExt_render
+    COutputMix *mOutputMix;
+    SLuint32 mOutputMixEpoch;   // odd while the device is rendering, only written by the device
+    SLuint32 mZoneMask;     // 1 bit per COutputMix::mZone in use
+    SLuint32 mMixerThreads; // worker threads of each output mix, 0 to mix serially
+    SLuint32 mDevice;       // SL_DESKTOP_DEVICE_*
+    SLuint32 mClockPercent; // speed of the null device's virtual clock, 0 as fast as possible
+    SLboolean mDeferredCallbacks;   // whether each output mix has a callback thread
+    SLuint32 mMaxVoices;    // tracks actually mixed by each output mix, 0 for no limit
+    SLboolean mSilenceDetection;    // whether enqueued buffers are scanned for silence
+    SLuint32 mPeriodFrames; // frames per period of the device
+    SLuint32 mPeriods;      // periods in the ring buffer of the device
+    SLuint32 mPriority;     // SCHED_FIFO priority of the device's thread, 0 for normal scheduling
+    SLuint32 mSampleRate;   // of the device and of every output mix, in Hz
+    SLuint32 mChannels;     // of the device; output mixes are stereo, see IOutputMixExt_FillBuffer
 #endif
     // Each engine is its own universe.
     SLuint32 mInstanceCount;
-    unsigned mInstanceMask; // 1 bit per active object
-    unsigned mChangedMask;  // objects which have changed since last sync
-#define MAX_INSTANCE 32     // maximum active objects per engine, see mInstanceMask
+    // Objects are tracked in a two-level bitmap: a word of 1 bit per object for each group of
+    // INSTANCE_GROUP objects, and a summary word of 1 bit per group
+#define INSTANCE_GROUP 32       // objects per word of mInstanceMasks and mChangedMasks
+#define MAX_INSTANCE_GROUPS 32  // bits in mFullMask and mChangedGroupMask
+#define MAX_INSTANCE (INSTANCE_GROUP * MAX_INSTANCE_GROUPS) // maximum active objects per engine
+    unsigned mFullMask;         // groups which have no free slots
+    unsigned mChangedGroupMask; // groups which have at least one bit set in mChangedMasks
+    unsigned mInstanceMasks[MAX_INSTANCE_GROUPS];   // 1 bit per active object
+    unsigned mChangedMasks[MAX_INSTANCE_GROUPS];    // objects which have changed since last sync
     IObject *mInstances[MAX_INSTANCE];
     SLboolean mShutdown;
     SLboolean mShutdownAck;
@@ -315,6 +348,9 @@ typedef struct {
     const struct SLEnvironmentalReverbItf_ *mItf;
     IObject *mThis;
     SLEnvironmentalReverbSettings mProperties;
+#ifdef USE_OUTPUTMIXEXT
+    AuxReverb mAuxReverb;
+#endif
 #if defined(ANDROID)
     effect_descriptor_t mEnvironmentalReverbDescriptor;
     android::sp<android::AudioEffect> mEnvironmentalReverbEffect;
@@ -340,6 +376,12 @@ typedef struct {
     SLuint16 mPreset;
 #if 0 < MAX_EQ_BANDS
     SLmillibel mLevels[MAX_EQ_BANDS];
+#endif
+#ifdef USE_OUTPUTMIXEXT
+    // Filters designed by the application thread for the mixer, see IEqualizer_publish
+    MixBiquadCoefs mPublishedCoefs;
+    SLboolean mPublishedActive; ///< Whether the mixer is to apply mPublishedCoefs
+    SLuint32 mCoefsSequence;    ///< Odd while mPublishedCoefs is being updated
 #endif
     // const to end of struct
     SLuint16 mNumPresets;
@@ -431,7 +473,9 @@ typedef struct {
     // fields that were formerly here are now at CAudioPlayer
 } IMuteSolo;
 
-#define MAX_TRACK 32        // see mActiveMask
+#define TRACK_GROUP 32          // tracks per group, see mActiveMasks
+#define MAX_TRACK_GROUPS 32     // see mGroupMask
+#define MAX_TRACK (TRACK_GROUP * MAX_TRACK_GROUPS)
 
 typedef struct {
     const struct SLOutputMixItf_ *mItf;
@@ -441,12 +485,105 @@ typedef struct {
 } IOutputMix;
 
 #ifdef USE_OUTPUTMIXEXT
+#define MIXBUS_FRAMES 512   // maximum frames mixed per pass, see mBus
+
+/** \brief Buffers of one thread mixing tracks: the callback thread, or a worker thread */
+
+typedef struct {
+    /** Wide accumulation bus, interleaved stereo float, converted once to the device format */
+    float mBus[MIXBUS_FRAMES * STEREO_CHANNELS];
+    /** Current track decoded to float, if it is neither 16-bit nor float */
+    float mDecode[MIXBUS_FRAMES * MIX_MAX_CHANNELS];
+    /** Current track converted to interleaved stereo float, the input of the resampler */
+    float mConvert[MIXBUS_FRAMES * STEREO_CHANNELS];
+    /** Output of the resampler for the current track, if it then goes through a time stretch */
+    float mStretch[MIXBUS_FRAMES * STEREO_CHANNELS];
+    /** Output of the resampler or time stretch for the current track, interleaved stereo float */
+    float mScratch[MIXBUS_FRAMES * STEREO_CHANNELS];
+    /** Current track with its gains applied, if it goes through an equalizer before the bus */
+    float mEqualize[MIXBUS_FRAMES * STEREO_CHANNELS];
+    /** Sends of the tracks to each aux effect, interleaved stereo float like mBus */
+    float mAux[AUX_MAX][MIXBUS_FRAMES * STEREO_CHANNELS];
+    SLboolean mBusHasData;  ///< Whether any track contributed to mBus during this pass
+    SLboolean mAuxHasData[AUX_MAX]; ///< Whether any track sent to each of mAux this pass
+    SLuint32 mUnderruns;    ///< Number of times a track mixed by this thread ran dry
+} MixLane;
+
+/** \brief The mixer's side of the bass boost of an output mix: a low shelf, as an equalizer, of
+ *  which less is applied while the boosted mix would clip, see mix_bass_boost
+ */
+
+typedef struct {
+    Equalizer mShelf;
+    /** The mix before the shelf, delayed by MIX_BIQUADS - 1 frames as the shelf delays it */
+    float mDry[(MIX_BIQUADS - 1 + MIXBUS_FRAMES) * STEREO_CHANNELS];
+    float mDepth;           ///< How much of the boost is applied, from 0 to 1
+} BassBoost;
+
+/** \brief The mixer's side of the virtualizer of an output mix: a crossfeed, see mix_virtualizer */
+
+typedef struct {
+    MixCrossfeedCoefs mCoefs;
+    /** History followed by the mix, deinterleaved */
+    float mLeft[MIX_CROSSFEED_TAPS - 1 + MIXBUS_FRAMES];
+    float mRight[MIX_CROSSFEED_TAPS - 1 + MIXBUS_FRAMES];
+    SLuint32 mSequence;     ///< IVirtualizer::mCoefsSequence when mCoefs was copied
+    SLboolean mActive;      ///< Whether the virtualizer is enabled with a non-zero strength
+} Virtualizer;
+
+/** \brief Mixer statistics, accumulated by the callback thread and published to the engine */
+
+typedef struct {
+    SLDesktopMixerStatistics mCounters; ///< Apart from the means and underruns
+    unsigned long long mMixTimeSum;     ///< Total of mCounters.lastMixTime, in microseconds
+    unsigned long long mJitterSum;      ///< Total jitter, in microseconds
+    SLuint32 mJitters;      ///< Number of intervals between periods in mJitterSum
+    long long mLastStart;   ///< When the last period started in monotonic nanoseconds, or 0
+} MixStatistics;
+
 typedef struct {
     const struct SLOutputMixExtItf_ *mItf;
     IObject *mThis;
-    unsigned mActiveMask;   // 1 bit per active track
-    Track mTracks[MAX_TRACK];
-    SLboolean mDestroyRequested;    ///< Mixer to acknowledge application's call to Object::Destroy
+    // Tracks are allocated in groups on demand, and a group is never moved or freed until the
+    // output mix is destroyed, as audio players and the mixer keep pointers to their tracks.
+    // The masks are a two-level bitmap, so both allocation and iteration are O(1) per track.
+    unsigned mGroupMask;    ///< 1 bit per group with at least one active track
+    unsigned mFreeMask;     ///< 1 bit per allocated group with at least one free track
+    unsigned mNumGroups;    ///< Number of allocated groups, which are the lowest indices
+    unsigned mActiveMasks[MAX_TRACK_GROUPS];    ///< 1 bit per active track within each group
+    Track *mTrackGroups[MAX_TRACK_GROUPS];      ///< TRACK_GROUP tracks each, or NULL
+    const MixKernels *mKernels;     ///< Fastest mixer kernels supported by this CPU
+    SLuint32 mSampleRate;           ///< Device sample rate in Hz, tracks are resampled to this
+    unsigned mChannels;             ///< Device channels, the final mix is expanded from stereo
+    ResamplerQuality mResamplerQuality; ///< Quality of resamplers for tracks
+    MixLane mLane;          ///< Buffers of the callback thread, which holds the final mix
+    short mClamped[MIXBUS_FRAMES * STEREO_CHANNELS]; ///< Final mix, unless the device is stereo
+    // Optional parallel mixing, see IOutputMixExt_FillBuffer; the fields below are only used
+    // by the callback thread, apart from mWork which workers read and mNextWork which they claim
+    ForkJoin *mForkJoin;    ///< Worker threads, or NULL to always mix serially
+    MixLane *mWorkerLanes;  ///< One per worker thread
+    Track *mWork[MAX_TRACK];    ///< Tracks to be mixed during the current pass
+    unsigned mNumWork;      ///< Number of tracks in mWork
+    unsigned mNextWork;     ///< Index of the next track in mWork to be claimed, atomically
+    unsigned mPassFrames;   ///< Number of frames to be mixed by each track during this pass
+    unsigned mSerialPasses; ///< Number of passes to mix serially after workers missed a deadline
+    Dispatcher *mDispatcher;    ///< Callback thread, or NULL to call back from the mixer
+    // Virtual voices, see mix_voices
+    unsigned mMaxVoices;    ///< Tracks mixed per fill, the rest are virtual; 0 for no limit
+    unsigned mNumVirtual;   ///< Number of virtual tracks during the current fill
+    unsigned long long mVoiceKeys[MAX_TRACK];   ///< Ranking of the tracks competing to be mixed
+    // 3D voices, see mix_spatialize; only used by the callback thread
+    MixListener mListener;  ///< Last good copy of the engine's Spatial::mListener
+    float mVoices[MIX_VOICE_ROWS * MAX_TRACK];  ///< Playing 3D tracks, see MixSpatialize
+    Track *mVoiceTracks[MAX_TRACK]; ///< Track of each column of mVoices
+    MixStatistics mStatistics;  ///< Only used by the callback thread
+    Equalizer mEqualizer;   ///< Of the output mix, only used by the callback thread
+    Virtualizer mVirtualizer;   ///< Likewise
+    BassBoost mBassBoost;   ///< Likewise
+    /** Whether Object::Destroy has begun, so the output mix can no longer become the engine's
+     *  current one; protected by the engine lock
+     */
+    SLboolean mDestroying;
 } IOutputMixExt;
 #endif
 
@@ -476,7 +613,6 @@ typedef struct Play_interface {
     SLuint32 mFrameUpdatePeriod;         // mPositionUpdatePeriod in frame units
     SLmillisecond mLastSeekPosition;     // Last known accurate position, set at Seek
     SLuint32 mFramesSinceLastSeek;       // Frames mixed since last known accurate position
-    SLuint32 mFramesSincePositionUpdate; // Frames mixed since last position update callback
 #endif
 } IPlay;
 
@@ -513,6 +649,9 @@ typedef struct {
     const struct SLPresetReverbItf_ *mItf;
     IObject *mThis;
     SLuint16 mPreset;
+#ifdef USE_OUTPUTMIXEXT
+    AuxReverb mAuxReverb;
+#endif
 #if defined(ANDROID)
     effect_descriptor_t mPresetReverbDescriptor;
     android::sp<android::AudioEffect> mPresetReverbEffect;
@@ -571,6 +710,12 @@ typedef struct {
     IObject *mThis;
     SLboolean mEnabled;
     SLpermille mStrength;
+#ifdef USE_OUTPUTMIXEXT
+    // Crossfeed designed by the application thread for the mixer, see IVirtualizer_publish
+    MixCrossfeedCoefs mPublishedCoefs;
+    SLboolean mPublishedActive; ///< Whether the mixer is to apply mPublishedCoefs
+    SLuint32 mCoefsSequence;    ///< Odd while mPublishedCoefs is being updated
+#endif
 #if defined(ANDROID)
     effect_descriptor_t mVirtualizerDescriptor;
     android::sp<android::AudioEffect> mVirtualizerEffect;
@@ -583,6 +728,12 @@ typedef struct {
     slVisualizationCallback mCallback;
     void *mContext;
     SLmilliHertz mRate;
+#ifdef USE_OUTPUTMIXEXT
+    /** Of an output mix, created when a callback is first registered and fed by the mixer, or
+     *  NULL; see desktop/Visualizer.c
+     */
+    Visualizer *mVisualizer;
+#endif
 } IVisualization;
 
 typedef struct /*Volume_interface*/ {
@@ -629,7 +780,7 @@ typedef struct {
     I3DSource m3DSource;
     I3DMacroscopic m3DMacroscopic;
     // remaining are per-instance private fields not associated with an interface
-    unsigned mMemberMask;   // set of member objects
+    SLuint32 mMemberCount;  // number of member objects
 } /*C3DGroup*/;
 
 #ifdef ANDROID
@@ -130,6 +130,39 @@ void object_lock_exclusive(IObject *thiz)
 #endif
 
 
+/** \brief Exclusively lock an object if it is not already locked, and return whether it was
+ *  locked.  Used by threads which must never block on an object, such as the mixer.
+ */
+
+#ifdef USE_DEBUG
+bool object_trylock_exclusive_(IObject *thiz, const char *file, int line)
+{
+    int ok;
+    ok = pthread_mutex_trylock(&thiz->mMutex);
+    if (0 != ok) {
+        // EBUSY is the expected failure
+        assert(EBUSY == ok);
+        return false;
+    }
+    assert(!pthread_equal(pthread_self(), thiz->mOwner));
+    thiz->mOwner = pthread_self();
+    thiz->mFile = file;
+    thiz->mLine = line;
+    // not android_atomic_inc because we are already holding a mutex
+    ++thiz->mGeneration;
+    return true;
+}
+#else
+bool object_trylock_exclusive(IObject *thiz)
+{
+    int ok;
+    ok = pthread_mutex_trylock(&thiz->mMutex);
+    assert(0 == ok || EBUSY == ok);
+    return 0 == ok;
+}
+#endif
+
+
 /** \brief Exclusively unlock an object and do not report any updates */
 
 #ifdef USE_DEBUG
@@ -275,7 +308,8 @@ void object_unlock_exclusive_attributes(IObject *thiz, unsigned attributes)
             IEngine *thisEngine = &thiz->mEngine->mEngine;
             // FIXME atomic or here
             interface_lock_exclusive(thisEngine);
-            thisEngine->mChangedMask |= 1 << id;
+            thisEngine->mChangedMasks[id / INSTANCE_GROUP] |= 1 << (id % INSTANCE_GROUP);
+            thisEngine->mChangedGroupMask |= 1 << (id / INSTANCE_GROUP);
             interface_unlock_exclusive(thisEngine);
         }
     }
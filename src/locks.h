@@ -18,12 +18,14 @@
 
 #ifdef USE_DEBUG
 extern void object_lock_exclusive_(IObject *thiz, const char *file, int line);
+extern bool object_trylock_exclusive_(IObject *thiz, const char *file, int line);
 extern void object_unlock_exclusive_(IObject *thiz, const char *file, int line);
 extern void object_unlock_exclusive_attributes_(IObject *thiz, unsigned attr,
     const char *file, int line);
 extern void object_cond_wait_(IObject *thiz, const char *file, int line);
 #else
 extern void object_lock_exclusive(IObject *thiz);
+extern bool object_trylock_exclusive(IObject *thiz);
 extern void object_unlock_exclusive(IObject *thiz);
 extern void object_unlock_exclusive_attributes(IObject *thiz, unsigned attr);
 extern void object_cond_wait(IObject *thiz);
@@ -33,6 +35,7 @@ extern void object_cond_broadcast(IObject *thiz);
 
 #ifdef USE_DEBUG
 #define object_lock_exclusive(thiz) object_lock_exclusive_((thiz), __FILE__, __LINE__)
+#define object_trylock_exclusive(thiz) object_trylock_exclusive_((thiz), __FILE__, __LINE__)
 #define object_unlock_exclusive(thiz) object_unlock_exclusive_((thiz), __FILE__, __LINE__)
 #define object_unlock_exclusive_attributes(thiz, attr) \
     object_unlock_exclusive_attributes_((thiz), (attr), __FILE__, __LINE__)
@@ -68,3 +71,29 @@ extern void object_cond_broadcast(IObject *thiz);
 #define interface_unlock_poke(thiz) interface_unlock_exclusive(thiz)
 #define interface_lock_peek(thiz)   interface_lock_shared(thiz)
 #define interface_unlock_peek(thiz) interface_unlock_shared(thiz)
+
+// Atomic operations on aligned 32-bit fields and pointers which are shared with a thread that
+// must never block on an object lock, such as the mixer.  The application side still updates
+// such fields with the object locked, so there is at most one writer at a time.
+
+#define atomic_load_relaxed(p)      __atomic_load_n((p), __ATOMIC_RELAXED)
+#define atomic_load_acquire(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define atomic_store_relaxed(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define atomic_store_release(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define atomic_add_release(p, v)    ((void) __atomic_add_fetch((p), (v), __ATOMIC_RELEASE))
+#define atomic_inc_release(p)       ((void) __atomic_add_fetch((p), 1, __ATOMIC_RELEASE))
+#define atomic_dec_release(p)       ((void) __atomic_sub_fetch((p), 1, __ATOMIC_RELEASE))
+#define atomic_exchange_acquire(p, v) __atomic_exchange_n((p), (v), __ATOMIC_ACQUIRE)
+#define atomic_fence_release()      __atomic_thread_fence(__ATOMIC_RELEASE)
+#define atomic_fence_acquire()      __atomic_thread_fence(__ATOMIC_ACQUIRE)
+// Orders a store before a later load, for two threads which each store and then load the
+// other's field, see IOutputMixExt_render
+#define atomic_fence_seq_cst()      __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+// Read-modify-write operations for fields which several mixer worker threads update at once
+
+#define atomic_fetch_inc_relaxed(p) __atomic_fetch_add((p), 1, __ATOMIC_RELAXED)
+#define atomic_or_release(p, v)     ((void) __atomic_or_fetch((p), (v), __ATOMIC_RELEASE))
+#define atomic_and_fetch_release(p, v) __atomic_and_fetch((p), (v), __ATOMIC_RELEASE)
+#define atomic_or_acq_rel(p, v)     ((void) __atomic_or_fetch((p), (v), __ATOMIC_ACQ_REL))
+#define atomic_exchange_acq_rel(p, v) __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
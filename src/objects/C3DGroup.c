@@ -25,9 +25,10 @@ predestroy_t C3DGroup_PreDestroy(void *self)
 {
     C3DGroup *thiz = (C3DGroup *) self;
     // See design document for explanation
-    if (0 == thiz->mMemberMask) {
+    if (0 == thiz->mMemberCount) {
         return predestroy_ok;
     }
-    SL_LOGE("Object::Destroy(%p) for 3DGroup ignored; mMemberMask=0x%x", thiz, thiz->mMemberMask);
+    SL_LOGE("Object::Destroy(%p) for 3DGroup ignored; mMemberCount=%u", thiz,
+        (unsigned) thiz->mMemberCount);
     return predestroy_error;
 }
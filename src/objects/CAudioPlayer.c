@@ -34,6 +34,12 @@ SLresult CAudioPlayer_Realize(void *self, SLboolean async)
     result = SndFile_Realize(thiz);
 #endif
 
+#ifdef USE_OUTPUTMIXEXT
+    if (SL_RESULT_SUCCESS == result) {
+        result = IOutputMixExt_realizeAudioPlayer(thiz);
+    }
+#endif
+
     // At this point the channel count and sample rate might still be unknown,
     // depending on the data source and the platform implementation.
     // If they are unknown here, then they will be determined during prefetch.
@@ -63,6 +69,9 @@ void CAudioPlayer_Destroy(void *self)
 #ifdef USE_SNDFILE
     SndFile_Destroy(thiz);
 #endif
+#ifdef USE_OUTPUTMIXEXT
+    IOutputMixExt_destroyAudioPlayer(thiz);
+#endif
 }
 
 
@@ -87,11 +96,11 @@ predestroy_t CAudioPlayer_PreDestroy(void *self)
     }
     assert(audioPlayer == thiz);
     // Request the mixer thread to unlink this audio player's track
-    thiz->mDestroyRequested = true;
-    while (thiz->mDestroyRequested) {
-        object_cond_wait(self);
-    }
-    // Mixer thread has acknowledged the request
+    atomic_store_release(&thiz->mDestroyRequested, true);
+    audioPlayerAwaitMixer(thiz);
+    // Mixer thread has acknowledged the request, and released the track
+    thiz->mTrack = NULL;
+    thiz->mDestroyRequested = SL_BOOLEAN_FALSE;
 #endif
     return predestroy_ok;
 }
@@ -30,6 +30,14 @@ SLresult CAudioRecorder_Realize(void *self, SLboolean async)
     result = android_audioRecorder_realize(thiz, async);
 #endif
 
+#ifdef USE_OUTPUTMIXEXT
+    CAudioRecorder *audioRecorder = (CAudioRecorder *) self;
+    // only buffer queue sinks are captured into; there is nothing to start for a URI
+    if (SL_DATALOCATOR_BUFFERQUEUE == audioRecorder->mDataSink.mLocator.mLocatorType) {
+        result = CaptureDevice_open(audioRecorder);
+    }
+#endif
+
     return result;
 }
 
@@ -62,6 +70,12 @@ predestroy_t CAudioRecorder_PreDestroy(void *self)
     CAudioRecorder *thiz = (CAudioRecorder *) self;
 #ifdef ANDROID
     android_audioRecorder_preDestroy(thiz);
+#endif
+#ifdef USE_OUTPUTMIXEXT
+    // the capture thread needs the lock to finish its period
+    object_unlock_exclusive(&thiz->mObject);
+    CaptureDevice_close(thiz);
+    object_lock_exclusive(&thiz->mObject);
 #endif
     return predestroy_ok;
 }
@@ -47,6 +47,21 @@ __attribute__((destructor)) static void onDlClose(void)
 }
 
 
+/** \brief Stop the sync thread when an engine fails to realize.  The sync thread locks the
+ *  engine to see the shutdown, so the lock held by Object::Realize is released meanwhile.
+ */
+
+static void CEngine_stopSync(CEngine *thiz)
+{
+    thiz->mEngine.mShutdown = SL_BOOLEAN_TRUE;
+    object_unlock_exclusive(&thiz->mObject);
+    (void) pthread_join(thiz->mSyncThread, (void **) NULL);
+    object_lock_exclusive(&thiz->mObject);
+    // so that CEngine_Destroy doesn't wait for it again
+    memset(&thiz->mSyncThread, 0, sizeof(pthread_t));
+}
+
+
 /** \brief Hook called by Object::Realize when an engine is realized */
 
 SLresult CEngine_Realize(void *self, SLboolean async)
@@ -63,14 +78,25 @@ SLresult CEngine_Realize(void *self, SLboolean async)
     // initialize the thread pool for asynchronous operations
     result = ThreadPool_init(&thiz->mThreadPool, 0, 0);
     if (SL_RESULT_SUCCESS != result) {
-        thiz->mEngine.mShutdown = SL_BOOLEAN_TRUE;
-        (void) pthread_join(thiz->mSyncThread, (void **) NULL);
+        CEngine_stopSync(thiz);
         return result;
     }
+#ifdef USE_OUTPUTMIXEXT
+    // through ALSA, or without audio hardware, each output mix has its own device, which is
+    // opened when the output mix is realized; SDL has only the one
 #ifdef USE_SDL
-    SDL_open(&thiz->mEngine);
+    if (SL_DESKTOP_DEVICE_AUDIO == thiz->mEngine.mDevice) {
+        result = SDL_open(&thiz->mEngine);
+    }
 #endif
-    return SL_RESULT_SUCCESS;
+#elif defined(USE_SDL)
+    result = SDL_open(&thiz->mEngine);
+#endif
+    // the thread pool is left for CEngine_Destroy
+    if (SL_RESULT_SUCCESS != result) {
+        CEngine_stopSync(thiz);
+    }
+    return result;
 }
 
 
@@ -90,16 +116,19 @@ void CEngine_Destroy(void *self)
 
     // Verify that there are no extant objects
     unsigned instanceCount = thiz->mEngine.mInstanceCount;
-    unsigned instanceMask = thiz->mEngine.mInstanceMask;
-    if ((0 < instanceCount) || (0 != instanceMask)) {
+    if (0 < instanceCount) {
         SL_LOGE("Object::Destroy(%p) for engine ignored; %u total active objects",
             thiz, instanceCount);
-        while (0 != instanceMask) {
-            unsigned i = ctz(instanceMask);
-            assert(MAX_INSTANCE > i);
-            SL_LOGE("Object::Destroy(%p) for engine ignored; active object ID %u at %p",
-                thiz, i + 1, thiz->mEngine.mInstances[i]);
-            instanceMask &= ~(1 << i);
+        unsigned group;
+        for (group = 0; group < MAX_INSTANCE_GROUPS; ++group) {
+            unsigned instanceMask = thiz->mEngine.mInstanceMasks[group];
+            while (0 != instanceMask) {
+                unsigned i = group * INSTANCE_GROUP + ctz(instanceMask);
+                assert(MAX_INSTANCE > i);
+                SL_LOGE("Object::Destroy(%p) for engine ignored; active object ID %u at %p",
+                    thiz, i + 1, thiz->mEngine.mInstances[i]);
+                instanceMask &= instanceMask - 1;
+            }
         }
     }
 
@@ -19,6 +19,75 @@
 #include "sles_allinclusive.h"
 
 
+#ifdef USE_OUTPUTMIXEXT
+
+/** \brief Give the output mix the lowest zone not used by another output mix of the engine, and
+ *  start its device on its own thread, unless the engine's device is SL_DESKTOP_DEVICE_AUDIO.
+ *  The zone tells the device which WAV file or ALSA PCM to use.  Called with the output mix locked.
+ */
+
+static SLresult COutputMix_openDevice(COutputMix *outputMix)
+{
+    IEngine *thisEngine = &outputMix->mObject.mEngine->mEngine;
+    // const after the engine is created, no lock needed
+    SLuint32 device = thisEngine->mDevice;
+    if (SL_DESKTOP_DEVICE_AUDIO == device) {
+        // SDL has a single device, which renders the output mix of the engine, see SDL_callback
+        return SL_RESULT_SUCCESS;
+    }
+    interface_lock_exclusive(thisEngine);
+    SLuint32 freeZones = ~thisEngine->mZoneMask;
+    if (0 == freeZones) {
+        interface_unlock_exclusive(thisEngine);
+        SL_LOGE("unable to realize output mix; all %u devices are in use", DEVICE_MAX_ZONES);
+        return SL_RESULT_RESOURCE_ERROR;
+    }
+    outputMix->mZone = ctz(freeZones);
+    thisEngine->mZoneMask |= (SLuint32) 1 << outputMix->mZone;
+    interface_unlock_exclusive(thisEngine);
+    SLresult result;
+    switch (device) {
+#ifdef USE_ALSA
+    case SL_DESKTOP_DEVICE_ALSA:
+        result = AlsaDevice_open(outputMix);
+        break;
+#endif
+    default:
+        result = NullDevice_open(outputMix);
+        break;
+    }
+    if (SL_RESULT_SUCCESS != result) {
+        interface_lock_exclusive(thisEngine);
+        thisEngine->mZoneMask &= ~((SLuint32) 1 << outputMix->mZone);
+        interface_unlock_exclusive(thisEngine);
+    }
+    return result;
+}
+
+
+/** \brief Stop the device of the output mix if it was started, and free its zone.  Called with
+ *  the output mix unlocked, as the device might be waiting for the lock to finish a period.
+ */
+
+static void COutputMix_closeDevice(COutputMix *outputMix)
+{
+    IEngine *thisEngine = &outputMix->mObject.mEngine->mEngine;
+    SLboolean started = outputMix->mNullDevice.mStarted;
+    NullDevice_close(outputMix);
+#ifdef USE_ALSA
+    started = started || outputMix->mAlsaDevice.mStarted;
+    AlsaDevice_close(outputMix);
+#endif
+    if (started) {
+        interface_lock_exclusive(thisEngine);
+        thisEngine->mZoneMask &= ~((SLuint32) 1 << outputMix->mZone);
+        interface_unlock_exclusive(thisEngine);
+    }
+}
+
+#endif
+
+
 /** \brief Hook called by Object::Realize when an output mix is realized */
 
 SLresult COutputMix_Realize(void *self, SLboolean async)
@@ -30,6 +99,31 @@ SLresult COutputMix_Realize(void *self, SLboolean async)
     result = android_outputMix_realize(thiz, async);
 #endif
 
+#ifdef USE_OUTPUTMIXEXT
+    COutputMix *outputMix = (COutputMix *) self;
+    // const after the engine is created, no lock needed
+    SLuint32 mixerThreads = outputMix->mObject.mEngine->mEngine.mMixerThreads;
+    // the workers would call back the application from several threads at once, so their
+    // callbacks are always deferred to the callback thread, and they can't run without it
+    if (0 < mixerThreads || outputMix->mObject.mEngine->mEngine.mDeferredCallbacks) {
+        IOutputMixExt_startDispatcher(outputMix);
+    }
+    if (0 < mixerThreads) {
+        if (NULL != outputMix->mOutputMixExt.mDispatcher) {
+            IOutputMixExt_startWorkers(outputMix, mixerThreads);
+        } else {
+            SL_LOGW("no callback thread for %u mixer workers, mixing serially", mixerThreads);
+        }
+    }
+    outputMix->mOutputMixExt.mMaxVoices = outputMix->mObject.mEngine->mEngine.mMaxVoices;
+    // the device starts pulling periods as soon as it is open, so it is opened last
+    result = COutputMix_openDevice(outputMix);
+    if (SL_RESULT_SUCCESS != result) {
+        // the object goes back to unrealized, and so must its threads
+        IOutputMixExt_stopThreads(outputMix);
+    }
+#endif
+
     return result;
 }
 
@@ -53,6 +147,33 @@ void COutputMix_Destroy(void *self)
 }
 
 
+#ifdef USE_OUTPUTMIXEXT
+
+/** \brief Return another output mix of the engine for the device to render, or NULL if there is
+ *  none.  Called with the engine locked.
+ */
+
+static COutputMix *COutputMix_next(IEngine *thisEngine)
+{
+    unsigned group;
+    for (group = 0; group < MAX_INSTANCE_GROUPS; ++group) {
+        unsigned mask = thisEngine->mInstanceMasks[group];
+        while (0 != mask) {
+            unsigned i = group * INSTANCE_GROUP + ctz(mask);
+            mask &= mask - 1;
+            IObject *object = thisEngine->mInstances[i];
+            if (SL_OBJECTID_OUTPUTMIX == IObjectToObjectID(object) &&
+                    !((COutputMix *) object)->mOutputMixExt.mDestroying) {
+                return (COutputMix *) object;
+            }
+        }
+    }
+    return NULL;
+}
+
+#endif
+
+
 /** \brief Hook called by Object::Destroy before an output mix is about to be destroyed */
 
 predestroy_t COutputMix_PreDestroy(void *self)
@@ -62,26 +183,24 @@ predestroy_t COutputMix_PreDestroy(void *self)
     // See design document for explanation
     if (0 == outputMix->mObject.mStrongRefCount) {
 #ifdef USE_OUTPUTMIXEXT
-        // We only support a single active output mix per engine, so check if this is the active mix
+        // If the device is rendering this output mix, then switch it to another one without
+        // pausing, and wait until the device can no longer be using this one
         IEngine *thisEngine = &outputMix->mObject.mEngine->mEngine;
         interface_lock_exclusive(thisEngine);
+        outputMix->mOutputMixExt.mDestroying = SL_BOOLEAN_TRUE;
         bool thisIsTheActiveOutputMix = false;
         if (outputMix == thisEngine->mOutputMix) {
+            atomic_store_release(&thisEngine->mOutputMix, COutputMix_next(thisEngine));
             thisIsTheActiveOutputMix = true;
         }
         interface_unlock_exclusive(thisEngine);
         if (thisIsTheActiveOutputMix) {
-            // Tell the asynchronous mixer callback that we want to destroy the output mix
-            outputMix->mOutputMixExt.mDestroyRequested = true;
-            while (outputMix->mOutputMixExt.mDestroyRequested) {
-                object_cond_wait(&outputMix->mObject);
-            }
-#ifdef USE_SDL
-            // Mixer callback has acknowledged our request and unlinked output mix from engine.
-            // Disable SDL_callback from being called periodically by SDL's internal thread.
-            SDL_PauseAudio(1);
-#endif
+            IOutputMixExt_synchronize(thisEngine, outputMix);
         }
+        // Then stop the output mix's own device, if it has one
+        object_unlock_exclusive(&outputMix->mObject);
+        COutputMix_closeDevice(outputMix);
+        object_lock_exclusive(&outputMix->mObject);
 #endif
         return predestroy_ok;
     }
@@ -88,6 +88,10 @@ const SLInterfaceID SL_IID_ANDROIDAUTOMATICGAINCONTROL =
         &SL_IID_array[MPH_ANDROIDAUTOMATICGAINCONTROL];
 const SLInterfaceID SL_IID_ANDROIDNOISESUPPRESSION = &SL_IID_array[MPH_ANDROIDNOISESUPPRESSION];
 
+// Wilhelm desktop extended interfaces, continued
+extern const SLInterfaceID SL_IID_DESKTOPSTATISTICS;
+const SLInterfaceID SL_IID_DESKTOPSTATISTICS = &SL_IID_array[MPH_DESKTOPSTATISTICS];
+
 #ifdef __cplusplus
 }
 #endif
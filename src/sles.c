@@ -250,6 +250,7 @@ extern void
     IAudioIODeviceCapabilities_init(void *),
     IBassBoost_init(void *),
     IBufferQueue_init(void *),
+    IDesktopStatistics_init(void *),
     IDeviceVolume_init(void *),
     IDynamicInterfaceManagement_init(void *),
     IDynamicSource_init(void *),
@@ -298,9 +299,11 @@ extern void
     IEnvironmentalReverb_deinit(void *),
     IEqualizer_deinit(void *),
     IObject_deinit(void *),
+    IOutputMixExt_deinit(void *),
     IPresetReverb_deinit(void *),
     IThreadSync_deinit(void *),
-    IVirtualizer_deinit(void *);
+    IVirtualizer_deinit(void *),
+    IVisualization_deinit(void *);
 
 extern bool
     IAndroidAcousticEchoCancellation_Expose(void *),
@@ -313,6 +316,13 @@ extern bool
     IPresetReverb_Expose(void *),
     IVirtualizer_Expose(void *);
 
+extern void
+    IBassBoost_Remove(void *),
+    IEnvironmentalReverb_Remove(void *),
+    IEqualizer_Remove(void *),
+    IPresetReverb_Remove(void *),
+    IVirtualizer_Remove(void *);
+
 extern void
     IXAEngine_init(void *),
     IStreamInformation_init(void*),
@@ -330,6 +340,7 @@ extern bool
 #define IDynamicSource_init         NULL
 #define IMetadataTraversal_init     NULL
 #define IVisualization_init         NULL
+#define IVisualization_deinit       NULL
 #endif
 
 #if !(USE_PROFILES & USE_PROFILES_GAME)
@@ -380,6 +391,13 @@ extern bool
 
 #ifndef USE_OUTPUTMIXEXT
 #define IOutputMixExt_init  NULL
+#define IOutputMixExt_deinit NULL
+#define IDesktopStatistics_init NULL
+#define IBassBoost_Remove   NULL
+#define IEnvironmentalReverb_Remove NULL
+#define IEqualizer_Remove   NULL
+#define IPresetReverb_Remove NULL
+#define IVirtualizer_Remove NULL
 #endif
 
 
@@ -395,7 +413,8 @@ extern bool
     { /* MPH_AUDIOENCODERCAPABILITIES, */ IAudioEncoderCapabilities_init, NULL, NULL, NULL, NULL },
     { /* MPH_AUDIOIODEVICECAPABILITIES, */ IAudioIODeviceCapabilities_init, NULL, NULL, NULL,
         NULL },
-    { /* MPH_BASSBOOST, */ IBassBoost_init, NULL, IBassBoost_deinit, IBassBoost_Expose, NULL },
+    { /* MPH_BASSBOOST, */ IBassBoost_init, NULL, IBassBoost_deinit, IBassBoost_Expose,
+        IBassBoost_Remove },
     { /* MPH_BUFFERQUEUE, */ IBufferQueue_init, NULL, IBufferQueue_deinit, NULL, NULL },
     { /* MPH_DEVICEVOLUME, */ IDeviceVolume_init, NULL, NULL, NULL, NULL },
     { /* MPH_DYNAMICINTERFACEMANAGEMENT, */ IDynamicInterfaceManagement_init, NULL, NULL, NULL,
@@ -405,8 +424,9 @@ extern bool
     { /* MPH_ENGINE, */ IEngine_init, NULL, IEngine_deinit, NULL, NULL },
     { /* MPH_ENGINECAPABILITIES, */ IEngineCapabilities_init, NULL, NULL, NULL, NULL },
     { /* MPH_ENVIRONMENTALREVERB, */ IEnvironmentalReverb_init, NULL, IEnvironmentalReverb_deinit,
-        IEnvironmentalReverb_Expose, NULL },
-    { /* MPH_EQUALIZER, */ IEqualizer_init, NULL, IEqualizer_deinit, IEqualizer_Expose, NULL },
+        IEnvironmentalReverb_Expose, IEnvironmentalReverb_Remove },
+    { /* MPH_EQUALIZER, */ IEqualizer_init, NULL, IEqualizer_deinit, IEqualizer_Expose,
+        IEqualizer_Remove },
     { /* MPH_LED, */ ILEDArray_init, NULL, NULL, NULL, NULL },
     { /* MPH_METADATAEXTRACTION, */ IMetadataExtraction_init, NULL, NULL, NULL, NULL },
     { /* MPH_METADATATRAVERSAL, */ IMetadataTraversal_init, NULL, NULL, NULL, NULL },
@@ -423,18 +443,18 @@ extern bool
     { /* MPH_PLAYBACKRATE, */ IPlaybackRate_init, NULL, NULL, NULL, NULL },
     { /* MPH_PREFETCHSTATUS, */ IPrefetchStatus_init, NULL, NULL, NULL, NULL },
     { /* MPH_PRESETREVERB, */ IPresetReverb_init, NULL, IPresetReverb_deinit,
-        IPresetReverb_Expose, NULL },
+        IPresetReverb_Expose, IPresetReverb_Remove },
     { /* MPH_RATEPITCH, */ IRatePitch_init, NULL, NULL, NULL, NULL },
     { /* MPH_RECORD, */ IRecord_init, NULL, NULL, NULL, NULL },
     { /* MPH_SEEK, */ ISeek_init, NULL, NULL, NULL, NULL },
     { /* MPH_THREADSYNC, */ IThreadSync_init, NULL, IThreadSync_deinit, NULL, NULL },
     { /* MPH_VIBRA, */ IVibra_init, NULL, NULL, NULL, NULL },
     { /* MPH_VIRTUALIZER, */ IVirtualizer_init, NULL, IVirtualizer_deinit, IVirtualizer_Expose,
-        NULL },
-    { /* MPH_VISUALIZATION, */ IVisualization_init, NULL, NULL, NULL, NULL },
+        IVirtualizer_Remove },
+    { /* MPH_VISUALIZATION, */ IVisualization_init, NULL, IVisualization_deinit, NULL, NULL },
     { /* MPH_VOLUME, */ IVolume_init, NULL, NULL, NULL, NULL },
 // Wilhelm desktop extended interfaces
-    { /* MPH_OUTPUTMIXEXT, */ IOutputMixExt_init, NULL, NULL, NULL, NULL },
+    { /* MPH_OUTPUTMIXEXT, */ IOutputMixExt_init, NULL, IOutputMixExt_deinit, NULL, NULL },
 // Android API level 9 extended interfaces
     { /* MPH_ANDROIDEFFECT */ IAndroidEffect_init, NULL, IAndroidEffect_deinit, NULL, NULL },
     { /* MPH_ANDROIDEFFECTCAPABILITIES */ IAndroidEffectCapabilities_init, NULL,
@@ -495,6 +515,8 @@ extern bool
             IAndroidAutomaticGainControl_deinit, IAndroidAutomaticGainControl_Expose, NULL },
     { /* MPH_ANDROIDNOISESUPPRESSION, */ IAndroidNoiseSuppression_init, NULL,
             IAndroidNoiseSuppression_deinit, IAndroidNoiseSuppression_Expose, NULL },
+// Wilhelm desktop extended interfaces, continued
+    { /* MPH_DESKTOPSTATISTICS, */ IDesktopStatistics_init, NULL, NULL, NULL, NULL },
 };
 
 
@@ -522,9 +544,9 @@ IObject *construct(const ClassTable *clazz, unsigned exposedMask, SLEngineItf en
                 free(thiz);
                 return NULL;
             }
-            // pre-allocate a pending slot, but don't assign bit from mInstanceMask yet
+            // pre-allocate a pending slot, but don't assign bit from mInstanceMasks yet
             ++thisEngine->mInstanceCount;
-            assert(((unsigned) ~0) != thisEngine->mInstanceMask);
+            assert(((unsigned) ~0) != thisEngine->mFullMask);
             interface_unlock_exclusive(thisEngine);
             // const, no lock needed
             if (thisEngine->mLossOfControlGlobal) {
@@ -22,6 +22,9 @@
 #include <SLES/OpenSLES_Android.h>
 #include <OMXAL/OpenMAXAL_Android.h>
 #endif
+#ifdef USE_OUTPUTMIXEXT
+#include <SLES/OpenSLES_Desktop.h>
+#endif
 #include <stddef.h> // offsetof
 #include <stdlib.h> // malloc
 #include <string.h> // memcmp
@@ -63,6 +66,7 @@ typedef struct CEngine_struct CEngine;
 typedef struct CAudioPlayer_struct CAudioPlayer;
 typedef struct CAudioRecorder_struct CAudioRecorder;
 typedef struct C3DGroup_struct C3DGroup;
+typedef struct CListener_struct CListener;
 typedef struct COutputMix_struct COutputMix;
 
 #ifdef USE_SNDFILE
@@ -74,8 +78,18 @@ typedef struct COutputMix_struct COutputMix;
 #include <SDL/SDL_audio.h>
 #endif // USE_SDL
 
+#ifdef USE_ALSA
+#include <alsa/asoundlib.h>
+#endif // USE_ALSA
+
 #define STEREO_CHANNELS 2
 
+// indexes into IEffectSend.mEnableLevels, and of the aux buses of the mixer
+
+#define AUX_ENVIRONMENTALREVERB 0
+#define AUX_PRESETREVERB        1
+#define AUX_MAX                 2
+
 /**
  * Constants to define unknown property values
  */
@@ -98,6 +112,11 @@ typedef struct COutputMix_struct COutputMix;
 #endif
 
 #ifdef USE_OUTPUTMIXEXT
+#include "desktop/mixer.h"
+#include "desktop/resampler.h"
+#include "desktop/reverb.h"
+#include "desktop/stretch.h"
+#include "desktop/forkjoin.h"
 #include "desktop/OutputMixExt.h"
 #endif
 
@@ -197,7 +216,7 @@ typedef predestroy_t (*PreDestroyHook)(void *self);
 struct iid_vtable {
     unsigned char mMPH;         // primary MPH for this interface, does not include any aliases
     unsigned char mInterface;   // relationship of interface to this class
-    /*size_t*/ unsigned short mOffset;
+    size_t mOffset;     // of the interface within the object, which may exceed 64 KiB
 };
 
 // Per-class const data shared by all instances of the same class
@@ -223,6 +242,9 @@ typedef struct {
 typedef struct {
     const void *mBuffer;
     SLuint32 mSize;
+#ifdef USE_OUTPUTMIXEXT
+    SLboolean mSilent;  // whether every sample is silence, so the mixer need not read the buffer
+#endif
 } BufferHeader;
 
 #ifdef ANDROID
@@ -273,11 +295,79 @@ struct SndFile {
     pthread_mutex_t mMutex; // protects mSNDFILE only
     SLboolean mEOF;         // sf_read returned zero sample frames
     SLuint32 mWhich;        // which buffer to use next
+    slesutPcmFormat mFormat; // sample format of the raw data in mBuffer
     short mBuffer[SndFile_BUFSIZE * SndFile_NUMBUFS];
 };
 
 #endif // USE_SNDFILE
 
+#ifdef USE_OUTPUTMIXEXT
+
+/** \brief Renders the output mix at a virtual clock, see desktop/NullDevice.c */
+
+typedef struct {
+    pthread_t mThread;
+    SLboolean mStarted;         // whether mThread was created
+    SLboolean mShutdown;        // set by NullDevice_close, read atomically by mThread
+#ifdef USE_SNDFILE
+    SNDFILE *mSNDFILE;          // for SL_DESKTOP_DEVICE_WAVFILE, otherwise NULL
+#endif
+    unsigned long long mFrames; // virtual clock, in frames rendered
+    short *mBuffer;             // one period, allocated by NullDevice_open
+} NullDevice;
+
+#define DEVICE_PERIOD_FRAMES 256        // default of SL_DESKTOP_ENGINEOPTION_PERIODFRAMES
+#define DEVICE_MAX_PERIOD_FRAMES 65536  // limit of SL_DESKTOP_ENGINEOPTION_PERIODFRAMES
+#define DEVICE_PERIODS 2                // default of SL_DESKTOP_ENGINEOPTION_PERIODS
+#define DEVICE_MAX_PERIODS 32           // limit of SL_DESKTOP_ENGINEOPTION_PERIODS
+#define DEVICE_SAMPLERATE 44100         // default of SL_DESKTOP_ENGINEOPTION_SAMPLERATE, in Hz
+#define DEVICE_MIN_SAMPLERATE 8000      // limits of SL_DESKTOP_ENGINEOPTION_SAMPLERATE
+#define DEVICE_MAX_SAMPLERATE 192000
+#define DEVICE_MAX_CHANNELS 8           // limit of SL_DESKTOP_ENGINEOPTION_CHANNELS
+#define DEVICE_MAX_ZONES 32             // output mixes with their own device, see COutputMix::mZone
+
+#ifdef USE_ALSA
+
+/** \brief Renders the output mix into the ring buffer of an ALSA PCM, see desktop/ALSA.c */
+
+typedef struct {
+    snd_pcm_t *mPcm;            // NULL until opened
+    pthread_t mThread;
+    SLboolean mStarted;         // whether mThread was created
+    SLboolean mShutdown;        // set by AlsaDevice_close, read atomically by mThread
+    snd_pcm_uframes_t mPeriodFrames;    // as configured by the device
+    snd_pcm_uframes_t mBufferFrames;    // likewise
+    unsigned long long mFrames; // frames rendered
+    unsigned mXruns;            // underruns and suspends recovered from
+} AlsaDevice;
+
+#endif // USE_ALSA
+
+/** \brief Captures into the buffer queue of an audio recorder, see desktop/Capture.c */
+
+typedef struct {
+    pthread_t mThread;
+    SLboolean mStarted;         // whether mThread was created
+    SLboolean mShutdown;        // set by CaptureDevice_close when locked, read atomically
+#ifdef USE_SNDFILE
+    SNDFILE *mSNDFILE;          // source for the null devices, or NULL to capture silence
+#endif
+#ifdef USE_ALSA
+    snd_pcm_t *mPcm;            // source for the sound card, or NULL
+#endif
+    SLuint32 mPeriodFrames;     // frames captured at a time
+    void *mScratch;             // one period, for frames which are dropped or converted
+    // only accessed with the audio recorder locked
+    SLuint32 mOffset;           // bytes captured into the buffer at the front of the queue
+    unsigned long long mFrames; // frames recorded since recording started from stopped
+    SLuint32 mFramesSincePositionUpdate;    // for SL_RECORDEVENT_HEADATNEWPOS
+    SLboolean mStalled;         // whether captured frames are being dropped
+    unsigned long long mDropped;    // frames captured with nowhere to put them
+    unsigned mOverruns;         // times frames started to be dropped
+} CaptureDevice;
+
+#endif // USE_OUTPUTMIXEXT
+
 #include "data.h"
 #include "itfstruct.h"
 #include "classes.h"
@@ -361,10 +451,27 @@ extern void CMediaPlayer_Destroy(void *self);
 extern predestroy_t CMediaPlayer_PreDestroy(void *self);
 
 #ifdef USE_SDL
-extern void SDL_open(IEngine *thisEngine);
+extern SLresult SDL_open(IEngine *thisEngine);
 extern void SDL_close(void);
 #endif
 
+#ifdef USE_OUTPUTMIXEXT
+extern SLboolean IOutputMixExt_render(IEngine *thisEngine, void *pBuffer, SLuint32 size);
+extern void IOutputMixExt_synchronize(IEngine *thisEngine, COutputMix *replaced);
+extern SLresult NullDevice_open(COutputMix *outputMix);
+extern void NullDevice_close(COutputMix *outputMix);
+#ifdef USE_ALSA
+extern SLresult AlsaDevice_open(COutputMix *outputMix);
+extern void AlsaDevice_close(COutputMix *outputMix);
+extern int AlsaDevice_startThread(pthread_t *thread, void *(*run)(void *), void *arg,
+    SLuint32 priority);
+#endif
+extern SLresult CaptureDevice_checkSourceSink(CAudioRecorder *audioRecorder);
+extern SLresult CaptureDevice_open(CAudioRecorder *audioRecorder);
+extern void CaptureDevice_close(CAudioRecorder *audioRecorder);
+extern void audioRecorderStateUpdate(CAudioRecorder *audioRecorder, SLuint32 oldState);
+#endif
+
 #define SL_OBJECT_STATE_REALIZING_1  ((SLuint32) 0x4) // async realize on work queue
 #define SL_OBJECT_STATE_REALIZING_2  ((SLuint32) 0x5) // sync realize, or async realize hook
 #define SL_OBJECT_STATE_RESUMING_1   ((SLuint32) 0x6) // async resume on work queue
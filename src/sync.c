@@ -42,25 +42,40 @@ void *sync_start(void *arg)
             object_unlock_exclusive(&thiz->mObject);
             break;
         }
-        if (thiz->m3DCommit.mWaiting) {
-            thiz->m3DCommit.mWaiting = 0;
-            ++thiz->m3DCommit.mGeneration;
-            // There might be more than one thread blocked in Commit, so wake them all
-            object_cond_broadcast(&thiz->mObject);
-            // here is where we would process the enqueued 3D commands
+        unsigned changedGroupMask = thiz->mEngine.mChangedGroupMask;
+        thiz->mEngine.mChangedGroupMask = 0;
+        unsigned changedMasks[MAX_INSTANCE_GROUPS];
+        unsigned groupMask = changedGroupMask;
+        while (groupMask) {
+            unsigned group = ctz(groupMask);
+            groupMask &= groupMask - 1;
+            changedMasks[group] = thiz->mEngine.mChangedMasks[group];
+            thiz->mEngine.mChangedMasks[group] = 0;
         }
-        // unsigned instanceMask = thiz->mEngine.mInstanceMask; // for debugger
-        unsigned changedMask = thiz->mEngine.mChangedMask;
-        thiz->mEngine.mChangedMask = 0;
         object_unlock_exclusive(&thiz->mObject);
 
+#ifdef USE_OUTPUTMIXEXT
+        IDesktopStatistics_sync(thiz);
+#endif
+
         // now we know which objects exist, and which of those have changes
 
-        unsigned combinedMask = changedMask /* | instanceMask for debugger */;
-        while (combinedMask) {
-            unsigned i = ctz(combinedMask);
+        // visit the changed objects one group at a time
+        unsigned group = 0;
+        unsigned combinedMask = 0;
+        for (;;) {
+            if (0 == combinedMask) {
+                if (0 == changedGroupMask) {
+                    break;
+                }
+                group = ctz(changedGroupMask);
+                changedGroupMask &= changedGroupMask - 1;
+                combinedMask = changedMasks[group];
+                continue;
+            }
+            unsigned i = group * INSTANCE_GROUP + ctz(combinedMask);
             assert(MAX_INSTANCE > i);
-            combinedMask &= ~(1 << i);
+            combinedMask &= combinedMask - 1;
             IObject *instance = (IObject *) thiz->mEngine.mInstances[i];
             // Could be NULL during construct or destroy
             if (NULL == instance) {
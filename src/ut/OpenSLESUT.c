@@ -20,6 +20,9 @@
 #ifdef ANDROID
 #include <SLES/OpenSLES_Android.h>
 #endif
+#ifdef USE_OUTPUTMIXEXT
+#include <SLES/OpenSLES_Desktop.h>
+#endif
 #include "OpenSLESUT.h"
 #include <stdio.h>
 #include <string.h>
@@ -88,6 +91,9 @@ static Pair pairs[] = {
 #if 0 // ifdef USE_OUTPUTMIXEXT
     _(OUTPUTMIXEXT),
 #endif
+#ifdef USE_OUTPUTMIXEXT
+    _(DESKTOPSTATISTICS),
+#endif
 #ifdef ANDROID
     _(ANDROIDEFFECT),
     _(ANDROIDEFFECTCAPABILITIES),
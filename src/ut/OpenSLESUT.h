@@ -24,6 +24,38 @@ extern void slesutPrintIID(SLInterfaceID iid);
 extern const char *slesutResultToString(SLresult result);
 extern const char *slesutObjectIDToString(SLuint32 objectID);
 
+/** \brief Sample formats of linear PCM, in order of increasing width */
+
+typedef enum {
+    SLESUT_PCM_INVALID = 0,
+    SLESUT_PCM_U8,          ///< 8-bit unsigned
+    SLESUT_PCM_S16,         ///< 16-bit signed
+    SLESUT_PCM_S24_PACKED,  ///< 24-bit signed in 3 bytes
+    SLESUT_PCM_S32,         ///< 32-bit signed
+    SLESUT_PCM_FLOAT        ///< 32-bit float, full scale is +/-1.0
+} slesutPcmFormat;
+
+/** \brief Probability density of the noise added when converting to fewer bits */
+
+typedef enum {
+    SLESUT_DITHER_NONE = 0,         ///< Round to nearest
+    SLESUT_DITHER_RECTANGULAR = 1,  ///< +/-0.5 LSB uniform
+    SLESUT_DITHER_TRIANGULAR = 2    ///< +/-1 LSB triangular, no noise modulation
+} slesutDither;
+
+/** \brief State of the dither noise generator, one per stream */
+
+typedef struct {
+    SLuint32 mLanes[8];
+} slesutDitherState;
+
+extern slesutPcmFormat slesutPcmFormatOf(const SLDataFormat_PCM *format);
+extern unsigned slesutPcmSampleSize(slesutPcmFormat format);
+extern void slesutDitherInit(slesutDitherState *state, SLuint32 seed);
+extern void slesutPcmConvert(void *dst, slesutPcmFormat dstFormat, const void *src,
+    slesutPcmFormat srcFormat, unsigned samples, slesutDither dither, slesutDitherState *state);
+extern SLboolean slesutPcmIsSilent(const void *src, slesutPcmFormat format, unsigned samples);
+
 #ifdef __cplusplus
 }
 #endif
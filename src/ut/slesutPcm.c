@@ -0,0 +1,715 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file slesutPcm.c Linear PCM sample format conversion */
+
+#include <SLES/OpenSLES.h>
+#include <SLES/OpenSLES_Android.h>
+#include "OpenSLESUT.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#define PCM_X86
+#endif
+
+// Every conversion goes through normalized float, where full scale is +/-1.0, so each format
+// only needs a kernel to decode to float and a kernel to encode from float.  This is exact
+// for all widening conversions, as float has a 24-bit mantissa; 32-bit integer samples keep
+// their top 24 significant bits.  Samples are little-endian, which is the native byte order
+// of every platform we run on.
+
+#define BLOCK_SAMPLES 256   // samples converted per pass through the intermediate float buffer
+
+#define U8_TO_FLOAT  (1.0f / 128.0f)
+#define S16_TO_FLOAT (1.0f / 32768.0f)
+#define S24_TO_FLOAT (1.0f / 8388608.0f)
+#define S32_TO_FLOAT (1.0f / 2147483648.0f)
+#define FLOAT_TO_U8  128.0f
+#define FLOAT_TO_S16 32768.0f
+#define FLOAT_TO_S24 8388608.0f
+#define FLOAT_TO_S32 2147483648.0f
+// the largest float which converts to a 32-bit integer without overflow
+#define S32_MAX_FLOAT 2147483520.0f
+
+
+/** \brief Decode samples to normalized float */
+typedef void (*PcmDecode)(float *dst, const void *src, unsigned samples);
+
+/** \brief Encode normalized float samples, adding noise in units of the destination LSB if
+ *  non-NULL, with rounding to nearest and clamping to full scale
+ */
+typedef void (*PcmEncode)(void *dst, const float *src, const float *noise, unsigned samples);
+
+/** \brief Generate dither noise in units of LSB; sample i is drawn from lane i % 8 */
+typedef void (*PcmNoise)(float *noise, unsigned samples, slesutDither dither,
+    slesutDitherState *state);
+
+/** \brief v-table for one implementation of the conversion kernels, indexed by format */
+
+typedef struct {
+    PcmDecode mDecode[SLESUT_PCM_FLOAT];
+    PcmEncode mEncode[SLESUT_PCM_FLOAT];
+    PcmNoise mNoise;
+} PcmKernels;
+
+
+// Portable scalar kernels, also used for the tail of each vectorized kernel.
+// They use the same operations in the same order as the vector kernels, so the results are
+// identical, including the dither noise.
+
+static void decode_u8_scalar(float *dst, const void *src, unsigned samples)
+{
+    const uint8_t *s = (const uint8_t *) src;
+    for ( ; samples > 0; --samples) {
+        *dst++ = (float) ((int) *s++ - 128) * U8_TO_FLOAT;
+    }
+}
+
+static void decode_s16_scalar(float *dst, const void *src, unsigned samples)
+{
+    const int16_t *s = (const int16_t *) src;
+    for ( ; samples > 0; --samples) {
+        *dst++ = (float) *s++ * S16_TO_FLOAT;
+    }
+}
+
+static void decode_s24_scalar(float *dst, const void *src, unsigned samples)
+{
+    const uint8_t *s = (const uint8_t *) src;
+    for ( ; samples > 0; --samples, s += 3) {
+        // assemble in the upper 24 bits, so the arithmetic shift sign-extends
+        int32_t x = (int32_t) (((uint32_t) s[0] << 8) | ((uint32_t) s[1] << 16) |
+            ((uint32_t) s[2] << 24)) >> 8;
+        *dst++ = (float) x * S24_TO_FLOAT;
+    }
+}
+
+static void decode_s32_scalar(float *dst, const void *src, unsigned samples)
+{
+    const int32_t *s = (const int32_t *) src;
+    for ( ; samples > 0; --samples) {
+        *dst++ = (float) *s++ * S32_TO_FLOAT;
+    }
+}
+
+/** \brief Scale, add the noise, clamp, and round to nearest */
+
+static inline int32_t encode_sample(float x, float scale, const float *noise, unsigned i,
+    float low, float high)
+{
+    x *= scale;
+    if (NULL != noise) {
+        x += noise[i];
+    }
+    // written so that NaN clamps to high, as the vector min and max do
+    x = x < high ? x : high;
+    x = x > low ? x : low;
+    return (int32_t) lrintf(x);
+}
+
+static void encode_u8_scalar(void *dst, const float *src, const float *noise, unsigned samples)
+{
+    uint8_t *d = (uint8_t *) dst;
+    unsigned i;
+    for (i = 0; i < samples; ++i) {
+        d[i] = (uint8_t) (encode_sample(src[i], FLOAT_TO_U8, noise, i, -128.0f, 127.0f) + 128);
+    }
+}
+
+static void encode_s16_scalar(void *dst, const float *src, const float *noise, unsigned samples)
+{
+    int16_t *d = (int16_t *) dst;
+    unsigned i;
+    for (i = 0; i < samples; ++i) {
+        d[i] = (int16_t) encode_sample(src[i], FLOAT_TO_S16, noise, i, -32768.0f, 32767.0f);
+    }
+}
+
+static void encode_s24_scalar(void *dst, const float *src, const float *noise, unsigned samples)
+{
+    uint8_t *d = (uint8_t *) dst;
+    unsigned i;
+    for (i = 0; i < samples; ++i, d += 3) {
+        int32_t x = encode_sample(src[i], FLOAT_TO_S24, noise, i, -8388608.0f, 8388607.0f);
+        d[0] = (uint8_t) x;
+        d[1] = (uint8_t) (x >> 8);
+        d[2] = (uint8_t) (x >> 16);
+    }
+}
+
+static void encode_s32_scalar(void *dst, const float *src, const float *noise, unsigned samples)
+{
+    int32_t *d = (int32_t *) dst;
+    unsigned i;
+    for (i = 0; i < samples; ++i) {
+        d[i] = encode_sample(src[i], FLOAT_TO_S32, noise, i, -FLOAT_TO_S32, S32_MAX_FLOAT);
+    }
+}
+
+/** \brief One step of a xorshift32 generator, and a uniform float in [-0.5, 0.5) from it */
+
+static inline float noise_draw(uint32_t *lane)
+{
+    uint32_t x = *lane;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *lane = x;
+    // 23 random bits in the mantissa of a float in [1.0, 2.0)
+    union {
+        uint32_t i;
+        float f;
+    } u;
+    u.i = (x >> 9) | 0x3F800000;
+    return u.f - 1.5f;
+}
+
+static void noise_scalar(float *noise, unsigned samples, slesutDither dither,
+    slesutDitherState *state)
+{
+    unsigned i;
+    for (i = 0; i < samples; ++i) {
+        uint32_t *lane = &state->mLanes[i & 7];
+        float n = noise_draw(lane);
+        if (SLESUT_DITHER_TRIANGULAR == dither) {
+            n += noise_draw(lane);
+        }
+        noise[i] = n;
+    }
+}
+
+static const PcmKernels PcmKernels_scalar = {
+    {NULL, decode_u8_scalar, decode_s16_scalar, decode_s24_scalar, decode_s32_scalar},
+    {NULL, encode_u8_scalar, encode_s16_scalar, encode_s24_scalar, encode_s32_scalar},
+    noise_scalar
+};
+
+
+#ifdef PCM_X86
+
+// SSE2 kernels, 4 or more samples per iteration.  The packed 24-bit format needs a byte
+// shuffle, which SSE2 doesn't have, so it stays scalar here.
+
+__attribute__((target("sse2")))
+static void decode_u8_sse2(float *dst, const void *src, unsigned samples)
+{
+    const uint8_t *s = (const uint8_t *) src;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi32(128);
+    const __m128 scale = _mm_set1_ps(U8_TO_FLOAT);
+    for ( ; samples >= 8; samples -= 8, s += 8, dst += 8) {
+        __m128i x = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) s), zero);
+        __m128i lo = _mm_sub_epi32(_mm_unpacklo_epi16(x, zero), bias);
+        __m128i hi = _mm_sub_epi32(_mm_unpackhi_epi16(x, zero), bias);
+        _mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    decode_u8_scalar(dst, s, samples);
+}
+
+__attribute__((target("sse2")))
+static void decode_s16_sse2(float *dst, const void *src, unsigned samples)
+{
+    const int16_t *s = (const int16_t *) src;
+    const __m128 scale = _mm_set1_ps(S16_TO_FLOAT);
+    for ( ; samples >= 8; samples -= 8, s += 8, dst += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *) s);
+        // sign-extend to 32 bits by duplicating each sample into the upper half then shifting down
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    decode_s16_scalar(dst, s, samples);
+}
+
+__attribute__((target("sse2")))
+static void decode_s32_sse2(float *dst, const void *src, unsigned samples)
+{
+    const int32_t *s = (const int32_t *) src;
+    const __m128 scale = _mm_set1_ps(S32_TO_FLOAT);
+    for ( ; samples >= 4; samples -= 4, s += 4, dst += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *) s);
+        _mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+    }
+    decode_s32_scalar(dst, s, samples);
+}
+
+/** \brief Scale, add the noise, clamp, and round to nearest, for 4 samples */
+
+__attribute__((target("sse2")))
+static inline __m128i encode_sse2(const float *src, const float *noise, __m128 scale,
+    __m128 low, __m128 high)
+{
+    __m128 x = _mm_mul_ps(_mm_loadu_ps(src), scale);
+    if (NULL != noise) {
+        x = _mm_add_ps(x, _mm_loadu_ps(noise));
+    }
+    return _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(x, high), low));
+}
+
+__attribute__((target("sse2")))
+static void encode_u8_sse2(void *dst, const float *src, const float *noise, unsigned samples)
+{
+    uint8_t *d = (uint8_t *) dst;
+    const __m128 scale = _mm_set1_ps(FLOAT_TO_U8);
+    const __m128 low = _mm_set1_ps(-128.0f);
+    const __m128 high = _mm_set1_ps(127.0f);
+    const __m128i bias = _mm_set1_epi16(128);
+    unsigned i;
+    for (i = 0; i + 8 <= samples; i += 8) {
+        const float *n = NULL != noise ? &noise[i] : NULL;
+        __m128i lo = encode_sse2(&src[i], n, scale, low, high);
+        __m128i hi = encode_sse2(&src[i + 4], NULL != n ? n + 4 : NULL, scale, low, high);
+        __m128i x = _mm_add_epi16(_mm_packs_epi32(lo, hi), bias);
+        _mm_storel_epi64((__m128i *) &d[i], _mm_packus_epi16(x, x));
+    }
+    encode_u8_scalar(&d[i], &src[i], NULL != noise ? &noise[i] : NULL, samples - i);
+}
+
+__attribute__((target("sse2")))
+static void encode_s16_sse2(void *dst, const float *src, const float *noise, unsigned samples)
+{
+    int16_t *d = (int16_t *) dst;
+    const __m128 scale = _mm_set1_ps(FLOAT_TO_S16);
+    const __m128 low = _mm_set1_ps(-32768.0f);
+    const __m128 high = _mm_set1_ps(32767.0f);
+    unsigned i;
+    for (i = 0; i + 8 <= samples; i += 8) {
+        const float *n = NULL != noise ? &noise[i] : NULL;
+        __m128i lo = encode_sse2(&src[i], n, scale, low, high);
+        __m128i hi = encode_sse2(&src[i + 4], NULL != n ? n + 4 : NULL, scale, low, high);
+        _mm_storeu_si128((__m128i *) &d[i], _mm_packs_epi32(lo, hi));
+    }
+    encode_s16_scalar(&d[i], &src[i], NULL != noise ? &noise[i] : NULL, samples - i);
+}
+
+__attribute__((target("sse2")))
+static void encode_s32_sse2(void *dst, const float *src, const float *noise, unsigned samples)
+{
+    int32_t *d = (int32_t *) dst;
+    const __m128 scale = _mm_set1_ps(FLOAT_TO_S32);
+    const __m128 low = _mm_set1_ps(-FLOAT_TO_S32);
+    const __m128 high = _mm_set1_ps(S32_MAX_FLOAT);
+    unsigned i;
+    for (i = 0; i + 4 <= samples; i += 4) {
+        _mm_storeu_si128((__m128i *) &d[i],
+            encode_sse2(&src[i], NULL != noise ? &noise[i] : NULL, scale, low, high));
+    }
+    encode_s32_scalar(&d[i], &src[i], NULL != noise ? &noise[i] : NULL, samples - i);
+}
+
+/** \brief One step of 4 lanes of xorshift32, and a uniform float in [-0.5, 0.5) from each */
+
+__attribute__((target("sse2")))
+static inline __m128 noise_draw_sse2(__m128i *lanes)
+{
+    __m128i x = *lanes;
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+    *lanes = x;
+    __m128i mantissa = _mm_or_si128(_mm_srli_epi32(x, 9), _mm_set1_epi32(0x3F800000));
+    return _mm_sub_ps(_mm_castsi128_ps(mantissa), _mm_set1_ps(1.5f));
+}
+
+__attribute__((target("sse2")))
+static void noise_sse2(float *noise, unsigned samples, slesutDither dither,
+    slesutDitherState *state)
+{
+    __m128i lanes0 = _mm_loadu_si128((const __m128i *) &state->mLanes[0]);
+    __m128i lanes1 = _mm_loadu_si128((const __m128i *) &state->mLanes[4]);
+    unsigned i;
+    for (i = 0; i + 8 <= samples; i += 8) {
+        __m128 n0 = noise_draw_sse2(&lanes0);
+        __m128 n1 = noise_draw_sse2(&lanes1);
+        if (SLESUT_DITHER_TRIANGULAR == dither) {
+            n0 = _mm_add_ps(n0, noise_draw_sse2(&lanes0));
+            n1 = _mm_add_ps(n1, noise_draw_sse2(&lanes1));
+        }
+        _mm_storeu_ps(&noise[i], n0);
+        _mm_storeu_ps(&noise[i + 4], n1);
+    }
+    _mm_storeu_si128((__m128i *) &state->mLanes[0], lanes0);
+    _mm_storeu_si128((__m128i *) &state->mLanes[4], lanes1);
+    noise_scalar(&noise[i], samples - i, dither, state);
+}
+
+static const PcmKernels PcmKernels_sse2 = {
+    {NULL, decode_u8_sse2, decode_s16_sse2, decode_s24_scalar, decode_s32_sse2},
+    {NULL, encode_u8_sse2, encode_s16_sse2, encode_s24_scalar, encode_s32_sse2},
+    noise_sse2
+};
+
+
+// AVX2 kernels, 8 or more samples per iteration.  Packed 24-bit samples are shuffled into or
+// out of 32-bit lanes 4 at a time, as 12 bytes don't split evenly over the 256-bit lanes.
+
+__attribute__((target("avx2")))
+static void decode_u8_avx2(float *dst, const void *src, unsigned samples)
+{
+    const uint8_t *s = (const uint8_t *) src;
+    const __m256i bias = _mm256_set1_epi32(128);
+    const __m256 scale = _mm256_set1_ps(U8_TO_FLOAT);
+    for ( ; samples >= 8; samples -= 8, s += 8, dst += 8) {
+        __m256i x = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) s));
+        _mm256_storeu_ps(dst, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(x, bias)),
+            scale));
+    }
+    decode_u8_scalar(dst, s, samples);
+}
+
+__attribute__((target("avx2")))
+static void decode_s16_avx2(float *dst, const void *src, unsigned samples)
+{
+    const int16_t *s = (const int16_t *) src;
+    const __m256 scale = _mm256_set1_ps(S16_TO_FLOAT);
+    for ( ; samples >= 8; samples -= 8, s += 8, dst += 8) {
+        __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) s));
+        _mm256_storeu_ps(dst, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+    }
+    decode_s16_scalar(dst, s, samples);
+}
+
+__attribute__((target("avx2")))
+static void decode_s24_avx2(float *dst, const void *src, unsigned samples)
+{
+    const uint8_t *s = (const uint8_t *) src;
+    // each sample goes to the upper 24 bits of a lane, and the arithmetic shift sign-extends
+    const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m128 scale = _mm_set1_ps(S24_TO_FLOAT);
+    // the 16-byte load reads 4 bytes beyond the 4 samples, so stop while 2 more samples remain
+    for ( ; samples >= 6; samples -= 4, s += 12, dst += 4) {
+        __m128i x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) s), shuffle);
+        _mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(x, 8)), scale));
+    }
+    decode_s24_scalar(dst, s, samples);
+}
+
+__attribute__((target("avx2")))
+static void decode_s32_avx2(float *dst, const void *src, unsigned samples)
+{
+    const int32_t *s = (const int32_t *) src;
+    const __m256 scale = _mm256_set1_ps(S32_TO_FLOAT);
+    for ( ; samples >= 8; samples -= 8, s += 8, dst += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) s);
+        _mm256_storeu_ps(dst, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+    }
+    decode_s32_scalar(dst, s, samples);
+}
+
+/** \brief Scale, add the noise, clamp, and round to nearest, for 8 samples */
+
+__attribute__((target("avx2")))
+static inline __m256i encode_avx2(const float *src, const float *noise, __m256 scale,
+    __m256 low, __m256 high)
+{
+    __m256 x = _mm256_mul_ps(_mm256_loadu_ps(src), scale);
+    if (NULL != noise) {
+        x = _mm256_add_ps(x, _mm256_loadu_ps(noise));
+    }
+    return _mm256_cvtps_epi32(_mm256_max_ps(_mm256_min_ps(x, high), low));
+}
+
+__attribute__((target("avx2")))
+static void encode_u8_avx2(void *dst, const float *src, const float *noise, unsigned samples)
+{
+    uint8_t *d = (uint8_t *) dst;
+    const __m256 scale = _mm256_set1_ps(FLOAT_TO_U8);
+    const __m256 low = _mm256_set1_ps(-128.0f);
+    const __m256 high = _mm256_set1_ps(127.0f);
+    const __m128i bias = _mm_set1_epi16(128);
+    unsigned i;
+    for (i = 0; i + 8 <= samples; i += 8) {
+        __m256i x = encode_avx2(&src[i], NULL != noise ? &noise[i] : NULL, scale, low, high);
+        __m128i y = _mm_packs_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+        y = _mm_add_epi16(y, bias);
+        _mm_storel_epi64((__m128i *) &d[i], _mm_packus_epi16(y, y));
+    }
+    encode_u8_scalar(&d[i], &src[i], NULL != noise ? &noise[i] : NULL, samples - i);
+}
+
+__attribute__((target("avx2")))
+static void encode_s16_avx2(void *dst, const float *src, const float *noise, unsigned samples)
+{
+    int16_t *d = (int16_t *) dst;
+    const __m256 scale = _mm256_set1_ps(FLOAT_TO_S16);
+    const __m256 low = _mm256_set1_ps(-32768.0f);
+    const __m256 high = _mm256_set1_ps(32767.0f);
+    unsigned i;
+    for (i = 0; i + 8 <= samples; i += 8) {
+        __m256i x = encode_avx2(&src[i], NULL != noise ? &noise[i] : NULL, scale, low, high);
+        _mm_storeu_si128((__m128i *) &d[i],
+            _mm_packs_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1)));
+    }
+    encode_s16_scalar(&d[i], &src[i], NULL != noise ? &noise[i] : NULL, samples - i);
+}
+
+__attribute__((target("avx2")))
+static void encode_s24_avx2(void *dst, const float *src, const float *noise, unsigned samples)
+{
+    uint8_t *d = (uint8_t *) dst;
+    const __m256 scale = _mm256_set1_ps(FLOAT_TO_S24);
+    const __m256 low = _mm256_set1_ps(-8388608.0f);
+    const __m256 high = _mm256_set1_ps(8388607.0f);
+    // the low 3 bytes of each lane, packed into the first 12 bytes
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    unsigned i;
+    for (i = 0; i + 8 <= samples; i += 8) {
+        __m256i x = encode_avx2(&src[i], NULL != noise ? &noise[i] : NULL, scale, low, high);
+        __m128i lo = _mm_shuffle_epi8(_mm256_castsi256_si128(x), shuffle);
+        __m128i hi = _mm_shuffle_epi8(_mm256_extracti128_si256(x, 1), shuffle);
+        // 24 bytes, stored as 12 + 12 without writing beyond the end
+        uint8_t *p = &d[i * 3];
+        _mm_storel_epi64((__m128i *) p, lo);
+        int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(lo, 8));
+        memcpy(p + 8, &tail, sizeof(tail));
+        _mm_storel_epi64((__m128i *) (p + 12), hi);
+        tail = _mm_cvtsi128_si32(_mm_srli_si128(hi, 8));
+        memcpy(p + 20, &tail, sizeof(tail));
+    }
+    encode_s24_scalar(&d[i * 3], &src[i], NULL != noise ? &noise[i] : NULL, samples - i);
+}
+
+__attribute__((target("avx2")))
+static void encode_s32_avx2(void *dst, const float *src, const float *noise, unsigned samples)
+{
+    int32_t *d = (int32_t *) dst;
+    const __m256 scale = _mm256_set1_ps(FLOAT_TO_S32);
+    const __m256 low = _mm256_set1_ps(-FLOAT_TO_S32);
+    const __m256 high = _mm256_set1_ps(S32_MAX_FLOAT);
+    unsigned i;
+    for (i = 0; i + 8 <= samples; i += 8) {
+        _mm256_storeu_si256((__m256i *) &d[i],
+            encode_avx2(&src[i], NULL != noise ? &noise[i] : NULL, scale, low, high));
+    }
+    encode_s32_scalar(&d[i], &src[i], NULL != noise ? &noise[i] : NULL, samples - i);
+}
+
+/** \brief One step of 8 lanes of xorshift32, and a uniform float in [-0.5, 0.5) from each */
+
+__attribute__((target("avx2")))
+static inline __m256 noise_draw_avx2(__m256i *lanes)
+{
+    __m256i x = *lanes;
+    x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+    x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+    *lanes = x;
+    __m256i mantissa = _mm256_or_si256(_mm256_srli_epi32(x, 9), _mm256_set1_epi32(0x3F800000));
+    return _mm256_sub_ps(_mm256_castsi256_ps(mantissa), _mm256_set1_ps(1.5f));
+}
+
+__attribute__((target("avx2")))
+static void noise_avx2(float *noise, unsigned samples, slesutDither dither,
+    slesutDitherState *state)
+{
+    __m256i lanes = _mm256_loadu_si256((const __m256i *) state->mLanes);
+    unsigned i;
+    for (i = 0; i + 8 <= samples; i += 8) {
+        __m256 n = noise_draw_avx2(&lanes);
+        if (SLESUT_DITHER_TRIANGULAR == dither) {
+            n = _mm256_add_ps(n, noise_draw_avx2(&lanes));
+        }
+        _mm256_storeu_ps(&noise[i], n);
+    }
+    _mm256_storeu_si256((__m256i *) state->mLanes, lanes);
+    noise_scalar(&noise[i], samples - i, dither, state);
+}
+
+static const PcmKernels PcmKernels_avx2 = {
+    {NULL, decode_u8_avx2, decode_s16_avx2, decode_s24_avx2, decode_s32_avx2},
+    {NULL, encode_u8_avx2, encode_s16_avx2, encode_s24_avx2, encode_s32_avx2},
+    noise_avx2
+};
+
+#endif // PCM_X86
+
+
+/** \brief Return the fastest kernels supported by the CPU we are running on */
+
+static const PcmKernels *PcmKernels_get(void)
+{
+    // The selection is idempotent, so a race between two first callers is harmless
+    static const PcmKernels *selected = NULL;
+    const PcmKernels *kernels = selected;
+    if (NULL == kernels) {
+        kernels = &PcmKernels_scalar;
+#ifdef PCM_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            kernels = &PcmKernels_avx2;
+        } else if (__builtin_cpu_supports("sse2")) {
+            kernels = &PcmKernels_sse2;
+        }
+#endif
+        selected = kernels;
+    }
+    return kernels;
+}
+
+
+/** \brief Return the sample format described by a PCM data format, or SLESUT_PCM_INVALID */
+
+slesutPcmFormat slesutPcmFormatOf(const SLDataFormat_PCM *format)
+{
+    SLuint32 representation;
+    switch (format->formatType) {
+    case SL_DATAFORMAT_PCM:
+        // the representation is implied by the container size
+        representation = 8 == format->containerSize ? SL_ANDROID_PCM_REPRESENTATION_UNSIGNED_INT :
+            SL_ANDROID_PCM_REPRESENTATION_SIGNED_INT;
+        break;
+    case SL_ANDROID_DATAFORMAT_PCM_EX:
+        representation = ((const SLAndroidDataFormat_PCM_EX *) format)->representation;
+        break;
+    default:
+        return SLESUT_PCM_INVALID;
+    }
+    switch (representation) {
+    case SL_ANDROID_PCM_REPRESENTATION_UNSIGNED_INT:
+        return 8 == format->containerSize ? SLESUT_PCM_U8 : SLESUT_PCM_INVALID;
+    case SL_ANDROID_PCM_REPRESENTATION_SIGNED_INT:
+        switch (format->containerSize) {
+        case 16:
+            return SLESUT_PCM_S16;
+        case 24:
+            return SLESUT_PCM_S24_PACKED;
+        case 32:
+            return SLESUT_PCM_S32;
+        default:
+            return SLESUT_PCM_INVALID;
+        }
+    case SL_ANDROID_PCM_REPRESENTATION_FLOAT:
+        return 32 == format->containerSize ? SLESUT_PCM_FLOAT : SLESUT_PCM_INVALID;
+    default:
+        return SLESUT_PCM_INVALID;
+    }
+}
+
+
+/** \brief Return the number of bytes in one sample of the specified format */
+
+unsigned slesutPcmSampleSize(slesutPcmFormat format)
+{
+    static const unsigned sizes[] = {0, 1, 2, 3, 4, 4};
+    return (unsigned) format < sizeof(sizes) / sizeof(sizes[0]) ? sizes[format] : 0;
+}
+
+
+/** \brief Seed the dither noise generator */
+
+void slesutDitherInit(slesutDitherState *state, SLuint32 seed)
+{
+    unsigned i;
+    for (i = 0; i < 8; ++i) {
+        // xorshift must not start at zero
+        SLuint32 lane = seed + (i + 1) * 0x9E3779B9;
+        state->mLanes[i] = 0 != lane ? lane : 1;
+    }
+}
+
+
+/** \brief Convert samples from one format to another.  Noise of the specified shape is added
+ *  when the destination has fewer bits than the source, otherwise dither is ignored and state
+ *  may be NULL.  The source and destination must not overlap, unless the formats are the same.
+ */
+
+void slesutPcmConvert(void *dst, slesutPcmFormat dstFormat, const void *src,
+    slesutPcmFormat srcFormat, unsigned samples, slesutDither dither, slesutDitherState *state)
+{
+    assert(SLESUT_PCM_INVALID != dstFormat && SLESUT_PCM_FLOAT >= dstFormat);
+    assert(SLESUT_PCM_INVALID != srcFormat && SLESUT_PCM_FLOAT >= srcFormat);
+    if (dstFormat == srcFormat) {
+        memmove(dst, src, samples * slesutPcmSampleSize(srcFormat));
+        return;
+    }
+    const PcmKernels *kernels = PcmKernels_get();
+    if (SLESUT_PCM_FLOAT == dstFormat) {
+        (*kernels->mDecode[srcFormat])((float *) dst, src, samples);
+        return;
+    }
+    // the formats are in order of increasing width, and float is the widest
+    SLboolean narrowing = dstFormat < srcFormat && SLESUT_DITHER_NONE != dither;
+    assert(!narrowing || NULL != state);
+    PcmEncode encode = kernels->mEncode[dstFormat];
+    size_t srcSize = slesutPcmSampleSize(srcFormat);
+    size_t dstSize = slesutPcmSampleSize(dstFormat);
+    float block[BLOCK_SAMPLES];
+    float noise[BLOCK_SAMPLES];
+    while (samples > 0) {
+        unsigned count = samples < BLOCK_SAMPLES ? samples : BLOCK_SAMPLES;
+        const float *f;
+        if (SLESUT_PCM_FLOAT == srcFormat) {
+            f = (const float *) src;
+        } else {
+            (*kernels->mDecode[srcFormat])(block, src, count);
+            f = block;
+        }
+        if (narrowing) {
+            (*kernels->mNoise)(noise, count, dither, state);
+        }
+        (*encode)(dst, f, narrowing ? noise : NULL, count);
+        src = (const char *) src + count * srcSize;
+        dst = (char *) dst + count * dstSize;
+        samples -= count;
+    }
+}
+
+
+/** \brief Return whether every sample is silence: zero, or mid-scale for unsigned 8-bit, and zero
+ *  of either sign for float.  The scan stops at the first sample which is not, so an audible
+ *  buffer usually costs only a few comparisons.
+ */
+
+SLboolean slesutPcmIsSilent(const void *src, slesutPcmFormat format, unsigned samples)
+{
+    assert(SLESUT_PCM_INVALID != format && SLESUT_PCM_FLOAT >= format);
+    // compare 8 bytes at a time; each word holds whole float samples, as it starts at a multiple
+    // of 8 bytes, so the sign bits of float samples are at the top of each 32-bit half
+    uint64_t silence, mask;
+    switch (format) {
+    case SLESUT_PCM_U8:
+        silence = 0x8080808080808080ULL;
+        mask = ~(uint64_t) 0;
+        break;
+    case SLESUT_PCM_FLOAT:
+        silence = 0;
+        mask = 0x7FFFFFFF7FFFFFFFULL;
+        break;
+    default:
+        silence = 0;
+        mask = ~(uint64_t) 0;
+        break;
+    }
+    const uint8_t *s = (const uint8_t *) src;
+    size_t bytes = (size_t) samples * slesutPcmSampleSize(format);
+    uint64_t word;
+    for ( ; bytes >= sizeof(word); bytes -= sizeof(word), s += sizeof(word)) {
+        memcpy(&word, s, sizeof(word));    // the buffer need not be aligned
+        if ((word & mask) != silence) {
+            return SL_BOOLEAN_FALSE;
+        }
+    }
+    // the tail is padded with silence
+    word = silence;
+    memcpy(&word, s, bytes);
+    return (word & mask) == silence ? SL_BOOLEAN_TRUE : SL_BOOLEAN_FALSE;
+}
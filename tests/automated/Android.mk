@@ -35,5 +35,8 @@ LOCAL_MODULE_PATH := $(TARGET_OUT_DATA)/nativetest
 
 include $(BUILD_EXECUTABLE)
 
+# The tests of the desktop devices need the desktop configuration of the library
+# (USE_OUTPUTMIXEXT), so they are built and run by Makefile rather than here.
+
 # Build the manual test programs.
 include $(call all-makefiles-under,$(LOCAL_PATH))
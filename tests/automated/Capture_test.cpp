@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file Capture_test.cpp Record into a buffer queue from the desktop capture file */
+
+// This test is for the desktop build (USE_OUTPUTMIXEXT), see Makefile, and needs no audio
+// hardware: with the null device, an audio recorder captures the WAV file named by
+// SL_DESKTOP_CAPTUREFILE, which the test writes to $TMPDIR, or /tmp.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <SLES/OpenSLES.h>
+#include <SLES/OpenSLES_Desktop.h>
+#include "OpenSLESUT.h"
+#include <gtest/gtest.h>
+
+#define SAMPLE_RATE 44100
+#define CHANNELS 2
+#define NUM_BUFFERS 4
+#define BUFFER_FRAMES (SAMPLE_RATE / 8)     // about 125 ms
+#define TIMEOUT_MS 10000    // how long to wait for a callback before failing
+
+// 1 second of a stereo ramp, so each frame identifies its position in the file
+static short captureFile[SAMPLE_RATE * CHANNELS];
+
+// enough buffers for the whole file, so each can be checked afterwards
+static short recordBuffers[SAMPLE_RATE / BUFFER_FRAMES][BUFFER_FRAMES * CHANNELS];
+#define TOTAL_BUFFERS (sizeof(recordBuffers) / sizeof(recordBuffers[0]))
+// position after the specified number of buffers are filled
+#define POSITION(buffers) ((SLmillisecond) ((buffers) * BUFFER_FRAMES * 1000ULL / SAMPLE_RATE))
+
+static const SLInterfaceID ids[1] = { SL_IID_BUFFERQUEUE };
+static const SLboolean flags[1] = { SL_BOOLEAN_TRUE };
+
+static void CheckErr(SLresult res) {
+    ASSERT_EQ(SL_RESULT_SUCCESS, res) << slesutResultToString(res);
+}
+
+static void PutLittleEndian(unsigned char *p, SLuint32 value, unsigned bytes) {
+    unsigned i;
+    for (i = 0; i < bytes; ++i) {
+        p[i] = (unsigned char) (value >> (8 * i));
+    }
+}
+
+// The fixture for recording from the capture file
+class TestCapture: public ::testing::Test {
+public:
+    SLObjectItf engineObject;
+    SLEngineItf engineEngine;
+    SLObjectItf recorderObject;
+    SLRecordItf recorderRecord;
+    SLBufferQueueItf recorderBufferQueue;
+    char capturePath[256];
+
+    // updated by the callbacks
+    volatile SLuint32 buffersDone;
+    volatile SLuint32 stalls;
+    SLuint32 buffersEnqueued;
+    bool refill;
+
+    static void BufferQueueCallback(SLBufferQueueItf caller, void *context) {
+        TestCapture *thiz = (TestCapture *) context;
+        ++thiz->buffersDone;
+        if (thiz->refill && TOTAL_BUFFERS > thiz->buffersEnqueued) {
+            (*caller)->Enqueue(caller, recordBuffers[thiz->buffersEnqueued++],
+                    sizeof(recordBuffers[0]));
+        }
+    }
+
+    static void RecordCallback(SLRecordItf caller, void *context, SLuint32 event) {
+        TestCapture *thiz = (TestCapture *) context;
+        if (event & SL_RECORDEVENT_HEADSTALLED) {
+            ++thiz->stalls;
+        }
+    }
+
+protected:
+    virtual void SetUp() {
+        engineObject = NULL;
+        recorderObject = NULL;
+        buffersDone = 0;
+        stalls = 0;
+        buffersEnqueued = 0;
+        refill = true;
+        memset(recordBuffers, 0, sizeof(recordBuffers));
+        const char *tmpdir = getenv("TMPDIR");
+        snprintf(capturePath, sizeof(capturePath), "%s/Capture_test_%d.wav",
+                NULL != tmpdir ? tmpdir : "/tmp", (int) getpid());
+        unsigned i;
+        for (i = 0; i < SAMPLE_RATE * CHANNELS; ++i) {
+            captureFile[i] = (short) (i * 7);
+        }
+        WriteCaptureFile();
+        setenv("SL_DESKTOP_CAPTUREFILE", capturePath, 1);
+    }
+
+    virtual void TearDown() {
+        if (NULL != recorderObject) {
+            (*recorderObject)->Destroy(recorderObject);
+            recorderObject = NULL;
+        }
+        if (NULL != engineObject) {
+            (*engineObject)->Destroy(engineObject);
+            engineObject = NULL;
+        }
+        unlink(capturePath);
+    }
+
+    /* Write captureFile as a canonical 16-bit PCM WAV file */
+    void WriteCaptureFile() {
+        SLuint32 dataSize = sizeof(captureFile);
+        unsigned char header[44];
+        memcpy(&header[0], "RIFF", 4);
+        PutLittleEndian(&header[4], 36 + dataSize, 4);
+        memcpy(&header[8], "WAVEfmt ", 8);
+        PutLittleEndian(&header[16], 16, 4);
+        PutLittleEndian(&header[20], 1, 2);     // PCM
+        PutLittleEndian(&header[22], CHANNELS, 2);
+        PutLittleEndian(&header[24], SAMPLE_RATE, 4);
+        PutLittleEndian(&header[28], SAMPLE_RATE * CHANNELS * sizeof(short), 4);
+        PutLittleEndian(&header[32], CHANNELS * sizeof(short), 2);
+        PutLittleEndian(&header[34], 16, 2);
+        memcpy(&header[36], "data", 4);
+        PutLittleEndian(&header[40], dataSize, 4);
+        FILE *fp = fopen(capturePath, "wb");
+        ASSERT_TRUE(NULL != fp) << capturePath;
+        ASSERT_EQ((size_t) 1, fwrite(header, sizeof(header), 1, fp));
+        ASSERT_EQ((size_t) 1, fwrite(captureFile, sizeof(captureFile), 1, fp));
+        fclose(fp);
+    }
+
+    /* Create the engine on the null device, and a 16-bit stereo buffer queue recorder */
+    void CreateRecorder(SLuint32 clockPercent) {
+        SLEngineOption options[] = {
+            {SL_DESKTOP_ENGINEOPTION_DEVICE, SL_DESKTOP_DEVICE_NULL},
+            {SL_DESKTOP_ENGINEOPTION_CLOCK, clockPercent}
+        };
+        CheckErr(slCreateEngine(&engineObject, 2, options, 0, NULL, NULL));
+        CheckErr((*engineObject)->Realize(engineObject, SL_BOOLEAN_FALSE));
+        CheckErr((*engineObject)->GetInterface(engineObject, SL_IID_ENGINE, &engineEngine));
+
+        SLDataLocator_IODevice locator_iodevice = {SL_DATALOCATOR_IODEVICE,
+                SL_IODEVICE_AUDIOINPUT, SL_DEFAULTDEVICEID_AUDIOINPUT, NULL};
+        SLDataSource audiosrc = {&locator_iodevice, NULL};
+        SLDataLocator_BufferQueue locator_bufferqueue = {SL_DATALOCATOR_BUFFERQUEUE,
+                NUM_BUFFERS};
+        SLDataFormat_PCM pcm = {SL_DATAFORMAT_PCM, CHANNELS, SL_SAMPLINGRATE_44_1,
+                SL_PCMSAMPLEFORMAT_FIXED_16, 16, SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT,
+                SL_BYTEORDER_LITTLEENDIAN};
+        SLDataSink audiosnk = {&locator_bufferqueue, &pcm};
+        CheckErr((*engineEngine)->CreateAudioRecorder(engineEngine, &recorderObject, &audiosrc,
+                &audiosnk, 1, ids, flags));
+        CheckErr((*recorderObject)->Realize(recorderObject, SL_BOOLEAN_FALSE));
+        CheckErr((*recorderObject)->GetInterface(recorderObject, SL_IID_RECORD,
+                &recorderRecord));
+        CheckErr((*recorderObject)->GetInterface(recorderObject, SL_IID_BUFFERQUEUE,
+                &recorderBufferQueue));
+        CheckErr((*recorderBufferQueue)->RegisterCallback(recorderBufferQueue,
+                BufferQueueCallback, this));
+        CheckErr((*recorderRecord)->RegisterCallback(recorderRecord, RecordCallback, this));
+        CheckErr((*recorderRecord)->SetCallbackEventsMask(recorderRecord,
+                SL_RECORDEVENT_HEADSTALLED));
+    }
+
+    void Enqueue() {
+        CheckErr((*recorderBufferQueue)->Enqueue(recorderBufferQueue,
+                recordBuffers[buffersEnqueued++], sizeof(recordBuffers[0])));
+    }
+
+    void WaitForBuffers(SLuint32 count) {
+        unsigned ms;
+        for (ms = 0; ms < TIMEOUT_MS && count > buffersDone; ++ms) {
+            usleep(1000);
+        }
+        ASSERT_LE(count, buffersDone) << "buffers were not filled within the timeout";
+    }
+};
+
+/* Recording as fast as possible waits for buffers, so it captures the whole file in order, with
+ * the position at its duration, and never stalls
+ */
+TEST_F(TestCapture, testCaptureFile) {
+    CreateRecorder(0);
+    unsigned i;
+    for (i = 0; i < NUM_BUFFERS; ++i) {
+        Enqueue();
+    }
+    CheckErr((*recorderRecord)->SetRecordState(recorderRecord, SL_RECORDSTATE_RECORDING));
+    WaitForBuffers(TOTAL_BUFFERS);
+    CheckErr((*recorderRecord)->SetRecordState(recorderRecord, SL_RECORDSTATE_STOPPED));
+    for (i = 0; i < TOTAL_BUFFERS; ++i) {
+        ASSERT_EQ(0, memcmp(recordBuffers[i], &captureFile[i * BUFFER_FRAMES * CHANNELS],
+                sizeof(recordBuffers[0]))) << "buffer " << i;
+    }
+    SLmillisecond position;
+    CheckErr((*recorderRecord)->GetPosition(recorderRecord, &position));
+    ASSERT_EQ(POSITION(TOTAL_BUFFERS), position);
+    ASSERT_EQ((SLuint32) 0, stalls);
+}
+
+/* At the virtual clock, capture goes on without buffers, so running out of them is an overrun:
+ * HEADSTALLED is signalled once, the position doesn't advance, and capture resumes into the next
+ * buffer enqueued
+ */
+TEST_F(TestCapture, testOverrun) {
+    CreateRecorder(400);
+    refill = false;
+    Enqueue();
+    CheckErr((*recorderRecord)->SetRecordState(recorderRecord, SL_RECORDSTATE_RECORDING));
+    WaitForBuffers(1);
+    unsigned ms;
+    for (ms = 0; ms < TIMEOUT_MS && 0 == stalls; ++ms) {
+        usleep(1000);
+    }
+    ASSERT_EQ((SLuint32) 1, stalls);
+    // the overrun goes on, but is only signalled once
+    usleep(100000);
+    ASSERT_EQ((SLuint32) 1, stalls);
+    SLmillisecond position;
+    CheckErr((*recorderRecord)->GetPosition(recorderRecord, &position));
+    ASSERT_EQ(POSITION(1), position);
+    ASSERT_EQ(0, memcmp(recordBuffers[0], captureFile, sizeof(recordBuffers[0])));
+    Enqueue();
+    WaitForBuffers(2);
+    CheckErr((*recorderRecord)->GetPosition(recorderRecord, &position));
+    ASSERT_EQ(POSITION(2), position);
+    // the file went on while frames were dropped, so the second buffer starts later in it
+    ASSERT_NE(0, memcmp(recordBuffers[1], &captureFile[BUFFER_FRAMES * CHANNELS],
+            sizeof(recordBuffers[1])));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,720 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file NullDevice_test.cpp Play a buffer queue through the desktop null devices */
+
+// This test is for the desktop build (USE_OUTPUTMIXEXT), see Makefile, and needs no audio
+// hardware: it renders through SL_DESKTOP_DEVICE_WAVFILE into a file in $TMPDIR, or /tmp.
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <SLES/OpenSLES.h>
+#include <SLES/OpenSLES_Desktop.h>
+#include "OpenSLESUT.h"
+#include <gtest/gtest.h>
+
+#define SAMPLE_RATE 44100
+#define CHANNELS 2
+#define WAV_HEADER 44       // canonical header of a 16-bit PCM WAV file
+#define TIMEOUT_MS 10000    // how long to wait for a callback before failing
+
+// 1 second of a stereo 441 Hz sine wave
+static short sineBuffer[SAMPLE_RATE * CHANNELS];
+
+static const SLInterfaceID ids[1] = { SL_IID_BUFFERQUEUE };
+static const SLboolean flags[1] = { SL_BOOLEAN_TRUE };
+
+static void CheckErr(SLresult res) {
+    ASSERT_EQ(SL_RESULT_SUCCESS, res) << slesutResultToString(res);
+}
+
+static long long NowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// updated by ParallelCallback, from whichever thread calls it
+static volatile int inCallback;
+static volatile int maxInCallback;
+static volatile unsigned parallelDone;
+
+static void ParallelCallback(SLBufferQueueItf caller, void *context) {
+    int n = __sync_add_and_fetch(&inCallback, 1);
+    if (n > maxInCallback) {
+        maxInCallback = n;
+    }
+    // widen the window for another callback to overlap this one
+    usleep(100);
+    __sync_sub_and_fetch(&inCallback, 1);
+    __sync_add_and_fetch(&parallelDone, 1);
+}
+
+// The fixture for playing through the null devices
+class TestNullDevice: public ::testing::Test {
+public:
+    SLObjectItf engineObject;
+    SLEngineItf engineEngine;
+    SLObjectItf outputmixObject;
+    SLObjectItf playerObject;
+    SLPlayItf playerPlay;
+    SLBufferQueueItf playerBufferQueue;
+    char wavPath[256];
+
+    // updated by the callbacks
+    volatile SLuint32 buffersDone;
+    volatile SLuint32 markers;
+    volatile SLuint32 newPositions;
+
+    static void BufferQueueCallback(SLBufferQueueItf caller, void *context) {
+        TestNullDevice *thiz = (TestNullDevice *) context;
+        ++thiz->buffersDone;
+    }
+
+    static void PlayCallback(SLPlayItf caller, void *context, SLuint32 event) {
+        TestNullDevice *thiz = (TestNullDevice *) context;
+        if (event & SL_PLAYEVENT_HEADATMARKER) {
+            ++thiz->markers;
+        }
+        if (event & SL_PLAYEVENT_HEADATNEWPOS) {
+            ++thiz->newPositions;
+        }
+    }
+
+protected:
+    virtual void SetUp() {
+        engineObject = NULL;
+        outputmixObject = NULL;
+        playerObject = NULL;
+        buffersDone = 0;
+        markers = 0;
+        newPositions = 0;
+        const char *tmpdir = getenv("TMPDIR");
+        snprintf(wavPath, sizeof(wavPath), "%s/NullDevice_test_%d.wav",
+                NULL != tmpdir ? tmpdir : "/tmp", (int) getpid());
+        setenv("SL_DESKTOP_WAVFILE", wavPath, 1);
+        unsigned i;
+        for (i = 0; i < SAMPLE_RATE; ++i) {
+            short sample = (short) (16384.0 * sin(i * 2.0 * M_PI * 441.0 / SAMPLE_RATE));
+            sineBuffer[i * CHANNELS] = sample;
+            sineBuffer[i * CHANNELS + 1] = sample;
+        }
+    }
+
+    virtual void TearDown() {
+        DestroyAll();
+        unlink(wavPath);
+    }
+
+    void DestroyAll() {
+        if (NULL != playerObject) {
+            (*playerObject)->Destroy(playerObject);
+            playerObject = NULL;
+        }
+        if (NULL != outputmixObject) {
+            (*outputmixObject)->Destroy(outputmixObject);
+            outputmixObject = NULL;
+        }
+        if (NULL != engineObject) {
+            (*engineObject)->Destroy(engineObject);
+            engineObject = NULL;
+        }
+    }
+
+    /* Create the engine with the specified options, and a realized output mix */
+    void CreateEngine(SLuint32 numOptions, const SLEngineOption *options) {
+        CheckErr(slCreateEngine(&engineObject, numOptions, options, 0, NULL, NULL));
+        CheckErr((*engineObject)->Realize(engineObject, SL_BOOLEAN_FALSE));
+        CheckErr((*engineObject)->GetInterface(engineObject, SL_IID_ENGINE, &engineEngine));
+        CheckErr((*engineEngine)->CreateOutputMix(engineEngine, &outputmixObject, 0, NULL, NULL));
+        CheckErr((*outputmixObject)->Realize(outputmixObject, SL_BOOLEAN_FALSE));
+    }
+
+    /* Create the engine on the specified null device, an output mix, and a buffer queue player */
+    void CreatePlayer(SLuint32 device, SLuint32 clockPercent) {
+        SLEngineOption options[] = {
+            {SL_DESKTOP_ENGINEOPTION_DEVICE, device},
+            {SL_DESKTOP_ENGINEOPTION_CLOCK, clockPercent}
+        };
+        CreateEngine(2, options);
+        SLDataFormat_PCM pcm = {SL_DATAFORMAT_PCM, CHANNELS, SL_SAMPLINGRATE_44_1,
+                SL_PCMSAMPLEFORMAT_FIXED_16, 16, SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT,
+                SL_BYTEORDER_LITTLEENDIAN};
+        CreatePlayerOf(&pcm);
+    }
+
+    /* Create a buffer queue player of the specified format on the output mix */
+    void CreatePlayerOf(SLDataFormat_PCM *pcm, SLuint32 numBuffers = 1) {
+        SLDataLocator_BufferQueue locator_bufferqueue = {SL_DATALOCATOR_BUFFERQUEUE, numBuffers};
+        SLDataSource audiosrc = {&locator_bufferqueue, pcm};
+        SLDataLocator_OutputMix locator_outputmix = {SL_DATALOCATOR_OUTPUTMIX, outputmixObject};
+        SLDataSink audiosnk = {&locator_outputmix, NULL};
+        CheckErr((*engineEngine)->CreateAudioPlayer(engineEngine, &playerObject, &audiosrc,
+                &audiosnk, 1, ids, flags));
+        CheckErr((*playerObject)->Realize(playerObject, SL_BOOLEAN_FALSE));
+        CheckErr((*playerObject)->GetInterface(playerObject, SL_IID_PLAY, &playerPlay));
+        CheckErr((*playerObject)->GetInterface(playerObject, SL_IID_BUFFERQUEUE,
+                &playerBufferQueue));
+        CheckErr((*playerBufferQueue)->RegisterCallback(playerBufferQueue, BufferQueueCallback,
+                this));
+        CheckErr((*playerPlay)->RegisterCallback(playerPlay, PlayCallback, this));
+    }
+
+    /* Play the sine wave once, with a marker and position updates, and wait for it to finish */
+    void PlaySine() {
+        CheckErr((*playerPlay)->SetMarkerPosition(playerPlay, 500));
+        CheckErr((*playerPlay)->SetPositionUpdatePeriod(playerPlay, 100));
+        CheckErr((*playerPlay)->SetCallbackEventsMask(playerPlay,
+                SL_PLAYEVENT_HEADATMARKER | SL_PLAYEVENT_HEADATNEWPOS));
+        PlayBuffer(sineBuffer, sizeof(sineBuffer));
+    }
+
+    /* Play one buffer, and wait for it to finish */
+    void PlayBuffer(const void *buffer, SLuint32 size) {
+        CheckErr((*playerBufferQueue)->Enqueue(playerBufferQueue, buffer, size));
+        CheckErr((*playerPlay)->SetPlayState(playerPlay, SL_PLAYSTATE_PLAYING));
+        unsigned ms;
+        for (ms = 0; ms < TIMEOUT_MS && 0 == buffersDone; ++ms) {
+            usleep(1000);
+        }
+        ASSERT_EQ((SLuint32) 1, buffersDone) << "buffer was not played within the timeout";
+    }
+
+    /* Destroy everything, so the WAV file is complete, and read up to maxSamples of its data;
+     * return the number of samples read
+     */
+    size_t ReadWav(short *samples, size_t maxSamples) {
+        DestroyAll();
+        FILE *fp = fopen(wavPath, "rb");
+        if (NULL == fp) {
+            ADD_FAILURE() << wavPath;
+            return 0;
+        }
+        fseek(fp, WAV_HEADER, SEEK_SET);
+        size_t count = fread(samples, sizeof(short), maxSamples, fp);
+        fclose(fp);
+        return count;
+    }
+};
+
+/* The position of a player is the frames mixed, so it ends at the duration of the buffer, having
+ * passed the marker once and a position update every 100 ms
+ */
+TEST_F(TestNullDevice, testPositionAndMarker) {
+    CreatePlayer(SL_DESKTOP_DEVICE_NULL, 0);
+    PlaySine();
+    SLmillisecond position;
+    CheckErr((*playerPlay)->GetPosition(playerPlay, &position));
+    ASSERT_EQ((SLmillisecond) 1000, position);
+    ASSERT_EQ((SLuint32) 1, markers);
+    ASSERT_EQ((SLuint32) 10, newPositions);
+}
+
+/* At 400 percent, the virtual clock takes at least a quarter of a second to play one second */
+TEST_F(TestNullDevice, testVirtualClock) {
+    CreatePlayer(SL_DESKTOP_DEVICE_NULL, 400);
+    long long start = NowNs();
+    PlaySine();
+    long long elapsedMs = (NowNs() - start) / 1000000LL;
+    ASSERT_LE(225, elapsedMs);
+    SLmillisecond position;
+    CheckErr((*playerPlay)->GetPosition(playerPlay, &position));
+    ASSERT_EQ((SLmillisecond) 1000, position);
+    ASSERT_EQ((SLuint32) 1, markers);
+}
+
+/* The WAV file holds whole stereo frames, at least the second played, and all of its energy */
+TEST_F(TestNullDevice, testWavOutput) {
+    CreatePlayer(SL_DESKTOP_DEVICE_WAVFILE, 400);
+    PlaySine();
+    // the file is complete once the output mix, and so its device, is destroyed
+    DestroyAll();
+    FILE *fp = fopen(wavPath, "rb");
+    ASSERT_TRUE(NULL != fp) << wavPath;
+    unsigned char header[WAV_HEADER];
+    ASSERT_EQ((size_t) WAV_HEADER, fread(header, 1, WAV_HEADER, fp));
+    ASSERT_EQ(0, memcmp(header, "RIFF", 4));
+    ASSERT_EQ(0, memcmp(&header[8], "WAVE", 4));
+    ASSERT_EQ(0, memcmp(&header[36], "data", 4));
+    SLuint32 dataSize = header[40] | (header[41] << 8) | (header[42] << 16) |
+            ((SLuint32) header[43] << 24);
+    fseek(fp, 0, SEEK_END);
+    long fileSize = ftell(fp);
+    ASSERT_EQ((long) (WAV_HEADER + dataSize), fileSize);
+    ASSERT_EQ((SLuint32) 0, dataSize % (CHANNELS * sizeof(short)));
+    ASSERT_LE((SLuint32) sizeof(sineBuffer), dataSize);
+    // the mix may start and end with silence, but is otherwise the sine wave at unity gain
+    fseek(fp, WAV_HEADER, SEEK_SET);
+    double energy = 0.0;
+    short samples[1024];
+    size_t count;
+    while (0 < (count = fread(samples, sizeof(short), 1024, fp))) {
+        size_t i;
+        for (i = 0; i < count; ++i) {
+            energy += (double) samples[i] * samples[i];
+        }
+    }
+    fclose(fp);
+    double expected = 0.0;
+    unsigned i;
+    for (i = 0; i < SAMPLE_RATE * CHANNELS; ++i) {
+        expected += (double) sineBuffer[i] * sineBuffer[i];
+    }
+    ASSERT_NEAR(1.0, energy / expected, 0.01);
+}
+
+/* A 48 kHz source is resampled to the 44.1 kHz mix: the position is still in source time, and the
+ * output has the pitch and the level of the source
+ */
+TEST_F(TestNullDevice, testResampling) {
+    SLEngineOption options[] = {
+        {SL_DESKTOP_ENGINEOPTION_DEVICE, SL_DESKTOP_DEVICE_WAVFILE},
+        {SL_DESKTOP_ENGINEOPTION_CLOCK, 400}
+    };
+    CreateEngine(2, options);
+    SLDataFormat_PCM pcm = {SL_DATAFORMAT_PCM, CHANNELS, SL_SAMPLINGRATE_48,
+            SL_PCMSAMPLEFORMAT_FIXED_16, 16, SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT,
+            SL_BYTEORDER_LITTLEENDIAN};
+    CreatePlayerOf(&pcm);
+    // 1 second of a 480 Hz sine wave at 48 kHz
+    static short source[48000 * CHANNELS];
+    double sourceEnergy = 0.0;
+    unsigned i;
+    for (i = 0; i < 48000; ++i) {
+        short sample = (short) (16384.0 * sin(i * 2.0 * M_PI * 480.0 / 48000));
+        source[i * CHANNELS] = sample;
+        source[i * CHANNELS + 1] = sample;
+        sourceEnergy += (double) sample * sample;
+    }
+    PlayBuffer(source, sizeof(source));
+    SLmillisecond position;
+    CheckErr((*playerPlay)->GetPosition(playerPlay, &position));
+    ASSERT_EQ((SLmillisecond) 1000, position);
+    static short output[2 * SAMPLE_RATE * CHANNELS];
+    size_t count = ReadWav(output, sizeof(output) / sizeof(output[0]));
+    ASSERT_LE((size_t) SAMPLE_RATE * CHANNELS, count);
+    // count the rising zero crossings of the left channel, one per cycle
+    double energy = 0.0;
+    unsigned cycles = 0;
+    for (i = 0; i < count / CHANNELS; ++i) {
+        short sample = output[i * CHANNELS];
+        energy += (double) sample * sample;
+        if (0 < i && output[(i - 1) * CHANNELS] < 0 && sample >= 0) {
+            ++cycles;
+        }
+    }
+    ASSERT_NEAR(480, (int) cycles, 2);
+    // the same mean power over the second, which is 44100 frames at the output rate
+    ASSERT_NEAR(1.0, (energy / SAMPLE_RATE) / (sourceEnergy / 48000), 0.02);
+}
+
+/* Each channel of a mono or multichannel source holds a different constant, so each side of the
+ * stereo mix is the sum of the channels folded into it: front left or right at unity, and
+ * center, LFE, and surround channels at -3 dB
+ */
+TEST_F(TestNullDevice, testDownmix) {
+    static const struct {
+        SLuint32 channels;
+        SLuint32 channelMask;
+        double left;
+        double right;
+    } layouts[] = {
+        // mono is heard on both sides at unity
+        {1, SL_SPEAKER_FRONT_CENTER, 1000.0, 1000.0},
+        // quad: front left and right, then back left and right
+        {4, SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT | SL_SPEAKER_BACK_LEFT |
+                SL_SPEAKER_BACK_RIGHT,
+                1000.0 + M_SQRT1_2 * 3000.0, 2000.0 + M_SQRT1_2 * 4000.0},
+        // 5.1: then center and LFE between the fronts and the backs
+        {6, SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT | SL_SPEAKER_FRONT_CENTER |
+                SL_SPEAKER_LOW_FREQUENCY | SL_SPEAKER_BACK_LEFT | SL_SPEAKER_BACK_RIGHT,
+                1000.0 + M_SQRT1_2 * (3000.0 + 4000.0 + 5000.0),
+                2000.0 + M_SQRT1_2 * (3000.0 + 4000.0 + 6000.0)},
+        // 7.1: and the sides last
+        {8, SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT | SL_SPEAKER_FRONT_CENTER |
+                SL_SPEAKER_LOW_FREQUENCY | SL_SPEAKER_BACK_LEFT | SL_SPEAKER_BACK_RIGHT |
+                SL_SPEAKER_SIDE_LEFT | SL_SPEAKER_SIDE_RIGHT,
+                1000.0 + M_SQRT1_2 * (3000.0 + 4000.0 + 5000.0 + 7000.0),
+                2000.0 + M_SQRT1_2 * (3000.0 + 4000.0 + 6000.0 + 8000.0)}
+    };
+    const unsigned frames = SAMPLE_RATE / 10;
+    static short source[SAMPLE_RATE / 10 * 8];
+    static short output[SAMPLE_RATE * CHANNELS];
+    unsigned layout;
+    for (layout = 0; layout < sizeof(layouts) / sizeof(layouts[0]); ++layout) {
+        SCOPED_TRACE(layouts[layout].channels);
+        SLEngineOption options[] = {
+            {SL_DESKTOP_ENGINEOPTION_DEVICE, SL_DESKTOP_DEVICE_WAVFILE},
+            {SL_DESKTOP_ENGINEOPTION_CLOCK, 400}
+        };
+        CreateEngine(2, options);
+        SLDataFormat_PCM pcm = {SL_DATAFORMAT_PCM, layouts[layout].channels,
+                SL_SAMPLINGRATE_44_1, SL_PCMSAMPLEFORMAT_FIXED_16, 16,
+                layouts[layout].channelMask, SL_BYTEORDER_LITTLEENDIAN};
+        CreatePlayerOf(&pcm);
+        unsigned i, channel;
+        for (i = 0; i < frames; ++i) {
+            for (channel = 0; channel < layouts[layout].channels; ++channel) {
+                source[i * layouts[layout].channels + channel] = (short) (1000 * (channel + 1));
+            }
+        }
+        buffersDone = 0;
+        PlayBuffer(source, frames * layouts[layout].channels * sizeof(short));
+        size_t count = ReadWav(output, sizeof(output) / sizeof(output[0]));
+        // look at the middle of the buffer, after any silence the mix starts with
+        for (i = 0; i < count / CHANNELS && 0 == output[i * CHANNELS]; ++i) {
+        }
+        i += frames / 2;
+        ASSERT_LT(i, count / CHANNELS);
+        ASSERT_NEAR(layouts[layout].left, output[i * CHANNELS], 1.0);
+        ASSERT_NEAR(layouts[layout].right, output[i * CHANNELS + 1], 1.0);
+    }
+}
+
+/* Players are given tracks up to the engine's limit on objects, which with the engine and the
+ * output mix needs all 32 groups of tracks; a track freed in the first or the last group is
+ * reused, and the players in both of them are mixed
+ */
+TEST_F(TestNullDevice, testTrackGroups) {
+    SLEngineOption options[] = {
+        {SL_DESKTOP_ENGINEOPTION_DEVICE, SL_DESKTOP_DEVICE_NULL}
+    };
+    CreateEngine(1, options);
+    SLDataLocator_BufferQueue locator_bufferqueue = {SL_DATALOCATOR_BUFFERQUEUE, 1};
+    SLDataFormat_PCM pcm = {SL_DATAFORMAT_PCM, CHANNELS, SL_SAMPLINGRATE_44_1,
+            SL_PCMSAMPLEFORMAT_FIXED_16, 16, SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT,
+            SL_BYTEORDER_LITTLEENDIAN};
+    SLDataSource audiosrc = {&locator_bufferqueue, &pcm};
+    SLDataLocator_OutputMix locator_outputmix = {SL_DATALOCATOR_OUTPUTMIX, outputmixObject};
+    SLDataSink audiosnk = {&locator_outputmix, NULL};
+    // 32 groups of 32 tracks, less the engine and the output mix
+    const unsigned maxPlayers = 32 * 32 - 2;
+    static SLObjectItf players[maxPlayers];
+    unsigned i, numPlayers;
+    for (numPlayers = 0; numPlayers < maxPlayers; ++numPlayers) {
+        if (SL_RESULT_SUCCESS != (*engineEngine)->CreateAudioPlayer(engineEngine,
+                &players[numPlayers], &audiosrc, &audiosnk, 1, ids, flags) ||
+                SL_RESULT_SUCCESS != (*players[numPlayers])->Realize(players[numPlayers],
+                SL_BOOLEAN_FALSE)) {
+            break;
+        }
+    }
+    EXPECT_EQ(maxPlayers, numPlayers);
+    if (maxPlayers == numPlayers) {
+        SLObjectItf extra;
+        EXPECT_EQ(SL_RESULT_MEMORY_FAILURE, (*engineEngine)->CreateAudioPlayer(engineEngine,
+                &extra, &audiosrc, &audiosnk, 1, ids, flags));
+        // free the whole first group and a track of the last, and take them again
+        for (i = 0; i < 32; ++i) {
+            (*players[i])->Destroy(players[i]);
+        }
+        (*players[maxPlayers - 1])->Destroy(players[maxPlayers - 1]);
+        for (i = 0; i <= 32; ++i) {
+            unsigned player = 32 > i ? i : maxPlayers - 1;
+            EXPECT_EQ(SL_RESULT_SUCCESS, (*engineEngine)->CreateAudioPlayer(engineEngine,
+                    &players[player], &audiosrc, &audiosnk, 1, ids, flags));
+            EXPECT_EQ(SL_RESULT_SUCCESS, (*players[player])->Realize(players[player],
+                    SL_BOOLEAN_FALSE));
+        }
+        // play one buffer on a player at each end
+        const unsigned ends[2] = {0, maxPlayers - 1};
+        for (i = 0; i < 2; ++i) {
+            SLObjectItf player = players[ends[i]];
+            SLPlayItf play;
+            SLBufferQueueItf bufferQueue;
+            CheckErr((*player)->GetInterface(player, SL_IID_PLAY, &play));
+            CheckErr((*player)->GetInterface(player, SL_IID_BUFFERQUEUE, &bufferQueue));
+            CheckErr((*bufferQueue)->RegisterCallback(bufferQueue, BufferQueueCallback, this));
+            CheckErr((*bufferQueue)->Enqueue(bufferQueue, sineBuffer,
+                    SAMPLE_RATE / 10 * CHANNELS * sizeof(short)));
+            CheckErr((*play)->SetPlayState(play, SL_PLAYSTATE_PLAYING));
+        }
+        unsigned ms;
+        for (ms = 0; ms < TIMEOUT_MS && 2 > buffersDone; ++ms) {
+            usleep(1000);
+        }
+        EXPECT_EQ((SLuint32) 2, buffersDone);
+    }
+    for (i = 0; i < numPlayers; ++i) {
+        (*players[i])->Destroy(players[i]);
+    }
+}
+
+/* With one voice, a player of higher priority steals it from one already playing, which keeps its
+ * place while virtual: when it has the voice back, it resumes where it would have been had it
+ * been mixed all along
+ */
+TEST_F(TestNullDevice, testVoiceStealing) {
+    SLEngineOption options[] = {
+        {SL_DESKTOP_ENGINEOPTION_DEVICE, SL_DESKTOP_DEVICE_WAVFILE},
+        {SL_DESKTOP_ENGINEOPTION_CLOCK, 400},
+        {SL_DESKTOP_ENGINEOPTION_MAXVOICES, 1}
+    };
+    CreateEngine(3, options);
+    SLDataFormat_PCM pcm = {SL_DATAFORMAT_PCM, CHANNELS, SL_SAMPLINGRATE_44_1,
+            SL_PCMSAMPLEFORMAT_FIXED_16, 16, SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT,
+            SL_BYTEORDER_LITTLEENDIAN};
+    // the low priority player is a ramp, so its level in the mix shows its position
+    CreatePlayerOf(&pcm);
+    CheckErr((*playerObject)->SetPriority(playerObject, SL_PRIORITY_LOW, SL_BOOLEAN_TRUE));
+    static short ramp[SAMPLE_RATE * CHANNELS];
+    unsigned i;
+    for (i = 0; i < SAMPLE_RATE; ++i) {
+        ramp[i * CHANNELS] = ramp[i * CHANNELS + 1] = (short) (i / 10 + 1);
+    }
+    // and the high priority player a constant louder than the whole ramp, for 200 ms
+    SLDataLocator_BufferQueue locator_bufferqueue = {SL_DATALOCATOR_BUFFERQUEUE, 1};
+    SLDataSource audiosrc = {&locator_bufferqueue, &pcm};
+    SLDataLocator_OutputMix locator_outputmix = {SL_DATALOCATOR_OUTPUTMIX, outputmixObject};
+    SLDataSink audiosnk = {&locator_outputmix, NULL};
+    SLObjectItf highObject;
+    SLPlayItf highPlay;
+    SLBufferQueueItf highBufferQueue;
+    CheckErr((*engineEngine)->CreateAudioPlayer(engineEngine, &highObject, &audiosrc, &audiosnk,
+            1, ids, flags));
+    CheckErr((*highObject)->Realize(highObject, SL_BOOLEAN_FALSE));
+    CheckErr((*highObject)->SetPriority(highObject, SL_PRIORITY_HIGH, SL_BOOLEAN_FALSE));
+    CheckErr((*highObject)->GetInterface(highObject, SL_IID_PLAY, &highPlay));
+    CheckErr((*highObject)->GetInterface(highObject, SL_IID_BUFFERQUEUE, &highBufferQueue));
+    CheckErr((*highBufferQueue)->RegisterCallback(highBufferQueue, BufferQueueCallback, this));
+    static short constant[SAMPLE_RATE / 5 * CHANNELS];
+    for (i = 0; i < SAMPLE_RATE / 5 * CHANNELS; ++i) {
+        constant[i] = 20000;
+    }
+
+    CheckErr((*playerBufferQueue)->Enqueue(playerBufferQueue, ramp, sizeof(ramp)));
+    CheckErr((*playerPlay)->SetPlayState(playerPlay, SL_PLAYSTATE_PLAYING));
+    SLmillisecond position = 0;
+    unsigned ms;
+    for (ms = 0; ms < TIMEOUT_MS && 100 > position; ++ms) {
+        usleep(1000);
+        CheckErr((*playerPlay)->GetPosition(playerPlay, &position));
+    }
+    CheckErr((*highBufferQueue)->Enqueue(highBufferQueue, constant, sizeof(constant)));
+    CheckErr((*highPlay)->SetPlayState(highPlay, SL_PLAYSTATE_PLAYING));
+    // a player keeps its voice while it is playing, even with an empty queue, so stop it
+    for (ms = 0; ms < TIMEOUT_MS && 1 > buffersDone; ++ms) {
+        usleep(1000);
+    }
+    CheckErr((*highPlay)->SetPlayState(highPlay, SL_PLAYSTATE_STOPPED));
+    for (ms = 0; ms < TIMEOUT_MS && 2 > buffersDone; ++ms) {
+        usleep(1000);
+    }
+    (*highObject)->Destroy(highObject);
+    ASSERT_EQ((SLuint32) 2, buffersDone);
+    CheckErr((*playerPlay)->GetPosition(playerPlay, &position));
+    ASSERT_EQ((SLmillisecond) 1000, position);
+
+    static short output[2 * SAMPLE_RATE * CHANNELS];
+    size_t frames = ReadWav(output, sizeof(output) / sizeof(output[0])) / CHANNELS;
+    // the ramp starts at 1
+    size_t first, start, end;
+    for (first = 0; first < frames && 0 == output[first * CHANNELS]; ++first) {
+    }
+    ASSERT_EQ(1, output[first * CHANNELS]);
+    // while the high priority player is mixed, the ramp is not
+    for (start = first; start < frames && 20000 != output[start * CHANNELS]; ++start) {
+    }
+    for (end = start; end < frames && 20000 == output[end * CHANNELS]; ++end) {
+    }
+    ASSERT_EQ((size_t) SAMPLE_RATE / 5, end - start);
+    // once the high priority player is stopped, the ramp resumes where it would have been
+    for ( ; end < frames && 0 == output[end * CHANNELS]; ++end) {
+    }
+    ASSERT_LT(end, frames);
+    ASSERT_NEAR((double) (end - first) / 10 + 1, output[end * CHANNELS], 1.0);
+}
+
+/* A buffer found silent when it is enqueued is not read by the mixer, but its place in the mix,
+ * the position and its callback are the same as if it had been; to show whether it was read, the
+ * test changes it after enqueueing it, which an application must not do
+ */
+TEST_F(TestNullDevice, testSilenceDetection) {
+    const unsigned frames = SAMPLE_RATE / 10;
+    static short first[SAMPLE_RATE / 10 * CHANNELS], silent[SAMPLE_RATE / 10 * CHANNELS],
+            last[SAMPLE_RATE / 10 * CHANNELS];
+    static short output[SAMPLE_RATE * CHANNELS];
+    unsigned detection;
+    for (detection = 0; detection < 2; ++detection) {
+        SCOPED_TRACE(detection);
+        SLEngineOption options[] = {
+            {SL_DESKTOP_ENGINEOPTION_DEVICE, SL_DESKTOP_DEVICE_WAVFILE},
+            {SL_DESKTOP_ENGINEOPTION_CLOCK, 400},
+            {SL_DESKTOP_ENGINEOPTION_SILENCEDETECTION, detection}
+        };
+        CreateEngine(3, options);
+        SLDataFormat_PCM pcm = {SL_DATAFORMAT_PCM, CHANNELS, SL_SAMPLINGRATE_44_1,
+                SL_PCMSAMPLEFORMAT_FIXED_16, 16, SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT,
+                SL_BYTEORDER_LITTLEENDIAN};
+        CreatePlayerOf(&pcm, 3);
+        unsigned i;
+        for (i = 0; i < frames * CHANNELS; ++i) {
+            first[i] = 1000;
+            silent[i] = 0;
+            last[i] = 2000;
+        }
+        buffersDone = 0;
+        CheckErr((*playerBufferQueue)->Enqueue(playerBufferQueue, first, sizeof(first)));
+        CheckErr((*playerBufferQueue)->Enqueue(playerBufferQueue, silent, sizeof(silent)));
+        CheckErr((*playerBufferQueue)->Enqueue(playerBufferQueue, last, sizeof(last)));
+        for (i = 0; i < frames * CHANNELS; ++i) {
+            silent[i] = 3000;
+        }
+        CheckErr((*playerPlay)->SetPlayState(playerPlay, SL_PLAYSTATE_PLAYING));
+        unsigned ms;
+        for (ms = 0; ms < TIMEOUT_MS && 3 > buffersDone; ++ms) {
+            usleep(1000);
+        }
+        ASSERT_EQ((SLuint32) 3, buffersDone);
+        SLmillisecond position;
+        CheckErr((*playerPlay)->GetPosition(playerPlay, &position));
+        ASSERT_EQ((SLmillisecond) 300, position);
+        size_t count = ReadWav(output, sizeof(output) / sizeof(output[0])) / CHANNELS;
+        size_t start;
+        for (start = 0; start < count && 0 == output[start * CHANNELS]; ++start) {
+        }
+        ASSERT_LT(start + 3 * frames, count);
+        // each buffer is mixed for exactly its duration, one after the other
+        for (i = 0; i < 3 * frames; ++i) {
+            short expected = frames > i ? 1000 : 2 * frames > i ? (detection ? 0 : 3000) : 2000;
+            ASSERT_EQ(expected, output[(start + i) * CHANNELS]) << i;
+            ASSERT_EQ(expected, output[(start + i) * CHANNELS + 1]) << i;
+        }
+        ASSERT_EQ(0, output[(start + 3 * frames) * CHANNELS]);
+    }
+}
+
+/* Stopping, clearing, and destroying a playing player each wait for the mixer to let go of the
+ * track; stopping rewinds the position but keeps the queue, and clearing empties it
+ */
+TEST_F(TestNullDevice, testStopClearAndDestroy) {
+    CreatePlayer(SL_DESKTOP_DEVICE_NULL, 100);
+    CheckErr((*playerBufferQueue)->Enqueue(playerBufferQueue, sineBuffer, sizeof(sineBuffer)));
+    CheckErr((*playerPlay)->SetPlayState(playerPlay, SL_PLAYSTATE_PLAYING));
+    usleep(100000);
+    SLmillisecond position;
+    CheckErr((*playerPlay)->GetPosition(playerPlay, &position));
+    ASSERT_LT((SLmillisecond) 0, position);
+    CheckErr((*playerPlay)->SetPlayState(playerPlay, SL_PLAYSTATE_STOPPED));
+    SLuint32 state;
+    CheckErr((*playerPlay)->GetPlayState(playerPlay, &state));
+    ASSERT_EQ(SL_PLAYSTATE_STOPPED, state);
+    CheckErr((*playerPlay)->GetPosition(playerPlay, &position));
+    ASSERT_EQ((SLmillisecond) 0, position);
+    SLBufferQueueState queueState;
+    CheckErr((*playerBufferQueue)->GetState(playerBufferQueue, &queueState));
+    ASSERT_EQ((SLuint32) 1, queueState.count);
+    CheckErr((*playerBufferQueue)->Clear(playerBufferQueue));
+    CheckErr((*playerBufferQueue)->GetState(playerBufferQueue, &queueState));
+    ASSERT_EQ((SLuint32) 0, queueState.count);
+    ASSERT_EQ((SLuint32) 0, buffersDone);
+    // play again, and destroy the player while it is playing
+    CheckErr((*playerBufferQueue)->Enqueue(playerBufferQueue, sineBuffer, sizeof(sineBuffer)));
+    CheckErr((*playerPlay)->SetPlayState(playerPlay, SL_PLAYSTATE_PLAYING));
+    usleep(50000);
+    (*playerObject)->Destroy(playerObject);
+    playerObject = NULL;
+    ASSERT_EQ((SLuint32) 0, buffersDone);
+}
+
+/* With worker threads, tracks are mixed in parallel, but the application is still called back
+ * from one thread at a time, even though it didn't ask for deferred callbacks
+ */
+TEST_F(TestNullDevice, testParallelCallbacksSerialized) {
+    SLEngineOption options[] = {
+        {SL_DESKTOP_ENGINEOPTION_DEVICE, SL_DESKTOP_DEVICE_NULL},
+        {SL_DESKTOP_ENGINEOPTION_MIXERTHREADS, 2}
+    };
+    CheckErr(slCreateEngine(&engineObject, 2, options, 0, NULL, NULL));
+    CheckErr((*engineObject)->Realize(engineObject, SL_BOOLEAN_FALSE));
+    CheckErr((*engineObject)->GetInterface(engineObject, SL_IID_ENGINE, &engineEngine));
+    CheckErr((*engineEngine)->CreateOutputMix(engineEngine, &outputmixObject, 0, NULL, NULL));
+    CheckErr((*outputmixObject)->Realize(outputmixObject, SL_BOOLEAN_FALSE));
+    // enough players for the mixer to fork, each with ten buffers of 100 ms
+    const unsigned numPlayers = 8, numBuffers = 10, frames = SAMPLE_RATE / numBuffers;
+    SLDataLocator_BufferQueue locator_bufferqueue = {SL_DATALOCATOR_BUFFERQUEUE, numBuffers};
+    SLDataFormat_PCM pcm = {SL_DATAFORMAT_PCM, CHANNELS, SL_SAMPLINGRATE_44_1,
+            SL_PCMSAMPLEFORMAT_FIXED_16, 16, SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT,
+            SL_BYTEORDER_LITTLEENDIAN};
+    SLDataSource audiosrc = {&locator_bufferqueue, &pcm};
+    SLDataLocator_OutputMix locator_outputmix = {SL_DATALOCATOR_OUTPUTMIX, outputmixObject};
+    SLDataSink audiosnk = {&locator_outputmix, NULL};
+    SLObjectItf players[numPlayers];
+    SLPlayItf plays[numPlayers];
+    inCallback = 0;
+    maxInCallback = 0;
+    parallelDone = 0;
+    unsigned i, j;
+    for (i = 0; i < numPlayers; ++i) {
+        CheckErr((*engineEngine)->CreateAudioPlayer(engineEngine, &players[i], &audiosrc,
+                &audiosnk, 1, ids, flags));
+        CheckErr((*players[i])->Realize(players[i], SL_BOOLEAN_FALSE));
+        CheckErr((*players[i])->GetInterface(players[i], SL_IID_PLAY, &plays[i]));
+        SLBufferQueueItf bufferQueue;
+        CheckErr((*players[i])->GetInterface(players[i], SL_IID_BUFFERQUEUE, &bufferQueue));
+        CheckErr((*bufferQueue)->RegisterCallback(bufferQueue, ParallelCallback, NULL));
+        for (j = 0; j < numBuffers; ++j) {
+            CheckErr((*bufferQueue)->Enqueue(bufferQueue, &sineBuffer[j * frames * CHANNELS],
+                    frames * CHANNELS * sizeof(short)));
+        }
+    }
+    for (i = 0; i < numPlayers; ++i) {
+        CheckErr((*plays[i])->SetPlayState(plays[i], SL_PLAYSTATE_PLAYING));
+    }
+    unsigned ms;
+    for (ms = 0; ms < TIMEOUT_MS && numPlayers * numBuffers > parallelDone; ++ms) {
+        usleep(1000);
+    }
+    for (i = 0; i < numPlayers; ++i) {
+        (*players[i])->Destroy(players[i]);
+    }
+    ASSERT_EQ(numPlayers * numBuffers, parallelDone);
+    ASSERT_EQ(1, maxInCallback);
+}
+
+/* If the device can't be opened, the output mix goes back to unrealized, without the threads it
+ * started, and can be realized again once the device is available
+ */
+TEST_F(TestNullDevice, testRealizeAfterDeviceFailure) {
+    SLEngineOption options[] = {
+        {SL_DESKTOP_ENGINEOPTION_DEVICE, SL_DESKTOP_DEVICE_WAVFILE},
+        {SL_DESKTOP_ENGINEOPTION_MIXERTHREADS, 2},
+        {SL_DESKTOP_ENGINEOPTION_DEFERREDCALLBACKS, SL_BOOLEAN_TRUE}
+    };
+    CheckErr(slCreateEngine(&engineObject, 3, options, 0, NULL, NULL));
+    CheckErr((*engineObject)->Realize(engineObject, SL_BOOLEAN_FALSE));
+    CheckErr((*engineObject)->GetInterface(engineObject, SL_IID_ENGINE, &engineEngine));
+    CheckErr((*engineEngine)->CreateOutputMix(engineEngine, &outputmixObject, 0, NULL, NULL));
+    setenv("SL_DESKTOP_WAVFILE", "/nonexistent/NullDevice_test.wav", 1);
+    ASSERT_NE(SL_RESULT_SUCCESS, (*outputmixObject)->Realize(outputmixObject, SL_BOOLEAN_FALSE));
+    SLuint32 state;
+    CheckErr((*outputmixObject)->GetState(outputmixObject, &state));
+    ASSERT_EQ(SL_OBJECT_STATE_UNREALIZED, state);
+    setenv("SL_DESKTOP_WAVFILE", wavPath, 1);
+    CheckErr((*outputmixObject)->Realize(outputmixObject, SL_BOOLEAN_FALSE));
+    CheckErr((*outputmixObject)->GetState(outputmixObject, &state));
+    ASSERT_EQ(SL_OBJECT_STATE_REALIZED, state);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
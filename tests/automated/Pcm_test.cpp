@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file Pcm_test.cpp Convert between the linear PCM sample formats of OpenSLESUT */
+
+// The conversions use the fastest kernels the CPU supports; the sample counts are chosen so that
+// each test also runs the scalar tail of the vector kernels, and spans several blocks.
+
+#include <stdint.h>
+#include <string.h>
+#include <SLES/OpenSLES.h>
+#include <SLES/OpenSLES_Android.h>
+#include "OpenSLESUT.h"
+#include <gtest/gtest.h>
+
+#define S16_VALUES 65536
+#define S24_MIN (-8388608)
+#define S24_MAX 8388607
+
+static void PutS24(uint8_t *dst, int32_t value) {
+    dst[0] = (uint8_t) value;
+    dst[1] = (uint8_t) (value >> 8);
+    dst[2] = (uint8_t) (value >> 16);
+}
+
+static int32_t GetS24(const uint8_t *src) {
+    return (int32_t) ((uint32_t) src[0] << 8 | (uint32_t) src[1] << 16 | (uint32_t) src[2] << 24)
+            >> 8;
+}
+
+/* Every 16-bit sample survives the trip through float, which is exactly the sample / 32768 */
+TEST(TestPcm, testS16FloatRoundTrip) {
+    static int16_t s16[S16_VALUES], back[S16_VALUES];
+    static float f[S16_VALUES];
+    unsigned i;
+    for (i = 0; i < S16_VALUES; ++i) {
+        s16[i] = (int16_t) (i - 32768);
+    }
+    slesutPcmConvert(f, SLESUT_PCM_FLOAT, s16, SLESUT_PCM_S16, S16_VALUES, SLESUT_DITHER_NONE,
+            NULL);
+    slesutPcmConvert(back, SLESUT_PCM_S16, f, SLESUT_PCM_FLOAT, S16_VALUES, SLESUT_DITHER_NONE,
+            NULL);
+    for (i = 0; i < S16_VALUES; ++i) {
+        ASSERT_EQ(s16[i] / 32768.0f, f[i]) << i;
+        ASSERT_EQ(s16[i], back[i]) << i;
+    }
+}
+
+/* Every 8-bit unsigned sample is offset by 128, and survives widening to any format and back */
+TEST(TestPcm, testU8RoundTrip) {
+    // two of each value, so the count is not a multiple of the vector width
+    const unsigned samples = 2 * 256 + 3;
+    uint8_t u8[samples], back[samples];
+    int16_t s16[samples];
+    uint8_t s24[samples * 3];
+    float f[samples];
+    unsigned i;
+    for (i = 0; i < samples; ++i) {
+        u8[i] = (uint8_t) i;
+    }
+    slesutPcmConvert(s16, SLESUT_PCM_S16, u8, SLESUT_PCM_U8, samples, SLESUT_DITHER_NONE, NULL);
+    for (i = 0; i < samples; ++i) {
+        ASSERT_EQ(((int) u8[i] - 128) * 256, s16[i]) << i;
+    }
+    memset(back, 0, sizeof(back));
+    slesutPcmConvert(back, SLESUT_PCM_U8, s16, SLESUT_PCM_S16, samples, SLESUT_DITHER_NONE, NULL);
+    ASSERT_EQ(0, memcmp(u8, back, samples));
+
+    slesutPcmConvert(s24, SLESUT_PCM_S24_PACKED, u8, SLESUT_PCM_U8, samples, SLESUT_DITHER_NONE,
+            NULL);
+    for (i = 0; i < samples; ++i) {
+        ASSERT_EQ(((int32_t) u8[i] - 128) * 65536, GetS24(&s24[i * 3])) << i;
+    }
+    memset(back, 0, sizeof(back));
+    slesutPcmConvert(back, SLESUT_PCM_U8, s24, SLESUT_PCM_S24_PACKED, samples,
+            SLESUT_DITHER_NONE, NULL);
+    ASSERT_EQ(0, memcmp(u8, back, samples));
+
+    slesutPcmConvert(f, SLESUT_PCM_FLOAT, u8, SLESUT_PCM_U8, samples, SLESUT_DITHER_NONE, NULL);
+    for (i = 0; i < samples; ++i) {
+        ASSERT_EQ(((int) u8[i] - 128) / 128.0f, f[i]) << i;
+    }
+    memset(back, 0, sizeof(back));
+    slesutPcmConvert(back, SLESUT_PCM_U8, f, SLESUT_PCM_FLOAT, samples, SLESUT_DITHER_NONE, NULL);
+    ASSERT_EQ(0, memcmp(u8, back, samples));
+}
+
+/* Packed 24-bit samples, including both ends of the range, are little-endian in 3 bytes, and
+ * survive the trip through float and through 32 bits, where they are the top 3 bytes
+ */
+TEST(TestPcm, testS24PackedRoundTrip) {
+    const unsigned samples = 1001;
+    static uint8_t s24[samples * 3], back[samples * 3];
+    static int32_t s32[samples];
+    static float f[samples];
+    unsigned i;
+    for (i = 0; i < samples; ++i) {
+        int32_t value;
+        switch (i) {
+        case 0:
+            value = S24_MIN;
+            break;
+        case 1:
+            value = S24_MAX;
+            break;
+        case 2:
+            value = -1;
+            break;
+        case 3:
+            value = 1;
+            break;
+        default:
+            // an odd stride, once through the whole range, so every byte varies
+            value = S24_MIN + (int32_t) (i * 16787u % 16777216u);
+            break;
+        }
+        PutS24(&s24[i * 3], value);
+    }
+    slesutPcmConvert(f, SLESUT_PCM_FLOAT, s24, SLESUT_PCM_S24_PACKED, samples,
+            SLESUT_DITHER_NONE, NULL);
+    ASSERT_EQ(-1.0f, f[0]);
+    slesutPcmConvert(back, SLESUT_PCM_S24_PACKED, f, SLESUT_PCM_FLOAT, samples,
+            SLESUT_DITHER_NONE, NULL);
+    ASSERT_EQ(0, memcmp(s24, back, sizeof(s24)));
+
+    slesutPcmConvert(s32, SLESUT_PCM_S32, s24, SLESUT_PCM_S24_PACKED, samples,
+            SLESUT_DITHER_NONE, NULL);
+    for (i = 0; i < samples; ++i) {
+        ASSERT_EQ(GetS24(&s24[i * 3]) * 256, s32[i]) << i;
+    }
+    memset(back, 0, sizeof(back));
+    slesutPcmConvert(back, SLESUT_PCM_S24_PACKED, s32, SLESUT_PCM_S32, samples,
+            SLESUT_DITHER_NONE, NULL);
+    ASSERT_EQ(0, memcmp(s24, back, sizeof(s24)));
+
+    // 16-bit samples are widened into the top two bytes
+    const int16_t s16[3] = {0x1234, -32768, 32767};
+    const uint8_t expected[9] = {0x00, 0x34, 0x12, 0x00, 0x00, 0x80, 0x00, 0xFF, 0x7F};
+    slesutPcmConvert(back, SLESUT_PCM_S24_PACKED, s16, SLESUT_PCM_S16, 3, SLESUT_DITHER_NONE,
+            NULL);
+    ASSERT_EQ(0, memcmp(expected, back, sizeof(expected)));
+}
+
+/* Float beyond full scale is clamped, as is the top of the range, which has no integer */
+TEST(TestPcm, testClamp) {
+    const float f[5] = {1.0f, -1.0f, 2.0f, -2.0f, 0.5f};
+    int16_t s16[5];
+    uint8_t u8[5], s24[15];
+    slesutPcmConvert(s16, SLESUT_PCM_S16, f, SLESUT_PCM_FLOAT, 5, SLESUT_DITHER_NONE, NULL);
+    slesutPcmConvert(u8, SLESUT_PCM_U8, f, SLESUT_PCM_FLOAT, 5, SLESUT_DITHER_NONE, NULL);
+    slesutPcmConvert(s24, SLESUT_PCM_S24_PACKED, f, SLESUT_PCM_FLOAT, 5, SLESUT_DITHER_NONE,
+            NULL);
+    const int16_t expected16[5] = {32767, -32768, 32767, -32768, 16384};
+    const uint8_t expected8[5] = {255, 0, 255, 0, 192};
+    const int32_t expected24[5] = {S24_MAX, S24_MIN, S24_MAX, S24_MIN, 4194304};
+    unsigned i;
+    for (i = 0; i < 5; ++i) {
+        ASSERT_EQ(expected16[i], s16[i]) << i;
+        ASSERT_EQ(expected8[i], u8[i]) << i;
+        ASSERT_EQ(expected24[i], GetS24(&s24[i * 3])) << i;
+    }
+}
+
+/* Triangular dither when narrowing stays within 1 LSB, is unbiased, and is the same for the same
+ * seed; without dither, a fraction of an LSB rounds to nearest
+ */
+TEST(TestPcm, testDither) {
+    const unsigned samples = 4099;
+    static int16_t s16[samples];
+    static uint8_t u8[samples], again[samples];
+    unsigned i;
+    // a quarter of an 8-bit LSB
+    for (i = 0; i < samples; ++i) {
+        s16[i] = 64;
+    }
+    slesutPcmConvert(u8, SLESUT_PCM_U8, s16, SLESUT_PCM_S16, samples, SLESUT_DITHER_NONE, NULL);
+    for (i = 0; i < samples; ++i) {
+        ASSERT_EQ(128, u8[i]) << i;
+    }
+    slesutDitherState state;
+    slesutDitherInit(&state, 1234);
+    slesutPcmConvert(u8, SLESUT_PCM_U8, s16, SLESUT_PCM_S16, samples, SLESUT_DITHER_TRIANGULAR,
+            &state);
+    double sum = 0.0;
+    for (i = 0; i < samples; ++i) {
+        ASSERT_LE(127, u8[i]) << i;
+        ASSERT_GE(129, u8[i]) << i;
+        sum += u8[i] - 128;
+    }
+    ASSERT_NEAR(0.25, sum / samples, 0.05);
+    slesutDitherInit(&state, 1234);
+    slesutPcmConvert(again, SLESUT_PCM_U8, s16, SLESUT_PCM_S16, samples,
+            SLESUT_DITHER_TRIANGULAR, &state);
+    ASSERT_EQ(0, memcmp(u8, again, samples));
+}
+
+/* Silence is zero, mid-scale for unsigned 8-bit, and either zero for float; a single sample
+ * which is not, even in the tail of the buffer, is found
+ */
+TEST(TestPcm, testIsSilent) {
+    const unsigned samples = 13;
+    uint8_t u8[samples];
+    memset(u8, 0x80, sizeof(u8));
+    ASSERT_TRUE(slesutPcmIsSilent(u8, SLESUT_PCM_U8, samples));
+    u8[samples - 1] = 0x81;
+    ASSERT_FALSE(slesutPcmIsSilent(u8, SLESUT_PCM_U8, samples));
+    // the byte after the buffer is not looked at
+    ASSERT_TRUE(slesutPcmIsSilent(u8, SLESUT_PCM_U8, samples - 1));
+    memset(u8, 0, sizeof(u8));
+    ASSERT_FALSE(slesutPcmIsSilent(u8, SLESUT_PCM_U8, samples));
+
+    uint8_t s24[samples * 3];
+    memset(s24, 0, sizeof(s24));
+    ASSERT_TRUE(slesutPcmIsSilent(s24, SLESUT_PCM_S24_PACKED, samples));
+    s24[samples * 3 - 3] = 1;
+    ASSERT_FALSE(slesutPcmIsSilent(s24, SLESUT_PCM_S24_PACKED, samples));
+
+    float f[samples];
+    unsigned i;
+    for (i = 0; i < samples; ++i) {
+        f[i] = i & 1 ? -0.0f : 0.0f;
+    }
+    ASSERT_TRUE(slesutPcmIsSilent(f, SLESUT_PCM_FLOAT, samples));
+    f[samples - 1] = 1e-30f;
+    ASSERT_FALSE(slesutPcmIsSilent(f, SLESUT_PCM_FLOAT, samples));
+}
+
+/* The container size of a PCM format selects the sample format, and 8 bits are unsigned */
+TEST(TestPcm, testFormatOf) {
+    SLDataFormat_PCM pcm = {SL_DATAFORMAT_PCM, 2, SL_SAMPLINGRATE_44_1, 0, 0,
+            SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT, SL_BYTEORDER_LITTLEENDIAN};
+    const struct {
+        SLuint32 containerSize;
+        slesutPcmFormat format;
+    } sizes[] = {
+        {8, SLESUT_PCM_U8},
+        {16, SLESUT_PCM_S16},
+        {24, SLESUT_PCM_S24_PACKED},
+        {32, SLESUT_PCM_S32},
+        {12, SLESUT_PCM_INVALID}
+    };
+    unsigned i;
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        pcm.bitsPerSample = pcm.containerSize = sizes[i].containerSize;
+        ASSERT_EQ(sizes[i].format, slesutPcmFormatOf(&pcm)) << sizes[i].containerSize;
+    }
+    SLAndroidDataFormat_PCM_EX pcmEx = {SL_ANDROID_DATAFORMAT_PCM_EX, 2, SL_SAMPLINGRATE_44_1,
+            32, 32, SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT, SL_BYTEORDER_LITTLEENDIAN,
+            SL_ANDROID_PCM_REPRESENTATION_FLOAT};
+    ASSERT_EQ(SLESUT_PCM_FLOAT, slesutPcmFormatOf((const SLDataFormat_PCM *) &pcmEx));
+    ASSERT_EQ(4u, slesutPcmSampleSize(SLESUT_PCM_FLOAT));
+    ASSERT_EQ(3u, slesutPcmSampleSize(SLESUT_PCM_S24_PACKED));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
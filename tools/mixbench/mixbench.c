@@ -0,0 +1,721 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** Mixbench is a host tool to benchmark the track mixer kernels.
+ *  For each operation (copy with gain, add with gain, plain add) it reports
+ *  the number of stereo frames per second processed by the original
+ *  scalar loops from IOutputMixExt_FillBuffer, and by each kernel set
+ *  supported by the host CPU.  It also reports the wide bus operations
+ *  (load, accumulate, and the final clamp to 16 bits), the FIR kernel of the sinc resampler,
+ *  the biquad cascade of the equalizer, the feedback delay network of the reverb, the peak
+ *  meter of the bass boost, the crossfeed of the virtualizer, the FFT of the visualizer, the
+ *  correlation of the time stretch, and the resampler, reverb and time stretch themselves, which
+ *  have no counterpart in the original loops.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mixer.h"
+#include "resampler.h"
+#include "reverb.h"
+#include "stretch.h"
+
+
+/** Global variables */
+
+// command line options
+static unsigned framesPerBuffer = 256;
+static double secondsPerTest = 1.0;
+
+static const float gainLeft = 0.7f;
+static const float gainRight = 0.3f;
+
+// taps of the FIR kernel, as used by the sinc resampler when upsampling
+#define FILTER_TAPS 32
+static const float fraction = 0.375f;
+
+// channels of the source of the downmix kernel when it is timed, as for 5.1
+#define DOWNMIX_CHANNELS 6
+
+// low pass sections with a double pole at 0.5 and unity gain at DC, so that filtering the bus in
+// place over and over keeps it bounded
+static const MixBiquadCoefs biquadCoefs = {
+    {0.0625f, 0.0625f, 0.0625f, 0.0625f},
+    {0.125f, 0.125f, 0.125f, 0.125f},
+    {0.0625f, 0.0625f, 0.0625f, 0.0625f},
+    {-1.0f, -1.0f, -1.0f, -1.0f},
+    {0.25f, 0.25f, 0.25f, 0.25f}
+};
+static float biquadState[MIX_BIQUAD_STATE];
+
+// a network which decays, as the feedback times the gain of the Hadamard transform is below 1,
+// so that running it over and over on its own lines keeps them bounded
+static const MixFdnCoefs fdnCoefs = {
+    {0.2f, 0.3f, 0.2f, 0.3f, 0.2f, 0.3f, 0.2f, 0.3f},
+    {0.3f, 0.3f, 0.3f, 0.3f, 0.3f, 0.3f, 0.3f, 0.3f},
+    {0.35f, 0.35f, 0.35f, -0.35f, 0.35f, 0.35f, -0.35f, 0.35f},
+    {0.25f, 0.0f, 0.25f, 0.0f, 0.25f, 0.0f, 0.25f, 0.0f},
+    {0.0f, 0.25f, 0.0f, 0.25f, 0.0f, 0.25f, 0.0f, 0.25f}
+};
+static float fdnState[MIX_FDN_LINES];
+static float *fdnLines;     // MIX_FDN_LINES lines of framesPerBuffer frames
+static float *fdnOut;       // framesPerBuffer frames of stereo
+
+// a crossfeed which is a decaying echo of the other channel, as for the virtualizer
+static MixCrossfeedCoefs crossfeedCoefs;
+
+// points of each FFT, no more than the smallest buffer; the twiddles of the pass with half
+// butterflies are at index half - 1, as in the visualizer
+#define FFT_POINTS 64
+static float twiddleRe[FFT_POINTS - 1], twiddleIm[FFT_POINTS - 1];
+static float fftRe[FFT_POINTS], fftIm[FFT_POINTS];
+
+/** Run the complex FFT of FFT_POINTS points from re and im, in bit reversed order, in place */
+
+static void fft(const MixKernels *kernels, float *re, float *im)
+{
+    unsigned half;
+    for (half = 1; half < FFT_POINTS; half *= 2) {
+        (*kernels->mButterflies)(re, im, FFT_POINTS, half, &twiddleRe[half - 1],
+            &twiddleIm[half - 1]);
+    }
+}
+
+// a batch of 3D voices, one per frame of the buffer, scattered around a listener which is off
+// the origin and turned, so that every branch of the spatialize kernels is taken
+static float *spatialVoices;    // MIX_VOICE_ROWS rows of framesPerBuffer voices
+static const MixListener spatialListener = {
+    {1.0f, 0.5f, -2.0f},
+    {3.0f, 0.0f, -1.0f},
+    {0.6f, 0.0f, -0.8f},
+    {0.8f, 0.0f, 0.6f},
+    1.0f
+};
+
+/** Fill the input rows of the batch of 3D voices */
+
+static void spatial_init(void)
+{
+    unsigned i;
+    for (i = 0; i < framesPerBuffer; ++i) {
+        float *voice = &spatialVoices[i];
+        unsigned stride = framesPerBuffer;
+        float angle = i * 0.7f;
+        voice[MIX_VOICE_X * stride] = 8.0f * cosf(angle) * (i % 5) / 4.0f;
+        voice[MIX_VOICE_Y * stride] = (float) (i % 3) - 1.0f;
+        voice[MIX_VOICE_Z * stride] = 8.0f * sinf(angle) * (i % 7) / 6.0f;
+        voice[MIX_VOICE_VX * stride] = 20.0f * sinf(angle * 3.0f);
+        voice[MIX_VOICE_VY * stride] = 0.0f;
+        voice[MIX_VOICE_VZ * stride] = 400.0f * cosf(angle * 5.0f);
+        voice[MIX_VOICE_FRONT_X * stride] = cosf(angle * 2.0f);
+        voice[MIX_VOICE_FRONT_Y * stride] = 0.0f;
+        voice[MIX_VOICE_FRONT_Z * stride] = sinf(angle * 2.0f);
+        voice[MIX_VOICE_RELATIVE * stride] = (float) (i % 4 == 0);
+        voice[MIX_VOICE_MIN_DISTANCE * stride] = 1.0f + (i % 3) * 0.5f;
+        voice[MIX_VOICE_MAX_DISTANCE * stride] = 6.0f + (i % 5);
+        voice[MIX_VOICE_ROLLOFF * stride] = 0.5f + (i % 4) * 0.5f;
+        voice[MIX_VOICE_LINEAR * stride] = (float) (i % 2);
+        voice[MIX_VOICE_MUTE * stride] = (float) (i % 3 == 0);
+        voice[MIX_VOICE_CONE_INNER * stride] = 0.5f;
+        voice[MIX_VOICE_CONE_OUTER * stride] = (i % 6 == 0) ? 0.5f : -0.2f;
+        voice[MIX_VOICE_CONE_LEVEL * stride] = 0.25f;
+        voice[MIX_VOICE_DOPPLER * stride] = (float) (i % 4) * 0.5f;
+    }
+}
+
+
+// The original loops, reproduced here as the baseline; note that they wrap on overflow
+
+typedef struct {
+    short left;
+    short right;
+} stereo;
+
+static void legacy_copy_gain(short *dst, const short *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    stereo *mixBuffer = (stereo *) dst;
+    const stereo *source = (const stereo *) src;
+    for ( ; frames > 0; --frames, ++mixBuffer, ++source) {
+        mixBuffer->left = (short) (source->left * gainLeft);
+        mixBuffer->right = (short) (source->right * gainRight);
+    }
+}
+
+static void legacy_add_gain(short *dst, const short *src, unsigned frames,
+    float gainLeft, float gainRight)
+{
+    stereo *mixBuffer = (stereo *) dst;
+    const stereo *source = (const stereo *) src;
+    for ( ; frames > 0; --frames, ++mixBuffer, ++source) {
+        mixBuffer->left += (short) (source->left * gainLeft);
+        mixBuffer->right += (short) (source->right * gainRight);
+    }
+}
+
+static void legacy_add(short *dst, const short *src, unsigned frames)
+{
+    stereo *mixBuffer = (stereo *) dst;
+    const stereo *source = (const stereo *) src;
+    for ( ; frames > 0; --frames, ++mixBuffer, ++source) {
+        mixBuffer->left += source->left;
+        mixBuffer->right += source->right;
+    }
+}
+
+static const MixKernels MixKernels_legacy = {
+    "legacy",
+    legacy_copy_gain,
+    legacy_add_gain,
+    legacy_add,
+    // the original loops had none of the later kernels, so only the first three ops are measured
+    NULL,    // mLoad
+    NULL,    // mAccumulate
+    NULL,    // mClamp
+    NULL,    // mLoadFloat
+    NULL,    // mAccumulateFloat
+    NULL,    // mFilter
+    NULL,    // mDownmix
+    NULL,    // mDownmixFloat
+    NULL,    // mBiquads
+    NULL,    // mFdn
+    NULL,    // mPeak
+    NULL,    // mCrossfeed
+    NULL,    // mButterflies
+    NULL,    // mSpatialize
+    NULL     // mCorrelate
+};
+
+
+/** Return the current monotonic time in seconds */
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/** Fill a buffer with pseudo-random full-scale samples, so that the adds do overflow */
+
+static void randomize(short *buffer, unsigned samples)
+{
+    for ( ; samples > 0; --samples) {
+        *buffer++ = (short) (rand() & 0xFFFF);
+    }
+}
+
+
+/** Check that a kernel set produces exactly the same output as the scalar kernels */
+
+static int verify(const MixKernels *kernels, const short *src, const short *dst0,
+    const float *bus0, const short *multi, const float *multiFloat, const float *matrices)
+{
+    // use an odd frame count so that the scalar tail of each vector kernel is exercised too
+    unsigned frames = framesPerBuffer - 1;
+    size_t size = framesPerBuffer * 2 * sizeof(short);
+    short *expected = (short *) malloc(size);
+    short *actual = (short *) malloc(size);
+    assert(NULL != expected && NULL != actual);
+    int ok = 1;
+
+    memcpy(expected, dst0, size);
+    memcpy(actual, dst0, size);
+    (*MixKernels_scalar.mCopyGain)(expected, src, frames, gainLeft, gainRight);
+    (*kernels->mCopyGain)(actual, src, frames, gainLeft, gainRight);
+    ok = ok && !memcmp(expected, actual, size);
+
+    memcpy(expected, dst0, size);
+    memcpy(actual, dst0, size);
+    (*MixKernels_scalar.mAddGain)(expected, src, frames, gainLeft, gainRight);
+    (*kernels->mAddGain)(actual, src, frames, gainLeft, gainRight);
+    ok = ok && !memcmp(expected, actual, size);
+
+    memcpy(expected, dst0, size);
+    memcpy(actual, dst0, size);
+    (*MixKernels_scalar.mAdd)(expected, src, frames);
+    (*kernels->mAdd)(actual, src, frames);
+    ok = ok && !memcmp(expected, actual, size);
+
+    size_t busSize = framesPerBuffer * 2 * sizeof(float);
+    float *expectedBus = (float *) malloc(busSize);
+    float *actualBus = (float *) malloc(busSize);
+    assert(NULL != expectedBus && NULL != actualBus);
+
+    memcpy(expectedBus, bus0, busSize);
+    memcpy(actualBus, bus0, busSize);
+    (*MixKernels_scalar.mLoad)(expectedBus, src, frames, gainLeft, gainRight);
+    (*kernels->mLoad)(actualBus, src, frames, gainLeft, gainRight);
+    ok = ok && !memcmp(expectedBus, actualBus, busSize);
+
+    memcpy(expectedBus, bus0, busSize);
+    memcpy(actualBus, bus0, busSize);
+    (*MixKernels_scalar.mAccumulate)(expectedBus, src, frames, gainLeft, gainRight);
+    (*kernels->mAccumulate)(actualBus, src, frames, gainLeft, gainRight);
+    ok = ok && !memcmp(expectedBus, actualBus, busSize);
+
+    memcpy(expected, dst0, size);
+    memcpy(actual, dst0, size);
+    (*MixKernels_scalar.mClamp)(expected, bus0, frames);
+    (*kernels->mClamp)(actual, bus0, frames);
+    ok = ok && !memcmp(expected, actual, size);
+
+    memcpy(expectedBus, bus0, busSize);
+    memcpy(actualBus, bus0, busSize);
+    (*MixKernels_scalar.mLoadFloat)(expectedBus, bus0, frames, gainLeft, gainRight);
+    (*kernels->mLoadFloat)(actualBus, bus0, frames, gainLeft, gainRight);
+    ok = ok && !memcmp(expectedBus, actualBus, busSize);
+
+    memcpy(expectedBus, bus0, busSize);
+    memcpy(actualBus, bus0, busSize);
+    (*MixKernels_scalar.mAccumulateFloat)(expectedBus, bus0 + 2, frames, gainLeft, gainRight);
+    (*kernels->mAccumulateFloat)(actualBus, bus0 + 2, frames, gainLeft, gainRight);
+    ok = ok && !memcmp(expectedBus, actualBus, busSize);
+
+    // use the bus as both the deinterleaved history and the coefficients
+    float expectedOut[2], actualOut[2];
+    (*MixKernels_scalar.mFilter)(expectedOut, bus0, bus0 + FILTER_TAPS, bus0 + 2 * FILTER_TAPS,
+        bus0 + 3 * FILTER_TAPS, fraction, FILTER_TAPS);
+    (*kernels->mFilter)(actualOut, bus0, bus0 + FILTER_TAPS, bus0 + 2 * FILTER_TAPS,
+        bus0 + 3 * FILTER_TAPS, fraction, FILTER_TAPS);
+    ok = ok && fabsf(expectedOut[0] - actualOut[0]) < 1e-4f &&
+        fabsf(expectedOut[1] - actualOut[1]) < 1e-4f;
+
+    // the downmix kernels also sum in a different order, so they are checked within a tolerance
+    static const unsigned channelCounts[] = {1, 4, 6, 8};
+    unsigned c;
+    for (c = 0; c < sizeof(channelCounts) / sizeof(channelCounts[0]); ++c) {
+        unsigned channels = channelCounts[c];
+        const float *matrix = &matrices[channels * 2 * MIX_MAX_CHANNELS];
+        (*MixKernels_scalar.mDownmix)(expectedBus, multi, frames, channels, matrix);
+        (*kernels->mDownmix)(actualBus, multi, frames, channels, matrix);
+        unsigned i;
+        for (i = 0; i < frames * 2; ++i) {
+            ok = ok && fabsf(expectedBus[i] - actualBus[i]) < 1e-5f;
+        }
+        // but the float downmix kernels sum in the same order, so they are exact
+        (*MixKernels_scalar.mDownmixFloat)(expectedBus, multiFloat, frames, channels, matrix);
+        (*kernels->mDownmixFloat)(actualBus, multiFloat, frames, channels, matrix);
+        ok = ok && !memcmp(expectedBus, actualBus, frames * 2 * sizeof(float));
+    }
+
+    // the biquad kernels filter in the same order, but the compiler might fuse the scalar
+    // multiplies and adds, so they are checked within a tolerance
+    float expectedState[MIX_BIQUAD_STATE], actualState[MIX_BIQUAD_STATE];
+    memset(expectedState, 0, sizeof(expectedState));
+    memset(actualState, 0, sizeof(actualState));
+    memcpy(expectedBus, bus0, busSize);
+    memcpy(actualBus, bus0, busSize);
+    (*MixKernels_scalar.mBiquads)(expectedBus, frames, &biquadCoefs, expectedState);
+    (*kernels->mBiquads)(actualBus, frames, &biquadCoefs, actualState);
+    for (c = 0; c < frames * 2; ++c) {
+        ok = ok && fabsf(expectedBus[c] - actualBus[c]) < 1e-4f;
+    }
+
+    // the network kernels also sum in a different order, so they are checked within a tolerance
+    size_t linesSize = MIX_FDN_LINES * frames * sizeof(float);
+    float *expectedLines = (float *) malloc(linesSize);
+    float *actualLines = (float *) malloc(linesSize);
+    assert(NULL != expectedLines && NULL != actualLines);
+    for (c = 0; c < MIX_FDN_LINES * frames; ++c) {
+        expectedLines[c] = bus0[c % (frames * 2)];
+    }
+    memcpy(actualLines, expectedLines, linesSize);
+    float expectedFdnState[MIX_FDN_LINES], actualFdnState[MIX_FDN_LINES];
+    for (c = 0; c < MIX_FDN_LINES; ++c) {
+        expectedFdnState[c] = actualFdnState[c] = bus0[c];
+    }
+    (*MixKernels_scalar.mFdn)(expectedBus, expectedLines, bus0, frames, &fdnCoefs,
+        expectedFdnState);
+    (*kernels->mFdn)(actualBus, actualLines, bus0, frames, &fdnCoefs, actualFdnState);
+    for (c = 0; c < frames * 2; ++c) {
+        ok = ok && fabsf(expectedBus[c] - actualBus[c]) < 1e-4f;
+    }
+    for (c = 0; c < MIX_FDN_LINES * frames; ++c) {
+        ok = ok && fabsf(expectedLines[c] - actualLines[c]) < 1e-4f;
+    }
+    for (c = 0; c < MIX_FDN_LINES; ++c) {
+        ok = ok && fabsf(expectedFdnState[c] - actualFdnState[c]) < 1e-4f;
+    }
+    free(expectedLines);
+    free(actualLines);
+
+    ok = ok && (*MixKernels_scalar.mPeak)(bus0, frames) == (*kernels->mPeak)(bus0, frames);
+
+    // the crossfeed kernels sum in a different order too; the bus is each channel and its history
+    const float *left = bus0 + MIX_CROSSFEED_TAPS - 1, *right = bus0 + MIX_CROSSFEED_TAPS;
+    (*MixKernels_scalar.mCrossfeed)(expectedBus, left, right, frames, &crossfeedCoefs);
+    (*kernels->mCrossfeed)(actualBus, left, right, frames, &crossfeedCoefs);
+    for (c = 0; c < frames * 2; ++c) {
+        ok = ok && fabsf(expectedBus[c] - actualBus[c]) < 1e-4f;
+    }
+
+    // the butterflies are the same in each kernel set, but are checked within a tolerance as for
+    // the biquads; the bus is the real and imaginary parts
+    memcpy(expectedBus, bus0, 2 * FFT_POINTS * sizeof(float));
+    memcpy(actualBus, bus0, 2 * FFT_POINTS * sizeof(float));
+    fft(&MixKernels_scalar, expectedBus, expectedBus + FFT_POINTS);
+    fft(kernels, actualBus, actualBus + FFT_POINTS);
+    for (c = 0; c < 2 * FFT_POINTS; ++c) {
+        ok = ok && fabsf(expectedBus[c] - actualBus[c]) < 1e-3f;
+    }
+
+    // the vector spatialize kernels approximate the power of the exponential rolloff, so are
+    // checked within a tolerance; the batch isn't a multiple of the vector width, for the tails
+    size_t voicesSize = MIX_VOICE_ROWS * framesPerBuffer * sizeof(float);
+    float *expectedVoices = (float *) malloc(voicesSize);
+    float *actualVoices = (float *) malloc(voicesSize);
+    assert(NULL != expectedVoices && NULL != actualVoices);
+    memcpy(expectedVoices, spatialVoices, voicesSize);
+    memcpy(actualVoices, spatialVoices, voicesSize);
+    unsigned count = framesPerBuffer - 1;
+    (*MixKernels_scalar.mSpatialize)(expectedVoices, framesPerBuffer, count, &spatialListener);
+    (*kernels->mSpatialize)(actualVoices, framesPerBuffer, count, &spatialListener);
+    for (c = MIX_VOICE_INPUTS * framesPerBuffer; c < MIX_VOICE_ROWS * framesPerBuffer; ++c) {
+        ok = ok && (c % framesPerBuffer >= count ||
+            fabsf(expectedVoices[c] - actualVoices[c]) < 1e-3f);
+    }
+    free(expectedVoices);
+    free(actualVoices);
+
+    // the correlation kernels sum in the same order, but are checked within a tolerance as for
+    // the biquads; the reference and signal are the bus, and the offsets aren't a multiple of the
+    // vector width, for the tails
+    unsigned offsets = frames + 3;
+    (*MixKernels_scalar.mCorrelate)(expectedBus, bus0, bus0, frames / 2, offsets);
+    (*kernels->mCorrelate)(actualBus, bus0, bus0, frames / 2, offsets);
+    for (c = 0; c < offsets; ++c) {
+        ok = ok && fabsf(expectedBus[c] - actualBus[c]) < 1e-3f;
+    }
+
+    free(expectedBus);
+    free(actualBus);
+    free(expected);
+    free(actual);
+    return ok;
+}
+
+
+/** Time one operation of one kernel set, and return frames per second */
+
+enum Operation {
+    OP_COPY_GAIN,
+    OP_ADD_GAIN,
+    OP_ADD,
+    OP_LOAD,
+    OP_ACCUMULATE,
+    OP_CLAMP,
+    OP_FILTER,
+    OP_DOWNMIX,
+    OP_BIQUADS,
+    OP_FDN,
+    OP_PEAK,
+    OP_CROSSFEED,
+    OP_FFT,
+    OP_SPATIALIZE,
+    OP_CORRELATE
+};
+
+static double measure(const MixKernels *kernels, enum Operation op, short *dst, const short *src,
+    float *bus, const short *multi, const float *matrix)
+{
+    unsigned long long frames = 0;
+    double start = now(), elapsed;
+    do {
+        unsigned i;
+        // amortize the clock reads
+        for (i = 0; i < 1000; ++i) {
+            switch (op) {
+            case OP_COPY_GAIN:
+                (*kernels->mCopyGain)(dst, src, framesPerBuffer, gainLeft, gainRight);
+                break;
+            case OP_ADD_GAIN:
+                (*kernels->mAddGain)(dst, src, framesPerBuffer, gainLeft, gainRight);
+                break;
+            case OP_ADD:
+                (*kernels->mAdd)(dst, src, framesPerBuffer);
+                break;
+            case OP_LOAD:
+                (*kernels->mLoad)(bus, src, framesPerBuffer, gainLeft, gainRight);
+                break;
+            case OP_ACCUMULATE:
+                (*kernels->mAccumulate)(bus, src, framesPerBuffer, gainLeft, gainRight);
+                break;
+            case OP_CLAMP:
+                (*kernels->mClamp)(dst, bus, framesPerBuffer);
+                break;
+            case OP_FILTER:
+                {
+                // one output frame per frame of the buffer, using the bus as the history
+                // and the coefficients
+                float out[2], sum = 0.0f;
+                unsigned j;
+                for (j = 0; j < framesPerBuffer; ++j) {
+                    (*kernels->mFilter)(out, bus, bus + FILTER_TAPS, bus + 2 * FILTER_TAPS,
+                        bus + 3 * FILTER_TAPS, fraction, FILTER_TAPS);
+                    sum += out[0];
+                }
+                // so the calls can't be optimized away
+                bus[4 * FILTER_TAPS - 1] = sum;
+                }
+                break;
+            case OP_DOWNMIX:
+                (*kernels->mDownmix)(bus, multi, framesPerBuffer, DOWNMIX_CHANNELS, matrix);
+                break;
+            case OP_BIQUADS:
+                (*kernels->mBiquads)(bus, framesPerBuffer, &biquadCoefs, biquadState);
+                break;
+            case OP_FDN:
+                (*kernels->mFdn)(fdnOut, fdnLines, bus, framesPerBuffer, &fdnCoefs, fdnState);
+                break;
+            case OP_PEAK:
+                // so the calls can't be optimized away
+                fdnOut[0] += (*kernels->mPeak)(bus, framesPerBuffer);
+                break;
+            case OP_CROSSFEED:
+                (*kernels->mCrossfeed)(fdnOut, bus + MIX_CROSSFEED_TAPS - 1,
+                    bus + MIX_CROSSFEED_TAPS, framesPerBuffer, &crossfeedCoefs);
+                break;
+            case OP_FFT:
+                {
+                // a transform of each FFT_POINTS frames of the buffer, from its left channel
+                unsigned j;
+                for (j = 0; j + FFT_POINTS <= framesPerBuffer; j += FFT_POINTS) {
+                    memcpy(fftRe, &bus[j], sizeof(fftRe));
+                    memset(fftIm, 0, sizeof(fftIm));
+                    fft(kernels, fftRe, fftIm);
+                    fdnOut[0] += fftRe[1];
+                }
+                }
+                break;
+            case OP_SPATIALIZE:
+                // a frame is a voice
+                (*kernels->mSpatialize)(spatialVoices, framesPerBuffer, framesPerBuffer,
+                    &spatialListener);
+                break;
+            case OP_CORRELATE:
+                // a frame is an offset, and the template and signal are the bus and its tail
+                (*kernels->mCorrelate)(fdnOut, bus + framesPerBuffer, bus, framesPerBuffer,
+                    framesPerBuffer);
+                break;
+            }
+        }
+        frames += 1000ULL * framesPerBuffer;
+        elapsed = now() - start;
+    } while (elapsed < secondsPerTest);
+    return frames / elapsed;
+}
+
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        framesPerBuffer = atoi(argv[1]);
+        // the filter needs the bus to hold the history and coefficients
+        if (framesPerBuffer < 2 * FILTER_TAPS) {
+            fprintf(stderr, "usage: %s [frames-per-buffer [seconds-per-test]]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (argc > 2) {
+        secondsPerTest = atof(argv[2]);
+    }
+
+    size_t size = framesPerBuffer * 2 * sizeof(short);
+    short *src = (short *) malloc(size);
+    short *dst = (short *) malloc(size);
+    short *dst0 = (short *) malloc(size);
+    size_t busSize = framesPerBuffer * 2 * sizeof(float);
+    float *bus = (float *) malloc(busSize);
+    float *bus0 = (float *) malloc(busSize);
+    assert(NULL != src && NULL != dst && NULL != dst0 && NULL != bus && NULL != bus0);
+    randomize(src, framesPerBuffer * 2);
+    randomize(dst0, framesPerBuffer * 2);
+    // a bus with about 2x headroom in use, so that the clamp is exercised
+    unsigned i;
+    for (i = 0; i < framesPerBuffer * 2; ++i) {
+        bus0[i] = dst0[i] / 16384.0f;
+    }
+    // a source with the maximum number of channels, and a downmix matrix for each channel count
+    // with coefficients for the channels that are present only
+    short *multi = (short *) malloc(framesPerBuffer * MIX_MAX_CHANNELS * sizeof(short));
+    float *multiFloat = (float *) malloc(framesPerBuffer * MIX_MAX_CHANNELS * sizeof(float));
+    float *matrices = (float *) calloc((MIX_MAX_CHANNELS + 1) * 2 * MIX_MAX_CHANNELS,
+        sizeof(float));
+    assert(NULL != multi && NULL != multiFloat && NULL != matrices);
+    randomize(multi, framesPerBuffer * MIX_MAX_CHANNELS);
+    for (i = 0; i < framesPerBuffer * MIX_MAX_CHANNELS; ++i) {
+        multiFloat[i] = multi[i] / 32768.0f;
+    }
+    unsigned channels;
+    for (channels = 1; channels <= MIX_MAX_CHANNELS; ++channels) {
+        float *matrix = &matrices[channels * 2 * MIX_MAX_CHANNELS];
+        unsigned j;
+        for (j = 0; j < channels; ++j) {
+            matrix[j] = 1.0f / (j + 1);
+            matrix[MIX_MAX_CHANNELS + j] = 1.0f / (channels - j);
+        }
+    }
+    const float *downmixMatrix = &matrices[DOWNMIX_CHANNELS * 2 * MIX_MAX_CHANNELS];
+    fdnLines = (float *) calloc(MIX_FDN_LINES * framesPerBuffer, sizeof(float));
+    fdnOut = (float *) malloc(busSize);
+    assert(NULL != fdnLines && NULL != fdnOut);
+    crossfeedCoefs.mDirect = 0.7f;
+    for (i = 0; i < MIX_CROSSFEED_TAPS; ++i) {
+        crossfeedCoefs.mCross[i] = 0.3f / (i + 1);
+    }
+    unsigned half;
+    for (half = 1; half < FFT_POINTS; half *= 2) {
+        for (i = 0; i < half; ++i) {
+            twiddleRe[half - 1 + i] = (float) cos(-M_PI * i / half);
+            twiddleIm[half - 1 + i] = (float) sin(-M_PI * i / half);
+        }
+    }
+    spatialVoices = (float *) calloc(MIX_VOICE_ROWS * framesPerBuffer, sizeof(float));
+    assert(NULL != spatialVoices);
+    spatial_init();
+
+    const MixKernels *all[] = {
+        &MixKernels_legacy,
+        &MixKernels_scalar,
+#if defined(__i386__) || defined(__x86_64__)
+        &MixKernels_sse2,
+        &MixKernels_avx2,
+#endif
+    };
+    static const char * const opNames[] = {"copy*gain", "add*gain", "add",
+        "load", "accumulate", "clamp", "filter", "downmix", "biquads", "fdn", "peak",
+        "crossfeed", "fft", "3d", "correlate"};
+
+    printf("frames per buffer: %u, selected kernels: %s\n", framesPerBuffer,
+        MixKernels_get()->mName);
+    printf("%-8s", "kernels");
+    enum Operation op;
+    for (op = OP_COPY_GAIN; op <= OP_CORRELATE; ++op) {
+        printf(" %12s", opNames[op]);
+    }
+    printf("   (M frames/s)\n");
+    int status = EXIT_SUCCESS;
+    unsigned k;
+    for (k = 0; k < sizeof(all) / sizeof(all[0]); ++k) {
+        const MixKernels *kernels = all[k];
+        if (&MixKernels_legacy != kernels) {
+            if (!MixKernels_isSupported(kernels)) {
+                printf("%-8s %12s\n", kernels->mName, "unsupported");
+                continue;
+            }
+            if (!verify(kernels, src, dst0, bus0, multi, multiFloat, matrices)) {
+                printf("%-8s %12s\n", kernels->mName, "MISMATCH");
+                status = EXIT_FAILURE;
+                continue;
+            }
+        }
+        printf("%-8s", kernels->mName);
+        for (op = OP_COPY_GAIN; op <= OP_CORRELATE; ++op) {
+            if (NULL == kernels->mLoad && op >= OP_LOAD) {
+                printf(" %12s", "-");
+                continue;
+            }
+            memcpy(dst, dst0, size);
+            memcpy(bus, bus0, busSize);
+            printf(" %12.1f", measure(kernels, op, dst, src, bus, multi, downmixMatrix) / 1e6);
+        }
+        printf("\n");
+    }
+
+    // the resampler uses the fastest supported kernels
+    static const char * const qualityNames[] = {"linear", "cubic", "sinc"};
+    float *out = (float *) malloc(busSize);
+    assert(NULL != out);
+    printf("resample 48000 to 44100 (M output frames/s):");
+    ResamplerQuality quality;
+    for (quality = RESAMPLER_LINEAR; quality <= RESAMPLER_SINC; ++quality) {
+        Resampler *resampler = Resampler_create(48000, 44100, quality);
+        assert(NULL != resampler);
+        unsigned long long outFrames = 0;
+        double start = now(), elapsed;
+        do {
+            for (i = 0; i < 1000; ++i) {
+                unsigned used;
+                outFrames += Resampler_process(resampler, out, framesPerBuffer, bus0,
+                    framesPerBuffer, &used);
+            }
+            elapsed = now() - start;
+        } while (elapsed < secondsPerTest);
+        Resampler_destroy(resampler);
+        printf(" %s %.1f", qualityNames[quality], outFrames / elapsed / 1e6);
+    }
+    printf("\n");
+
+    // and so does the reverb, as for a large hall, with the input at full scale throughout
+    static const ReverbProperties hall = {
+        -1000, -600, 1800, 700, -2000, 20, -1400, 40, 1000, 1000
+    };
+    ReverbParams params;
+    Reverb_design(&params, &hall, 1, 44100);
+    Reverb *reverb = Reverb_create(44100);
+    assert(NULL != reverb);
+    Reverb_setParams(reverb, &params);
+    unsigned long long reverbFrames = 0;
+    double start = now(), elapsed;
+    do {
+        for (i = 0; i < 1000; ++i) {
+            Reverb_process(reverb, out, 0, bus0, framesPerBuffer);
+        }
+        reverbFrames += 1000ULL * framesPerBuffer;
+        elapsed = now() - start;
+    } while (elapsed < secondsPerTest);
+    Reverb_destroy(reverb);
+    printf("reverb (M frames/s): %.1f\n", reverbFrames / elapsed / 1e6);
+
+    // and so does the time stretch, at a tempo which needs a search for every segment
+    Stretch *stretch = Stretch_create(44100);
+    assert(NULL != stretch);
+    Stretch_setTempo(stretch, 1.25f);
+    unsigned long long stretchFrames = 0;
+    start = now();
+    do {
+        for (i = 0; i < 1000; ++i) {
+            unsigned used, count = Stretch_inputFrames(stretch, framesPerBuffer);
+            if (count > framesPerBuffer) {
+                count = framesPerBuffer;
+            }
+            stretchFrames += Stretch_process(stretch, out, framesPerBuffer, bus0, count, &used);
+        }
+        elapsed = now() - start;
+    } while (elapsed < secondsPerTest);
+    Stretch_destroy(stretch);
+    printf("stretch (M output frames/s): %.1f\n", stretchFrames / elapsed / 1e6);
+    free(out);
+
+    free(multi);
+    free(multiFloat);
+    free(matrices);
+    free(fdnLines);
+    free(fdnOut);
+    free(spatialVoices);
+    free(src);
+    free(dst);
+    free(dst0);
+    free(bus);
+    free(bus0);
+    return status;
+}